@@ -0,0 +1,17 @@
+#version 460 core
+
+layout (location = 0) in vec3 l_position;
+layout (location = 1) in vec2 l_texture_coord;
+
+out vec2 v_texture_coord;
+
+/**
+ * Fraction of the source texture along each axis to read, from its bottom left corner.
+ */
+uniform vec2 u_texture_coord_scale = vec2(1.0);
+
+void main()
+{
+    v_texture_coord = l_texture_coord * u_texture_coord_scale;
+    gl_Position = vec4(l_position, 1.0);
+}
\ No newline at end of file
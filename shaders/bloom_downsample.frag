@@ -0,0 +1,42 @@
+#version 460 core
+
+out vec4 o_color;
+
+in vec2 v_texture_coord;
+
+/**
+ * Level to downsample, twice the size of the level being rendered.
+ */
+uniform sampler2D u_texture_sampler;
+
+/**
+ * 13-tap downsample filter. The taps are five overlapping 2x2 boxes, one in the center
+ * and four around it, which keeps bright single pixels from flickering as they move, and
+ * covering the whole 4x4 footprint of the destination texel avoids aliasing.
+ */
+void main()
+{
+    const vec2 texel = 1.0 / textureSize(u_texture_sampler, 0);
+    const vec2 uv = v_texture_coord;
+
+    const vec3 a = texture(u_texture_sampler, uv + texel * vec2(-2.0,  2.0)).rgb;
+    const vec3 b = texture(u_texture_sampler, uv + texel * vec2( 0.0,  2.0)).rgb;
+    const vec3 c = texture(u_texture_sampler, uv + texel * vec2( 2.0,  2.0)).rgb;
+    const vec3 d = texture(u_texture_sampler, uv + texel * vec2(-2.0,  0.0)).rgb;
+    const vec3 e = texture(u_texture_sampler, uv).rgb;
+    const vec3 f = texture(u_texture_sampler, uv + texel * vec2( 2.0,  0.0)).rgb;
+    const vec3 g = texture(u_texture_sampler, uv + texel * vec2(-2.0, -2.0)).rgb;
+    const vec3 h = texture(u_texture_sampler, uv + texel * vec2( 0.0, -2.0)).rgb;
+    const vec3 i = texture(u_texture_sampler, uv + texel * vec2( 2.0, -2.0)).rgb;
+    const vec3 j = texture(u_texture_sampler, uv + texel * vec2(-1.0,  1.0)).rgb;
+    const vec3 k = texture(u_texture_sampler, uv + texel * vec2( 1.0,  1.0)).rgb;
+    const vec3 l = texture(u_texture_sampler, uv + texel * vec2(-1.0, -1.0)).rgb;
+    const vec3 m = texture(u_texture_sampler, uv + texel * vec2( 1.0, -1.0)).rgb;
+
+    vec3 result = e * 0.125;
+    result += (a + c + g + i) * 0.03125;
+    result += (b + d + f + h) * 0.0625;
+    result += (j + k + l + m) * 0.125;
+
+    o_color = vec4(result, 1.0);
+}
@@ -0,0 +1,36 @@
+#version 460 core
+
+out vec4 o_color;
+
+in vec2 v_texture_coord;
+
+/**
+ * Level to upsample, half the size of the level being rendered, which it is added to.
+ */
+uniform sampler2D u_texture_sampler;
+
+/**
+ * Radius of the filter in texels of the level being upsampled.
+ */
+const float filter_radius = 1.0;
+
+/**
+ * 3x3 tent upsample filter.
+ */
+void main()
+{
+    const vec2 offset = filter_radius / textureSize(u_texture_sampler, 0);
+    const vec2 uv = v_texture_coord;
+
+    vec3 result = texture(u_texture_sampler, uv).rgb * 4.0;
+    result += texture(u_texture_sampler, uv + vec2(   0.0,  offset.y)).rgb * 2.0;
+    result += texture(u_texture_sampler, uv + vec2(   0.0, -offset.y)).rgb * 2.0;
+    result += texture(u_texture_sampler, uv + vec2( offset.x,  0.0)).rgb * 2.0;
+    result += texture(u_texture_sampler, uv + vec2(-offset.x,  0.0)).rgb * 2.0;
+    result += texture(u_texture_sampler, uv + vec2( offset.x,  offset.y)).rgb;
+    result += texture(u_texture_sampler, uv + vec2(-offset.x,  offset.y)).rgb;
+    result += texture(u_texture_sampler, uv + vec2( offset.x, -offset.y)).rgb;
+    result += texture(u_texture_sampler, uv + vec2(-offset.x, -offset.y)).rgb;
+
+    o_color = vec4(result / 16.0, 1.0);
+}
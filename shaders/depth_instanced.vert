@@ -1,11 +1,11 @@
 #version 460 core
 
 layout (location = 0) in vec3 l_position;
+layout (location = 4) in mat4 l_model;
 
 uniform mat4 u_light_view_projection;
-uniform mat4 u_model;
 
 void main()
 {
-    gl_Position = u_light_view_projection * u_model * vec4(l_position, 1.0);
-}
\ No newline at end of file
+    gl_Position = u_light_view_projection * l_model * vec4(l_position, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 460 core
+
+#include "include/frame.glsl"
+
+layout (location = 0) in vec3 l_position;
+layout (location = 4) in mat4 l_model;
+
+/**
+ * The lit pass only shades fragments whose depth equals the depth written here, so the
+ * position must be computed exactly as in regular_object.vert.
+ */
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = u_projection * u_view * l_model * vec4(l_position, 1.0);
+}
@@ -0,0 +1,33 @@
+/**
+ * Maximum number of shadow cascades. Must match Renderer::max_shadow_cascades.
+ */
+#define MAX_SHADOW_CASCADES 4
+
+/**
+ * Per-frame camera state, filled once per frame by the renderer.
+ *
+ * Must match Renderer::FrameUniforms.
+ */
+layout(std140, binding = 0) uniform FrameData
+{
+    mat4 u_view;
+    mat4 u_projection;
+
+    /**
+     * World to light clip space of each shadow cascade.
+     */
+    mat4 u_light_view_projections[MAX_SHADOW_CASCADES];
+
+    /**
+     * View space depth at which each shadow cascade ends.
+     */
+    vec4 u_shadow_cascade_splits;
+
+    /**
+     * Depth bias of each shadow cascade, in the depth units of that cascade.
+     */
+    vec4 u_shadow_cascade_biases;
+
+    vec3 u_camera_position;
+    int u_num_shadow_cascades;
+};
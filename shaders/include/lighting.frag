@@ -1,32 +1,5 @@
-/**
- * A point light source.
- */
-struct PointLight
-{
-    /**
-     * Position of the light source in world coordinates.
-     */
-    vec3 position;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-/**
- * A light source assumed infinitely far away.
- */
-struct DirectionalLight
-{
-    /**
-     * Direction of the light.
-     */
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
+#include "include/frame.glsl"
+#include "include/lights.glsl"
 
 /**
  * Material properties of a surface.
@@ -40,30 +13,46 @@ struct Material
 };
 
 /**
- * Computes the shadow component for a fragment, averaging over a 3x3 grid
- * of adjacent texels.
+ * Computes the shadow component for a fragment from the shadow cascade covering it,
+ * averaging over a 3x3 grid of adjacent texels.
  *
- * @param shadow_map_sampler The shadow map sampler.
- * @param frag_pos_light_space The fragment position in light space.
+ * @param shadow_map_sampler The shadow map sampler, one layer per cascade.
+ * @param frag_pos The fragment position in world space.
  *
  * @return The shadow factor.
  */
-float compute_shadow_component(sampler2D shadow_map_sampler, vec4 frag_pos_light_space)
+float compute_shadow_component(sampler2DArray shadow_map_sampler, vec3 frag_pos)
 {
+    /*
+     * Fragments beyond the last cascade are never shadowed.
+     */
+    float view_depth = -(u_view * vec4(frag_pos, 1.0)).z;
+    if (view_depth > u_shadow_cascade_splits[u_num_shadow_cascades - 1])
+    {
+        return 0.0;
+    }
+
+    int cascade = 0;
+    while (view_depth > u_shadow_cascade_splits[cascade])
+    {
+        cascade++;
+    }
+
+    vec4 frag_pos_light_space = u_light_view_projections[cascade] * vec4(frag_pos, 1.0);
     vec3 proj_coords = frag_pos_light_space.xyz / frag_pos_light_space.w * 0.5 + 0.5;
-    float closest_depth = texture(shadow_map_sampler, proj_coords.xy).r;
     float current_depth = proj_coords.z;
 
-    const float bias = 0.005;
+    float bias = u_shadow_cascade_biases[cascade];
     float shadow = 0.0;
     if (proj_coords.z <= 1.0)
     {
-        vec2 texel_size = 1.0 / textureSize(shadow_map_sampler, 0);
+        vec2 texel_size = 1.0 / textureSize(shadow_map_sampler, 0).xy;
         for(int x = -1; x <= 1; ++x)
         {
             for(int y = -1; y <= 1; ++y)
             {
-                float pcf_depth = texture(shadow_map_sampler, proj_coords.xy + vec2(x, y) * texel_size).r; 
+                vec2 pcf_coords = proj_coords.xy + vec2(x, y) * texel_size;
+                float pcf_depth = texture(shadow_map_sampler, vec3(pcf_coords, cascade)).r;
                 shadow += current_depth - bias > pcf_depth ? 1.0 : 0.0;
             }
         }
@@ -78,9 +67,9 @@ float compute_shadow_component(sampler2D shadow_map_sampler, vec4 frag_pos_light
  *
  * @param light The directional light source.
  * @param material The material properties of the surface.
- * @param shadow_map_sampler The shadow map sampler.
+ * @param shadow_map_sampler The shadow map sampler, one layer per cascade.
  * @param normal The normal vector at the fragment.
- * @param frag_pos_light_space The fragment position in light space.
+ * @param frag_pos The fragment position in world space.
  * @param view_direction The view direction vector.
  *
  * @return The computed light component.
@@ -88,9 +77,9 @@ float compute_shadow_component(sampler2D shadow_map_sampler, vec4 frag_pos_light
 vec3 compute_directional_component(
     DirectionalLight light,
     Material material,
-    sampler2D shadow_map_sampler,
+    sampler2DArray shadow_map_sampler,
     vec3 normal,
-    vec4 frag_pos_light_space,
+    vec3 frag_pos,
     vec3 view_direction)
 {
     vec3 light_direction = -light.direction;
@@ -113,7 +102,7 @@ vec3 compute_directional_component(
     float shine = pow(max(dot(normal, halfway_direction), 0.0), material.shininess);
     vec3 specular_light = shine * light.specular * material.specular;
 
-    float shadow = compute_shadow_component(shadow_map_sampler, frag_pos_light_space);
+    float shadow = compute_shadow_component(shadow_map_sampler, frag_pos);
 
     return (ambient_light + (1.0 - shadow) * (diffuse_light + specular_light));
 }
@@ -156,13 +145,53 @@ vec3 compute_point_component(
     vec3 specular_light = shine * light.specular * material.specular;
 
     /*
-     * Compute attenuation.
+     * Compute attenuation, windowed so that it fades out to zero at the radius of the
+     * light, which is as far as the light is assigned to clusters.
      */
     float distance = length(light.position - frag_pos);
-    const float constant = 1.0;
-    const float linear = 0.007;
-    const float quadratic = 0.002;
-    float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+    float attenuation = 1.0 / (POINT_LIGHT_CONSTANT + POINT_LIGHT_LINEAR * distance +
+                               POINT_LIGHT_QUADRATIC * (distance * distance));
+    float falloff = distance / light.radius;
+    falloff *= falloff;
+    float window = clamp(1.0 - falloff * falloff, 0.0, 1.0);
+    attenuation *= window * window;
 
     return attenuation * (ambient_light + diffuse_light + specular_light);
 }
+
+/**
+ * Computes the component of light contributed by the point lights affecting the cluster
+ * of the fragment, so that the cost depends on the lights near the fragment rather than
+ * on all lights of the scene.
+ *
+ * @param material The material properties of the surface.
+ * @param normal The normal vector at the fragment.
+ * @param frag_pos The position of the fragment in world coordinates.
+ * @param view_direction The view direction vector.
+ *
+ * @return The computed light component.
+ */
+vec3 compute_point_lights_component(
+    Material material,
+    vec3 normal,
+    vec3 frag_pos,
+    vec3 view_direction)
+{
+    float view_depth = -(u_view * vec4(frag_pos, 1.0)).z;
+    uint cluster = get_cluster_index(gl_FragCoord.xy, view_depth);
+    uint first_light = cluster * MAX_LIGHTS_PER_CLUSTER;
+    uint num_lights = u_cluster_light_counts[cluster];
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0; i < num_lights; i++)
+    {
+        result += compute_point_component(
+            u_point_lights[u_cluster_light_indices[first_light + i]],
+            material,
+            normal,
+            frag_pos,
+            view_direction);
+    }
+
+    return result;
+}
@@ -0,0 +1,133 @@
+/**
+ * Size of the cluster grid the view frustum is divided into, in tiles across the screen
+ * and slices along the view depth. Must match the cluster constants in Renderer.cc.
+ */
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define NUM_CLUSTERS (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+
+/**
+ * Lights beyond this many in a cluster are left out of it.
+ */
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+/**
+ * Attenuation of point lights over distance. Must match Renderer.cc, which derives the
+ * radius of each light from it.
+ */
+#define POINT_LIGHT_CONSTANT 1.0
+#define POINT_LIGHT_LINEAR 0.007
+#define POINT_LIGHT_QUADRATIC 0.002
+
+/**
+ * A point light source.
+ *
+ * Must match Renderer::PointLightData.
+ */
+struct PointLight
+{
+    /**
+     * Position of the light source in world coordinates.
+     */
+    vec3 position;
+
+    /**
+     * Distance beyond which the light has no effect.
+     */
+    float radius;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+/**
+ * A light source assumed infinitely far away.
+ */
+struct DirectionalLight
+{
+    /**
+     * Direction of the light.
+     */
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+/**
+ * Lights shared by every lit shader, filled once per frame by the renderer.
+ *
+ * Must match Renderer::LightUniforms.
+ */
+layout(std140, binding = 1) uniform LightData
+{
+    DirectionalLight u_directional_light;
+
+    /**
+     * Cluster tiles per pixel along each screen axis.
+     */
+    vec2 u_cluster_tiles_per_pixel;
+
+    /**
+     * Scale and bias turning the log of a view depth into its cluster slice.
+     */
+    vec2 u_cluster_depth_scale_bias;
+
+    uint u_num_point_lights;
+};
+
+/**
+ * Point lights of the frame.
+ */
+layout(std430, binding = 6) readonly buffer PointLightBuffer
+{
+    PointLight u_point_lights[];
+};
+
+/**
+ * Lights affecting each cluster, filled by shaders/light_cluster.comp. The lights of a
+ * cluster are indices into u_point_lights, starting at MAX_LIGHTS_PER_CLUSTER times the
+ * index of the cluster.
+ */
+layout(std430, binding = 7) buffer ClusterBuffer
+{
+    uint u_cluster_light_counts[NUM_CLUSTERS];
+    uint u_cluster_light_indices[];
+};
+
+/**
+ * @brief Get the view depth a cluster slice starts at. Slice 0 starts at the camera.
+ *
+ * @param slice The cluster slice.
+ *
+ * @return The view depth.
+ */
+float get_cluster_slice_depth(uint slice)
+{
+    if (slice == 0)
+    {
+        return 0.0;
+    }
+    return exp((float(slice) - u_cluster_depth_scale_bias.y) / u_cluster_depth_scale_bias.x);
+}
+
+/**
+ * @brief Get the cluster a point on the screen falls in.
+ *
+ * @param frag_coord The window coordinates of the point, e.g. gl_FragCoord.xy.
+ * @param view_depth The view depth of the point.
+ *
+ * @return The index of the cluster.
+ */
+uint get_cluster_index(vec2 frag_coord, float view_depth)
+{
+    const uvec2 tile = min(uvec2(frag_coord * u_cluster_tiles_per_pixel),
+                           uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    const int slice = int(floor(log(max(view_depth, 1e-6)) * u_cluster_depth_scale_bias.x +
+                                u_cluster_depth_scale_bias.y));
+    const uint clamped_slice = uint(clamp(slice, 0, CLUSTER_GRID_Z - 1));
+    return tile.x + CLUSTER_GRID_X * (tile.y + CLUSTER_GRID_Y * clamped_slice);
+}
@@ -0,0 +1,23 @@
+/**
+ * A material, with its textures as bindless texture handles. The handles are zero when
+ * bindless textures are not supported, in which case the textures are bound instead.
+ *
+ * Must match MaterialTable::MaterialData.
+ */
+struct MaterialData
+{
+    uvec2 texture;
+    uvec2 normal_map;
+    vec4 ambient;
+    vec4 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+/**
+ * Materials of the regular objects, indexed by the material index of each instance.
+ */
+layout(std430, binding = 2) readonly buffer MaterialBuffer
+{
+    MaterialData u_materials[];
+};
@@ -0,0 +1,91 @@
+/**
+ * Number of cells along each side of a chunk and number of vertices in a chunk. Must match
+ * TerrainMesh.
+ */
+#define TERRAIN_CHUNK_SIZE 64
+#define TERRAIN_CHUNK_NUM_VERTICES ((TERRAIN_CHUNK_SIZE + 1) * (TERRAIN_CHUNK_SIZE + 5))
+
+/**
+ * Number of tiles a terrain mesh may have room for. Must match TerrainMesh::max_num_tiles.
+ */
+#define TERRAIN_MAX_TILES 256
+
+/**
+ * Layout of the grid of one terrain tile.
+ *
+ * Must match TerrainMesh::TileLayoutUniforms.
+ */
+struct TerrainTile
+{
+    /**
+     * World position of the first grid vertex along X and Z.
+     */
+    vec2 origin;
+
+    /**
+     * Heights are quantized over [height_min, height_min + height_range].
+     */
+    float height_min;
+    float height_range;
+
+    int num_chunks_x;
+};
+
+/**
+ * Layouts of the terrain tiles, updated by the terrain mesh whenever a tile is set.
+ *
+ * Must match TerrainMesh::LayoutUniforms.
+ */
+layout(std140, binding = 2) uniform TerrainData
+{
+    /**
+     * Number of chunks each tile has room for, whether it uses them all or not.
+     */
+    int u_terrain_tile_num_chunks;
+
+    TerrainTile u_terrain_tiles[TERRAIN_MAX_TILES];
+};
+
+/**
+ * Compact terrain vertex. Must match TerrainVertex.
+ */
+layout(location = 0) in uvec2 l_chunk_position;
+layout(location = 1) in float l_height;
+layout(location = 2) in vec2 l_normal;
+
+/**
+ * @brief Decode the world space position of the terrain vertex. Chunks are drawn with
+ * their first vertex as base vertex, which tells which chunk of which tile the vertex is
+ * in.
+ *
+ * @return The position.
+ */
+vec3 decode_terrain_position()
+{
+    int chunk = gl_BaseVertex / TERRAIN_CHUNK_NUM_VERTICES;
+    int tile_idx = chunk / u_terrain_tile_num_chunks;
+    chunk -= tile_idx * u_terrain_tile_num_chunks;
+
+    const TerrainTile tile = u_terrain_tiles[tile_idx];
+    ivec2 chunk_origin =
+        ivec2(chunk % tile.num_chunks_x, chunk / tile.num_chunks_x) * TERRAIN_CHUNK_SIZE;
+    vec2 position_xz = tile.origin + vec2(chunk_origin + ivec2(l_chunk_position));
+    return vec3(position_xz.x, tile.height_min + l_height * tile.height_range, position_xz.y);
+}
+
+/**
+ * @brief Decode the octahedral encoded normal of the terrain vertex, unfolding the lower
+ * half of the octahedron from the corners of the XZ plane.
+ *
+ * @return The unit normal.
+ */
+vec3 decode_terrain_normal()
+{
+    vec3 normal = vec3(l_normal.x, 1.0 - abs(l_normal.x) - abs(l_normal.y), l_normal.y);
+    if (normal.y < 0.0)
+    {
+        vec2 signs = vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.z >= 0.0 ? 1.0 : -1.0);
+        normal.xz = (1.0 - abs(normal.zx)) * signs;
+    }
+    return normalize(normal);
+}
@@ -1,10 +1,10 @@
 #version 460 core
 
+#include "include/frame.glsl"
+
 layout(location = 0) in vec3 l_position;
 
 uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_projection;
 
 void main()
 {
@@ -1,6 +1,9 @@
 #version 460 core
+#extension GL_ARB_bindless_texture : enable
+#extension GL_NV_gpu_shader5 : enable
 
 #include "include/lighting.frag"
+#include "include/material.glsl"
 
 out vec4 color;
 
@@ -8,34 +11,51 @@ in vec3 v_position_world_coords;
 in mat3 v_tangent_bitangent_norm;
 in vec2 v_texture_coord;
 in vec3 v_view_direction;
-in vec4 v_frag_pos_light_space;
+flat in uint v_material;
 
+uniform sampler2DArray u_shadow_map_sampler;
+
+/*
+ * Without bindless textures, the renderer splits batches into runs of one material and binds
+ * that material's textures here. This must match MaterialTable::is_bindless().
+ */
+#if !defined(GL_ARB_bindless_texture) || !defined(GL_NV_gpu_shader5)
 uniform sampler2D u_texture_sampler;
 uniform sampler2D u_normal_map_sampler;
-uniform sampler2D u_shadow_map_sampler;
-
-uniform PointLight u_point_light;
-uniform DirectionalLight u_directional_light;
-uniform Material u_material;
+#endif
 
 void main()
 {
+    const MaterialData material_data = u_materials[v_material];
+    const Material material = Material(material_data.ambient.rgb,
+                                       material_data.diffuse.rgb,
+                                       material_data.specular,
+                                       material_data.shininess);
+
+#if defined(GL_ARB_bindless_texture) && defined(GL_NV_gpu_shader5)
+    /*
+     * Instances of one draw may have different materials, so the texture handles are not
+     * dynamically uniform, which GL_NV_gpu_shader5 allows bindless handles to be.
+     */
+    const vec3 texture_color = texture(sampler2D(material_data.texture), v_texture_coord).rgb;
+    vec3 normal = texture(sampler2D(material_data.normal_map), v_texture_coord).rgb;
+#else
     const vec3 texture_color = texture(u_texture_sampler, v_texture_coord).rgb;
     vec3 normal = texture(u_normal_map_sampler, v_texture_coord).rgb;
+#endif
     normal = normal * 2.0 - 1.0;
     normal = normalize(v_tangent_bitangent_norm * normal);
 
     vec3 result = compute_directional_component(
         u_directional_light,
-        u_material,
+        material,
         u_shadow_map_sampler,
         normal,
-        v_frag_pos_light_space,
+        v_position_world_coords,
         v_view_direction);
 
-    result += compute_point_component(
-        u_point_light,
-        u_material,
+    result += compute_point_lights_component(
+        material,
         normal,
         v_position_world_coords,
         v_view_direction);
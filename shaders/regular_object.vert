@@ -1,9 +1,13 @@
 #version 460 core
 
+#include "include/frame.glsl"
+
 layout(location = 0) in vec3 l_position;
 layout(location = 1) in vec3 l_norm;
 layout(location = 2) in vec2 l_texture_coord;
 layout(location = 3) in vec4 l_tangent;
+layout(location = 4) in mat4 l_model;
+layout(location = 8) in uint l_material;
 
 /**
  * Variables going to fragment shader.
@@ -12,33 +16,33 @@ out vec3 v_position_world_coords;
 out mat3 v_tangent_bitangent_norm;
 out vec2 v_texture_coord;
 out vec3 v_view_direction;
-out vec4 v_frag_pos_light_space;
+flat out uint v_material;
 
-uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_projection;
-uniform vec3 u_camera_position;
-uniform mat4 u_light_view_projection;
+/**
+ * Must match the depth pre-pass, see depth_prepass_instanced.vert.
+ */
+invariant gl_Position;
 
 void main()
 {
     const vec4 position_four_vector = vec4(l_position, 1.0);
 
-    gl_Position = u_projection * u_view * u_model * position_four_vector;
+    gl_Position = u_projection * u_view * l_model * position_four_vector;
 
     v_texture_coord = l_texture_coord;
+    v_material = l_material;
 
     /*
      * Position of vertex in world space.
      */
-    v_position_world_coords = vec3(u_model * position_four_vector);
+    v_position_world_coords = vec3(l_model * position_four_vector);
 
     /*
      * Transform tangent-bitangent-normal vectors to world space.
      */
-    const vec3 tangent =   normalize(mat3(u_model) * l_tangent.xyz);
+    const vec3 tangent =   normalize(mat3(l_model) * l_tangent.xyz);
     const vec3 bitangent = normalize(cross(l_norm, tangent) * l_tangent.w);
-    const vec3 norm =      normalize(mat3(u_model) * l_norm);
+    const vec3 norm =      normalize(mat3(l_model) * l_norm);
     v_tangent_bitangent_norm = mat3(tangent, bitangent, norm);
 
     /*
@@ -46,9 +50,4 @@ void main()
      * shader to do lighting.
      */
     v_view_direction = normalize(u_camera_position - v_position_world_coords);
-
-    /*
-     * Compute position of vertex in light space for shadow mapping.
-     */
-    v_frag_pos_light_space = u_light_view_projection * position_four_vector;
 }
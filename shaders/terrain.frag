@@ -7,14 +7,11 @@ out vec4 color;
 in vec3 v_position_world_coords;
 in vec3 v_normal;
 in vec3 v_view_direction;
-in vec4 v_frag_pos_light_space;
 
 uniform sampler2D u_texture_sampler;
 uniform sampler2D u_normal_map_sampler;
-uniform sampler2D u_shadow_map_sampler;
+uniform sampler2DArray u_shadow_map_sampler;
 
-uniform PointLight u_point_light;
-uniform DirectionalLight u_directional_light;
 uniform Material u_material;
 
 /**
@@ -131,11 +128,10 @@ void main()
         u_material,
         u_shadow_map_sampler,
         normal_world_space,
-        v_frag_pos_light_space,
+        v_position_world_coords,
         v_view_direction);
 
-    result += compute_point_component(
-        u_point_light,
+    result += compute_point_lights_component(
         u_material,
         normal_world_space,
         v_position_world_coords,
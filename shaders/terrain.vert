@@ -1,7 +1,7 @@
 #version 460 core
 
-layout(location = 0) in vec3 l_position;
-layout(location = 1) in vec3 l_normal;
+#include "include/frame.glsl"
+#include "include/terrain_vertex.glsl"
 
 /**
  * Variables going to fragment shader.
@@ -9,19 +9,19 @@ layout(location = 1) in vec3 l_normal;
 out vec3 v_position_world_coords;
 out vec3 v_normal;
 out vec3 v_view_direction;
-out vec4 v_frag_pos_light_space;
 
 uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_projection;
-uniform vec3 u_camera_position;
-uniform mat4 u_light_view_projection;
+
+/**
+ * Must match the depth pre-pass, see terrain_depth_prepass.vert.
+ */
+invariant gl_Position;
 
 void main()
 {
-    v_normal = l_normal;
+    v_normal = decode_terrain_normal();
 
-    vec4 position_four_vector = vec4(l_position, 1.0);
+    vec4 position_four_vector = vec4(decode_terrain_position(), 1.0);
 
     gl_Position = u_projection * u_view * u_model * position_four_vector;
 
@@ -35,9 +35,4 @@ void main()
      * shader to do lighting.
      */
     v_view_direction = normalize(u_camera_position - v_position_world_coords);
-
-    /*
-     * Compute position of vertex in light space for shadow mapping.
-     */
-    v_frag_pos_light_space = u_light_view_projection * position_four_vector;
 }
@@ -0,0 +1,11 @@
+#version 460 core
+
+#include "include/terrain_vertex.glsl"
+
+uniform mat4 u_light_view_projection;
+uniform mat4 u_model;
+
+void main()
+{
+    gl_Position = u_light_view_projection * u_model * vec4(decode_terrain_position(), 1.0);
+}
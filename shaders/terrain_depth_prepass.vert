@@ -0,0 +1,17 @@
+#version 460 core
+
+#include "include/frame.glsl"
+#include "include/terrain_vertex.glsl"
+
+uniform mat4 u_model;
+
+/**
+ * The lit pass only shades fragments whose depth equals the depth written here, so the
+ * position must be computed exactly as in terrain.vert.
+ */
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = u_projection * u_view * u_model * vec4(decode_terrain_position(), 1.0);
+}
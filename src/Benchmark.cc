@@ -0,0 +1,251 @@
+#include "Benchmark.h"
+
+#include "assert_util.h"
+#include "log.h"
+#include "perf.h"
+
+#include <GL/glew.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#ifndef GIT_COMMIT
+#define GIT_COMMIT "unknown"
+#endif
+
+namespace Engine
+{
+    /**
+     * @brief Write a string as a JSON string literal.
+     *
+     * @param file File to write to.
+     * @param string String to write.
+     */
+    static void write_json_string(std::FILE *file, const char *string)
+    {
+        std::fputc('"', file);
+        for (const char *c = string; *c != '\0'; c++)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                std::fputc('\\', file);
+                std::fputc(*c, file);
+            }
+            else if (static_cast<unsigned char>(*c) < 0x20)
+            {
+                std::fprintf(file, "\\u%04x", *c);
+            }
+            else
+            {
+                std::fputc(*c, file);
+            }
+        }
+        std::fputc('"', file);
+    }
+
+    /**
+     * @brief Write the percentiles of a histogram of nanoseconds as a JSON object of
+     * milliseconds.
+     *
+     * @param file File to write to.
+     * @param histogram Histogram to write.
+     */
+    static void write_json_percentiles(std::FILE *file, const Histogram &histogram)
+    {
+        std::fprintf(file,
+                     "{\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, "
+                     "\"p99\": %.4f, \"max\": %.4f}",
+                     histogram.get_mean() / 1e6,
+                     histogram.get_percentile(50) / 1e6,
+                     histogram.get_percentile(90) / 1e6,
+                     histogram.get_percentile(95) / 1e6,
+                     histogram.get_percentile(99) / 1e6,
+                     histogram.get_max() / 1e6);
+    }
+
+    /**
+     * @brief Constructor. The benchmark is disabled until initialized with a number of
+     * frames.
+     */
+    Benchmark::Benchmark():
+        num_warmup_frames_done(0), is_measuring(false), num_frames_measured(0),
+        num_frames_collected(0)
+    {}
+
+    /**
+     * @brief Set up the camera path.
+     *
+     * @param _options Options of the benchmark.
+     * @param terrain Terrain to orbit if there is no recorded path.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Benchmark::init(const Options &_options, const TerrainStreamer &terrain)
+    {
+        options = _options;
+        if (!is_enabled())
+        {
+            return true;
+        }
+
+        if (options.camera_path.empty())
+        {
+            camera_path.make_orbit(terrain);
+        }
+        else
+        {
+            ASSERT_RET_IF_NOT(camera_path.load(options.camera_path), false);
+        }
+
+        LOG("Benchmarking %zu frames\n", options.num_frames);
+
+        return true;
+    }
+
+    /**
+     * @return Time step of the current frame in seconds. Nothing moves during the warm-up.
+     */
+    double Benchmark::get_dt() const
+    {
+        return is_measuring ? frame_dt : 0.0;
+    }
+
+    /**
+     * @return Camera of the current frame.
+     */
+    CameraPath::Keyframe Benchmark::get_camera() const
+    {
+        return camera_path.sample(static_cast<float>(num_frames_measured * frame_dt));
+    }
+
+    /**
+     * @brief Finish a frame, measuring it unless still warming up.
+     *
+     * @param profiler Profiler the frame was recorded in.
+     * @param is_loaded Whether everything loaded in the background is in place, which
+     * the warm-up waits for.
+     */
+    void Benchmark::end_frame(const Profiler &profiler, const bool is_loaded)
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        const std::chrono::steady_clock::duration frame_time = now - frame_end_time;
+        frame_end_time = now;
+
+        if (!is_measuring)
+        {
+            num_warmup_frames_done++;
+            if (num_warmup_frames_done >= num_warmup_frames && is_loaded)
+            {
+                LOG("Warmed up after %zu frames, measuring\n", num_warmup_frames_done);
+                is_measuring = true;
+                num_frames_collected = profiler.get_num_frames_collected();
+            }
+            return;
+        }
+
+        frame_ns.add(std::chrono::duration_cast<std::chrono::nanoseconds>(frame_time).count());
+        num_frames_measured++;
+
+        /*
+         * The profiler reads frames back a few frames late, and not necessarily once per
+         * frame, so scopes are sampled whenever it has read back a new one.
+         */
+        if (profiler.get_num_frames_collected() == num_frames_collected)
+        {
+            return;
+        }
+        num_frames_collected = profiler.get_num_frames_collected();
+
+        const std::vector<Profiler::ScopeStats> &profiler_scopes = profiler.get_scopes();
+        for (size_t i = 0; i < profiler_scopes.size(); i++)
+        {
+            const Profiler::ScopeStats &scope = profiler_scopes[i];
+            if (unlikely(i == scopes.size()))
+            {
+                scopes.push_back({
+                    .name = scope.name,
+                    .depth = scope.depth,
+                    .cpu_ns = {},
+                    .gpu_ns = {},
+                });
+            }
+
+            /*
+             * A scope which did not run in the frame has no timings rather than zero ones.
+             */
+            if (scope.cpu_ms == 0.f && scope.gpu_ms == 0.f)
+            {
+                continue;
+            }
+            scopes[i].cpu_ns.add(static_cast<uint64_t>(scope.cpu_ms * 1e6f));
+            scopes[i].gpu_ns.add(static_cast<uint64_t>(scope.gpu_ms * 1e6f));
+        }
+    }
+
+    /**
+     * @brief Write the report of the measured frames.
+     *
+     * @param info Context of the run.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Benchmark::write_report(const Info &info) const
+    {
+        std::FILE *file = std::fopen(options.report_path.c_str(), "w");
+        if (file == nullptr)
+        {
+            LOG_ERROR("Failed to open %s: %s\n", options.report_path.c_str(), std::strerror(errno));
+            return false;
+        }
+
+        const char *const renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+
+        std::fprintf(file, "{\n  \"commit\": ");
+        write_json_string(file, GIT_COMMIT);
+        std::fprintf(file, ",\n  \"renderer\": ");
+        write_json_string(file, renderer != nullptr ? renderer : "unknown");
+        std::fprintf(file, ",\n  \"camera_path\": ");
+        write_json_string(file,
+                          options.camera_path.empty() ? "orbit" : options.camera_path.c_str());
+        std::fprintf(file,
+                     ",\n  \"window\": [%d, %d],\n  \"chasers\": %zu,\n  \"dt_ms\": %.4f,"
+                     "\n  \"frames\": %zu,\n  \"frame_ms\": ",
+                     info.window_width,
+                     info.window_height,
+                     info.num_chasers,
+                     frame_dt * 1e3,
+                     num_frames_measured);
+        write_json_percentiles(file, frame_ns);
+        std::fprintf(file, ",\n  \"scopes\": [");
+        for (size_t i = 0; i < scopes.size(); i++)
+        {
+            const ScopeSamples &scope = scopes[i];
+            std::fprintf(file, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+            write_json_string(file, scope.name);
+            std::fprintf(file,
+                         ", \"depth\": %d, \"samples\": %" PRIu64 ",\n     \"cpu_ms\": ",
+                         scope.depth,
+                         scope.cpu_ns.get_count());
+            write_json_percentiles(file, scope.cpu_ns);
+            std::fprintf(file, ",\n     \"gpu_ms\": ");
+            write_json_percentiles(file, scope.gpu_ns);
+            std::fprintf(file, "}");
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+
+        if (unlikely(std::fclose(file) != 0))
+        {
+            LOG_ERROR(
+                "Failed to write %s: %s\n", options.report_path.c_str(), std::strerror(errno));
+            return false;
+        }
+
+        LOG("Wrote benchmark report %s: frame time p50 %.2f ms, p99 %.2f ms\n",
+            options.report_path.c_str(),
+            frame_ns.get_percentile(50) / 1e6,
+            frame_ns.get_percentile(99) / 1e6);
+
+        return true;
+    }
+}
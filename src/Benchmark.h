@@ -0,0 +1,129 @@
+#pragma once
+
+#include "CameraPath.h"
+#include "Histogram.h"
+#include "Profiler.h"
+#include "TerrainStreamer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Reproducible performance measurement over a scripted camera flight.
+     *
+     * The game runs with a fixed time step and flies the camera along a path instead of
+     * taking input. After a warm-up, which lasts until all textures are loaded, a fixed
+     * number of frames is measured: the wall time of every frame, including the swap, and
+     * the CPU and GPU time of every profiler scope. The percentiles are then written as a
+     * JSON report, so that two commits can be compared by running the same benchmark on
+     * both.
+     */
+    class Benchmark
+    {
+    public:
+        struct Options
+        {
+            /**
+             * Number of frames to measure, or 0 to play normally.
+             */
+            size_t num_frames = 0;
+
+            /**
+             * Recorded camera path to fly, or empty to orbit the terrain.
+             */
+            std::string camera_path;
+
+            std::string report_path = "benchmark.json";
+        };
+
+        /**
+         * @brief Context of a run, written at the top of the report.
+         */
+        struct Info
+        {
+            int window_width;
+            int window_height;
+            size_t num_chasers;
+        };
+
+        /**
+         * Time step of every measured frame in seconds.
+         */
+        static constexpr double frame_dt = 1.0 / 60.0;
+
+        Benchmark();
+
+        bool init(const Options &_options, const TerrainStreamer &terrain);
+
+        /**
+         * @return True if the game runs the benchmark, otherwise false.
+         */
+        bool is_enabled() const
+        {
+            return options.num_frames > 0;
+        }
+
+        /**
+         * @return True once all frames have been measured, otherwise false.
+         */
+        bool is_done() const
+        {
+            return num_frames_measured >= options.num_frames;
+        }
+
+        double get_dt() const;
+
+        CameraPath::Keyframe get_camera() const;
+
+        void end_frame(const Profiler &profiler, const bool is_loaded);
+
+        bool write_report(const Info &info) const;
+
+    private:
+        /**
+         * Minimum number of frames rendered before measuring, so that caches, drivers
+         * and the frame arenas settle.
+         */
+        static constexpr size_t num_warmup_frames = 120;
+
+        /**
+         * @brief Samples of one profiler scope, in nanoseconds.
+         */
+        struct ScopeSamples
+        {
+            const char *name;
+            int depth;
+            Histogram cpu_ns;
+            Histogram gpu_ns;
+        };
+
+        Options options;
+
+        CameraPath camera_path;
+
+        size_t num_warmup_frames_done;
+        bool is_measuring;
+        size_t num_frames_measured;
+
+        std::chrono::steady_clock::time_point frame_end_time;
+
+        /**
+         * Wall time between the ends of consecutive measured frames, in nanoseconds.
+         */
+        Histogram frame_ns;
+
+        /**
+         * Samples of each profiler scope, in the order of Profiler::get_scopes().
+         */
+        std::vector<ScopeSamples> scopes;
+
+        /**
+         * Frames the profiler had read back when the scopes were last sampled.
+         */
+        uint64_t num_frames_collected;
+    };
+}
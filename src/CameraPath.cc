@@ -0,0 +1,252 @@
+#include "CameraPath.h"
+
+#include "log.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <glm/ext/scalar_constants.hpp>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor. The path is empty until loaded, generated or recorded.
+     */
+    CameraPath::CameraPath(): is_looping(false)
+    {}
+
+    /**
+     * @brief Load a recorded path.
+     *
+     * @param file_path Path to the file.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool CameraPath::load(const std::string &file_path)
+    {
+        std::FILE *file = std::fopen(file_path.c_str(), "r");
+        if (file == nullptr)
+        {
+            LOG_ERROR("Failed to open %s: %s\n", file_path.c_str(), std::strerror(errno));
+            return false;
+        }
+
+        keyframes.clear();
+        is_looping = false;
+
+        Keyframe keyframe;
+        while (std::fscanf(file,
+                           "%f %f %f %f %f %f",
+                           &keyframe.time,
+                           &keyframe.position.x,
+                           &keyframe.position.y,
+                           &keyframe.position.z,
+                           &keyframe.horizontal_angle,
+                           &keyframe.vertical_angle) == 6)
+        {
+            add_keyframe(keyframe);
+        }
+        const bool is_complete = std::feof(file);
+        std::fclose(file);
+
+        if (unlikely(!is_complete || keyframes.empty()))
+        {
+            LOG_ERROR("Invalid camera path %s after %zu keyframes\n",
+                      file_path.c_str(),
+                      keyframes.size());
+            return false;
+        }
+
+        LOG("Loaded camera path %s of %zu keyframes, %.1f s\n",
+            file_path.c_str(),
+            keyframes.size(),
+            get_duration());
+
+        return true;
+    }
+
+    /**
+     * @brief Save the path.
+     *
+     * @param file_path Path to the file.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool CameraPath::save(const std::string &file_path) const
+    {
+        std::FILE *file = std::fopen(file_path.c_str(), "w");
+        if (file == nullptr)
+        {
+            LOG_ERROR("Failed to open %s: %s\n", file_path.c_str(), std::strerror(errno));
+            return false;
+        }
+
+        for (const Keyframe &keyframe : keyframes)
+        {
+            std::fprintf(file,
+                         "%.3f %.3f %.3f %.3f %.4f %.4f\n",
+                         keyframe.time,
+                         keyframe.position.x,
+                         keyframe.position.y,
+                         keyframe.position.z,
+                         keyframe.horizontal_angle,
+                         keyframe.vertical_angle);
+        }
+
+        if (unlikely(std::fclose(file) != 0))
+        {
+            LOG_ERROR("Failed to write %s: %s\n", file_path.c_str(), std::strerror(errno));
+            return false;
+        }
+
+        LOG("Saved camera path %s of %zu keyframes\n", file_path.c_str(), keyframes.size());
+
+        return true;
+    }
+
+    /**
+     * @brief Replace the path with a looping orbit around the middle of the terrain at a
+     * fixed height above the ground, looking ahead and slightly down.
+     *
+     * @param terrain Terrain to orbit.
+     */
+    void CameraPath::make_orbit(const TerrainStreamer &terrain)
+    {
+        static constexpr size_t num_keyframes = 32;
+        static constexpr float duration = 60.f;
+        static constexpr float height_above_ground = 30.f;
+        static constexpr float vertical_angle = -0.25f;
+
+        keyframes.clear();
+        is_looping = true;
+
+        const float radius =
+            0.25f * std::min(terrain.get_file().get_num_rows(), terrain.get_file().get_num_cols());
+        for (size_t i = 0; i <= num_keyframes; i++)
+        {
+            const float fraction = static_cast<float>(i) / num_keyframes;
+            const float angle = 2.f * glm::pi<float>() * fraction;
+            const float x = radius * std::sin(angle);
+            const float z = radius * std::cos(angle);
+
+            /*
+             * The direction of travel is a quarter turn ahead of the angle around the
+             * orbit.
+             */
+            add_keyframe({
+                .time = duration * fraction,
+                .position = glm::vec3(x, terrain.get_height(x, z) + height_above_ground, z),
+                .horizontal_angle = angle + 0.5f * glm::pi<float>(),
+                .vertical_angle = vertical_angle,
+            });
+        }
+    }
+
+    /**
+     * @brief Append a keyframe, which must be no earlier than the last.
+     *
+     * @param keyframe Keyframe to append.
+     */
+    void CameraPath::add_keyframe(const Keyframe &keyframe)
+    {
+        if (unlikely(!keyframes.empty() && keyframe.time < keyframes.back().time))
+        {
+            LOG_ERROR("Keyframe at %.3f s is before the last one at %.3f s\n",
+                      keyframe.time,
+                      keyframes.back().time);
+            return;
+        }
+
+        keyframes.push_back(keyframe);
+    }
+
+    /**
+     * @brief Get the camera at a point along the path.
+     *
+     * @param time Time since the start of the path in seconds. Times past the end wrap
+     * around on a looping path and stay at the last keyframe otherwise.
+     *
+     * @return Interpolated keyframe.
+     */
+    CameraPath::Keyframe CameraPath::sample(float time) const
+    {
+        if (unlikely(keyframes.empty()))
+        {
+            return {};
+        }
+
+        const float duration = get_duration();
+        if (is_looping && duration > 0.f)
+        {
+            time = std::fmod(time, duration);
+        }
+        time = std::clamp(time, keyframes.front().time, duration);
+
+        const auto next = std::upper_bound(
+            keyframes.begin(), keyframes.end(), time, [](const float t, const Keyframe &keyframe) {
+                return t < keyframe.time;
+            });
+        if (next == keyframes.end())
+        {
+            Keyframe last = keyframes.back();
+            last.time = time;
+            return last;
+        }
+
+        const size_t i1 = (next - keyframes.begin()) - 1;
+        const size_t i2 = i1 + 1;
+        const Keyframe &k1 = keyframes[i1];
+        const Keyframe &k2 = keyframes[i2];
+
+        /*
+         * The outer control points are the neighbours of the segment. At the ends of the
+         * path they are mirrored, unless it loops, where the first and last keyframes are
+         * the same point.
+         */
+        const size_t last_idx = keyframes.size() - 1;
+        glm::vec3 p0;
+        glm::vec3 p3;
+        if (i1 > 0)
+        {
+            p0 = keyframes[i1 - 1].position;
+        }
+        else
+        {
+            p0 = is_looping && last_idx > 1 ? keyframes[last_idx - 1].position
+                                            : 2.f * k1.position - k2.position;
+        }
+        if (i2 < last_idx)
+        {
+            p3 = keyframes[i2 + 1].position;
+        }
+        else
+        {
+            p3 = is_looping && last_idx > 1 ? keyframes[1].position
+                                            : 2.f * k2.position - k1.position;
+        }
+
+        const float span = k2.time - k1.time;
+        const float t = span > 0.f ? (time - k1.time) / span : 0.f;
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+
+        const glm::vec3 position = 0.5f * ((2.f * k1.position) + (k2.position - p0) * t +
+                                           (2.f * p0 - 5.f * k1.position + 4.f * k2.position -
+                                            p3) * t2 +
+                                           (3.f * k1.position - p0 - 3.f * k2.position + p3) *
+                                               t3);
+
+        const float horizontal_delta =
+            std::remainder(k2.horizontal_angle - k1.horizontal_angle, 2.f * glm::pi<float>());
+
+        return {
+            .time = time,
+            .position = position,
+            .horizontal_angle = k1.horizontal_angle + horizontal_delta * t,
+            .vertical_angle = k1.vertical_angle + (k2.vertical_angle - k1.vertical_angle) * t,
+        };
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "TerrainStreamer.h"
+
+#include <glm/vec3.hpp>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief A camera flight through a list of keyframes.
+     *
+     * The position follows a Catmull-Rom spline through the keyframes, and the viewing
+     * angles are interpolated linearly between them, the horizontal angle turning the short
+     * way. A path is either recorded while playing and saved to a text file, one
+     * "time x y z horizontal_angle vertical_angle" keyframe per line, or generated as an
+     * orbit over the terrain.
+     */
+    class CameraPath
+    {
+    public:
+        struct Keyframe
+        {
+            /**
+             * Time since the start of the path in seconds.
+             */
+            float time;
+
+            glm::vec3 position;
+            float horizontal_angle;
+            float vertical_angle;
+        };
+
+        CameraPath();
+
+        bool load(const std::string &file_path);
+
+        bool save(const std::string &file_path) const;
+
+        void make_orbit(const TerrainStreamer &terrain);
+
+        void add_keyframe(const Keyframe &keyframe);
+
+        Keyframe sample(float time) const;
+
+        /**
+         * @return Time of the last keyframe in seconds.
+         */
+        float get_duration() const
+        {
+            return keyframes.empty() ? 0.f : keyframes.back().time;
+        }
+
+        bool empty() const
+        {
+            return keyframes.empty();
+        }
+
+    private:
+        std::vector<Keyframe> keyframes;
+
+        /**
+         * Whether the path starts over after its last keyframe rather than stopping there.
+         */
+        bool is_looping;
+    };
+}
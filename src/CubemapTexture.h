@@ -1,11 +1,11 @@
 #pragma once
 
-#include "assert_util.h"
+#include "GLState.h"
+#include "TextureLoader.h"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <array>
-#include <stb/stb_image.h>
 #include <string>
 
 namespace Engine
@@ -17,10 +17,15 @@ namespace Engine
         {}
 
         /**
-         * @brief Load texture from file into the given slot.
+         * @brief Create the texture in the given slot and load its faces from file in the
+         * background. The faces are decoded in parallel, and each holds a single
+         * placeholder texel until all of them have been uploaded together.
          *
+         * @param loader Loader to load the faces with.
          * @param file_name_prefix File name prefix.
          * @param file_name_suffix File name suffix.
+         * @param _slot Texture slot.
+         * @param placeholder Placeholder texel.
          *
          * The six faces should be named as:
          * file_name_prefix + "px" + file_name_suffix
@@ -34,46 +39,28 @@ namespace Engine
          *
          * @return True on success, otherwise false.
          */
-        bool create_from_file(const std::string &file_name_prefix,
+        bool create_from_file(TextureLoader &loader,
+                              const std::string &file_name_prefix,
                               const std::string &file_name_suffix,
-                              const size_t _slot)
+                              const size_t _slot,
+                              const std::array<uint8_t, 4> &placeholder)
         {
             slot = _slot;
 
             glGenTextures(1, &texture_id);
             glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
 
-            const std::array<std::string, 6> faces = {
-                file_name_prefix + "px" + file_name_suffix,
-                file_name_prefix + "nx" + file_name_suffix,
-                file_name_prefix + "py" + file_name_suffix,
-                file_name_prefix + "ny" + file_name_suffix,
-                file_name_prefix + "pz" + file_name_suffix,
-                file_name_prefix + "nz" + file_name_suffix,
-            };
-
-            int width, height, channels;
-            for (uint8_t i = 0; i < faces.size(); i++)
+            for (uint8_t i = 0; i < 6; i++)
             {
-                uint8_t *face = stbi_load(faces[i].c_str(), &width, &height, &channels, 0);
-                ASSERT_RET_IF_NOT(face, false);
-                LOG("Loading cubemap face %s (%d x %d x %d)\n",
-                    faces[i].c_str(),
-                    width,
-                    height,
-                    channels);
-                const GLenum internal_format = (channels == 4) ? GL_RGBA8 : GL_RGB8;
-                const GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
                              0,
-                             internal_format,
-                             width,
-                             height,
+                             GL_RGBA8,
+                             1 /* width */,
+                             1 /* height */,
                              0,
-                             format,
+                             GL_RGBA,
                              GL_UNSIGNED_BYTE,
-                             face);
-                stbi_image_free(face);
+                             placeholder.data());
             }
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -81,6 +68,20 @@ namespace Engine
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
+            loader.load(texture_id,
+                        GL_TEXTURE_CUBE_MAP,
+                        {
+                            file_name_prefix + "px" + file_name_suffix,
+                            file_name_prefix + "nx" + file_name_suffix,
+                            file_name_prefix + "py" + file_name_suffix,
+                            file_name_prefix + "ny" + file_name_suffix,
+                            file_name_prefix + "pz" + file_name_suffix,
+                            file_name_prefix + "nz" + file_name_suffix,
+                        },
+                        false /* flip_vertically */,
+                        false /* generate_mipmap */,
+                        nullptr);
+
             return true;
         }
 
@@ -93,6 +94,16 @@ namespace Engine
             glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
         }
 
+        /**
+         * @brief Use the texture unless it is already bound to its slot.
+         *
+         * @param state Tracked GL state.
+         */
+        void use(GLState &state) const
+        {
+            state.bind_texture(slot, GL_TEXTURE_CUBE_MAP, texture_id);
+        }
+
         /**
          * @return The texture slot.
          */
@@ -0,0 +1,79 @@
+#include "DynamicResolution.h"
+
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor. The scale stays at max_scale until enabled, with a budget of a
+     * 60 Hz frame.
+     */
+    DynamicResolution::DynamicResolution():
+        is_enabled(false),
+        frame_budget_ms(1000.0f / 60.0f),
+        scale(max_scale),
+        gpu_ms(0.0f),
+        num_frames_collected(0)
+    {}
+
+    /**
+     * @brief Adjust the scale from the GPU time of the latest frame read back by the
+     * profiler. Call once per frame, before rendering.
+     *
+     * @param profiler Profiler whose root scope is the frame.
+     */
+    void DynamicResolution::update(const Profiler &profiler)
+    {
+        const std::vector<Profiler::ScopeStats> &scopes = profiler.get_scopes();
+        if (unlikely(scopes.empty()) ||
+            profiler.get_num_frames_collected() == num_frames_collected)
+        {
+            return;
+        }
+        num_frames_collected = profiler.get_num_frames_collected();
+
+        const float frame_gpu_ms = scopes[0].gpu_ms;
+        gpu_ms = gpu_ms == 0.0f ? frame_gpu_ms : gpu_ms + (frame_gpu_ms - gpu_ms) * smoothing;
+
+        if (!is_enabled || gpu_ms <= 0.0f)
+        {
+            return;
+        }
+
+        if (gpu_ms > frame_budget_ms || gpu_ms < headroom * frame_budget_ms)
+        {
+            /*
+             * Aim for the middle of the band, where the time has room to move either way.
+             */
+            const float target_ms = 0.5f * (1.0f + headroom) * frame_budget_ms;
+            const float target_scale = scale * std::sqrt(target_ms / gpu_ms);
+            scale += std::clamp(target_scale - scale, -max_step, max_step);
+            scale = std::clamp(scale, min_scale, max_scale);
+        }
+    }
+
+    /**
+     * @brief Turn dynamic resolution on or off. Turning it off renders at max_scale again.
+     *
+     * @param _is_enabled Whether the scale follows the GPU time.
+     */
+    void DynamicResolution::set_enabled(const bool _is_enabled)
+    {
+        is_enabled = _is_enabled;
+        if (!is_enabled)
+        {
+            scale = max_scale;
+        }
+    }
+
+    /**
+     * @param _frame_budget_ms GPU time a frame should stay within.
+     */
+    void DynamicResolution::set_frame_budget_ms(const float _frame_budget_ms)
+    {
+        frame_budget_ms = std::max(_frame_budget_ms, 1.0f);
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Profiler.h"
+
+#include <cstdint>
+
+namespace Engine
+{
+    /**
+     * @brief Picks the fraction of the window resolution along each axis that the scene is
+     * rendered at, so that the GPU time of a frame stays within a budget.
+     *
+     * The GPU time of the whole frame is read from the profiler, a few frames late. It is
+     * smoothed so that a single slow frame does not blur the screen, and the scale only
+     * moves once the smoothed time leaves the band between headroom times the budget and
+     * the budget, by at most max_step per frame so that it does not oscillate on the
+     * profiler's latency. The cost of a frame is taken to grow with its number of pixels,
+     * i.e. with the square of the scale.
+     */
+    class DynamicResolution
+    {
+    public:
+        /**
+         * Range of the scale. The render targets are allocated at the window resolution,
+         * which is the largest scale.
+         * @{
+         */
+        static constexpr float min_scale = 0.5f;
+        static constexpr float max_scale = 1.0f;
+        /**
+         * @}
+         */
+
+        DynamicResolution();
+
+        void update(const Profiler &profiler);
+
+        void set_enabled(const bool _is_enabled);
+
+        void set_frame_budget_ms(const float _frame_budget_ms);
+
+        /**
+         * @return Whether the scale follows the GPU time, rather than staying at max_scale.
+         */
+        bool get_enabled() const
+        {
+            return is_enabled;
+        }
+
+        /**
+         * @return GPU time a frame should stay within.
+         */
+        float get_frame_budget_ms() const
+        {
+            return frame_budget_ms;
+        }
+
+        /**
+         * @return Fraction of the window resolution to render the scene at.
+         */
+        float get_scale() const
+        {
+            return scale;
+        }
+
+        /**
+         * @return Smoothed GPU time of a frame.
+         */
+        float get_gpu_ms() const
+        {
+            return gpu_ms;
+        }
+
+    private:
+        /**
+         * Fraction of the budget below which the scale is raised again.
+         */
+        static constexpr float headroom = 0.85f;
+
+        /**
+         * Largest change of the scale in one frame.
+         */
+        static constexpr float max_step = 0.02f;
+
+        /**
+         * Weight of each new GPU time in the smoothed one.
+         */
+        static constexpr float smoothing = 0.1f;
+
+        bool is_enabled;
+        float frame_budget_ms;
+        float scale;
+        float gpu_ms;
+
+        /**
+         * Frames the profiler had read back when last updated, to only count each once.
+         */
+        uint64_t num_frames_collected;
+    };
+}
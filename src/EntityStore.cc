@@ -0,0 +1,173 @@
+#include "EntityStore.h"
+
+#include "log.h"
+#include "perf.h"
+
+#include <cmath>
+#include <glm/ext/scalar_constants.hpp>
+#include <glm/vec4.hpp>
+
+namespace Engine
+{
+    /**
+     * @brief Reserve room for a number of entities, so that spawning up to that many does
+     * not reallocate the components.
+     *
+     * @param capacity Number of entities.
+     */
+    void EntityStore::reserve(const size_t capacity)
+    {
+        position_x.reserve(capacity);
+        position_y.reserve(capacity);
+        position_z.reserve(capacity);
+        velocity_x.reserve(capacity);
+        velocity_y.reserve(capacity);
+        velocity_z.reserve(capacity);
+        yaw.reserve(capacity);
+        model.reserve(capacity);
+        render_handle.reserve(capacity);
+    }
+
+    /**
+     * @brief Add an entity at rest.
+     *
+     * @param position Position of the entity.
+     * @param _yaw Orientation of the entity, as an angle around +Y in radians.
+     * @param _render_handle Index of the material of the entity in the material table.
+     *
+     * @return The entity.
+     */
+    EntityStore::Entity EntityStore::spawn(const glm::vec3 &position,
+                                           const float _yaw,
+                                           const GLuint _render_handle)
+    {
+        position_x.push_back(position.x);
+        position_y.push_back(position.y);
+        position_z.push_back(position.z);
+        velocity_x.push_back(0.f);
+        velocity_y.push_back(0.f);
+        velocity_z.push_back(0.f);
+        yaw.push_back(_yaw);
+        model.push_back(glm::mat4(1.f));
+        render_handle.push_back(_render_handle);
+
+        return size() - 1;
+    }
+
+    /**
+     * @brief Remove an entity. The last entity takes its place to keep the components
+     * contiguous, so its index changes.
+     *
+     * @param entity Entity to remove.
+     */
+    void EntityStore::remove(const Entity entity)
+    {
+        if (unlikely(entity >= size()))
+        {
+            LOG_ERROR("Entity %u is not in the store of %zu entities\n", entity, size());
+            return;
+        }
+
+        const auto swap_remove = [entity](auto &component) {
+            component[entity] = component.back();
+            component.pop_back();
+        };
+        swap_remove(position_x);
+        swap_remove(position_y);
+        swap_remove(position_z);
+        swap_remove(velocity_x);
+        swap_remove(velocity_y);
+        swap_remove(velocity_z);
+        swap_remove(yaw);
+        swap_remove(model);
+        swap_remove(render_handle);
+    }
+
+    /**
+     * @brief Copy the positions and orientations of all entities. The arrays of @p poses
+     * keep their storage, so reusing one does not allocate.
+     *
+     * @param[out] poses Poses to fill in.
+     */
+    void EntityStore::get_poses(Poses &poses) const
+    {
+        poses.position_x.assign(position_x.begin(), position_x.end());
+        poses.position_y.assign(position_y.begin(), position_y.end());
+        poses.position_z.assign(position_z.begin(), position_z.end());
+        poses.yaw.assign(yaw.begin(), yaw.end());
+    }
+
+    /**
+     * @brief Build the transforms of all entities from their poses interpolated between
+     * two ticks, on the job system.
+     *
+     * @param from Poses of the earlier tick.
+     * @param to Poses of the later tick.
+     * @param alpha Fraction of the way from @p from to @p to.
+     */
+    void EntityStore::update_transforms(const Poses &from, const Poses &to, const float alpha)
+    {
+        if (unlikely(from.yaw.size() != size() || to.yaw.size() != size()))
+        {
+            LOG_ERROR("Poses of %zu and %zu entities do not match the store of %zu entities\n",
+                      from.yaw.size(),
+                      to.yaw.size(),
+                      size());
+            return;
+        }
+
+        glm::mat4 *const models = model.data();
+        parallel_for(
+            0,
+            size(),
+            [&from, &to, alpha, models](const size_t begin, const size_t end) {
+                for (size_t i = begin; i < end; i++)
+                {
+                    const float x = from.position_x[i] +
+                                    (to.position_x[i] - from.position_x[i]) * alpha;
+                    const float y = from.position_y[i] +
+                                    (to.position_y[i] - from.position_y[i]) * alpha;
+                    const float z = from.position_z[i] +
+                                    (to.position_z[i] - from.position_z[i]) * alpha;
+
+                    /*
+                     * Turn the short way around.
+                     */
+                    const float yaw_delta =
+                        std::remainder(to.yaw[i] - from.yaw[i], 2.f * glm::pi<float>());
+                    const float angle = from.yaw[i] + yaw_delta * alpha;
+                    const float cos_yaw = std::cos(angle);
+                    const float sin_yaw = std::sin(angle);
+
+                    /*
+                     * Translation times rotation around +Y, written out by column rather
+                     * than composed with glm::translate() and glm::rotate().
+                     */
+                    models[i] = glm::mat4(glm::vec4(cos_yaw, 0.f, -sin_yaw, 0.f),
+                                          glm::vec4(0.f, 1.f, 0.f, 0.f),
+                                          glm::vec4(sin_yaw, 0.f, cos_yaw, 0.f),
+                                          glm::vec4(x, y, z, 1.f));
+                }
+            },
+            entities_per_job);
+    }
+
+    /**
+     * @return Pointers to the component arrays. They are invalidated by spawning
+     * entities.
+     */
+    EntityStore::Components EntityStore::get_components()
+    {
+        return {
+            .position_x = position_x.data(),
+            .position_y = position_y.data(),
+            .position_z = position_z.data(),
+            .velocity_x = velocity_x.data(),
+            .velocity_y = velocity_y.data(),
+            .velocity_z = velocity_z.data(),
+            .yaw = yaw.data(),
+            .model = model.data(),
+            .render_handle = render_handle.data(),
+        };
+    }
+}
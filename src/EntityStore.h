@@ -0,0 +1,144 @@
+#pragma once
+
+#include "parallel.h"
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Entities of one kind, with each component kept in its own contiguous array
+     * indexed by entity, so that systems stream through just the components they use.
+     *
+     * An entity has a position, a velocity, an orientation as a yaw around +Y, a transform
+     * as its model matrix and a render handle, the index of its material in the renderer's
+     * material table. All entities of a store are drawn with the same drawable, straight
+     * from the transform and render handle arrays.
+     *
+     * The simulation owns the positions, velocities and orientations, and hands them to the
+     * render thread as poses, which builds the transforms from them. The other components
+     * are only written by spawning and removing entities, which must not happen while the
+     * simulation is running.
+     */
+    class EntityStore
+    {
+    public:
+        /**
+         * Index of an entity in the store.
+         */
+        using Entity = uint32_t;
+
+        /**
+         * @brief Pointers to the component arrays, which systems index by entity.
+         */
+        struct Components
+        {
+            float *position_x;
+            float *position_y;
+            float *position_z;
+            float *velocity_x;
+            float *velocity_y;
+            float *velocity_z;
+            float *yaw;
+            glm::mat4 *model;
+            GLuint *render_handle;
+        };
+
+        /**
+         * @brief Positions and orientations of all entities as of a tick, as handed from
+         * the simulation to the render thread.
+         */
+        struct Poses
+        {
+            std::vector<float> position_x;
+            std::vector<float> position_y;
+            std::vector<float> position_z;
+            std::vector<float> yaw;
+        };
+
+        void reserve(const size_t capacity);
+
+        Entity spawn(const glm::vec3 &position, const float yaw, const GLuint render_handle);
+
+        void remove(const Entity entity);
+
+        void get_poses(Poses &poses) const;
+
+        void update_transforms(const Poses &from, const Poses &to, const float alpha);
+
+        /**
+         * @brief Run a system over all entities, split into chunks run in parallel on the
+         * job system. Chunks are disjoint, so a system may write the components of the
+         * entities of its chunk without synchronization.
+         *
+         * @param system Function taking the components, and the first and one past the
+         * last entity of a chunk.
+         * @param min_chunk_size Smallest number of entities worth a job of their own.
+         */
+        template <typename System>
+        void update(System &&system, const size_t min_chunk_size = entities_per_job)
+        {
+            const Components components = get_components();
+            parallel_for(
+                0,
+                size(),
+                [&system, &components](const size_t begin, const size_t end) {
+                    system(components, begin, end);
+                },
+                min_chunk_size);
+        }
+
+        Components get_components();
+
+        /**
+         * @return Number of entities.
+         */
+        size_t size() const
+        {
+            return yaw.size();
+        }
+
+        /**
+         * @return Model matrix of every entity.
+         */
+        const glm::mat4 *get_models() const
+        {
+            return model.data();
+        }
+
+        /**
+         * @return Render handle of every entity.
+         */
+        const GLuint *get_render_handles() const
+        {
+            return render_handle.data();
+        }
+
+    private:
+        /**
+         * Number of entities a system is run on per job by default.
+         */
+        static constexpr size_t entities_per_job = 1024;
+
+        /**
+         * Components.
+         * @{
+         */
+        std::vector<float> position_x;
+        std::vector<float> position_y;
+        std::vector<float> position_z;
+        std::vector<float> velocity_x;
+        std::vector<float> velocity_y;
+        std::vector<float> velocity_z;
+        std::vector<float> yaw;
+        std::vector<glm::mat4> model;
+        std::vector<GLuint> render_handle;
+        /**
+         * @}
+         */
+    };
+}
@@ -0,0 +1,125 @@
+#include "FileWatcher.h"
+
+#include "log.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor.
+     */
+    FileWatcher::FileWatcher(): fd(-1)
+    {}
+
+    /**
+     * @brief Destructor. Stops watching all directories.
+     */
+    FileWatcher::~FileWatcher()
+    {
+        if (fd != -1)
+        {
+            close(fd);
+        }
+    }
+
+    /**
+     * @brief Create the inotify instance.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool FileWatcher::init()
+    {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (unlikely(fd == -1))
+        {
+            LOG_ERROR("Failed to create inotify instance: %s\n", std::strerror(errno));
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Start watching a directory.
+     *
+     * @param directory Path to the directory, without a trailing slash. Changed files are
+     * reported as this path followed by their name.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool FileWatcher::watch(const std::string &directory)
+    {
+        const int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (unlikely(wd == -1))
+        {
+            LOG_ERROR("Failed to watch %s: %s\n", directory.c_str(), std::strerror(errno));
+            return false;
+        }
+
+        directories[wd] = directory;
+        LOG("Watching %s\n", directory.c_str());
+
+        return true;
+    }
+
+    /**
+     * @brief Get the files which changed since the last poll, without blocking. A file
+     * written several times is reported once.
+     *
+     * @param[out] changed_paths Paths to the changed files, cleared first.
+     */
+    void FileWatcher::poll(std::vector<std::string> &changed_paths)
+    {
+        changed_paths.clear();
+        if (unlikely(fd == -1))
+        {
+            return;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        while (true)
+        {
+            const ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0)
+            {
+                if (length == -1 && errno != EAGAIN)
+                {
+                    LOG_ERROR("Failed to read inotify events: %s\n", std::strerror(errno));
+                }
+                return;
+            }
+
+            for (ssize_t offset = 0; offset < length;)
+            {
+                const inotify_event *const event =
+                    reinterpret_cast<const inotify_event *>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                if (unlikely(event->mask & IN_Q_OVERFLOW))
+                {
+                    LOG_WARN("inotify queue overflowed, some changes were missed\n");
+                    continue;
+                }
+
+                const auto it = directories.find(event->wd);
+                if (event->len == 0 || it == directories.end())
+                {
+                    continue;
+                }
+
+                const std::string path = it->second + "/" + event->name;
+                if (std::find(changed_paths.begin(), changed_paths.end(), path) ==
+                    changed_paths.end())
+                {
+                    changed_paths.push_back(path);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Watches directories for files being written, through inotify.
+     *
+     * Only files which were closed after writing or moved into a watched directory are
+     * reported, which covers both editors which write in place and those which write a
+     * temporary file and rename it. Subdirectories are not watched, each directory must be
+     * added on its own.
+     */
+    class FileWatcher
+    {
+    public:
+        FileWatcher();
+
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher &) = delete;
+        FileWatcher &operator=(const FileWatcher &) = delete;
+
+        bool init();
+
+        bool watch(const std::string &directory);
+
+        void poll(std::vector<std::string> &changed_paths);
+
+    private:
+        /**
+         * inotify file descriptor, or -1.
+         */
+        int fd;
+
+        /**
+         * Watched directories by their watch descriptors.
+         */
+        std::unordered_map<int, std::string> directories;
+    };
+}
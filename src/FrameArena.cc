@@ -0,0 +1,74 @@
+#include "FrameArena.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor. No memory is allocated until the first allocation.
+     */
+    FrameArena::FrameArena(): block_idx(0), offset(0), num_bytes_used(0), capacity(0)
+    {}
+
+    /**
+     * @brief Allocate uninitialized memory, valid until the next reset.
+     *
+     * @param size Number of bytes.
+     * @param alignment Alignment of the memory, a power of two.
+     *
+     * @return The memory.
+     */
+    void *FrameArena::allocate(const size_t size, const size_t alignment)
+    {
+        /*
+         * Look for room in the current block, then in the blocks after it, which are left
+         * from earlier frames.
+         */
+        for (; block_idx < blocks.size(); block_idx++)
+        {
+            Block &block = blocks[block_idx];
+            const uintptr_t address = reinterpret_cast<uintptr_t>(block.data.get()) + offset;
+            const size_t padding = (alignment - address % alignment) % alignment;
+            if (likely(offset + padding + size <= block.size))
+            {
+                void *const memory = block.data.get() + offset + padding;
+                offset += padding + size;
+                num_bytes_used += size;
+                return memory;
+            }
+            offset = 0;
+        }
+
+        /*
+         * Blocks are allocated with operator new[], which aligns them for any fundamental
+         * type, so only for over-aligned types may the start of a block need padding.
+         */
+        const size_t new_block_size = std::max(block_size, size + alignment);
+        LOG("Growing frame arena by %zu KB\n", new_block_size / 1024);
+        blocks.push_back({
+            .data = std::make_unique<std::byte[]>(new_block_size),
+            .size = new_block_size,
+        });
+        capacity += new_block_size;
+
+        Block &block = blocks.back();
+        const uintptr_t address = reinterpret_cast<uintptr_t>(block.data.get());
+        const size_t padding = (alignment - address % alignment) % alignment;
+        offset = padding + size;
+        num_bytes_used += size;
+        return block.data.get() + padding;
+    }
+
+    /**
+     * @brief Free everything allocated from the arena, keeping its blocks for reuse.
+     */
+    void FrameArena::reset()
+    {
+        block_idx = 0;
+        offset = 0;
+        num_bytes_used = 0;
+    }
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "perf.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Linear allocator for data which lives for a frame.
+     *
+     * Allocating bumps an offset into a block of memory, and everything is freed at once by
+     * resetting the arena. Blocks are kept across resets, so once the arena has grown to
+     * fit a frame, allocating never touches the heap again. Only trivially destructible
+     * types may be allocated, since nothing is destroyed on reset.
+     */
+    class FrameArena
+    {
+    public:
+        /**
+         * @brief Growable array whose elements are allocated in an arena. The array does
+         * not own its storage: arrays are emptied with clear() when their arena is reset.
+         * Growing copies the elements into a new allocation twice the size, leaving the old
+         * one behind until the reset.
+         */
+        template <typename T>
+        class Array
+        {
+        public:
+            static_assert(std::is_trivially_copyable_v<T> &&
+                          std::is_trivially_destructible_v<T>);
+
+            Array(): elements(nullptr), count(0), capacity(0)
+            {}
+
+            /**
+             * @brief Append an element.
+             *
+             * @param arena Arena to grow the array in, the same on every call until the
+             * array is cleared.
+             * @param element Element to append.
+             */
+            void push_back(FrameArena &arena, const T &element)
+            {
+                if (unlikely(count == capacity))
+                {
+                    grow(arena);
+                }
+                new (&elements[count]) T(element);
+                count++;
+            }
+
+            /**
+             * @brief Empty the array and forget its storage.
+             */
+            void clear()
+            {
+                elements = nullptr;
+                count = 0;
+                capacity = 0;
+            }
+
+            T &operator[](const size_t idx)
+            {
+                return elements[idx];
+            }
+
+            const T &operator[](const size_t idx) const
+            {
+                return elements[idx];
+            }
+
+            T *begin()
+            {
+                return elements;
+            }
+
+            T *end()
+            {
+                return elements + count;
+            }
+
+            const T *begin() const
+            {
+                return elements;
+            }
+
+            const T *end() const
+            {
+                return elements + count;
+            }
+
+            size_t size() const
+            {
+                return count;
+            }
+
+            bool empty() const
+            {
+                return count == 0;
+            }
+
+        private:
+            /**
+             * Number of elements the array first allocates room for.
+             */
+            static constexpr size_t initial_capacity = 16;
+
+            void grow(FrameArena &arena)
+            {
+                const size_t new_capacity = capacity == 0 ? initial_capacity : 2 * capacity;
+                T *const new_elements = arena.allocate<T>(new_capacity);
+                if (count > 0)
+                {
+                    std::memcpy(static_cast<void *>(new_elements), elements, count * sizeof(T));
+                }
+                elements = new_elements;
+                capacity = new_capacity;
+            }
+
+            T *elements;
+            size_t count;
+            size_t capacity;
+        };
+
+        FrameArena();
+
+        FrameArena(const FrameArena &) = delete;
+        FrameArena &operator=(const FrameArena &) = delete;
+
+        void *allocate(const size_t size, const size_t alignment);
+
+        /**
+         * @brief Allocate uninitialized storage for an array.
+         *
+         * @param count Number of elements.
+         *
+         * @return The array.
+         */
+        template <typename T>
+        T *allocate(const size_t count)
+        {
+            static_assert(std::is_trivially_destructible_v<T>);
+            return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        /**
+         * @brief Allocate and construct an object.
+         *
+         * @param args Arguments to construct the object with.
+         *
+         * @return The object.
+         */
+        template <typename T, typename... Args>
+        T *create(Args &&...args)
+        {
+            static_assert(std::is_trivially_destructible_v<T>);
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        void reset();
+
+        /**
+         * @return Number of bytes allocated since the last reset.
+         */
+        size_t get_num_bytes_used() const
+        {
+            return num_bytes_used;
+        }
+
+        /**
+         * @return Number of bytes of all blocks.
+         */
+        size_t get_capacity() const
+        {
+            return capacity;
+        }
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<std::byte[]> data;
+            size_t size;
+        };
+
+        /**
+         * Size of the blocks, except for those made larger to fit a single allocation.
+         */
+        static constexpr size_t block_size = 1 << 20;
+
+        std::vector<Block> blocks;
+
+        /**
+         * Block which is currently allocated from, and the offset of its first free byte.
+         * @{
+         */
+        size_t block_idx;
+        size_t offset;
+        /**
+         * @}
+         */
+
+        size_t num_bytes_used;
+        size_t capacity;
+    };
+}
@@ -0,0 +1,248 @@
+#include "FrameStats.h"
+
+#include "log.h"
+#include "perf.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor.
+     */
+    FrameStats::FrameStats():
+        hitch_threshold_us(0),
+        num_hitches(0),
+        start_time(std::chrono::steady_clock::now()),
+        is_running(false),
+        export_file(nullptr),
+        is_first_trace_event(true),
+        ram_usage_MB(0)
+    {}
+
+    /**
+     * @brief Destructor.
+     */
+    FrameStats::~FrameStats()
+    {
+        stop();
+    }
+
+    /**
+     * @brief Open the export file, if any, and start counting frames.
+     *
+     * @param _options Options.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool FrameStats::init(const Options &_options)
+    {
+        options = _options;
+        start_time = std::chrono::steady_clock::now();
+        next_flush_time = start_time;
+        next_ram_usage_time = start_time;
+
+        if (options.export_format != ExportFormat::NONE)
+        {
+            export_file = std::fopen(options.export_path.c_str(), "w");
+            if (export_file == nullptr)
+            {
+                LOG_ERROR("Failed to open %s: %s\n",
+                          options.export_path.c_str(),
+                          std::strerror(errno));
+                return false;
+            }
+
+            if (options.export_format == ExportFormat::CSV)
+            {
+                std::fputs("frame,start_ms,dt_ms,hitch,ram_MB\n", export_file);
+            }
+            else
+            {
+                std::fputs("{\"traceEvents\":[\n", export_file);
+            }
+
+            LOG("Exporting frame stats to %s\n", options.export_path.c_str());
+        }
+
+        is_running = true;
+
+        return true;
+    }
+
+    /**
+     * @brief Flush the remaining frames, finish the export and log a summary. Called by the
+     * destructor if not called before.
+     */
+    void FrameStats::stop()
+    {
+        if (!is_running)
+        {
+            return;
+        }
+        is_running = false;
+
+        JobSystem::get().wait(flush_counter);
+        flushing_records.swap(pending_records);
+        flush();
+
+        if (export_file != nullptr)
+        {
+            if (options.export_format == ExportFormat::TRACE)
+            {
+                std::fputs("\n]}\n", export_file);
+            }
+            std::fclose(export_file);
+            export_file = nullptr;
+        }
+
+        LOG("Frame times over %lu frames: mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, "
+            "max %.3f ms, %lu hitches\n",
+            get_num_frames(),
+            get_mean_ms(),
+            get_percentile_ms(50.0),
+            get_percentile_ms(95.0),
+            get_percentile_ms(99.0),
+            get_max_ms(),
+            num_hitches);
+    }
+
+    /**
+     * @brief Count a frame.
+     *
+     * @param dt Duration of the frame which just ended in seconds.
+     */
+    void FrameStats::add_frame(const double dt)
+    {
+        const uint64_t dt_us = dt * 1e6;
+        histogram.add(dt_us);
+
+        const bool is_hitch = hitch_threshold_us != 0 && dt_us > hitch_threshold_us;
+        num_hitches += is_hitch;
+
+        if (unlikely(histogram.get_count() % hitch_threshold_period == 0))
+        {
+            hitch_threshold_us = hitch_factor * histogram.get_percentile(50.0);
+        }
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (options.export_format != ExportFormat::NONE)
+        {
+            const uint64_t end_us =
+                std::chrono::duration_cast<std::chrono::microseconds>(now - start_time).count();
+            pending_records.push_back({
+                .idx = histogram.get_count() - 1,
+                .start_us = end_us - std::min(dt_us, end_us),
+                .dt_us = dt_us,
+                .is_hitch = is_hitch,
+            });
+        }
+
+        /*
+         * If the previous flush is still going, try again next frame.
+         */
+        if (unlikely(is_running && now >= next_flush_time && flush_counter.is_done()))
+        {
+            flushing_records.swap(pending_records);
+            JobSystem::get().run_background([this]() { flush(); }, &flush_counter);
+            next_flush_time = now + flush_period;
+        }
+    }
+
+    /**
+     * @brief Read the resident set size if it is due and write out the frames handed to the
+     * flush.
+     */
+    void FrameStats::flush()
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= next_ram_usage_time)
+        {
+            unsigned long rss_pages = 0;
+            std::ifstream statm("/proc/self/statm");
+            statm >> rss_pages >> rss_pages;
+            ram_usage_MB.store(rss_pages * sysconf(_SC_PAGESIZE) / 1024 / 1024,
+                               std::memory_order_relaxed);
+
+            if (export_file != nullptr)
+            {
+                write_ram_usage(
+                    std::chrono::duration_cast<std::chrono::microseconds>(now - start_time)
+                        .count());
+            }
+
+            next_ram_usage_time = now + ram_usage_period;
+        }
+
+        if (export_file != nullptr)
+        {
+            write_records(flushing_records);
+        }
+        flushing_records.clear();
+    }
+
+    /**
+     * @brief Write frames to the export file.
+     *
+     * @param records Frames to write.
+     */
+    void FrameStats::write_records(const std::vector<FrameRecord> &records)
+    {
+        const unsigned long ram_MB = get_ram_usage_MB();
+        for (const FrameRecord &record : records)
+        {
+            if (options.export_format == ExportFormat::CSV)
+            {
+                std::fprintf(export_file,
+                             "%lu,%.3f,%.3f,%d,%lu\n",
+                             record.idx,
+                             record.start_us / 1e3,
+                             record.dt_us / 1e3,
+                             record.is_hitch,
+                             ram_MB);
+                continue;
+            }
+
+            std::fprintf(export_file,
+                         "%s{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%lu,"
+                         "\"dur\":%lu,\"args\":{\"frame\":%lu}}",
+                         is_first_trace_event ? "" : ",\n",
+                         record.start_us,
+                         record.dt_us,
+                         record.idx);
+            is_first_trace_event = false;
+
+            if (record.is_hitch)
+            {
+                std::fprintf(export_file,
+                             ",\n{\"name\":\"hitch\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,"
+                             "\"ts\":%lu}",
+                             record.start_us);
+            }
+        }
+    }
+
+    /**
+     * @brief Write the resident set size to the export file as a trace counter. CSV exports
+     * carry it as a column instead.
+     *
+     * @param time_us Time since start in microseconds.
+     */
+    void FrameStats::write_ram_usage(const uint64_t time_us)
+    {
+        if (options.export_format != ExportFormat::TRACE)
+        {
+            return;
+        }
+
+        std::fprintf(export_file,
+                     "%s{\"name\":\"ram\",\"ph\":\"C\",\"pid\":1,\"ts\":%lu,\"args\":{\"MB\":%lu}}",
+                     is_first_trace_event ? "" : ",\n",
+                     time_us,
+                     get_ram_usage_MB());
+        is_first_trace_event = false;
+    }
+}
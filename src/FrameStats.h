@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Histogram.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Frame time statistics for performance monitoring.
+     *
+     * Frame times are counted in a histogram in microseconds, from which percentiles are
+     * reported, and frames taking far longer than the median are counted as hitches.
+     * Optionally, every frame is also streamed to a CSV file or a Chrome trace (viewable in
+     * chrome://tracing or Perfetto).
+     *
+     * Anything which may block, i.e. writing the export and reading the resident set size
+     * from /proc, is done in a background job every flush_period, so the render
+     * thread only ever appends to an in-memory queue.
+     */
+    class FrameStats
+    {
+    public:
+        enum class ExportFormat : uint8_t
+        {
+            NONE,
+            CSV,
+            TRACE,
+        };
+
+        struct Options
+        {
+            ExportFormat export_format = ExportFormat::NONE;
+            std::string export_path;
+        };
+
+        FrameStats();
+
+        ~FrameStats();
+
+        FrameStats(const FrameStats &) = delete;
+        FrameStats &operator=(const FrameStats &) = delete;
+
+        bool init(const Options &options);
+
+        void stop();
+
+        void add_frame(const double dt);
+
+        /**
+         * @brief Get a frame time percentile over all frames so far.
+         *
+         * @param percentile Percentage in [0, 100].
+         *
+         * @return Frame time in milliseconds.
+         */
+        double get_percentile_ms(const double percentile) const
+        {
+            return histogram.get_percentile(percentile) / 1e3;
+        }
+
+        double get_max_ms() const
+        {
+            return histogram.get_max() / 1e3;
+        }
+
+        double get_mean_ms() const
+        {
+            return histogram.get_mean() / 1e3;
+        }
+
+        uint64_t get_num_frames() const
+        {
+            return histogram.get_count();
+        }
+
+        uint64_t get_num_hitches() const
+        {
+            return num_hitches;
+        }
+
+        /**
+         * @return Resident set size as of the last time the background thread read it.
+         */
+        unsigned long get_ram_usage_MB() const
+        {
+            return ram_usage_MB.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * A frame is a hitch if it takes longer than this many times the median.
+         */
+        static constexpr double hitch_factor = 2.0;
+
+        /**
+         * Number of frames between updates of the hitch threshold, and before the first
+         * update, during which no hitches are counted.
+         */
+        static constexpr uint64_t hitch_threshold_period = 64;
+
+        /**
+         * Frames are batched up and flushed this often rather than one at a time.
+         */
+        static constexpr std::chrono::milliseconds flush_period {100};
+
+        static constexpr std::chrono::milliseconds ram_usage_period {1000};
+
+        /**
+         * @brief A frame waiting to be exported.
+         */
+        struct FrameRecord
+        {
+            uint64_t idx;
+            uint64_t start_us;
+            uint64_t dt_us;
+            bool is_hitch;
+        };
+
+        void flush();
+
+        void write_records(const std::vector<FrameRecord> &records);
+
+        void write_ram_usage(const uint64_t time_us);
+
+        Histogram histogram;
+        uint64_t hitch_threshold_us;
+        uint64_t num_hitches;
+
+        std::chrono::steady_clock::time_point start_time;
+
+        Options options;
+
+        bool is_running;
+
+        /**
+         * Frames not handed to a flush yet.
+         */
+        std::vector<FrameRecord> pending_records;
+        std::chrono::steady_clock::time_point next_flush_time;
+
+        /**
+         * State only accessed by the flush job while one is in flight.
+         * @{
+         */
+        std::vector<FrameRecord> flushing_records;
+        std::chrono::steady_clock::time_point next_ram_usage_time;
+        std::FILE *export_file;
+        bool is_first_trace_event;
+        /**
+         * @}
+         */
+
+        /**
+         * At most one flush is in flight at a time, so they never write out of order.
+         */
+        JobSystem::Counter flush_counter;
+
+        std::atomic<unsigned long> ram_usage_MB;
+    };
+}
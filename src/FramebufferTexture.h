@@ -1,9 +1,11 @@
 #pragma once
 
+#include "GLState.h"
 #include "assert_util.h"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <stb/stb_image.h>
 #include <string>
 
@@ -12,7 +14,7 @@ namespace Engine
     class FramebufferTexture
     {
     public:
-        FramebufferTexture()
+        FramebufferTexture(): target(GL_TEXTURE_2D)
         {}
 
         /**
@@ -35,6 +37,8 @@ namespace Engine
             height = _height;
             attachment = _attachment;
             slot = _slot;
+            target = GL_TEXTURE_2D;
+            num_levels = 1;
 
             glGenTextures(1, &texture_id);
             glBindTexture(GL_TEXTURE_2D, texture_id);
@@ -59,13 +63,158 @@ namespace Engine
                 attachment - GL_COLOR_ATTACHMENT0);
         }
 
+        /**
+         * @brief Create a texture array whose layers are each attached to a different
+         * framebuffer with attach_layer().
+         *
+         * @param _width Width of each layer in pixels.
+         * @param _height Height of each layer in pixels.
+         * @param num_layers Number of layers.
+         */
+        void create_layered(const GLsizei _width,
+                            const GLsizei _height,
+                            const GLsizei num_layers,
+                            const GLenum _attachment,
+                            const GLenum _slot,
+                            const GLint internal_format,
+                            const GLint format,
+                            const GLenum min_filter,
+                            const GLenum max_filter,
+                            const GLint wrap_mode)
+        {
+            width = _width;
+            height = _height;
+            attachment = _attachment;
+            slot = _slot;
+            target = GL_TEXTURE_2D_ARRAY;
+            num_levels = 1;
+
+            glGenTextures(1, &texture_id);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY,
+                         0,
+                         internal_format,
+                         width,
+                         height,
+                         num_layers,
+                         0,
+                         format,
+                         GL_FLOAT,
+                         nullptr);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, min_filter);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, max_filter);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap_mode);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap_mode);
+
+            if (wrap_mode == GL_CLAMP_TO_BORDER)
+            {
+                float border_color[] = {1.0f, 1.0f, 1.0f, 1.0f};
+                glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border_color);
+            }
+
+            LOG("Created layered framebuffer texture id: 0x%x, slot: %u, layers: %d\n",
+                texture_id,
+                slot,
+                num_layers);
+        }
+
+        /**
+         * @brief Create a texture with a chain of mip levels, each of which can be attached
+         * to a different framebuffer with attach_level().
+         *
+         * @param _width Width of the first level in pixels.
+         * @param _height Height of the first level in pixels.
+         * @param _num_levels Number of levels, each half the size of the previous one.
+         * @param internal_format Sized internal format.
+         */
+        void create_mipmapped(const GLsizei _width,
+                              const GLsizei _height,
+                              const GLsizei _num_levels,
+                              const GLenum _attachment,
+                              const GLenum _slot,
+                              const GLenum internal_format,
+                              const GLenum filter,
+                              const GLint wrap_mode)
+        {
+            width = _width;
+            height = _height;
+            attachment = _attachment;
+            slot = _slot;
+            target = GL_TEXTURE_2D;
+            num_levels = _num_levels;
+
+            glGenTextures(1, &texture_id);
+            glBindTexture(GL_TEXTURE_2D, texture_id);
+            glTexStorage2D(GL_TEXTURE_2D, num_levels, internal_format, width, height);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
+
+            LOG("Created mipmapped framebuffer texture id: 0x%x, slot: %u, levels: %d\n",
+                texture_id,
+                slot,
+                num_levels);
+        }
+
+        /**
+         * @brief Attach one mip level of the texture to the bound framebuffer.
+         *
+         * @param level Level to attach.
+         */
+        void attach_level(const GLint level) const
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture_id, level);
+        }
+
+        /**
+         * @brief Restrict sampling to a single mip level, so that the texture can be
+         * sampled while another of its levels is being rendered to. Also uses the texture.
+         *
+         * @param level Level to sample.
+         */
+        void sample_level(const GLint level) const
+        {
+            use();
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level);
+        }
+
+        /**
+         * @brief Attach one layer of a layered texture to the bound framebuffer.
+         *
+         * @param layer Layer to attach.
+         */
+        void attach_layer(const GLint layer) const
+        {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, texture_id, 0, layer);
+        }
+
         /**
          * @brief Use the texture.
          */
         void use() const
         {
             glActiveTexture(GL_TEXTURE0 + slot);
-            glBindTexture(GL_TEXTURE_2D, texture_id);
+            glBindTexture(target, texture_id);
+        }
+
+        /**
+         * @brief Use the texture unless it is already bound to its slot.
+         *
+         * @param state Tracked GL state.
+         */
+        void use(GLState &state) const
+        {
+            state.bind_texture(slot, target, texture_id);
+        }
+
+        /**
+         * @return OpenGL texture ID.
+         */
+        GLuint get_id() const
+        {
+            return texture_id;
         }
 
         /**
@@ -100,11 +249,37 @@ namespace Engine
             return height;
         }
 
+        /**
+         * @return Number of mip levels.
+         */
+        GLsizei get_num_levels() const
+        {
+            return num_levels;
+        }
+
+        /**
+         * @return Width of a mip level in pixels.
+         */
+        int get_level_width(const GLint level) const
+        {
+            return std::max(width >> level, 1);
+        }
+
+        /**
+         * @return Height of a mip level in pixels.
+         */
+        int get_level_height(const GLint level) const
+        {
+            return std::max(height >> level, 1);
+        }
+
     private:
         GLuint texture_id;
+        GLenum target;
         GLenum attachment;
         uint8_t slot;
         int width;
         int height;
+        GLsizei num_levels;
     };
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace Engine
+{
+    /**
+     * @brief Axis-aligned bounding box in world space.
+     */
+    struct BoundingBox
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+
+        /**
+         * @return Distance from @p point to the closest point of the box, 0 if inside.
+         */
+        float distance_to(const glm::vec3 &point) const
+        {
+            const glm::vec3 closest = glm::clamp(point, min, max);
+            return glm::length(point - closest);
+        }
+    };
+
+    /**
+     * @brief View frustum described by six clip planes, usable for both perspective and
+     * orthographic projections.
+     */
+    class Frustum
+    {
+    public:
+        /**
+         * @brief Extract the frustum planes from a view projection matrix.
+         *
+         * Each plane is a combination of the rows of the matrix such that a point p is
+         * on the inner side of the plane when dot(plane, (p, 1)) >= 0.
+         *
+         * @param view_projection View projection matrix.
+         */
+        Frustum(const glm::mat4 &view_projection)
+        {
+            const glm::vec4 row0(view_projection[0][0],
+                                 view_projection[1][0],
+                                 view_projection[2][0],
+                                 view_projection[3][0]);
+            const glm::vec4 row1(view_projection[0][1],
+                                 view_projection[1][1],
+                                 view_projection[2][1],
+                                 view_projection[3][1]);
+            const glm::vec4 row2(view_projection[0][2],
+                                 view_projection[1][2],
+                                 view_projection[2][2],
+                                 view_projection[3][2]);
+            const glm::vec4 row3(view_projection[0][3],
+                                 view_projection[1][3],
+                                 view_projection[2][3],
+                                 view_projection[3][3]);
+
+            planes = {
+                row3 + row0, /* left */
+                row3 - row0, /* right */
+                row3 + row1, /* bottom */
+                row3 - row1, /* top */
+                row3 + row2, /* near */
+                row3 - row2, /* far */
+            };
+        }
+
+        /**
+         * @brief Test whether a bounding box is at least partially inside the frustum.
+         *
+         * For each plane, only the corner of the box furthest along the plane normal is
+         * tested. If even that corner is behind the plane, the whole box is outside.
+         *
+         * @param box Bounding box to test.
+         *
+         * @return True if the box may be visible, otherwise false.
+         */
+        bool intersects(const BoundingBox &box) const
+        {
+            for (const glm::vec4 &plane : planes)
+            {
+                const glm::vec3 furthest(plane.x >= 0.f ? box.max.x : box.min.x,
+                                         plane.y >= 0.f ? box.max.y : box.min.y,
+                                         plane.z >= 0.f ? box.max.z : box.min.z);
+                if (plane.x * furthest.x + plane.y * furthest.y + plane.z * furthest.z + plane.w <
+                    0.f)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        /**
+         * Left, right, bottom, top, near and far planes.
+         */
+        std::array<glm::vec4, 6> planes;
+    };
+}
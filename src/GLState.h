@@ -0,0 +1,194 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <array>
+
+namespace Engine
+{
+    /**
+     * @brief Shadow of the OpenGL binding state, so that binding what is already bound
+     * costs no GL call.
+     *
+     * Only binds made through this class are tracked. Anything else binding programs, vertex
+     * arrays, textures or framebuffers, e.g. resource creation or the GUI, leaves the shadow
+     * out of date, so it must be invalidated before being relied on again.
+     */
+    class GLState
+    {
+    public:
+        static constexpr size_t max_texture_units = 16;
+        static constexpr size_t max_draw_buffers = 8;
+
+        GLState()
+        {
+            begin_frame();
+        }
+
+        /**
+         * @brief Forget all bindings, causing the next bind of everything to be issued.
+         */
+        void invalidate()
+        {
+            program = unknown;
+            vertex_array = unknown;
+            framebuffer = unknown;
+            active_texture_unit = unknown;
+            textures.fill({GL_NONE, unknown});
+            num_draw_buffers = -1;
+        }
+
+        /**
+         * @brief Invalidate the state and reset the statistics, once per frame.
+         */
+        void begin_frame()
+        {
+            invalidate();
+            num_calls = 0;
+            num_calls_skipped = 0;
+        }
+
+        void use_program(const GLuint _program)
+        {
+            if (is_bound(program, _program))
+            {
+                return;
+            }
+            glUseProgram(_program);
+        }
+
+        void bind_vertex_array(const GLuint _vertex_array)
+        {
+            if (is_bound(vertex_array, _vertex_array))
+            {
+                return;
+            }
+            glBindVertexArray(_vertex_array);
+        }
+
+        /**
+         * @brief Bind a framebuffer to GL_FRAMEBUFFER. Draw buffers are state of the
+         * framebuffer, so they are forgotten when it changes.
+         *
+         * @param _framebuffer Framebuffer to bind.
+         */
+        void bind_framebuffer(const GLuint _framebuffer)
+        {
+            if (is_bound(framebuffer, _framebuffer))
+            {
+                return;
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+            num_draw_buffers = -1;
+        }
+
+        /**
+         * @brief Bind a texture to a texture unit.
+         *
+         * @param unit Texture unit, below max_texture_units.
+         * @param target Texture target.
+         * @param texture Texture to bind.
+         */
+        void bind_texture(const GLuint unit, const GLenum target, const GLuint texture)
+        {
+            BoundTexture &bound = textures[unit];
+            num_calls++;
+            if (bound.target == target && bound.texture == texture)
+            {
+                num_calls_skipped++;
+                return;
+            }
+
+            if (active_texture_unit != unit)
+            {
+                glActiveTexture(GL_TEXTURE0 + unit);
+                active_texture_unit = unit;
+            }
+            glBindTexture(target, texture);
+            bound = {target, texture};
+        }
+
+        /**
+         * @brief Select the color attachments of the bound framebuffer to draw into.
+         *
+         * @param count Number of buffers, at most max_draw_buffers.
+         * @param buffers Buffers to draw into.
+         */
+        void set_draw_buffers(const GLsizei count, const GLenum *buffers)
+        {
+            num_calls++;
+            if (num_draw_buffers == count &&
+                std::equal(buffers, buffers + count, draw_buffers.data()))
+            {
+                num_calls_skipped++;
+                return;
+            }
+
+            glDrawBuffers(count, buffers);
+            std::copy(buffers, buffers + count, draw_buffers.data());
+            num_draw_buffers = count;
+        }
+
+        /**
+         * @return Number of binds requested since begin_frame().
+         */
+        size_t get_num_calls() const
+        {
+            return num_calls;
+        }
+
+        /**
+         * @return Number of binds since begin_frame() which were skipped since they were
+         * redundant.
+         */
+        size_t get_num_calls_skipped() const
+        {
+            return num_calls_skipped;
+        }
+
+    private:
+        /**
+         * Binding which is not known, matching no real object.
+         */
+        static constexpr GLuint unknown = static_cast<GLuint>(-1);
+
+        struct BoundTexture
+        {
+            GLenum target;
+            GLuint texture;
+        };
+
+        /**
+         * @brief Count a bind and record the new binding.
+         *
+         * @param bound Recorded binding.
+         * @param object Object to bind.
+         *
+         * @return True if @p object is already bound, otherwise false.
+         */
+        bool is_bound(GLuint &bound, const GLuint object)
+        {
+            num_calls++;
+            if (bound == object)
+            {
+                num_calls_skipped++;
+                return true;
+            }
+
+            bound = object;
+            return false;
+        }
+
+        GLuint program;
+        GLuint vertex_array;
+        GLuint framebuffer;
+        GLuint active_texture_unit;
+        std::array<BoundTexture, max_texture_units> textures;
+
+        GLsizei num_draw_buffers;
+        std::array<GLenum, max_draw_buffers> draw_buffers;
+
+        size_t num_calls;
+        size_t num_calls_skipped;
+    };
+}
@@ -1,16 +1,20 @@
 #include "Game.h"
 
+#include "Heightmap.h"
 #include "Vertex.h"
 #include "assert_util.h"
 #include "log.h"
 #include "perf.h"
 
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <array>
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_opengl3.h>
+#include <cfloat>
+#include <cmath>
 #include <execinfo.h>
-#include <fstream>
+#include <glm/common.hpp>
 #include <glm/ext/scalar_constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <imgui.h>
@@ -75,8 +79,13 @@ namespace Engine
     /**
      * Constructor.
      */
-    Game::Game():
+    Game::Game(const Options &_options):
+        options(_options),
         window(nullptr),
+        is_simulation_stopping(false),
+        simulation_inputs {},
+        pending_simulation_inputs {},
+        snapshots {},
         state(State::RUNNING),
         state_prev(State::RUNNING),
         window_center_x(0),
@@ -89,6 +98,9 @@ namespace Engine
         keyboard_inputs {},
         player_position(0.f, player_height, 0.f),
         player_velocity(0.f, 0.f, 0.f),
+        player_speed(0.f),
+        terrain_height(0.f),
+        on_ground_camera_y(0.f),
         last_crouch_time(std::chrono::steady_clock::now()),
         time_since_start(0.0),
         escape_pressed_prev(false),
@@ -101,85 +113,36 @@ namespace Engine
         right(0.f, 0.f, 0.f),
         forwards(0.f, 0.f, 0.f),
         head(0.f, 0.f, 0.f),
-        chaser_position(0.f, 0.f, 10.f),
         point_light_position(150.f, 100.f, 120.f),
+        point_light_velocity(20.f),
         orbital_angle(glm::pi<float>()),
-        stats_dt_buffer {},
-        stats_dt_buffer_idx(0),
-        stats_frames(0),
-        stats_dt_sum(0),
-        stats_dt_sq_sum(0),
+        snapshot {},
+        stats_free_vram_MB(0),
+        stats_total_vram_MB(0),
+        next_camera_keyframe_time(0.0),
         pause_menu(*this, renderer)
     {}
 
     /**
-     * Create and initialize instance of a Game.
-     *
-     * @return Instance of game on success, otherwise nullptr.
+     * Destructor.
      */
-    std::unique_ptr<Game> Game::create()
+    Game::~Game()
     {
-        std::unique_ptr<Game> new_game(new Game());
-        ASSERT_RET_IF_NOT(new_game->init(), nullptr);
-        return new_game;
+        stop_simulation();
     }
 
     /**
-     * @brief Apply a Gaussian blur to the given heightmap.
+     * Create and initialize instance of a Game.
      *
-     * @param[inout] heightmap Heightmap data.
-     * @param num_rows Number of rows in the heightmap.
-     * @param num_cols Number of columns in the heightmap.
-     * @param dimensions Number of dimensions in the heightmap.
-     * @param iterations Number of times to apply the blur.
+     * @param options Options given on the command line.
+     *
+     * @return Instance of game on success, otherwise nullptr.
      */
-    static void gaussian_blur(uint8_t *heightmap,
-                              const int num_rows,
-                              const int num_cols,
-                              const int dimensions,
-                              const uint8_t iterations)
+    std::unique_ptr<Game> Game::create(const Options &options)
     {
-        for (uint8_t i = 0; i < iterations; i++)
-        {
-            /*
-             * Copy original heightmap for reference.
-             */
-            std::vector<uint8_t> heightmap_original(heightmap,
-                                                    heightmap + num_rows * num_cols * dimensions);
-
-            const float kernel[3][3] = {{1, 2, 1}, {2, 4, 2}, {1, 2, 1}};
-
-            /*
-             * Apply blur.
-             */
-            for (int row = 0; row < num_rows; row++)
-            {
-                for (int col = 0; col < num_cols; col++)
-                {
-                    float sum = 0.f;
-                    float weight_sum = 0.f;
-
-                    for (int kernel_z = -1; kernel_z <= 1; kernel_z++)
-                    {
-                        for (int kernel_x = -1; kernel_x <= 1; kernel_x++)
-                        {
-                            int height_kerneled = col + kernel_x;
-                            int row_kerneled = row + kernel_z;
-                            height_kerneled = glm::clamp(height_kerneled, 0, num_cols - 1);
-                            row_kerneled = glm::clamp(row_kerneled, 0, num_rows - 1);
-
-                            const float kern = kernel[kernel_z + 1][kernel_x + 1];
-                            sum += heightmap_original[(row_kerneled * num_cols + height_kerneled) *
-                                                      dimensions] *
-                                   kern;
-                            weight_sum += kern;
-                        }
-                    }
-
-                    heightmap[(row * num_cols + col) * dimensions] = sum / weight_sum;
-                }
-            }
-        }
+        std::unique_ptr<Game> new_game(new Game(options));
+        ASSERT_RET_IF_NOT(new_game->init(), nullptr);
+        return new_game;
     }
 
     /**
@@ -191,11 +154,23 @@ namespace Engine
     {
         LOG("Creating window\n");
 
-        glfwWindowHint(GLFW_SAMPLES, 16);              /* 16x antialiasing */
+        /*
+         * The scene is rendered off-screen and post-processing is blitted into the window,
+         * which a multisampled default frame buffer could not take.
+         */
+        glfwWindowHint(GLFW_SAMPLES, 0);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4); /* OpenGL 4.6 */
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+        /*
+         * The benchmark needs no input, so its window stays hidden.
+         */
+        if (options.benchmark.num_frames > 0)
+        {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        }
+
         /*
          * Create window.
          */
@@ -236,11 +211,6 @@ namespace Engine
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         glEnable(GL_BLEND);
 
-        /*
-         * Enable anti-aliasing.
-         */
-        glEnable(GL_MULTISAMPLE);
-
         LOG("Initializing GLEW\n");
         ASSERT_RET_IF_GLEW_NOT_OK(glewInit(), false);
 
@@ -264,11 +234,19 @@ namespace Engine
         glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &stats_total_vram_MB);
         stats_total_vram_MB /= 1024;
 
+        ASSERT_RET_IF_NOT(frame_stats.init(options.stats), false);
+
         /*
          * Create screen frame buffer.
          */
         LOG("Initializing renderer\n");
-        renderer.init(window_width, window_height);
+        ASSERT_RET_IF_NOT(renderer.init(window_width, window_height), false);
+        if (options.frame_budget_ms > 0.f)
+        {
+            DynamicResolution &dynamic_resolution = renderer.get_dynamic_resolution();
+            dynamic_resolution.set_frame_budget_ms(options.frame_budget_ms);
+            dynamic_resolution.set_enabled(true);
+        }
 
         /*
          * Create chaser buffers.
@@ -334,208 +312,168 @@ namespace Engine
 
         LOG("Loading textures\n");
         {
-            ASSERT_RET_IF_NOT(chaser_textured_material.create_from_file("textures/snake.jpg",
+            TextureLoader &loader = renderer.get_texture_loader();
+            ASSERT_RET_IF_NOT(chaser_textured_material.create_from_file(loader,
+                                                                        "textures/snake.jpg",
                                                                         0 /* slot */),
                               false);
-            ASSERT_RET_IF_NOT(chaser_normal_map.create_from_file("textures/snake_normals.jpg",
-                                                                 1 /* slot */),
+            ASSERT_RET_IF_NOT(chaser_normal_map.create_from_file(loader,
+                                                                 "textures/snake_normals.jpg",
+                                                                 1 /* slot */,
+                                                                 Texture::placeholder_normal),
+                              false);
+            ASSERT_RET_IF_NOT(dirt_textured_material.create_from_file(loader,
+                                                                      "textures/dirt.jpg",
+                                                                      0 /* slot */),
+                              false);
+            ASSERT_RET_IF_NOT(dirt_normal_map.create_from_file(loader,
+                                                               "textures/dirt_normals.jpg",
+                                                               1 /* slot */,
+                                                               Texture::placeholder_normal),
                               false);
-            ASSERT_RET_IF_NOT(
-                dirt_textured_material.create_from_file("textures/dirt.jpg", 0 /* slot */), false);
-            ASSERT_RET_IF_NOT(
-                dirt_normal_map.create_from_file("textures/dirt_normals.jpg", 1 /* slot */), false);
         }
 
-        LOG("Loading terrain heightmaps\n");
+        /*
+         * Reload shaders and textures when their files change. The game runs the same
+         * without it, so failing to set it up is not fatal.
+         */
+        if (file_watcher.init() && renderer.start_hot_reload(window))
         {
-            stbi_set_flip_vertically_on_load(0);
-            int terrain_num_rows;
-            int terrain_channels;
-            uint8_t *_heightmap = stbi_load("terrain/iceland_heightmap.png",
-                                            &terrain_num_cols,
-                                            &terrain_num_rows,
-                                            &terrain_channels,
-                                            0);
-            ASSERT_RET_IF_NOT(_heightmap, false);
-
-            /*
-             * Wrap in RAII container for automatic freeing.
-             */
-            std::unique_ptr<uint8_t[]> heightmap(_heightmap);
-
-            /*
-             * First, apply a Gaussian blur to the heightmap to smooth out sharp edges.
-             */
-            gaussian_blur(heightmap.get(),
-                          terrain_num_rows,
-                          terrain_num_cols,
-                          terrain_channels,
-                          2 /* iterations */);
+            for (const char *const directory :
+                 {"shaders", "shaders/include", "textures", "textures/skybox"})
+            {
+                file_watcher.watch(directory);
+            }
+        }
+        else
+        {
+            LOG_WARN("Hot reload is disabled\n");
+        }
 
-            /*
-             * We need to have a right-handed coordinate system. If we choose to map the
-             * heightmap image to:
-             *
-             *          +z
-             *           o   / +y
-             *           |  /
-             *           | /
-             *   -x o----o----o +x
-             *           |
-             *           |
-             *           o
-             *          -z
-             *
-             * Then Y must point into the the screen. This means that the height values
-             * in the heightmap would turn to depth values which is wrong and if we try
-             * to reverse those effects, we will end up flipping the X or Z axis weirdly
-             * enough. Therefore, we map the heightmap image to:
-             *
-             *          -z
-             *           o
-             *           |
-             *           |
-             *   -x o----o----o +x
-             *         / |
-             *        /  |
-             *    +y /   o
-             *          +z
-             */
-            terrain_z_middle = terrain_num_rows / 2.f;
-            terrain_x_middle = terrain_num_cols / 2.f;
+        LOG("Loading terrain\n");
+        {
+            static constexpr const char *heightmap_path = "terrain/iceland_heightmap.png";
+            static constexpr const char *tiles_path = "terrain/iceland_heightmap.tiles";
+            static constexpr int blur_iterations = 2;
             static constexpr float y_top = 64.f;
             static constexpr float y_bottom = -27.f;
-            float y_scale = y_top / 0xFF;
-
-            const unsigned int num_vertices = terrain_num_rows * terrain_num_cols;
-            static constexpr unsigned int num_indices_per_vertex = 6;
-            const unsigned int num_indices =
-                (terrain_num_rows - 1) * (terrain_num_cols - 1) * num_indices_per_vertex;
+            static constexpr float y_scale = y_top / 0xFF;
+            static constexpr int tile_size = 512;
 
             /*
-             * Draw one copy of the texture per cell.
+             * The terrain is streamed from tiles written from the heightmap, keyed on the
+             * heightmap contents and everything it is processed with. If the tiles are
+             * valid, the heightmap is not even decoded.
              */
-            std::vector<Vertex3dNormal> vertices;
-            vertices.reserve(num_vertices);
-
-            std::vector<unsigned int> indices;
-            indices.reserve(num_indices);
-
-            xz_to_height_map.reserve(num_vertices);
+            TerrainTileFile::Key tiles_key = {
+                .source_hash = 0,
+                .blur_iterations = blur_iterations,
+                .y_scale = y_scale,
+                .y_bottom = y_bottom,
+            };
+            ASSERT_RET_IF_NOT(TerrainTileFile::hash_file(heightmap_path, tiles_key.source_hash),
+                              false);
 
-            /*
-             * Compute vertices and indices iterating from the top row to the bottom row
-             * and from the left column to the right column.
-             */
-            for (int row = 0; row < terrain_num_rows; row++)
+            if (!terrain_tiles.open(tiles_path, tiles_key))
             {
-                for (int col = 0; col < terrain_num_cols; col++)
-                {
-                    const uint8_t y = heightmap[(terrain_num_cols * row + col) * terrain_channels];
-
-                    Vertex3dNormal &vertex = vertices.emplace_back();
+                /*
+                 * Only the first channel is used, so it is the only one decoded.
+                 */
+                stbi_set_flip_vertically_on_load(0);
+                int terrain_num_rows;
+                int terrain_num_cols;
+                int terrain_channels;
+                uint8_t *_heightmap = stbi_load(heightmap_path,
+                                                &terrain_num_cols,
+                                                &terrain_num_rows,
+                                                &terrain_channels,
+                                                1);
+                ASSERT_RET_IF_NOT(_heightmap, false);
 
-                    vertex.position = {
-                        col - terrain_x_middle,
-                        y * y_scale + y_bottom,
-                        row - terrain_z_middle,
-                    };
+                /*
+                 * Wrap in RAII container for automatic freeing.
+                 */
+                std::unique_ptr<uint8_t[]> pixels(_heightmap);
 
-                    xz_to_height_map.push_back(vertex.position.y);
+                Heightmap heightmap;
+                ASSERT_RET_IF_NOT(
+                    heightmap.create(pixels.get(), terrain_num_rows, terrain_num_cols, 1),
+                    false);
+                pixels.reset();
 
-                    /*
-                     * If we are not on the bottom row or rightmost column, wind the
-                     * triangles.
-                     */
-                    if (row != terrain_num_rows - 1 && col != terrain_num_cols - 1)
-                    {
-                        const int this_vertex = terrain_num_cols * row + col;
-                        const int right_vertex = this_vertex + 1;
-                        const int bottom_vertex = terrain_num_cols * (row + 1) + col;
-                        const int bottom_right_vertex = bottom_vertex + 1;
-
-                        indices.push_back(this_vertex);
-                        indices.push_back(bottom_vertex);
-                        indices.push_back(right_vertex);
-
-                        indices.push_back(right_vertex);
-                        indices.push_back(bottom_vertex);
-                        indices.push_back(bottom_right_vertex);
-                    }
-                }
-            }
+                /*
+                 * First, apply a Gaussian blur to the heightmap to smooth out sharp edges.
+                 */
+                heightmap.blur(blur_iterations);
 
-            /*
-             * Accumulate normals, tangents, and bitangents for each vertex in each
-             * triangle.
-             */
-            std::vector<glm::vec3> tangents;
-            std::vector<glm::vec3> bitangents;
-            tangents.reserve(vertices.size());
-            bitangents.reserve(vertices.size());
-            for (size_t i = 0; i < indices.size(); i += 3)
-            {
                 /*
-                 *             e2
-                 *     v0------->---------v2
-                 *     |                  /
-                 *     |     +         /
-                 *     |            /
-                 * e1 \ /        /
-                 *     |      /
-                 *     |   /
-                 *     |/
-                 *     v1
+                 * We need to have a right-handed coordinate system. If we choose to map the
+                 * heightmap image to:
+                 *
+                 *          +z
+                 *           o   / +y
+                 *           |  /
+                 *           | /
+                 *   -x o----o----o +x
+                 *           |
+                 *           |
+                 *           o
+                 *          -z
+                 *
+                 * Then Y must point into the the screen. This means that the height values
+                 * in the heightmap would turn to depth values which is wrong and if we try
+                 * to reverse those effects, we will end up flipping the X or Z axis weirdly
+                 * enough. Therefore, we map the heightmap image to:
                  *
-                 *                     v0
-                 *                    /|
-                 *                 /   |
-                 *         e1   /      |
-                 *          /_        \ / e2
-                 *        /            |
-                 *     /       +       |
-                 *  /                  |
-                 * v1------------------v2
+                 *          -z
+                 *           o
+                 *           |
+                 *           |
+                 *   -x o----o----o +x
+                 *         / |
+                 *        /  |
+                 *    +y /   o
+                 *          +z
                  */
-
-                const size_t idx0 = indices[i + 0];
-                const size_t idx1 = indices[i + 1];
-                const size_t idx2 = indices[i + 2];
-
-                Vertex3dNormal &v0 = vertices[idx0];
-                Vertex3dNormal &v1 = vertices[idx1];
-                Vertex3dNormal &v2 = vertices[idx2];
-
-                const glm::vec3 e1 = v1.position - v0.position;
-                const glm::vec3 e2 = v2.position - v0.position;
+                const int x_middle = terrain_num_cols / 2;
+                const int z_middle = terrain_num_rows / 2;
 
                 /*
-                 * Compute face normal.
+                 * The tiles are written a band of rows at a time straight from the 8-bit
+                 * heightmap, which spans y_bottom up to y_bottom + 0xFF * y_scale.
                  */
-                const glm::vec3 face_normal = glm::normalize(glm::cross(e1, e2));
-                v0.norm += face_normal;
-                v1.norm += face_normal;
-                v2.norm += face_normal;
+                const auto get_rows = [&heightmap](const int row_begin,
+                                                   const int num_rows,
+                                                   float *heights) {
+                    heightmap.get_heights(row_begin, num_rows, y_bottom, y_scale, heights);
+                };
+                ASSERT_RET_IF_NOT(TerrainTileFile::write(tiles_path,
+                                                         tiles_key,
+                                                         get_rows,
+                                                         terrain_num_rows,
+                                                         terrain_num_cols,
+                                                         glm::vec2(-x_middle, -z_middle),
+                                                         y_bottom,
+                                                         0xFF * y_scale,
+                                                         tile_size),
+                                  false);
+                ASSERT_RET_IF_NOT(terrain_tiles.open(tiles_path, tiles_key), false);
             }
 
+            terrain_min = terrain_tiles.get_origin();
+            terrain_max = terrain_min + glm::vec2(terrain_tiles.get_num_cols() - 1,
+                                                  terrain_tiles.get_num_rows() - 1);
+
             /*
-             * Finalize normals, tangents, and bitangents for each vertex.
+             * Load the tiles around the player before the first frame, the rest stream in
+             * as the player moves.
              */
-            for (size_t i = 0; i < vertices.size(); i += 1)
-            {
-                Vertex3dNormal &vertex = vertices[i];
-
-                /*
-                 * Average to produce normal.
-                 */
-                vertex.norm = glm::normalize(vertex.norm);
-            }
-
-            terrain_vertex_array.create(vertices.data(), vertices.size());
-            Vertex3dNormal::setup_vertex_array_attribs(terrain_vertex_array);
-            terrain_index_buffer.create(indices.data(), indices.size());
+            ASSERT_RET_IF_NOT(terrain_streamer.init(terrain_tiles), false);
+            ASSERT_RET_IF_NOT(terrain_streamer.load_around(player_position), false);
         }
 
+        ASSERT_RET_IF_NOT(benchmark.init(options.benchmark, terrain_streamer), false);
+
         LOG("Initializing GUI\n");
         ImGui::CreateContext();
         ImGui::StyleColorsDark();
@@ -557,6 +495,7 @@ namespace Engine
 
         if (!_init())
         {
+            renderer.stop_hot_reload();
             glfwTerminate();
             return false;
         }
@@ -564,79 +503,6 @@ namespace Engine
         return true;
     }
 
-    /**
-     * @brief Convert a cell coordinate to the height at that cell.
-     *
-     * @param cell_x X cell coordinate.
-     * @param cell_z Z cell coordinate.
-     *
-     * @return Terrain height.
-     */
-    float Game::cell_to_height(const int cell_x, const int cell_z) const
-    {
-        return xz_to_height_map[terrain_num_cols * cell_z + cell_x];
-    }
-
-    /**
-     * @return Terrain height at given (x, z) world coordinates.
-     *
-     * @param x X world coordinate.
-     * @param z Z world coordinate.
-     */
-    float Game::get_terrain_height(const float x, const float z) const
-    {
-        /*
-         * Convert from world coordinates to heightmap coordinates. To be smooth,
-         * linearly interpolate the height between the 3 vertices of the triangle the
-         * point is in.
-         *
-         *     |
-         *     |   0--2
-         *     |   |P/|
-         *     |   |/ |
-         *     |   1--3
-         * x ---------------
-         *     |
-         *     z
-         */
-        const float x_terrain = x + terrain_x_middle;
-        const float z_terrain = z + terrain_z_middle;
-
-        const int cell_x_left = static_cast<int>(std::floor(x_terrain));
-        const int cell_x_right = static_cast<int>(std::ceil(x_terrain));
-        const int cell_z_down = static_cast<int>(std::floor(z_terrain));
-        const int cell_z_up = static_cast<int>(std::ceil(z_terrain));
-
-        const float dx = x_terrain - cell_x_left;
-        const float dz = z_terrain - cell_z_down;
-
-        const float y2 = cell_to_height(cell_x_right, cell_z_up);
-
-        /*
-         * In bottom-right triangle.
-         */
-        if (dx > dz)
-        {
-            const float y0 = cell_to_height(cell_x_left, cell_z_down);
-            const float y3 = cell_to_height(cell_x_right, cell_z_down);
-            const float x_slope = (y3 - y0);
-            const float z_slope = (y2 - y3);
-            return y0 + x_slope * dx + z_slope * dz;
-        }
-
-        /*
-         * In top-left triangle.
-         */
-        else
-        {
-            const float y0 = cell_to_height(cell_x_left, cell_z_down);
-            const float y1 = cell_to_height(cell_x_left, cell_z_up);
-            const float x_slope = (y2 - y1);
-            const float z_slope = (y1 - y0);
-            return y0 + x_slope * dx + z_slope * dz;
-        }
-    }
-
     /**
      * Process menu input.
      */
@@ -706,35 +572,107 @@ namespace Engine
 
         ImGui::Text("%.3f ms (%.0f FPS)", dt * 1000.0, 1.0 / dt);
 
-        const double dt_mean = stats_dt_sum / stats_frames;
-        const double fps_mean = 1.0 / dt_mean;
-        ImGui::Text("mean: %.3f ms (%.0f FPS)", dt_mean * 1000.0, fps_mean);
+        const double dt_mean_ms = frame_stats.get_mean_ms();
+        ImGui::Text("mean: %.3f ms (%.0f FPS)", dt_mean_ms, 1000.0 / dt_mean_ms);
 
-        const double dt_variance = (stats_dt_sq_sum / stats_frames) - (dt_mean * dt_mean);
-        const double dt_stdev = sqrt(MAX(dt_variance, 0.0));
-        const double fps_stdev = dt_stdev / (dt_mean * dt_mean);
-        ImGui::Text("stdev: %.3f ms (%.0f FPS)", dt_stdev * 1000.0, fps_stdev);
+        ImGui::Text("p50 / p95 / p99: %.3f / %.3f / %.3f ms",
+                    frame_stats.get_percentile_ms(50.0),
+                    frame_stats.get_percentile_ms(95.0),
+                    frame_stats.get_percentile_ms(99.0));
+
+        ImGui::Text("max: %.3f ms, hitches: %lu",
+                    frame_stats.get_max_ms(),
+                    frame_stats.get_num_hitches());
 
         ImGui::Text("free vram: %d MB / %d MB", stats_free_vram_MB, stats_total_vram_MB);
 
-        ImGui::Text("ram usage: %d MB", stats_ram_usage_MB);
+        ImGui::Text("ram usage: %lu MB", frame_stats.get_ram_usage_MB());
+
+        ImGui::Text("terrain chunks: %zu / %zu",
+                    renderer.get_num_terrain_chunks_drawn(),
+                    terrain_streamer.get_mesh().get_num_chunks());
+
+        ImGui::Text("terrain tiles: %zu resident, %zu pending",
+                    terrain_streamer.get_num_resident_tiles(),
+                    terrain_streamer.get_num_pending_tiles());
+
+        ImGui::Text("regular object batches: %zu", renderer.get_num_regular_object_batches_drawn());
+
+        ImGui::Text("redundant gl calls skipped: %zu / %zu",
+                    renderer.get_num_gl_calls_skipped(),
+                    renderer.get_num_gl_calls());
+
+        ImGui::Text("overdraw: %.2fx%s",
+                    renderer.get_overdraw(),
+                    renderer.get_depth_prepass() ? " (depth pre-pass)" : "");
+
+        ImGui::Text("shadow cascades re-cached: %zu / %d",
+                    renderer.get_num_shadow_cascades_recached(),
+                    renderer.get_num_shadow_cascades());
+
+        ImGui::Text("render resolution: %dx%d (%.0f%%, gpu %.2f ms)",
+                    renderer.get_render_width(),
+                    renderer.get_render_height(),
+                    renderer.get_dynamic_resolution().get_scale() * 100.f,
+                    renderer.get_dynamic_resolution().get_gpu_ms());
+
+        /*
+         * Per-pass timings, lagging a few frames behind since the GPU queries are only read
+         * back once they are done.
+         */
+        const Profiler &profiler = renderer.get_profiler();
+        if (ImGui::BeginTable(
+                "passes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit))
+        {
+            ImGui::TableSetupColumn("pass");
+            ImGui::TableSetupColumn("cpu ms");
+            ImGui::TableSetupColumn("gpu ms");
+            ImGui::TableHeadersRow();
+            for (const Profiler::ScopeStats &scope : profiler.get_scopes())
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%*s%s", 2 * scope.depth, "", scope.name);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", scope.cpu_ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", scope.gpu_ms);
+            }
+            ImGui::EndTable();
+        }
+
+        /*
+         * The root scope is the whole frame.
+         */
+        if (likely(!profiler.get_scopes().empty()))
+        {
+            const Profiler::ScopeStats &frame_scope = profiler.get_scopes()[0];
+            ImGui::PlotLines("gpu ms",
+                             frame_scope.gpu_history.data(),
+                             frame_scope.gpu_history.size(),
+                             profiler.get_history_offset(),
+                             nullptr,
+                             0.f,
+                             FLT_MAX,
+                             ImVec2(0, 60));
+        }
 
         ImGui::Text("state: %s", state_to_string(state));
         ImGui::Text("player_movement_state: %s",
-                    player_movement_state_to_string(player_movement_state));
+                    player_movement_state_to_string(snapshot.player_movement_state));
         ImGui::Text("player_position: (%.2f, %.2f, %.2f)",
-                    player_position.x,
-                    player_position.y,
-                    player_position.z);
-        ImGui::Text("on_ground_camera_y: %.2f", on_ground_camera_y);
-        ImGui::Text("altitude: %.2f", player_position.y - on_ground_camera_y);
+                    snapshot.player_position.x,
+                    snapshot.player_position.y,
+                    snapshot.player_position.z);
+        ImGui::Text("on_ground_camera_y: %.2f", snapshot.on_ground_camera_y);
+        ImGui::Text("altitude: %.2f", snapshot.player_position.y - snapshot.on_ground_camera_y);
         ImGui::Text("player_velocity: (%.2f, %.2f, %.2f) (%.2f m/s)",
-                    player_velocity.x,
-                    player_velocity.y,
-                    player_velocity.z,
-                    player_speed);
-        ImGui::Text("move_impulse: %.2f", player_move_impulse);
-        ImGui::Text("friction_coeff: %.2f", friction_coeff);
+                    snapshot.player_velocity.x,
+                    snapshot.player_velocity.y,
+                    snapshot.player_velocity.z,
+                    snapshot.player_speed);
+        ImGui::Text("move_impulse: %.2f", snapshot.player_move_impulse);
+        ImGui::Text("friction_coeff: %.2f", snapshot.friction_coeff);
         ImGui::End();
 
         return true;
@@ -745,44 +683,16 @@ namespace Engine
      */
     void Game::update_stats()
     {
-        /*
-         * While we have not filled the stats buffer yet, just accumulate values.
-         */
-        if (unlikely(stats_frames < num_stats_frames))
-        {
-            stats_dt_buffer[stats_dt_buffer_idx] = dt;
-            stats_dt_sum += dt;
-            stats_dt_sq_sum += dt * dt;
-            stats_frames++;
-        }
+        frame_stats.add_frame(dt);
 
         /*
-         * Replace the oldest value in the buffer.
+         * Update VRAM usage every 60 frames. RAM usage is read by the frame stats off the
+         * render thread.
          */
-        else
-        {
-            const double dt_prev = stats_dt_buffer[stats_dt_buffer_idx];
-            stats_dt_buffer[stats_dt_buffer_idx] = dt;
-            stats_dt_sum += dt - dt_prev;
-            stats_dt_sq_sum += dt * dt - dt_prev * dt_prev;
-        }
-
-        stats_dt_buffer_idx = (stats_dt_buffer_idx + 1) % num_stats_frames;
-
-        /*
-         * Update expensive stats every 60 frames.
-         */
-        if (stats_dt_buffer_idx % 60 == 0)
+        if (frame_stats.get_num_frames() % 60 == 0)
         {
             glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &stats_free_vram_MB);
             stats_free_vram_MB /= 1024;
-
-            unsigned long rss_pages = 0;
-            std::ifstream statm("/proc/self/statm");
-            statm >> rss_pages >> rss_pages;
-            statm.close();
-
-            stats_ram_usage_MB = rss_pages * sysconf(_SC_PAGESIZE) / 1024 / 1024;
         }
     }
 
@@ -833,6 +743,14 @@ namespace Engine
             }
         }
 
+        update_view_vectors();
+    }
+
+    /**
+     * @brief Update the vectors of the view from the viewing angles.
+     */
+    void Game::update_view_vectors()
+    {
         /*
          * Get vector pointing at target.
          */
@@ -867,16 +785,16 @@ namespace Engine
      */
     bool Game::update_player_movement_state_grounded()
     {
-        if (keyboard_inputs.fly_rising_edge)
+        if (simulation_inputs.keyboard.fly_rising_edge)
         {
             player_movement_state = PlayerMovementState::FLYING;
             return true;
         }
 
         const bool can_jump = player_position.y - on_ground_camera_y <= 0.2f;
-        if (can_jump && keyboard_inputs.jump_rising_edge)
+        if (can_jump && simulation_inputs.keyboard.jump_rising_edge)
         {
-            player_velocity.y += move_impulse_jump * dt;
+            player_velocity.y += move_impulse_jump * tick_dt;
 
             /*
              * If the player jumps from a crouch, stand them up.
@@ -905,7 +823,7 @@ namespace Engine
             friction_coeff = friction_coeff_air;
 
             player_move_impulse = move_impulse_midair;
-            player_velocity.y -= acceleration_gravity * dt;
+            player_velocity.y -= acceleration_gravity * tick_dt;
         }
         /*
          * Otherwise set friction to that of ground.
@@ -952,22 +870,22 @@ namespace Engine
          * Determine which direction to move into.
          */
         glm::vec3 move_direction(0.f, 0.f, 0.f);
-        if (keyboard_inputs.forwards)
+        if (simulation_inputs.keyboard.forwards)
         {
-            move_direction = forwards;
+            move_direction = simulation_inputs.forwards;
         }
-        else if (keyboard_inputs.backwards)
+        else if (simulation_inputs.keyboard.backwards)
         {
-            move_direction = -forwards;
+            move_direction = -simulation_inputs.forwards;
         }
 
-        if (keyboard_inputs.right)
+        if (simulation_inputs.keyboard.right)
         {
-            move_direction += right;
+            move_direction += simulation_inputs.right;
         }
-        else if (keyboard_inputs.left)
+        else if (simulation_inputs.keyboard.left)
         {
-            move_direction -= right;
+            move_direction -= simulation_inputs.right;
         }
 
         /*
@@ -984,13 +902,15 @@ namespace Engine
             }
 
             const bool in_sprintable_direction =
-                move_direction.x * forwards.x + move_direction.z * forwards.z > 0.f;
+                move_direction.x * simulation_inputs.forwards.x +
+                    move_direction.z * simulation_inputs.forwards.z >
+                0.f;
 
             /*
              * While sprint button is being pressed and the player is on the ground,
              * set them to sprinting.
              */
-            if (keyboard_inputs.sprint_rising_edge && in_sprintable_direction)
+            if (simulation_inputs.keyboard.sprint_rising_edge && in_sprintable_direction)
             {
                 player_movement_state = PlayerMovementState::SPRINTING;
             }
@@ -998,7 +918,7 @@ namespace Engine
             /*
              * Crouch if crouch button is pressed.
              */
-            else if (keyboard_inputs.crouch_rising_edge)
+            else if (simulation_inputs.keyboard.crouch_rising_edge)
             {
                 player_movement_state = PlayerMovementState::CROUCHING;
             }
@@ -1019,8 +939,10 @@ namespace Engine
              * to walking.
              */
             const bool in_sprintable_direction =
-                move_direction.x * forwards.x + move_direction.z * forwards.z > 0.f;
-            if (keyboard_inputs.sprint_rising_edge || !in_sprintable_direction)
+                move_direction.x * simulation_inputs.forwards.x +
+                    move_direction.z * simulation_inputs.forwards.z >
+                0.f;
+            if (simulation_inputs.keyboard.sprint_rising_edge || !in_sprintable_direction)
             {
                 player_movement_state = PlayerMovementState::WALKING;
             }
@@ -1028,7 +950,7 @@ namespace Engine
             /*
              * Crouch if crouch button is pressed.
              */
-            else if (keyboard_inputs.crouch_rising_edge)
+            else if (simulation_inputs.keyboard.crouch_rising_edge)
             {
                 player_movement_state = PlayerMovementState::CROUCHING;
             }
@@ -1047,8 +969,10 @@ namespace Engine
              * Sprint if sprint button is pressed while crouching.
              */
             const bool in_sprintable_direction =
-                move_direction.x * forwards.x + move_direction.z * forwards.z > 0.f;
-            if (keyboard_inputs.sprint_rising_edge && in_sprintable_direction)
+                move_direction.x * simulation_inputs.forwards.x +
+                    move_direction.z * simulation_inputs.forwards.z >
+                0.f;
+            if (simulation_inputs.keyboard.sprint_rising_edge && in_sprintable_direction)
             {
                 player_movement_state = PlayerMovementState::SPRINTING;
             }
@@ -1056,7 +980,7 @@ namespace Engine
             /*
              * Uncrouch if crouch button is pressed again.
              */
-            else if (keyboard_inputs.crouch_rising_edge)
+            else if (simulation_inputs.keyboard.crouch_rising_edge)
             {
                 player_movement_state = PlayerMovementState::WALKING;
             }
@@ -1065,7 +989,7 @@ namespace Engine
         }
 
         case PlayerMovementState::FLYING:
-            if (keyboard_inputs.fly_rising_edge)
+            if (simulation_inputs.keyboard.fly_rising_edge)
             {
                 player_movement_state = PlayerMovementState::WALKING;
             }
@@ -1115,17 +1039,17 @@ namespace Engine
             /*
              * Replace jump with flying up.
              */
-            if (keyboard_inputs.jump)
+            if (simulation_inputs.keyboard.jump)
             {
-                player_velocity.y += player_move_impulse * dt;
+                player_velocity.y += player_move_impulse * tick_dt;
             }
 
             /*
              * Replace crouch with flying down.
              */
-            if (keyboard_inputs.crouch)
+            if (simulation_inputs.keyboard.crouch)
             {
-                player_velocity.y -= player_move_impulse * dt;
+                player_velocity.y -= player_move_impulse * tick_dt;
             }
 
             break;
@@ -1140,19 +1064,19 @@ namespace Engine
         if (move_direction.x != 0.f || move_direction.y != 0.f || move_direction.z != 0.f)
         {
             player_velocity +=
-                glm::normalize(move_direction) * player_move_impulse * static_cast<float>(dt);
+                glm::normalize(move_direction) * player_move_impulse * static_cast<float>(tick_dt);
         }
 
         /*
          * Apply friction.
          */
-        player_velocity -= player_velocity * friction_coeff * static_cast<float>(dt);
+        player_velocity -= player_velocity * friction_coeff * static_cast<float>(tick_dt);
         player_speed = glm::length(player_velocity);
 
         /*
          * Update player position.
          */
-        player_position += player_velocity * static_cast<float>(dt);
+        player_position += player_velocity * static_cast<float>(tick_dt);
 
         /*
          * Don't let the player go outside the world.
@@ -1163,23 +1087,361 @@ namespace Engine
             player_position.y = on_ground_camera_y;
         }
 
-        if (player_position.x < -terrain_x_middle + 1.f)
+        if (player_position.x < terrain_min.x + 1.f)
+        {
+            player_position.x = terrain_min.x + 1.f;
+        }
+        else if (player_position.x > terrain_max.x - 1.f)
+        {
+            player_position.x = terrain_max.x - 1.f;
+        }
+
+        if (player_position.z < terrain_min.y + 1.f)
+        {
+            player_position.z = terrain_min.y + 1.f;
+        }
+        else if (player_position.z > terrain_max.y - 1.f)
+        {
+            player_position.z = terrain_max.y - 1.f;
+        }
+    }
+
+    /**
+     * @brief Start ticking the simulation on its own thread.
+     */
+    void Game::start_simulation()
+    {
+        const Snapshot initial_snapshot = make_snapshot(std::chrono::steady_clock::now());
+        snapshots = {initial_snapshot, initial_snapshot};
+        snapshot = initial_snapshot;
+        chasers.get_poses(chaser_poses[0]);
+        chaser_poses[1] = chaser_poses[0];
+
+        if (benchmark.is_enabled())
+        {
+            simulated_time = initial_snapshot.time;
+            next_tick_time = simulated_time + tick_duration;
+            return;
+        }
+
+        is_simulation_stopping = false;
+        simulation_thread = std::thread(&Game::simulation_main, this);
+    }
+
+    /**
+     * @brief Stop the simulation thread, if running.
+     */
+    void Game::stop_simulation()
+    {
+        if (!simulation_thread.joinable())
+        {
+            return;
+        }
+
+        is_simulation_stopping = true;
+        simulation_thread.join();
+    }
+
+    /**
+     * @brief Tick the simulation every tick_duration until stopped, publishing a snapshot
+     * after every tick.
+     */
+    void Game::simulation_main()
+    {
+        std::chrono::steady_clock::time_point tick_time = std::chrono::steady_clock::now();
+        while (!is_simulation_stopping.load(std::memory_order_relaxed))
         {
-            player_position.x = -terrain_x_middle + 1.f;
+            tick_time += tick_duration;
+            std::this_thread::sleep_until(tick_time);
+
+            /*
+             * Ticks which are late run back to back to catch up, unless we are so far behind
+             * that it is better to skip ahead.
+             */
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (unlikely(now - tick_time > max_tick_lag))
+            {
+                LOG_WARN("Simulation fell %.0f ms behind, skipping ahead\n",
+                         std::chrono::duration<double, std::milli>(now - tick_time).count());
+                tick_time = now;
+            }
+
+            tick();
+            publish_tick(tick_time);
         }
-        else if (player_position.x > terrain_x_middle - 1.f)
+    }
+
+    /**
+     * @brief Run the ticks due by the simulated time on the calling thread, for
+     * benchmarking.
+     */
+    void Game::step_simulation()
+    {
+        while (next_tick_time <= simulated_time)
+        {
+            tick();
+            publish_tick(next_tick_time);
+            next_tick_time += tick_duration;
+        }
+    }
+
+    /**
+     * @brief Advance the simulation by tick_dt.
+     */
+    void Game::tick()
+    {
+        /*
+         * Take the inputs sampled since the last tick, consuming their rising edges.
+         */
         {
-            player_position.x = terrain_x_middle - 1.f;
+            std::lock_guard<std::mutex> lock(simulation_mutex);
+            simulation_inputs = pending_simulation_inputs;
+
+            KeyboardInputs &pending_keyboard = pending_simulation_inputs.keyboard;
+            pending_keyboard.jump_rising_edge = false;
+            pending_keyboard.crouch_rising_edge = false;
+            pending_keyboard.sprint_rising_edge = false;
+            pending_keyboard.fly_rising_edge = false;
         }
 
-        if (player_position.z < -terrain_z_middle + 1.f)
+        /*
+         * Cache variables used multiple times.
+         */
+        terrain_height = terrain_streamer.get_height(player_position.x, player_position.z);
+
+        /*
+         * Cache whether player is on the ground.
+         */
+        is_on_ground = player_position.y <= on_ground_camera_y;
+
+        /*
+         * Update player_position based on keyboard input.
+         */
+        update_player_position();
+
+        /*
+         * Update orbital angle.
+         */
+        orbital_angle += rotational_angular_speed * tick_dt;
+
+        /*
+         * Update chasers.
+         */
+        update_chasers();
+
+        /*
+         * Update point light position.
+         */
+        const float point_light_terrain_height =
+            terrain_streamer.get_height(point_light_position.x, point_light_position.z);
+        if (point_light_position.y < point_light_terrain_height + 1.f)
         {
-            player_position.z = -terrain_z_middle + 1.f;
+            point_light_velocity = 20.f;
         }
-        else if (player_position.z > terrain_z_middle - 1.f)
+        else if (point_light_position.y > point_light_terrain_height + 100.f)
         {
-            player_position.z = terrain_z_middle - 1.f;
+            point_light_velocity = -20.f;
         }
+        point_light_position.y += point_light_velocity * tick_dt;
+    }
+
+    /**
+     * @brief Publish the snapshot and chaser poses of the tick which just ran.
+     *
+     * @param tick_time Time the tick was scheduled at.
+     */
+    void Game::publish_tick(const std::chrono::steady_clock::time_point tick_time)
+    {
+        const Snapshot tick_snapshot = make_snapshot(tick_time);
+        chasers.get_poses(tick_chaser_poses);
+        std::lock_guard<std::mutex> lock(simulation_mutex);
+        snapshots[0] = snapshots[1];
+        snapshots[1] = tick_snapshot;
+        std::swap(chaser_poses[0], chaser_poses[1]);
+        std::swap(chaser_poses[1], tick_chaser_poses);
+    }
+
+    /**
+     * @brief Spawn the chasers on the ground, the first in front of the player and the rest
+     * spiralling out from it.
+     */
+    void Game::spawn_chasers()
+    {
+        const GLuint render_handle =
+            renderer.get_material_index(chaser_textured_material, chaser_normal_map);
+
+        /*
+         * Successive chasers are a golden angle apart around the spiral, which spreads them
+         * evenly however many there are.
+         */
+        static constexpr float golden_angle = 2.3999632f;
+        static constexpr float spacing = 2.f;
+        chasers.reserve(options.num_chasers);
+        for (size_t i = 0; i < options.num_chasers; i++)
+        {
+            const float radius = spacing * std::sqrt(static_cast<float>(i));
+            const float angle = golden_angle * i;
+            const float x = radius * std::sin(angle);
+            const float z = 10.f + radius * std::cos(angle);
+            const glm::vec3 position(x, terrain_streamer.get_height(x, z) + 1.f, z);
+            chasers.spawn(position, 0.f, render_handle);
+        }
+    }
+
+    /**
+     * @brief Move the chasers towards the player on the X-Z plane, facing them, and keep them
+     * on the ground.
+     */
+    void Game::update_chasers()
+    {
+        static constexpr float chaser_move_impulse = 5.f;
+        const float target_x = player_position.x;
+        const float target_z = player_position.z;
+        chasers.update([this, target_x, target_z](const EntityStore::Components &chaser,
+                                                  const size_t begin,
+                                                  const size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                const float to_player_x = target_x - chaser.position_x[i];
+                const float to_player_z = target_z - chaser.position_z[i];
+                const float distance =
+                    std::sqrt(to_player_x * to_player_x + to_player_z * to_player_z);
+                if (likely(distance > 0.f))
+                {
+                    const float speed_per_distance = chaser_move_impulse / distance;
+                    chaser.velocity_x[i] = to_player_x * speed_per_distance;
+                    chaser.velocity_z[i] = to_player_z * speed_per_distance;
+                    chaser.yaw[i] =
+                        glm::radians<float>(180.f) + std::atan2(to_player_x, to_player_z);
+                }
+                else
+                {
+                    chaser.velocity_x[i] = 0.f;
+                    chaser.velocity_z[i] = 0.f;
+                }
+
+                chaser.position_x[i] += chaser.velocity_x[i] * static_cast<float>(tick_dt);
+                chaser.position_z[i] += chaser.velocity_z[i] * static_cast<float>(tick_dt);
+            }
+
+            terrain_streamer.get_heights(chaser.position_x + begin,
+                                         chaser.position_z + begin,
+                                         end - begin,
+                                         chaser.position_y + begin);
+            for (size_t i = begin; i < end; i++)
+            {
+                chaser.position_y[i] += 1.f;
+            }
+        });
+    }
+
+    /**
+     * @brief Capture the simulation state.
+     *
+     * @param time Time the state is as of.
+     *
+     * @return Snapshot of the simulation state.
+     */
+    Game::Snapshot Game::make_snapshot(const std::chrono::steady_clock::time_point time) const
+    {
+        return {
+            .time = time,
+            .player_movement_state = player_movement_state,
+            .player_position = player_position,
+            .player_velocity = player_velocity,
+            .player_speed = player_speed,
+            .player_move_impulse = player_move_impulse,
+            .friction_coeff = friction_coeff,
+            .on_ground_camera_y = on_ground_camera_y,
+            .point_light_position = point_light_position,
+            .orbital_angle = orbital_angle,
+        };
+    }
+
+    /**
+     * @brief Hand the inputs sampled this frame to the simulation.
+     */
+    void Game::publish_simulation_inputs()
+    {
+        std::lock_guard<std::mutex> lock(simulation_mutex);
+
+        KeyboardInputs &pending_keyboard = pending_simulation_inputs.keyboard;
+        const KeyboardInputs pending_edges = pending_keyboard;
+        pending_keyboard = keyboard_inputs;
+        pending_keyboard.jump_rising_edge |= pending_edges.jump_rising_edge;
+        pending_keyboard.crouch_rising_edge |= pending_edges.crouch_rising_edge;
+        pending_keyboard.sprint_rising_edge |= pending_edges.sprint_rising_edge;
+        pending_keyboard.fly_rising_edge |= pending_edges.fly_rising_edge;
+
+        pending_simulation_inputs.forwards = forwards;
+        pending_simulation_inputs.right = right;
+    }
+
+    /**
+     * @brief Interpolate the simulation state for the current frame.
+     *
+     * The frame shows the simulation as it was one tick ago, which always lies between the
+     * last two snapshots, trading a tick of latency for motion that is smooth at any frame
+     * rate.
+     *
+     * @param now Current time.
+     */
+    void Game::update_snapshot(const std::chrono::steady_clock::time_point now)
+    {
+        std::array<Snapshot, 2> latest_snapshots;
+        {
+            std::lock_guard<std::mutex> lock(simulation_mutex);
+            latest_snapshots = snapshots;
+            latest_chaser_poses = chaser_poses;
+        }
+
+        const std::chrono::duration<float> time_since_latest = now - latest_snapshots[1].time;
+        const float alpha =
+            std::clamp(time_since_latest.count() / static_cast<float>(tick_dt), 0.f, 1.f);
+        snapshot = interpolate(latest_snapshots[0], latest_snapshots[1], alpha);
+        chasers.update_transforms(latest_chaser_poses[0], latest_chaser_poses[1], alpha);
+    }
+
+    /**
+     * @brief Add the camera of the current frame to the recorded path, every
+     * camera_keyframe_period.
+     */
+    void Game::record_camera_keyframe()
+    {
+        static constexpr double camera_keyframe_period = 0.25;
+        if (time_since_start < next_camera_keyframe_time)
+        {
+            return;
+        }
+        next_camera_keyframe_time = time_since_start + camera_keyframe_period;
+
+        recorded_camera_path.add_keyframe({
+            .time = static_cast<float>(time_since_start),
+            .position = snapshot.player_position,
+            .horizontal_angle = horizontal_angle,
+            .vertical_angle = vertical_angle,
+        });
+    }
+
+    /**
+     * @brief Interpolate between two snapshots.
+     *
+     * @param from Earlier snapshot.
+     * @param to Later snapshot.
+     * @param alpha Fraction of the way from @p from to @p to.
+     *
+     * @return Interpolated snapshot. Discrete state, and state only used for display, is
+     * taken from @p to.
+     */
+    Game::Snapshot Game::interpolate(const Snapshot &from, const Snapshot &to, const float alpha)
+    {
+        Snapshot result = to;
+        result.player_position = glm::mix(from.player_position, to.player_position, alpha);
+        result.point_light_position =
+            glm::mix(from.point_light_position, to.point_light_position, alpha);
+        result.orbital_angle = glm::mix(from.orbital_angle, to.orbital_angle, alpha);
+
+        return result;
     }
 
     /**
@@ -1234,16 +1496,10 @@ namespace Engine
         ASSERT_RET_IF_NOT(renderer.set_terrain({
                               .material = dirt_textured_material,
                               .normal_map = dirt_normal_map,
-                              .drawable = terrain_index_buffer,
+                              .mesh = terrain_streamer.get_mesh(),
                           }),
                           false);
 
-        /*
-         * Set day length and compute the rotational speed.
-         */
-        static constexpr float day_length_s = 10.f;
-        static constexpr float rotational_angular_speed = 2 * glm::pi<float>() / day_length_s;
-
         /*
          * Relative to the terrain, the skybox spins around it. We draw a sun
          * on the skybox in its model space so that it rotates with it with an
@@ -1255,12 +1511,16 @@ namespace Engine
         const glm::vec4 sun_position_skybox_model_space = glm::vec4(
             0.f, glm::sin(sun_orbital_elevation_angle), glm::cos(sun_orbital_elevation_angle), 0.f);
 
+        spawn_chasers();
+        start_simulation();
+
         /*
          * Loop until the user closes the window or state gets set to QUIT by the
          * program.
          */
         std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
         std::chrono::steady_clock::time_point frame_start_time = start_time;
+        Profiler &profiler = renderer.get_profiler();
         while (state != State::QUIT && !glfwWindowShouldClose(window))
         {
             /*
@@ -1271,97 +1531,76 @@ namespace Engine
 
             frame_start_time = std::chrono::steady_clock::now();
 
+            profiler.begin_frame();
+
             /*
              * Update stats.
              */
             update_stats();
 
             /*
-             * Process menu.
-             */
-            ASSERT_RET_IF_NOT(process_menu(), false);
-
-            /*
-             * Run gameplay.
-             */
-
-            time_since_start += dt;
-
-            /*
-             * Cache variables used multiple times.
+             * Benchmark frames all advance by the same time step however long they take, and
+             * the simulation is ticked here to follow them.
              */
-            terrain_height = get_terrain_height(player_position.x, player_position.z);
+            if (unlikely(benchmark.is_enabled()))
+            {
+                dt = benchmark.get_dt();
+                simulated_time += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::duration<double>(dt));
+                step_simulation();
+            }
 
             /*
-             * Cache whether player is on the ground.
+             * Get the simulation state to show this frame.
              */
-            is_on_ground = player_position.y <= on_ground_camera_y;
+            update_snapshot(benchmark.is_enabled() ? simulated_time
+                                                   : std::chrono::steady_clock::now());
 
             /*
-             * If not paused, get keyboard input and update view.
+             * Process menu.
              */
-            if (likely(state != State::PAUSED))
             {
-                get_movement_keyboard_inputs();
-                update_view();
+                Profiler::Scope scope(profiler, "menu");
+                ASSERT_RET_IF_NOT(process_menu(), false);
             }
 
-            /*
-             * Update player_position based on keyboard input.
-             */
-            update_player_position();
-
-            /*
-             * Update orbital angle.
-             */
-            orbital_angle += rotational_angular_speed * dt;
+            time_since_start += dt;
 
             /*
-             * Update chaser position to move towards player position on X-Z
-             * plane and face them.
+             * If not paused, get keyboard input and update view, then hand the input over to
+             * the simulation. The view follows the mouse every frame rather than every tick
+             * so that looking around is never behind.
              */
-            glm::vec3 direction_to_player_xz;
-            if (likely(player_position.x != chaser_position.x ||
-                       player_position.z != chaser_position.z))
+            if (unlikely(benchmark.is_enabled()))
             {
-                direction_to_player_xz =
-                    glm::normalize(glm::vec3(player_position.x - chaser_position.x,
-                                             0.f,
-                                             player_position.z - chaser_position.z));
-                static constexpr float chaser_move_impulse = 5.f;
-                chaser_position +=
-                    direction_to_player_xz * chaser_move_impulse * static_cast<float>(dt);
-                chaser_position.y = get_terrain_height(chaser_position.x, chaser_position.z) + 1.f;
+                /*
+                 * Fly the camera along the benchmark path, leaving the player where it is.
+                 */
+                const CameraPath::Keyframe camera = benchmark.get_camera();
+                horizontal_angle = camera.horizontal_angle;
+                vertical_angle = camera.vertical_angle;
+                update_view_vectors();
+                snapshot.player_position = camera.position;
             }
-            else
+            else if (likely(state != State::PAUSED))
             {
-                direction_to_player_xz = glm::vec3(1.f, 0.f, 0.f);
+                get_movement_keyboard_inputs();
+                update_view();
+                publish_simulation_inputs();
             }
 
-            glm::mat4 chaser_model = glm::translate(glm::mat4(1.f), chaser_position);
-
-            chaser_model =
-                glm::rotate(chaser_model,
-                            glm::radians<float>(180.f) +
-                                std::atan2(direction_to_player_xz.x, direction_to_player_xz.z),
-                            glm::vec3(0.f, 1.f, 0.f));
-
-            static float light_velocity = 20.f;
+            if (unlikely(!options.record_camera_path.empty()))
+            {
+                record_camera_keyframe();
+            }
 
             /*
-             * Update point light position.
+             * Stream the terrain around the camera.
              */
-            if (point_light_position.y <
-                get_terrain_height(point_light_position.x, point_light_position.z) + 1.f)
             {
-                light_velocity = 20.f;
+                Profiler::Scope scope(profiler, "terrain streaming");
+                ASSERT_RET_IF_NOT(terrain_streamer.update(snapshot.player_position), false);
             }
-            else if (point_light_position.y >
-                     get_terrain_height(point_light_position.x, point_light_position.z) + 100.f)
-            {
-                light_velocity = -20.f;
-            }
-            point_light_position.y += light_velocity * dt;
 
             /*
              * Compute the directional light direction relative to the terrain
@@ -1371,7 +1610,7 @@ namespace Engine
             const glm::mat4 terrain_model = glm::mat4(1.0f);
 
             const glm::mat4 terrain_model_matrix_rotated =
-                glm::rotate(terrain_model, orbital_angle, rotation_axis);
+                glm::rotate(terrain_model, snapshot.orbital_angle, rotation_axis);
 
             const glm::vec3 sun_position_terrain_model_space =
                 glm::vec3(terrain_model_matrix_rotated * sun_position_skybox_model_space);
@@ -1396,24 +1635,16 @@ namespace Engine
                     ? 0.f
                     : glm::exp(-brightness_falloff_factor / sine_of_elevation_angle);
 
-            const glm::mat4 view = glm::lookAt(player_position, player_position + direction, head);
+            const glm::mat4 view =
+                glm::lookAt(snapshot.player_position, snapshot.player_position + direction, head);
 
             /*
-             * Submit chaser to renderer.
+             * Submit chasers to renderer.
              */
-            Renderer::Transform chaser_transform = {
-                .position = chaser_position,
-                .rotation =
-                    glm::vec3(0.f,
-                              glm::radians<float>(180.f) +
-                                  std::atan2(direction_to_player_xz.x, direction_to_player_xz.z),
-                              0.f),
-                .scale = glm::vec3(1.f, 1.f, 1.f),
-            };
-            renderer.add_regular_object({
-                .material = chaser_textured_material,
-                .normal_map = chaser_normal_map,
-                .transform = chaser_transform,
+            renderer.add_regular_object_instances({
+                .models = chasers.get_models(),
+                .materials = chasers.get_render_handles(),
+                .count = chasers.size(),
                 .drawable = chaser_vertex_array,
             });
 
@@ -1437,7 +1668,7 @@ namespace Engine
              */
             glm::vec3 point_light_color = 10.f * glm::vec3(0xFF, 0xDF, 0x22) / 255.f;
             Renderer::Transform point_light_transform = {
-                .position = point_light_position,
+                .position = snapshot.point_light_position,
                 .rotation = glm::vec3(0.f, 0.f, 0.f),
                 .scale = glm::vec3(1.f, 1.f, 1.f),
             };
@@ -1462,27 +1693,54 @@ namespace Engine
              * emulate the planet rotating.
              */
             const glm::mat4 view_skybox =
-                glm::rotate(glm::mat4(glm::mat3(view)), orbital_angle, rotation_axis);
+                glm::rotate(glm::mat4(glm::mat3(view)), snapshot.orbital_angle, rotation_axis);
 
-            ASSERT_RET_IF_NOT(renderer.render(view, view_skybox, player_position, direction),
-                              false);
+            ASSERT_RET_IF_NOT(
+                renderer.render(view, view_skybox, snapshot.player_position, direction), false);
 
             /*
              * Render GUI.
              */
-            ImGui::Render();
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            {
+                Profiler::Scope scope(profiler, "gui");
+                ImGui::Render();
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            }
+
+            /*
+             * Swapping may block on vsync, keep it out of the frame.
+             */
+            profiler.end_frame();
 
             /*
              * Swap front and back buffers.
              */
             glfwSwapBuffers(window);
 
+            if (unlikely(benchmark.is_enabled()))
+            {
+                benchmark.end_frame(profiler,
+                                    renderer.get_texture_loader().get_num_pending() == 0);
+                if (benchmark.is_done())
+                {
+                    state = State::QUIT;
+                }
+            }
+
             /*
              * Poll for and process events.
              */
             glfwPollEvents();
 
+            /*
+             * Reload shaders and textures whose files changed.
+             */
+            file_watcher.poll(changed_paths);
+            if (unlikely(!changed_paths.empty()))
+            {
+                renderer.reload(changed_paths);
+            }
+
             /*
              * Log state transitions for debug.
              */
@@ -1497,6 +1755,26 @@ namespace Engine
 
         LOG("Exited main loop\n");
 
+        stop_simulation();
+
+        bool ok = true;
+        if (benchmark.is_enabled())
+        {
+            ok = benchmark.write_report({
+                .window_width = window_width,
+                .window_height = window_height,
+                .num_chasers = options.num_chasers,
+            });
+        }
+        if (!options.record_camera_path.empty())
+        {
+            ok = recorded_camera_path.save(options.record_camera_path) && ok;
+        }
+
+        frame_stats.stop();
+
+        renderer.stop_hot_reload();
+
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
@@ -1505,7 +1783,7 @@ namespace Engine
 
         glfwTerminate();
 
-        return true;
+        return ok;
     }
 
     /**
@@ -1,31 +1,74 @@
 #pragma once
 
+#include "Benchmark.h"
+#include "CameraPath.h"
 #include "CubemapTexture.h"
+#include "EntityStore.h"
+#include "FileWatcher.h"
+#include "FrameStats.h"
 #include "FramebufferTexture.h"
 #include "IndexBuffer.h"
 #include "MenuManager.h"
 #include "PauseMenu.h"
 #include "Renderer.h"
 #include "Shader.h"
+#include "TerrainStreamer.h"
+#include "TerrainTileFile.h"
 #include "Texture.h"
 #include "TexturedMaterial.h"
 #include "VertexArray.h"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <glm/ext/scalar_constants.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/trigonometric.hpp>
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace Engine
 {
     class Game
     {
     public:
-        static std::unique_ptr<Game> create();
+        /**
+         * @brief Options given on the command line.
+         */
+        struct Options
+        {
+            FrameStats::Options stats;
+
+            /**
+             * Number of chaser entities.
+             */
+            size_t num_chasers = 1;
+
+            Benchmark::Options benchmark;
+
+            /**
+             * File the camera path is recorded to while playing, or empty.
+             */
+            std::string record_camera_path;
+
+            /**
+             * GPU time per frame that dynamic resolution keeps frames within, or 0 to start
+             * with it off.
+             */
+            float frame_budget_ms = 0.f;
+        };
+
+        static std::unique_ptr<Game> create(const Options &options);
+
+        ~Game();
 
         bool run();
 
@@ -70,15 +113,43 @@ namespace Engine
             bool fly_rising_edge;
         };
 
-        Game();
+        /**
+         * @brief Inputs of the simulation, sampled by the render thread.
+         */
+        struct SimulationInputs
+        {
+            KeyboardInputs keyboard;
+            glm::vec3 forwards;
+            glm::vec3 right;
+        };
 
-        bool _init();
+        /**
+         * @brief State of the simulation after a tick, as needed to render it.
+         */
+        struct Snapshot
+        {
+            /**
+             * Time the tick was scheduled at.
+             */
+            std::chrono::steady_clock::time_point time;
+
+            PlayerMovementState player_movement_state;
+            glm::vec3 player_position;
+            glm::vec3 player_velocity;
+            float player_speed;
+            float player_move_impulse;
+            float friction_coeff;
+            float on_ground_camera_y;
+
+            glm::vec3 point_light_position;
+            float orbital_angle;
+        };
 
-        bool init();
+        Game(const Options &_options);
 
-        float cell_to_height(const int cell_x, const int cell_z) const;
+        bool _init();
 
-        float get_terrain_height(const float x, const float z) const;
+        bool init();
 
         bool process_menu();
 
@@ -86,6 +157,8 @@ namespace Engine
 
         void update_view();
 
+        void update_view_vectors();
+
         bool update_player_movement_state_grounded();
 
         void apply_player_movement_state_grounded();
@@ -94,6 +167,34 @@ namespace Engine
 
         void update_player_position();
 
+        void start_simulation();
+
+        void stop_simulation();
+
+        void simulation_main();
+
+        void step_simulation();
+
+        void tick();
+
+        void publish_tick(const std::chrono::steady_clock::time_point tick_time);
+
+        void spawn_chasers();
+
+        void update_chasers();
+
+        Snapshot make_snapshot(const std::chrono::steady_clock::time_point time) const;
+
+        void publish_simulation_inputs();
+
+        void update_snapshot(const std::chrono::steady_clock::time_point now);
+
+        void record_camera_keyframe();
+
+        static Snapshot interpolate(const Snapshot &from, const Snapshot &to, const float alpha);
+
+        Options options;
+
         /**
          * Window handle.
          */
@@ -128,6 +229,74 @@ namespace Engine
          */
         int window_center_y;
 
+        /**
+         * Simulation, ticked at a fixed rate on its own thread. While it runs, the player
+         * movement, position and velocity, the chaser poses and the lighting state are
+         * owned by the simulation thread, and the render thread only sees them through
+         * snapshots.
+         * @{
+         */
+        static constexpr int tick_rate = 120;
+        static constexpr double tick_dt = 1.0 / tick_rate;
+        static constexpr std::chrono::nanoseconds tick_duration {1000000000 / tick_rate};
+
+        /**
+         * Lag behind the tick schedule beyond which ticks are dropped rather than caught up
+         * on, e.g. after hitting a breakpoint.
+         */
+        static constexpr std::chrono::milliseconds max_tick_lag {250};
+
+        std::thread simulation_thread;
+        std::atomic<bool> is_simulation_stopping;
+
+        /**
+         * When benchmarking, the simulation is instead ticked on the render thread by
+         * step_simulation(), following a clock advanced by the fixed time step of each
+         * frame rather than the wall clock.
+         *   @{
+         */
+        std::chrono::steady_clock::time_point simulated_time;
+        std::chrono::steady_clock::time_point next_tick_time;
+        /**
+         *   @}
+         */
+
+        /**
+         * Inputs used by the current tick.
+         */
+        SimulationInputs simulation_inputs;
+
+        /**
+         * State shared between the simulation and render threads.
+         *   @{
+         */
+        std::mutex simulation_mutex;
+
+        /**
+         * Inputs sampled since the last tick. Rising edges are accumulated until a tick
+         * consumes them, so none are lost or seen twice however the frame and tick rates
+         * compare.
+         */
+        SimulationInputs pending_simulation_inputs;
+
+        /**
+         * Snapshots of the last two ticks, the latest last.
+         */
+        std::array<Snapshot, 2> snapshots;
+
+        /**
+         * Poses of the chasers as of the last two ticks, the latest last. They are kept out
+         * of the snapshots so that interpolating a snapshot does not copy them.
+         */
+        std::array<EntityStore::Poses, 2> chaser_poses;
+        /**
+         *   @}
+         */
+
+        /**
+         * @}
+         */
+
         /**
          * Player movement.
          */
@@ -173,6 +342,16 @@ namespace Engine
          */
         float player_speed;
 
+        /**
+         * Terrain height under the player and camera height when standing on it.
+         *   @{
+         */
+        float terrain_height;
+        float on_ground_camera_y;
+        /**
+         *   @}
+         */
+
         /**
          * Timestamp of last crouch.
          */
@@ -253,10 +432,32 @@ namespace Engine
         Renderer renderer;
 
         /**
-         * Chaser entity.
+         * Watches the shader and texture directories, reloading files which change.
          * @{
          */
-        glm::vec3 chaser_position;
+        FileWatcher file_watcher;
+        std::vector<std::string> changed_paths;
+        /**
+         * @}
+         */
+
+        /**
+         * Chaser entities.
+         * @{
+         */
+        EntityStore chasers;
+
+        /**
+         * Poses of the chasers after the current tick, swapped into chaser_poses on
+         * publishing, so that publishing does not copy them under the lock.
+         */
+        EntityStore::Poses tick_chaser_poses;
+
+        /**
+         * Render thread copy of chaser_poses.
+         */
+        std::array<EntityStore::Poses, 2> latest_chaser_poses;
+
         VertexArray chaser_vertex_array;
 
         Texture chaser_normal_map;
@@ -273,14 +474,18 @@ namespace Engine
          * Terrain.
          * @{
          */
-        std::vector<float> xz_to_height_map;
-        int terrain_num_cols;
-        int terrain_x_middle;
-        int terrain_z_middle;
-        VertexArray terrain_vertex_array;
-        IndexBuffer terrain_index_buffer = IndexBuffer(terrain_vertex_array);
-        float terrain_height;
-        float on_ground_camera_y;
+        TerrainTileFile terrain_tiles;
+        TerrainStreamer terrain_streamer;
+
+        /**
+         * Corners of the terrain on the X-Z plane, which the player is kept within.
+         * @{
+         */
+        glm::vec2 terrain_min;
+        glm::vec2 terrain_max;
+        /**
+         * @}
+         */
 
         Texture dirt_normal_map;
         TexturedMaterial dirt_textured_material =
@@ -307,25 +512,40 @@ namespace Engine
          * Lighting.
          * @{
          */
+        static constexpr float day_length_s = 10.f;
+        static constexpr float rotational_angular_speed = 2 * glm::pi<float>() / day_length_s;
         float orbital_angle;
         glm::vec3 point_light_position;
+        float point_light_velocity;
         /**
          * @}
          */
 
+        /**
+         * Simulation state as of the current frame, interpolated between the last two
+         * snapshots.
+         */
+        Snapshot snapshot;
+
         /**
          * Statistics.
          * @{
          */
-        static constexpr size_t num_stats_frames = 1024;
-        std::array<double, num_stats_frames> stats_dt_buffer;
-        size_t stats_dt_buffer_idx;
-        size_t stats_frames;
-        double stats_dt_sum;
-        double stats_dt_sq_sum;
+        FrameStats frame_stats;
         GLint stats_free_vram_MB;
         GLint stats_total_vram_MB;
-        unsigned long stats_ram_usage_MB;
+        /**
+         * @}
+         */
+
+        Benchmark benchmark;
+
+        /**
+         * Camera path being recorded, and the time its next keyframe is due.
+         * @{
+         */
+        CameraPath recorded_camera_path;
+        double next_camera_keyframe_time;
         /**
          * @}
          */
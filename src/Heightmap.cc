@@ -0,0 +1,328 @@
+#include "Heightmap.h"
+
+#include "assert_util.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <glm/geometric.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Engine
+{
+    /**
+     * @brief Constructor.
+     */
+    Heightmap::Heightmap(): num_rows(0), num_cols(0)
+    {}
+
+    /**
+     * @brief Create the heightmap from the first channel of an image.
+     *
+     * @param pixels Pixels of the image in row-major order.
+     * @param _num_rows Number of rows in the image.
+     * @param _num_cols Number of columns in the image.
+     * @param num_channels Number of channels per pixel.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Heightmap::create(const uint8_t *pixels,
+                           const int _num_rows,
+                           const int _num_cols,
+                           const int num_channels)
+    {
+        ASSERT_RET_IF(pixels == nullptr, false);
+        ASSERT_RET_IF(_num_rows < 2 || _num_cols < 2 || num_channels < 1, false);
+
+        num_rows = _num_rows;
+        num_cols = _num_cols;
+        heights.resize(static_cast<size_t>(num_rows) * num_cols);
+
+        parallel_for(0, heights.size(), [&](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                heights[i] = pixels[i * num_channels];
+            }
+        });
+
+        return true;
+    }
+
+    /**
+     * @brief Apply a 3x3 Gaussian blur to smooth out sharp edges. Pixels outside the
+     * heightmap are clamped to the edge.
+     *
+     * The kernel is separable, so it is applied as a vertical [1 2 1] pass followed by a
+     * horizontal [1 2 1] pass. Both run on 16-bit sums which are only divided by the kernel
+     * weight at the end, so the result is exactly that of the 3x3 kernel.
+     *
+     * @param iterations Number of times to apply the blur.
+     */
+    void Heightmap::blur(const int iterations)
+    {
+        scratch.resize(heights.size());
+
+        for (int i = 0; i < iterations; i++)
+        {
+            parallel_for(0, num_rows, [&](const size_t row_begin, const size_t row_end) {
+                blur_rows(heights.data(), scratch.data(), row_begin, row_end);
+            });
+            heights.swap(scratch);
+        }
+    }
+
+    /**
+     * @brief Apply one blur iteration to a range of rows.
+     *
+     * @param src Heights to blur.
+     * @param[out] dst Blurred heights.
+     * @param row_begin First row to blur.
+     * @param row_end Row after the last row to blur.
+     */
+    void Heightmap::blur_rows(const uint8_t *src,
+                              uint8_t *dst,
+                              const size_t row_begin,
+                              const size_t row_end) const
+    {
+        /*
+         * Vertical sums of the row, padded by one clamped column on either side.
+         */
+        std::vector<uint16_t> padded_sums(num_cols + 2);
+        uint16_t *const sums = padded_sums.data() + 1;
+
+        for (size_t row = row_begin; row < row_end; row++)
+        {
+            const uint8_t *const above = src + (row > 0 ? row - 1 : 0) * num_cols;
+            const uint8_t *const center = src + row * num_cols;
+            const uint8_t *const below =
+                src + std::min<size_t>(row + 1, num_rows - 1) * num_cols;
+            uint8_t *const out = dst + row * num_cols;
+
+            int col = 0;
+#ifdef __SSE2__
+            const __m128i zero = _mm_setzero_si128();
+            for (; col + 16 <= num_cols; col += 16)
+            {
+                const __m128i a =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(above + col));
+                const __m128i b =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(center + col));
+                const __m128i c =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(below + col));
+
+                const __m128i lo = _mm_add_epi16(
+                    _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(c, zero)),
+                    _mm_slli_epi16(_mm_unpacklo_epi8(b, zero), 1));
+                const __m128i hi = _mm_add_epi16(
+                    _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(c, zero)),
+                    _mm_slli_epi16(_mm_unpackhi_epi8(b, zero), 1));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + col), lo);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + col + 8), hi);
+            }
+#endif
+            for (; col < num_cols; col++)
+            {
+                sums[col] = above[col] + 2 * center[col] + below[col];
+            }
+
+            sums[-1] = sums[0];
+            sums[num_cols] = sums[num_cols - 1];
+
+            /*
+             * Horizontal pass. The sum of all taps is at most 16 * 0xFF, so it still fits
+             * in 16 bits before being divided by the weight of the kernel.
+             */
+            col = 0;
+#ifdef __SSE2__
+            auto load_sums = [sums](const int col) {
+                return _mm_loadu_si128(reinterpret_cast<const __m128i *>(sums + col));
+            };
+            auto horizontal_sum = [&load_sums](const int col) {
+                const __m128i left = load_sums(col - 1);
+                const __m128i middle = load_sums(col);
+                const __m128i right = load_sums(col + 1);
+                return _mm_srli_epi16(
+                    _mm_add_epi16(_mm_add_epi16(left, right), _mm_slli_epi16(middle, 1)), 4);
+            };
+            for (; col + 16 <= num_cols; col += 16)
+            {
+                const __m128i blurred =
+                    _mm_packus_epi16(horizontal_sum(col), horizontal_sum(col + 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + col), blurred);
+            }
+#endif
+            for (; col < num_cols; col++)
+            {
+                out[col] = (sums[col - 1] + 2 * sums[col] + sums[col + 1]) >> 4;
+            }
+        }
+    }
+
+    /**
+     * @brief Generate one terrain vertex per height, with normals from compute_normals().
+     *
+     * @param offset Offset added to the position of each vertex.
+     * @param y_scale Scale from height to Y coordinate.
+     * @param[out] vertices Vertices in row-major order.
+     * @param[out] vertex_heights Y coordinate of each vertex in row-major order.
+     */
+    void Heightmap::generate_vertices(const glm::vec3 &offset,
+                                      const float y_scale,
+                                      std::vector<Vertex3dNormal> &vertices,
+                                      std::vector<float> &vertex_heights) const
+    {
+        vertices.resize(heights.size());
+        vertex_heights.resize(heights.size());
+
+        parallel_for(0, num_rows, [&](const size_t row_begin, const size_t row_end) {
+            for (size_t row = row_begin; row < row_end; row++)
+            {
+                for (int col = 0; col < num_cols; col++)
+                {
+                    const size_t i = row * num_cols + col;
+                    vertices[i].position = {
+                        col + offset.x,
+                        heights[i] * y_scale + offset.y,
+                        row + offset.z,
+                    };
+                    vertex_heights[i] = vertices[i].position.y;
+                }
+            }
+        });
+
+        compute_normals(vertices.data(), num_rows, num_cols);
+    }
+
+    /**
+     * @brief Get the Y coordinates of the vertices of a band of rows, as
+     * generate_vertices() would generate them, without generating the vertices.
+     *
+     * @param row_begin First row of the band.
+     * @param _num_rows Number of rows in the band.
+     * @param y_offset Offset added to the Y coordinate of each vertex.
+     * @param y_scale Scale from height to Y coordinate.
+     * @param[out] vertex_heights Y coordinate of each vertex of the band in row-major order.
+     */
+    void Heightmap::get_heights(const int row_begin,
+                                const int _num_rows,
+                                const float y_offset,
+                                const float y_scale,
+                                float *vertex_heights) const
+    {
+        if (unlikely(row_begin < 0 || _num_rows < 0 || row_begin + _num_rows > num_rows))
+        {
+            LOG_ERROR("Rows %d to %d are outside the %d rows of the heightmap\n",
+                      row_begin,
+                      row_begin + _num_rows,
+                      num_rows);
+            return;
+        }
+
+        const uint8_t *const src = heights.data() + static_cast<size_t>(row_begin) * num_cols;
+        const size_t count = static_cast<size_t>(_num_rows) * num_cols;
+        for (size_t i = 0; i < count; i++)
+        {
+            vertex_heights[i] = src[i] * y_scale + y_offset;
+        }
+    }
+
+    /**
+     * @brief Set the normal of every vertex of a grid to the average of the face normals
+     * of the triangles around it.
+     *
+     * Each cell is wound into two triangles the same way the terrain mesh winds them:
+     *
+     *   this----right
+     *    |      /|
+     *    |    /  |
+     *    |  /    |
+     *    |/      |
+     *   bottom--bottom_right
+     *
+     * Rather than scattering each face normal into the vertices of its triangle, every
+     * vertex gathers the face normals of the up to six triangles it is part of, so rows can
+     * be processed in parallel without any synchronization.
+     *
+     * @param[in,out] vertices Vertices in row-major order, whose positions are read and
+     * whose normals are written.
+     * @param num_rows Number of rows in the grid.
+     * @param num_cols Number of columns in the grid.
+     */
+    void Heightmap::compute_normals(Vertex3dNormal *vertices,
+                                    const int num_rows,
+                                    const int num_cols)
+    {
+        auto position = [&](const int row, const int col) -> const glm::vec3 & {
+            return vertices[static_cast<size_t>(row) * num_cols + col].position;
+        };
+
+        auto face_normal = [](const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2) {
+            return glm::normalize(glm::cross(v1 - v0, v2 - v0));
+        };
+
+        parallel_for(0, num_rows, [&](const size_t row_begin, const size_t row_end) {
+            for (int row = row_begin; row < static_cast<int>(row_end); row++)
+            {
+                const bool has_above = row > 0;
+                const bool has_below = row < num_rows - 1;
+
+                for (int col = 0; col < num_cols; col++)
+                {
+                    const bool has_left = col > 0;
+                    const bool has_right = col < num_cols - 1;
+                    glm::vec3 norm(0.f);
+
+                    /*
+                     * This vertex is "this" of the cell to its bottom right.
+                     */
+                    if (has_below && has_right)
+                    {
+                        norm += face_normal(
+                            position(row, col), position(row + 1, col), position(row, col + 1));
+                    }
+
+                    /*
+                     * This vertex is "bottom" of the cell to its top right.
+                     */
+                    if (has_above && has_right)
+                    {
+                        norm += face_normal(position(row - 1, col),
+                                            position(row, col),
+                                            position(row - 1, col + 1));
+                        norm += face_normal(position(row - 1, col + 1),
+                                            position(row, col),
+                                            position(row, col + 1));
+                    }
+
+                    /*
+                     * This vertex is "right" of the cell to its bottom left.
+                     */
+                    if (has_below && has_left)
+                    {
+                        norm += face_normal(position(row, col - 1),
+                                            position(row + 1, col - 1),
+                                            position(row, col));
+                        norm += face_normal(position(row, col),
+                                            position(row + 1, col - 1),
+                                            position(row + 1, col));
+                    }
+
+                    /*
+                     * This vertex is "bottom_right" of the cell to its top left.
+                     */
+                    if (has_above && has_left)
+                    {
+                        norm += face_normal(
+                            position(row - 1, col), position(row, col - 1), position(row, col));
+                    }
+
+                    vertices[static_cast<size_t>(row) * num_cols + col].norm =
+                        glm::normalize(norm);
+                }
+            }
+        });
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Single-channel 8-bit heightmap which the terrain is generated from.
+     *
+     * All processing is split across rows and run on every hardware thread.
+     */
+    class Heightmap
+    {
+    public:
+        Heightmap();
+
+        bool create(const uint8_t *pixels,
+                    const int _num_rows,
+                    const int _num_cols,
+                    const int num_channels);
+
+        void blur(const int iterations);
+
+        void generate_vertices(const glm::vec3 &offset,
+                               const float y_scale,
+                               std::vector<Vertex3dNormal> &vertices,
+                               std::vector<float> &vertex_heights) const;
+
+        void get_heights(const int row_begin,
+                         const int _num_rows,
+                         const float y_offset,
+                         const float y_scale,
+                         float *vertex_heights) const;
+
+        static void compute_normals(Vertex3dNormal *vertices,
+                                    const int num_rows,
+                                    const int num_cols);
+
+        /**
+         * @return Number of rows.
+         */
+        int get_num_rows() const
+        {
+            return num_rows;
+        }
+
+        /**
+         * @return Number of columns.
+         */
+        int get_num_cols() const
+        {
+            return num_cols;
+        }
+
+    private:
+        void blur_rows(const uint8_t *src,
+                       uint8_t *dst,
+                       const size_t row_begin,
+                       const size_t row_end) const;
+
+        int num_rows;
+        int num_cols;
+
+        /**
+         * Heights in row-major order.
+         */
+        std::vector<uint8_t> heights;
+
+        /**
+         * Destination of each blur iteration, swapped with the heights afterwards.
+         */
+        std::vector<uint8_t> scratch;
+    };
+}
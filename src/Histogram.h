@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace Engine
+{
+    /**
+     * @brief Histogram of integer samples with a bounded relative error, in the style of
+     * HdrHistogram.
+     *
+     * Values below 2^(sub_bucket_bits + 1) are counted exactly. Above that, every power of
+     * two range is split into 2^sub_bucket_bits linear buckets, so any value is reported
+     * within 1 / 2^sub_bucket_bits of itself while the whole histogram stays a few kilobytes
+     * and adding a sample is a handful of instructions.
+     */
+    class Histogram
+    {
+    public:
+        static constexpr int sub_bucket_bits = 5;
+
+        /**
+         * Values at or above 2^max_exponent are counted as 2^max_exponent - 1.
+         */
+        static constexpr int max_exponent = 32;
+
+        Histogram()
+        {
+            clear();
+        }
+
+        void clear()
+        {
+            counts.fill(0);
+            count = 0;
+            sum = 0;
+            max = 0;
+        }
+
+        /**
+         * @brief Count one sample.
+         *
+         * @param value Sample to count.
+         */
+        void add(uint64_t value)
+        {
+            value = std::min(value, max_value);
+            counts[bucket_of(value)]++;
+            count++;
+            sum += value;
+            max = std::max(max, value);
+        }
+
+        /**
+         * @brief Get the value at or below which a percentage of the samples are.
+         *
+         * @param percentile Percentage in [0, 100].
+         *
+         * @return Highest value that falls into the same bucket as the sample of the given
+         * rank, or 0 if the histogram is empty.
+         */
+        uint64_t get_percentile(const double percentile) const
+        {
+            if (count == 0)
+            {
+                return 0;
+            }
+
+            const uint64_t rank =
+                std::max<uint64_t>(1, std::ceil(percentile / 100.0 * static_cast<double>(count)));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < counts.size(); i++)
+            {
+                seen += counts[i];
+                if (seen >= rank)
+                {
+                    return std::min(bucket_max_value(i), max);
+                }
+            }
+            return max;
+        }
+
+        uint64_t get_count() const
+        {
+            return count;
+        }
+
+        uint64_t get_max() const
+        {
+            return max;
+        }
+
+        double get_mean() const
+        {
+            return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+        }
+
+    private:
+        static constexpr uint64_t sub_bucket_count = 1 << sub_bucket_bits;
+        static constexpr uint64_t num_exact_values = 2 * sub_bucket_count;
+        static constexpr int min_exponent = sub_bucket_bits + 1;
+        static constexpr size_t num_buckets =
+            num_exact_values + (max_exponent - min_exponent) * sub_bucket_count;
+        static constexpr uint64_t max_value = (uint64_t(1) << max_exponent) - 1;
+
+        /**
+         * @return Bucket counting @p value.
+         */
+        static size_t bucket_of(const uint64_t value)
+        {
+            if (value < num_exact_values)
+            {
+                return value;
+            }
+
+            const int exponent = 63 - __builtin_clzll(value);
+            const int shift = exponent - sub_bucket_bits;
+            const uint64_t sub_bucket = (value >> shift) - sub_bucket_count;
+            return num_exact_values + (exponent - min_exponent) * sub_bucket_count + sub_bucket;
+        }
+
+        /**
+         * @return Highest value counted by bucket @p idx.
+         */
+        static uint64_t bucket_max_value(const size_t idx)
+        {
+            if (idx < num_exact_values)
+            {
+                return idx;
+            }
+
+            const size_t range_idx = idx - num_exact_values;
+            const int exponent = min_exponent + range_idx / sub_bucket_count;
+            const int shift = exponent - sub_bucket_bits;
+            const uint64_t sub_bucket = range_idx % sub_bucket_count;
+            return ((sub_bucket_count + sub_bucket + 1) << shift) - 1;
+        }
+
+        std::array<uint64_t, num_buckets> counts;
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+    };
+}
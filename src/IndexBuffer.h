@@ -26,29 +26,69 @@ namespace Engine
         {}
 
         /**
-         * @brief Create index buffer from given items.
+         * @brief Create index buffer from given items. Any previously created one is
+         * destroyed.
          *
          * @param items Pointer to the index items.
          * @param _count Number of indices.
+         * @param usage Usage hint of the buffer.
          */
-        void create(const void *items, const size_t _count)
+        void create(const void *items, const size_t _count, const GLenum usage = GL_STATIC_DRAW)
         {
+            destroy();
+
             count = _count;
 
+            vertex_array.bind();
             glGenBuffers(1, &index_buffer_obj);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_obj);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, _count * sizeof(IndexType), items, GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, _count * sizeof(IndexType), items, usage);
+        }
+
+        /**
+         * @brief Free the index buffer.
+         */
+        void destroy()
+        {
+            if (index_buffer_obj != 0)
+            {
+                glDeleteBuffers(1, &index_buffer_obj);
+                index_buffer_obj = 0;
+            }
+
+            count = 0;
+        }
+
+        /**
+         * @return OpenGL ID of the vertex array this buffer indexes into.
+         */
+        GLuint get_vertex_array_id() const override
+        {
+            return vertex_array.get_vertex_array_id();
         }
 
         /**
          * @brief Draw the vertices using this buffer together with the vertex buffer.
          */
-        void draw() const override
+        void draw_bound() const override
         {
-            vertex_array.bind();
             glDrawElements(GL_TRIANGLES, count, IndexGLtype, nullptr);
         }
 
+        /**
+         * @brief Draw instances of the vertices using this buffer together with the vertex
+         * buffer.
+         *
+         * @param instance_count Number of instances to draw.
+         * @param base_instance First instance to fetch per-instance attributes for.
+         */
+        void draw_instanced_bound(const GLsizei instance_count,
+                                  const GLuint base_instance) const override
+        {
+            glDrawElementsInstancedBaseInstance(
+                GL_TRIANGLES, count, IndexGLtype, nullptr, instance_count, base_instance);
+        }
+
     private:
         const VertexArray &vertex_array;
         GLuint index_buffer_obj;
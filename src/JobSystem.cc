@@ -0,0 +1,341 @@
+#include "JobSystem.h"
+
+#include "log.h"
+#include "perf.h"
+
+#include <algorithm>
+
+namespace Engine
+{
+    thread_local size_t JobSystem::worker_idx = JobSystem::no_worker;
+
+    /**
+     * @brief Get the job system shared by the whole engine, starting it on first use.
+     *
+     * @return Job system with one worker per hardware thread besides the calling thread,
+     * which is expected to wait on its jobs and so help run them.
+     */
+    JobSystem &JobSystem::get()
+    {
+        static JobSystem job_system(std::max(2u, std::thread::hardware_concurrency()) - 1);
+        return job_system;
+    }
+
+    /**
+     * @brief Constructor. Starts the workers.
+     *
+     * @param num_workers Number of worker threads, at least one.
+     */
+    JobSystem::JobSystem(const unsigned int num_workers):
+        next_worker(0), num_queued(0), num_background_queued(0), is_stopping(false)
+    {
+        for (unsigned int i = 0; i < std::max(1u, num_workers); i++)
+        {
+            workers.push_back(std::make_unique<Worker>());
+        }
+
+        /*
+         * Only start the threads once all deques exist since workers steal from each other
+         * right away.
+         */
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            workers[i]->thread = std::thread(&JobSystem::worker_main, this, i);
+        }
+
+        LOG("Started %zu job workers\n", workers.size());
+    }
+
+    /**
+     * @brief Destructor. Runs all queued jobs, then stops the workers.
+     */
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            is_stopping = true;
+        }
+        sleep_condition.notify_all();
+
+        for (std::unique_ptr<Worker> &worker : workers)
+        {
+            worker->thread.join();
+        }
+    }
+
+    /**
+     * @brief Submit a job.
+     *
+     * @param job Job to run.
+     * @param counter Counter to signal once the job is done, may be null.
+     */
+    void JobSystem::run(Job job, Counter *counter)
+    {
+        if (counter != nullptr)
+        {
+            counter->count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        push({std::move(job), counter});
+    }
+
+    /**
+     * @brief Submit a job which only starts once all jobs signalling a counter are done.
+     *
+     * @param dependency Counter to wait for.
+     * @param job Job to run.
+     * @param counter Counter to signal once the job is done, may be null. It counts the job
+     * from now on, not only once the job starts.
+     */
+    void JobSystem::run_after(Counter &dependency, Job job, Counter *counter)
+    {
+        if (counter != nullptr)
+        {
+            counter->count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(dependency.mutex);
+            if (dependency.count.load(std::memory_order_acquire) != 0)
+            {
+                dependency.continuations.push_back({std::move(job), counter});
+                return;
+            }
+        }
+
+        push({std::move(job), counter});
+    }
+
+    /**
+     * @brief Submit a long job to the background queue, which only idle workers run.
+     *
+     * @param job Job to run.
+     * @param counter Counter to signal once the job is done, may be null. Only threads
+     * outside the pool may wait on it.
+     */
+    void JobSystem::run_background(Job job, Counter *counter)
+    {
+        if (counter != nullptr)
+        {
+            counter->count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(background_mutex);
+            background_tasks.push_back({std::move(job), counter});
+        }
+        num_background_queued.fetch_add(1, std::memory_order_release);
+
+        /*
+         * See push().
+         */
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        sleep_condition.notify_one();
+    }
+
+    /**
+     * @brief Run jobs until all jobs signalling a counter are done. Background jobs are
+     * left to the workers.
+     *
+     * @param counter Counter to wait for.
+     */
+    void JobSystem::wait(Counter &counter)
+    {
+        while (!counter.is_done())
+        {
+            if (!run_one())
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        /*
+         * The job which brought the count to zero may still be submitting the
+         * continuations, wait for it to let go of the counter before the caller may destroy
+         * it.
+         */
+        std::lock_guard<std::mutex> lock(counter.mutex);
+    }
+
+    /**
+     * @brief Push a task onto the deque of the current worker, or of the next worker if
+     * called from outside the pool, and wake up a worker.
+     *
+     * @param task Task to push.
+     */
+    void JobSystem::push(Task task)
+    {
+        const size_t idx = (worker_idx != no_worker)
+                               ? worker_idx
+                               : next_worker.fetch_add(1, std::memory_order_relaxed) %
+                                     workers.size();
+        {
+            Worker &worker = *workers[idx];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        num_queued.fetch_add(1, std::memory_order_release);
+
+        /*
+         * Taking the lock orders the increment before any worker which is about to sleep
+         * checks the count, so the notification cannot be missed.
+         */
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        sleep_condition.notify_one();
+    }
+
+    /**
+     * @brief Take a task, newest first from the current worker's own deque, otherwise
+     * oldest first from another worker's.
+     *
+     * @param[out] task Task taken.
+     *
+     * @return True if a task was taken, otherwise false.
+     */
+    bool JobSystem::pop(Task &task)
+    {
+        if (num_queued.load(std::memory_order_acquire) == 0)
+        {
+            return false;
+        }
+
+        if (worker_idx != no_worker)
+        {
+            Worker &worker = *workers[worker_idx];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (!worker.tasks.empty())
+            {
+                task = std::move(worker.tasks.back());
+                worker.tasks.pop_back();
+                num_queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        const size_t first_victim = (worker_idx != no_worker) ? worker_idx + 1 : 0;
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            Worker &victim = *workers[(first_victim + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                num_queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Run one task if there is any.
+     *
+     * @return True if a task was run, otherwise false.
+     */
+    bool JobSystem::run_one()
+    {
+        Task task;
+        if (!pop(task))
+        {
+            return false;
+        }
+
+        task.job();
+        signal(task.counter);
+        return true;
+    }
+
+    /**
+     * @brief Run the oldest background task if there is any.
+     *
+     * @return True if a task was run, otherwise false.
+     */
+    bool JobSystem::run_one_background()
+    {
+        if (num_background_queued.load(std::memory_order_acquire) == 0)
+        {
+            return false;
+        }
+
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(background_mutex);
+            if (background_tasks.empty())
+            {
+                return false;
+            }
+            task = std::move(background_tasks.front());
+            background_tasks.pop_front();
+            num_background_queued.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        task.job();
+        signal(task.counter);
+        return true;
+    }
+
+    /**
+     * @brief Count a job signalling a counter as done, submitting the continuations of the
+     * counter if it was the last one.
+     *
+     * @param counter Counter to signal, may be null.
+     */
+    void JobSystem::signal(Counter *counter)
+    {
+        if (counter == nullptr)
+        {
+            return;
+        }
+
+        std::vector<Counter::Continuation> continuations;
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            if (counter->count.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            {
+                return;
+            }
+            continuations.swap(counter->continuations);
+        }
+
+        for (Counter::Continuation &continuation : continuations)
+        {
+            push({std::move(continuation.job), continuation.counter});
+        }
+    }
+
+    /**
+     * @brief Run jobs, background ones only when there are no others, sleeping while there
+     * are none at all, until stopped.
+     *
+     * @param idx Index of the worker.
+     */
+    void JobSystem::worker_main(const size_t idx)
+    {
+        worker_idx = idx;
+
+        const auto has_tasks = [this] {
+            return num_queued.load(std::memory_order_acquire) != 0 ||
+                   num_background_queued.load(std::memory_order_acquire) != 0;
+        };
+        while (true)
+        {
+            if (likely(run_one()) || run_one_background())
+            {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleep_condition.wait(lock, [this, &has_tasks] { return is_stopping || has_tasks(); });
+            if (is_stopping && !has_tasks())
+            {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Engine-wide pool of worker threads running short jobs.
+     *
+     * Every worker has its own deque of jobs. A worker pushes the jobs it spawns onto the
+     * back of its deque and pops from the back too, so related work stays on one core,
+     * while idle workers steal from the front of the others' deques. Jobs submitted from
+     * threads outside the pool are spread over the workers round-robin.
+     *
+     * Completion is tracked with counters: every job submitted with a counter increments it
+     * and decrements it when done. A thread waiting on a counter runs jobs itself instead
+     * of blocking, so jobs may wait on jobs they spawn, and jobs may be made to start only
+     * once a counter reaches zero.
+     *
+     * Long jobs, such as file reads and decodes, are submitted to a separate background
+     * queue which workers only take from when they have nothing else to run. Waiting
+     * threads never run background jobs, so that a frame waiting on its short jobs cannot
+     * end up stuck in one. Jobs must not wait on background jobs, since a worker waiting
+     * on them would not run them.
+     */
+    class JobSystem
+    {
+    public:
+        using Job = std::function<void()>;
+
+        /**
+         * @brief Number of outstanding jobs. Must outlive all jobs signalling it, and must
+         * be waited on before being destroyed.
+         */
+        class Counter
+        {
+        public:
+            Counter(): count(0)
+            {}
+
+            Counter(const Counter &) = delete;
+            Counter &operator=(const Counter &) = delete;
+
+            /**
+             * @return Whether all jobs signalling the counter are done.
+             */
+            bool is_done() const
+            {
+                return count.load(std::memory_order_acquire) == 0;
+            }
+
+        private:
+            friend class JobSystem;
+
+            struct Continuation
+            {
+                Job job;
+                Counter *counter;
+            };
+
+            std::atomic<size_t> count;
+
+            /**
+             * Jobs to submit once the count reaches zero.
+             * @{
+             */
+            std::mutex mutex;
+            std::vector<Continuation> continuations;
+            /**
+             * @}
+             */
+        };
+
+        static JobSystem &get();
+
+        JobSystem(const unsigned int num_workers);
+
+        ~JobSystem();
+
+        JobSystem(const JobSystem &) = delete;
+        JobSystem &operator=(const JobSystem &) = delete;
+
+        void run(Job job, Counter *counter = nullptr);
+
+        void run_after(Counter &dependency, Job job, Counter *counter = nullptr);
+
+        void run_background(Job job, Counter *counter = nullptr);
+
+        void wait(Counter &counter);
+
+        unsigned int get_num_workers() const
+        {
+            return workers.size();
+        }
+
+    private:
+        struct Task
+        {
+            Job job;
+            Counter *counter;
+        };
+
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+            std::thread thread;
+        };
+
+        /**
+         * Worker index of threads outside the pool.
+         */
+        static constexpr size_t no_worker = static_cast<size_t>(-1);
+
+        void push(Task task);
+
+        bool pop(Task &task);
+
+        bool run_one();
+
+        bool run_one_background();
+
+        void signal(Counter *counter);
+
+        void worker_main(const size_t idx);
+
+        /**
+         * Index of the worker the current thread is, or no_worker.
+         */
+        static thread_local size_t worker_idx;
+
+        std::vector<std::unique_ptr<Worker>> workers;
+
+        /**
+         * Worker the next job submitted from outside the pool goes to.
+         */
+        std::atomic<size_t> next_worker;
+
+        /**
+         * Number of jobs in all deques.
+         */
+        std::atomic<size_t> num_queued;
+
+        /**
+         * Background jobs, oldest first, and their number.
+         * @{
+         */
+        std::mutex background_mutex;
+        std::deque<Task> background_tasks;
+        std::atomic<size_t> num_background_queued;
+        /**
+         * @}
+         */
+
+        /**
+         * Idle workers sleep until there are jobs again.
+         * @{
+         */
+        std::mutex sleep_mutex;
+        std::condition_variable sleep_condition;
+        bool is_stopping;
+        /**
+         * @}
+         */
+    };
+}
@@ -0,0 +1,258 @@
+#include "MaterialTable.h"
+
+#include "assert_util.h"
+#include "log.h"
+#include "perf.h"
+
+#include <algorithm>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor.
+     */
+    MaterialTable::MaterialTable():
+        is_dirty(false),
+        placeholder_color_handle(0),
+        placeholder_normal_handle(0),
+        buffer_id(0),
+        buffer_capacity(0),
+        binding(0),
+        bindless(false)
+    {}
+
+    /**
+     * @brief Create the placeholder textures if bindless textures are supported and the
+     * material buffer, and bind the buffer to a shader storage binding point. Must be called
+     * from the GL thread.
+     *
+     * @param _binding Shader storage block binding point.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool MaterialTable::init(const GLuint _binding)
+    {
+        binding = _binding;
+
+        /*
+         * This must match the check of shaders/regular_object.frag.
+         */
+        bindless = GLEW_ARB_bindless_texture && GLEW_NV_gpu_shader5;
+        if (bindless)
+        {
+            ASSERT_RET_IF_NOT(
+                create_placeholder(Texture::placeholder_color, placeholder_color_handle), false);
+            ASSERT_RET_IF_NOT(
+                create_placeholder(Texture::placeholder_normal, placeholder_normal_handle),
+                false);
+        }
+        else
+        {
+            LOG_WARN("GL_ARB_bindless_texture or GL_NV_gpu_shader5 is not supported, binding "
+                     "material textures per draw\n");
+        }
+
+        buffer_capacity = initial_capacity;
+        glGenBuffers(1, &buffer_id);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer_id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+                     buffer_capacity * sizeof(MaterialData),
+                     nullptr,
+                     GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer_id);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        return true;
+    }
+
+    /**
+     * @brief Get the index of a material in the table, adding it if it is not in there yet.
+     *
+     * @param material Material, whose texture is the color texture.
+     * @param normal_map Normal map used with the material.
+     *
+     * @return Index of the material, for shaders to index the material buffer with.
+     */
+    GLuint MaterialTable::get_index(const TexturedMaterial &material, const Texture &normal_map)
+    {
+        /*
+         * There are only a handful of materials, too few for anything but a linear search
+         * to pay off.
+         */
+        const auto entry =
+            std::find_if(entries.begin(), entries.end(), [&material, &normal_map](const Entry &e) {
+                return e.material == &material && e.normal_map == &normal_map;
+            });
+        if (likely(entry != entries.end()))
+        {
+            return entry - entries.begin();
+        }
+
+        entries.push_back({
+            .material = &material,
+            .normal_map = &normal_map,
+            .is_final = false,
+        });
+        materials.push_back({
+            .texture = 0,
+            .normal_map = 0,
+            .ambient = glm::vec4(material.get_ambient(), 0.0f),
+            .diffuse = glm::vec4(material.get_diffuse(), 0.0f),
+            .specular = material.get_specular(),
+            .shininess = material.get_shininess(),
+        });
+        if (bindless)
+        {
+            update_entry(entries.size() - 1);
+        }
+        is_dirty = true;
+
+        return entries.size() - 1;
+    }
+
+    /**
+     * @brief Swap the placeholders of textures which finished loading for their own
+     * handles and upload the materials if any of them changed. Must be called from the GL
+     * thread before drawing with the materials.
+     */
+    void MaterialTable::update()
+    {
+        for (size_t i = 0; bindless && i < entries.size(); i++)
+        {
+            if (likely(entries[i].is_final))
+            {
+                continue;
+            }
+            update_entry(i);
+        }
+
+        if (likely(!is_dirty))
+        {
+            return;
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer_id);
+        if (unlikely(materials.size() > buffer_capacity))
+        {
+            /*
+             * Respecifying the storage keeps the buffer bound to its binding point.
+             */
+            buffer_capacity = std::max(materials.size(), 2 * buffer_capacity);
+            glBufferData(GL_SHADER_STORAGE_BUFFER,
+                         buffer_capacity * sizeof(MaterialData),
+                         nullptr,
+                         GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(
+            GL_SHADER_STORAGE_BUFFER, 0, materials.size() * sizeof(MaterialData), materials.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        is_dirty = false;
+    }
+
+    /**
+     * @brief Bind the textures of a material, for shaders without bindless textures. The
+     * textures are bound whether or not they have loaded, since they hold a placeholder
+     * until then.
+     *
+     * @param idx Index of the material.
+     * @param state Tracked GL state.
+     */
+    void MaterialTable::bind(const GLuint idx, GLState &state) const
+    {
+        const Entry &entry = entries[idx];
+        state.bind_texture(texture_unit, GL_TEXTURE_2D, entry.material->get_id());
+        state.bind_texture(normal_map_texture_unit, GL_TEXTURE_2D, entry.normal_map->get_id());
+    }
+
+    /**
+     * @brief Create a resident 1x1 texture for materials to use until their own texture
+     * has loaded.
+     *
+     * @param texel Texel to fill the texture with.
+     * @param[out] handle Bindless handle of the texture.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool MaterialTable::create_placeholder(const Texture::Texel &texel, GLuint64 &handle)
+    {
+        GLuint texture_id;
+        glGenTextures(1, &texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+
+        /*
+         * Without mipmaps, the default minification filter would leave the texture
+         * incomplete, and incomplete textures have no handle.
+         */
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(
+            GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel.data());
+
+        handle = glGetTextureHandleARB(texture_id);
+        ASSERT_RET_IF(handle == 0, false);
+        glMakeTextureHandleResidentARB(handle);
+
+        return true;
+    }
+
+    /**
+     * @brief Get the handle of a texture, creating it and making it resident the first time.
+     *
+     * @param texture Texture to get the handle of.
+     * @param placeholder_handle Handle to use while the texture is still loading, or if it
+     * has no handle.
+     *
+     * @return Resident handle.
+     */
+    GLuint64 MaterialTable::get_handle(const Texture &texture, const GLuint64 placeholder_handle)
+    {
+        if (!texture.is_loaded())
+        {
+            return placeholder_handle;
+        }
+
+        const auto existing = texture_handles.find(texture.get_id());
+        if (likely(existing != texture_handles.end()))
+        {
+            return existing->second;
+        }
+
+        GLuint64 handle = glGetTextureHandleARB(texture.get_id());
+        if (unlikely(handle == 0))
+        {
+            LOG_ERROR("Failed to get handle of texture %x, keeping placeholder\n",
+                      texture.get_id());
+            handle = placeholder_handle;
+        }
+        else
+        {
+            glMakeTextureHandleResidentARB(handle);
+        }
+        texture_handles[texture.get_id()] = handle;
+
+        return handle;
+    }
+
+    /**
+     * @brief Point an entry at the current handles of its textures.
+     *
+     * @param idx Index of the entry.
+     */
+    void MaterialTable::update_entry(const size_t idx)
+    {
+        Entry &entry = entries[idx];
+        MaterialData &data = materials[idx];
+
+        const GLuint64 texture = get_handle(*entry.material, placeholder_color_handle);
+        const GLuint64 normal_map = get_handle(*entry.normal_map, placeholder_normal_handle);
+        if (texture != data.texture || normal_map != data.normal_map)
+        {
+            data.texture = texture;
+            data.normal_map = normal_map;
+            is_dirty = true;
+        }
+
+        entry.is_final = entry.material->is_loaded() && entry.normal_map->is_loaded();
+    }
+}
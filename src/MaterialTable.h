@@ -0,0 +1,134 @@
+#pragma once
+
+#include "GLState.h"
+#include "Texture.h"
+#include "TexturedMaterial.h"
+
+#include <GL/glew.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Materials stored in a shader storage buffer, so that a single draw can cover
+     * instances with different materials, each instance carrying the index of its own.
+     *
+     * Textures are referenced through bindless texture handles (GL_ARB_bindless_texture)
+     * rather than texture units. Creating a handle freezes the storage of its texture, so a
+     * texture only gets a handle once its image has been uploaded, and its materials refer
+     * to a placeholder until then.
+     *
+     * The handles differ between instances of a draw, which is only defined with
+     * GL_NV_gpu_shader5. Without both extensions the table has no handles, and draws are
+     * split into runs of one material whose textures are bound with bind() instead.
+     */
+    class MaterialTable
+    {
+    public:
+        MaterialTable();
+
+        MaterialTable(const MaterialTable &) = delete;
+        MaterialTable &operator=(const MaterialTable &) = delete;
+
+        bool init(const GLuint _binding);
+
+        GLuint get_index(const TexturedMaterial &material, const Texture &normal_map);
+
+        void update();
+
+        void bind(const GLuint idx, GLState &state) const;
+
+        /**
+         * @return True if shaders sample the textures through their handles, otherwise
+         * false and the textures of a material must be bound with bind() before drawing
+         * with it.
+         */
+        bool is_bindless() const
+        {
+            return bindless;
+        }
+
+        /**
+         * @return Number of materials in the table.
+         */
+        size_t get_num_materials() const
+        {
+            return entries.size();
+        }
+
+        /**
+         * Texture units bind() binds the textures of a material to, for the samplers of
+         * shaders without bindless textures.
+         * @{
+         */
+        static constexpr GLuint texture_unit = 0;
+        static constexpr GLuint normal_map_texture_unit = 1;
+        /**
+         * @}
+         */
+
+    private:
+        /**
+         * @brief Material, mirroring the std430 MaterialData struct in
+         * shaders/include/material.glsl.
+         */
+        struct MaterialData
+        {
+            GLuint64 texture;
+            GLuint64 normal_map;
+            glm::vec4 ambient;
+            glm::vec4 diffuse;
+            glm::vec3 specular;
+            float shininess;
+        };
+        static_assert(sizeof(MaterialData) == 2 * sizeof(GLuint64) + 3 * sizeof(glm::vec4));
+
+        struct Entry
+        {
+            const TexturedMaterial *material;
+            const Texture *normal_map;
+
+            /**
+             * Whether both textures have replaced their placeholders, after which the
+             * entry no longer changes.
+             */
+            bool is_final;
+        };
+
+        /**
+         * Number of materials the buffer is first sized for. It grows when more are added.
+         */
+        static constexpr size_t initial_capacity = 64;
+
+        bool create_placeholder(const Texture::Texel &texel, GLuint64 &handle);
+
+        GLuint64 get_handle(const Texture &texture, const GLuint64 placeholder_handle);
+
+        void update_entry(const size_t idx);
+
+        std::vector<Entry> entries;
+
+        /**
+         * CPU copy of the buffer, uploaded whenever an entry changes.
+         */
+        std::vector<MaterialData> materials;
+        bool is_dirty;
+
+        /**
+         * Resident handle of every texture which has one, by texture ID.
+         */
+        std::unordered_map<GLuint, GLuint64> texture_handles;
+
+        GLuint64 placeholder_color_handle;
+        GLuint64 placeholder_normal_handle;
+
+        GLuint buffer_id;
+        size_t buffer_capacity;
+        GLuint binding;
+
+        bool bindless;
+    };
+}
@@ -0,0 +1,204 @@
+#include "PostProcess.h"
+
+#include "log.h"
+#include "perf.h"
+
+namespace Engine
+{
+    /**
+     * @brief Constructor. All stages but sharpening are enabled.
+     */
+    PostProcess::PostProcess():
+        width(0),
+        height(0),
+        stages(0),
+        exposure(1.0f),
+        gamma(0.5f),
+        sharpness(0.5f),
+        output_texture(0),
+        output_frame_buffer(0)
+    {
+        for (const Stage stage : {Stage::BLOOM, Stage::TONEMAP, Stage::GAMMA})
+        {
+            stages |= 1u << static_cast<uint32_t>(stage);
+        }
+    }
+
+    /**
+     * @brief Start compiling the post-processing shader, to be finished by finish_init().
+     *
+     * @param cache Cache to compile the shader through, or null.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool PostProcess::begin_init(ShaderCache *cache)
+    {
+        ASSERT_RET_IF_NOT(shader.begin_compile(
+                              {
+                                  {"post.comp", GL_COMPUTE_SHADER},
+                              },
+                              cache),
+                          false);
+
+        return true;
+    }
+
+    /**
+     * @brief Finish compiling the post-processing shader and create the final image.
+     *
+     * @param _width Width of the window.
+     * @param _height Height of the window.
+     * @param color_texture_slot Slot the scene color texture is bound to.
+     * @param bloom_texture_slot Slot the bloom texture is bound to.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool PostProcess::finish_init(const int _width,
+                                  const int _height,
+                                  const GLint color_texture_slot,
+                                  const GLint bloom_texture_slot)
+    {
+        width = _width;
+        height = _height;
+
+        ASSERT_RET_IF_NOT(shader.finish_compile(), false);
+        shader.use();
+        ASSERT_RET_IF_NOT(shader.set_int("u_color_texture_sampler", color_texture_slot), false);
+        ASSERT_RET_IF_NOT(shader.set_int("u_bloom_texture_sampler", bloom_texture_slot), false);
+        ASSERT_RET_IF_NOT(shader.get_uniform("u_stages", stages_uniform), false);
+        ASSERT_RET_IF_NOT(shader.get_uniform("u_render_scale", render_scale_uniform), false);
+        ASSERT_RET_IF_NOT(shader.get_uniform("u_exposure", exposure_uniform), false);
+        ASSERT_RET_IF_NOT(shader.get_uniform("u_gamma", gamma_uniform), false);
+        ASSERT_RET_IF_NOT(shader.get_uniform("u_sharpness", sharpness_uniform), false);
+        ASSERT_RET_IF_NOT(shader.get_uniform("u_bloom_intensity", bloom_intensity_uniform),
+                          false);
+        shader.set(exposure_uniform, exposure);
+        shader.set(gamma_uniform, gamma);
+        shader.set(sharpness_uniform, sharpness);
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &output_texture);
+        glTextureStorage2D(output_texture, 1, GL_RGBA8, width, height);
+
+        glCreateFramebuffers(1, &output_frame_buffer);
+        glNamedFramebufferTexture(output_frame_buffer, GL_COLOR_ATTACHMENT0, output_texture, 0);
+        if (unlikely(glCheckNamedFramebufferStatus(output_frame_buffer, GL_READ_FRAMEBUFFER) !=
+                     GL_FRAMEBUFFER_COMPLETE))
+        {
+            LOG_ERROR("Post-processing frame buffer is incomplete\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Post-process the scene into the default frame buffer, which is left bound.
+     * The scene color texture and level 0 of the bloom texture must be bound to their
+     * slots.
+     *
+     * @param render_scale Fraction of the scene color texture along each axis which the
+     * scene was rendered into.
+     */
+    void PostProcess::run(const glm::vec2 &render_scale)
+    {
+        shader.use();
+        shader.set(stages_uniform, static_cast<GLint>(stages));
+        shader.set(render_scale_uniform, render_scale);
+
+        glBindImageTexture(0, output_texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glDispatchCompute(
+            (width + group_size - 1) / group_size, (height + group_size - 1) / group_size, 1);
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBlitNamedFramebuffer(output_frame_buffer,
+                               0,
+                               0,
+                               0,
+                               width,
+                               height,
+                               0,
+                               0,
+                               width,
+                               height,
+                               GL_COLOR_BUFFER_BIT,
+                               GL_NEAREST);
+    }
+
+    /**
+     * @brief Turn a stage on or off.
+     *
+     * @param stage Stage.
+     * @param is_enabled Whether the stage runs.
+     */
+    void PostProcess::set_stage_enabled(const Stage stage, const bool is_enabled)
+    {
+        const uint32_t bit = 1u << static_cast<uint32_t>(stage);
+        stages = is_enabled ? stages | bit : stages & ~bit;
+    }
+
+    /**
+     * @param stage Stage.
+     *
+     * @return Whether the stage runs.
+     */
+    bool PostProcess::get_stage_enabled(const Stage stage) const
+    {
+        return (stages & (1u << static_cast<uint32_t>(stage))) != 0;
+    }
+
+    /**
+     * @param stage Stage.
+     *
+     * @return Name of the stage for display.
+     */
+    const char *PostProcess::get_stage_name(const Stage stage)
+    {
+        static constexpr std::array<const char *, num_stages> stage_names = {
+            "Sharpen",
+            "Bloom",
+            "Tonemap",
+            "Gamma",
+        };
+        return stage_names[static_cast<size_t>(stage)];
+    }
+
+    /**
+     * @param _exposure Exposure of the tonemap stage.
+     */
+    void PostProcess::set_exposure(const float _exposure)
+    {
+        exposure = _exposure;
+        shader.use();
+        shader.set(exposure_uniform, exposure);
+    }
+
+    /**
+     * @param _gamma Gamma of the gamma stage.
+     */
+    void PostProcess::set_gamma(const float _gamma)
+    {
+        gamma = _gamma;
+        shader.use();
+        shader.set(gamma_uniform, gamma);
+    }
+
+    /**
+     * @param _sharpness Strength of the sharpen stage.
+     */
+    void PostProcess::set_sharpness(const float _sharpness)
+    {
+        sharpness = _sharpness;
+        shader.use();
+        shader.set(sharpness_uniform, sharpness);
+    }
+
+    /**
+     * @param _bloom_intensity Weight of the bloom texture in the bloom stage.
+     */
+    void PostProcess::set_bloom_intensity(const float _bloom_intensity)
+    {
+        shader.use();
+        shader.set(bloom_intensity_uniform, _bloom_intensity);
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Shader.h"
+#include "ShaderCache.h"
+
+#include <GL/glew.h>
+#include <array>
+#include <cstdint>
+#include <glm/vec2.hpp>
+
+namespace Engine
+{
+    /**
+     * @brief Post-processing of the rendered scene into the window, on compute shaders.
+     *
+     * All stages run fused in a single dispatch of shaders/post.comp, which reads the
+     * scene and bloom textures once and writes the final RGBA8 image once, rather than
+     * reading and writing RGBA16F targets in a full-screen draw per stage. Each work group
+     * upscales its tile of the output, plus a one texel border, into shared memory, so that
+     * neighborhood stages like sharpening read their neighbors from there. The image is
+     * then blitted into the default frame buffer.
+     *
+     * Stages can be turned on and off individually. A disabled stage costs a uniform branch.
+     */
+    class PostProcess
+    {
+    public:
+        /**
+         * @brief Stages, in the order they are applied. These must match the stage bits of
+         * shaders/post.comp.
+         */
+        enum class Stage : uint8_t
+        {
+            SHARPEN,
+            BLOOM,
+            TONEMAP,
+            GAMMA,
+            COUNT,
+        };
+
+        static constexpr size_t num_stages = static_cast<size_t>(Stage::COUNT);
+
+        PostProcess();
+
+        bool begin_init(ShaderCache *cache);
+
+        bool finish_init(const int _width,
+                         const int _height,
+                         const GLint color_texture_slot,
+                         const GLint bloom_texture_slot);
+
+        void run(const glm::vec2 &render_scale);
+
+        void set_stage_enabled(const Stage stage, const bool is_enabled);
+
+        bool get_stage_enabled(const Stage stage) const;
+
+        static const char *get_stage_name(const Stage stage);
+
+        void set_exposure(const float _exposure);
+
+        void set_gamma(const float _gamma);
+
+        void set_sharpness(const float _sharpness);
+
+        void set_bloom_intensity(const float _bloom_intensity);
+
+        /**
+         * @return Exposure of the tonemap stage.
+         */
+        float get_exposure() const
+        {
+            return exposure;
+        }
+
+        /**
+         * @return Gamma of the gamma stage.
+         */
+        float get_gamma() const
+        {
+            return gamma;
+        }
+
+        /**
+         * @return Strength of the sharpen stage, 1 being the classic 3x3 sharpening kernel.
+         */
+        float get_sharpness() const
+        {
+            return sharpness;
+        }
+
+        /**
+         * @return Compute shader running the stages.
+         */
+        Shader &get_shader()
+        {
+            return shader;
+        }
+
+    private:
+        /**
+         * Size of a work group of shaders/post.comp along each axis.
+         */
+        static constexpr GLuint group_size = 16;
+
+        int width;
+        int height;
+
+        /**
+         * Bit of each enabled stage.
+         */
+        uint32_t stages;
+
+        float exposure;
+        float gamma;
+        float sharpness;
+
+        Shader shader;
+        Shader::Uniform<GLint> stages_uniform;
+        Shader::Uniform<glm::vec2> render_scale_uniform;
+        Shader::Uniform<float> exposure_uniform;
+        Shader::Uniform<float> gamma_uniform;
+        Shader::Uniform<float> sharpness_uniform;
+        Shader::Uniform<float> bloom_intensity_uniform;
+
+        /**
+         * Final image, and the frame buffer it is blitted into the window from.
+         * @{
+         */
+        GLuint output_texture;
+        GLuint output_frame_buffer;
+        /**
+         * @}
+         */
+    };
+}
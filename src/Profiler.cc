@@ -0,0 +1,183 @@
+#include "Profiler.h"
+
+#include "perf.h"
+
+#include <cstring>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor.
+     */
+    Profiler::Profiler():
+        frames {}, frame_idx(0), is_in_frame(false), depth(0), frame_record_idx(no_record),
+        history_idx(0), num_frames_collected(0)
+    {}
+
+    /**
+     * @brief Create the timestamp queries. Must be called from the GL thread.
+     */
+    void Profiler::init()
+    {
+        for (Frame &frame : frames)
+        {
+            glGenQueries(frame.queries.size(), frame.queries.data());
+            frame.records.reserve(max_records_per_frame);
+        }
+    }
+
+    /**
+     * @brief Start a frame. Collects the timings of the frame recorded num_frames_in_flight
+     * frames ago and opens the root scope.
+     */
+    void Profiler::begin_frame()
+    {
+        frame_idx = (frame_idx + 1) % num_frames_in_flight;
+        Frame &frame = frames[frame_idx];
+        collect(frame);
+        frame.records.clear();
+
+        is_in_frame = true;
+        depth = 0;
+        frame_record_idx = begin_scope("frame");
+    }
+
+    /**
+     * @brief End the frame started by begin_frame().
+     */
+    void Profiler::end_frame()
+    {
+        end_scope(frame_record_idx);
+        is_in_frame = false;
+    }
+
+    /**
+     * @brief Open a scope. Prefer Scope over calling this directly.
+     *
+     * @param name Name of the scope. Scopes are told apart by name, so it must stay valid
+     * for the lifetime of the profiler, e.g. a string literal.
+     *
+     * @return Record to pass to end_scope().
+     */
+    size_t Profiler::begin_scope(const char *name)
+    {
+        Frame &frame = frames[frame_idx];
+        if (unlikely(!is_in_frame || frame.records.size() == max_records_per_frame))
+        {
+            return no_record;
+        }
+
+        const size_t record_idx = frame.records.size();
+        frame.records.push_back({
+            .scope_idx = find_scope(name),
+            .cpu_begin = std::chrono::steady_clock::now(),
+            .cpu_end = {},
+        });
+        depth++;
+
+        glQueryCounter(frame.queries[2 * record_idx], GL_TIMESTAMP);
+
+        return record_idx;
+    }
+
+    /**
+     * @brief Close a scope opened by begin_scope().
+     *
+     * @param record_idx Record returned by begin_scope().
+     */
+    void Profiler::end_scope(const size_t record_idx)
+    {
+        if (unlikely(record_idx == no_record))
+        {
+            return;
+        }
+
+        Frame &frame = frames[frame_idx];
+        glQueryCounter(frame.queries[2 * record_idx + 1], GL_TIMESTAMP);
+        frame.records[record_idx].cpu_end = std::chrono::steady_clock::now();
+        depth--;
+    }
+
+    /**
+     * @brief Read back the timings of a frame into the scope statistics.
+     *
+     * The end of the root scope is the last query of the frame, so once it is available all
+     * other queries of the frame are too. If the GPU is somehow still behind, the frame is
+     * dropped rather than waited on.
+     *
+     * @param frame Frame to read back.
+     */
+    void Profiler::collect(Frame &frame)
+    {
+        if (unlikely(frame.records.empty()))
+        {
+            return;
+        }
+
+        GLint is_available = GL_FALSE;
+        glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &is_available);
+        if (unlikely(!is_available))
+        {
+            return;
+        }
+
+        for (ScopeStats &scope : scopes)
+        {
+            scope.cpu_ms = 0.f;
+            scope.gpu_ms = 0.f;
+        }
+
+        /*
+         * A scope entered several times in a frame reports the sum of its runs.
+         */
+        for (size_t i = 0; i < frame.records.size(); i++)
+        {
+            const Record &record = frame.records[i];
+
+            GLuint64 gpu_begin_ns = 0;
+            GLuint64 gpu_end_ns = 0;
+            glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &gpu_begin_ns);
+            glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &gpu_end_ns);
+
+            ScopeStats &scope = scopes[record.scope_idx];
+            scope.gpu_ms += (gpu_end_ns - gpu_begin_ns) / 1e6f;
+            scope.cpu_ms +=
+                std::chrono::duration<float, std::milli>(record.cpu_end - record.cpu_begin)
+                    .count();
+        }
+
+        for (ScopeStats &scope : scopes)
+        {
+            scope.gpu_history[history_idx] = scope.gpu_ms;
+        }
+        history_idx = (history_idx + 1) % history_length;
+        num_frames_collected++;
+    }
+
+    /**
+     * @brief Find a scope by name, registering it at the current depth if it is new.
+     *
+     * @param name Name of the scope.
+     *
+     * @return Index of the scope.
+     */
+    size_t Profiler::find_scope(const char *name)
+    {
+        for (size_t i = 0; i < scopes.size(); i++)
+        {
+            if (scopes[i].name == name || std::strcmp(scopes[i].name, name) == 0)
+            {
+                return i;
+            }
+        }
+
+        scopes.push_back({
+            .name = name,
+            .depth = depth,
+            .cpu_ms = 0.f,
+            .gpu_ms = 0.f,
+            .gpu_history = {},
+        });
+        return scopes.size() - 1;
+    }
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Measures the CPU and GPU time of named, nestable scopes of a frame.
+     *
+     * GPU time is measured with a pair of GL_TIMESTAMP queries around each scope. The
+     * queries of a frame are only read back num_frames_in_flight frames later, once the
+     * GPU has long finished them, so reading them never stalls the pipeline. CPU times are
+     * kept with the queries of their frame so that both columns of a scope always describe
+     * the same frame.
+     *
+     * The whole frame between begin_frame() and end_frame() is itself recorded as the root
+     * scope "frame".
+     */
+    class Profiler
+    {
+    public:
+        /**
+         * Number of frames kept in the history of each scope.
+         */
+        static constexpr size_t history_length = 240;
+
+        /**
+         * @brief Timings of a scope, as of the most recent frame read back.
+         */
+        struct ScopeStats
+        {
+            const char *name;
+
+            /**
+             * Number of scopes this one is nested in.
+             */
+            int depth;
+
+            float cpu_ms;
+            float gpu_ms;
+
+            /**
+             * GPU time of the scope over the last history_length frames, oldest first when
+             * starting from get_history_offset(). Frames in which the scope did not run
+             * are zero.
+             */
+            std::array<float, history_length> gpu_history;
+        };
+
+        /**
+         * @brief Records a scope for as long as it lives.
+         */
+        class Scope
+        {
+        public:
+            Scope(Profiler &_profiler, const char *name):
+                profiler(_profiler), record_idx(profiler.begin_scope(name))
+            {}
+
+            ~Scope()
+            {
+                profiler.end_scope(record_idx);
+            }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            Profiler &profiler;
+            size_t record_idx;
+        };
+
+        Profiler();
+
+        Profiler(const Profiler &) = delete;
+        Profiler &operator=(const Profiler &) = delete;
+
+        void init();
+
+        void begin_frame();
+
+        void end_frame();
+
+        size_t begin_scope(const char *name);
+
+        void end_scope(const size_t record_idx);
+
+        /**
+         * @return Scopes in the order they were first entered, which for a frame that
+         * always runs the same scopes is a depth-first walk of the scope tree.
+         */
+        const std::vector<ScopeStats> &get_scopes() const
+        {
+            return scopes;
+        }
+
+        /**
+         * @return Index of the oldest frame in the history of each scope.
+         */
+        size_t get_history_offset() const
+        {
+            return history_idx;
+        }
+
+        /**
+         * @return Number of frames read back so far. The timings of the scopes are those
+         * of a new frame whenever it changes.
+         */
+        uint64_t get_num_frames_collected() const
+        {
+            return num_frames_collected;
+        }
+
+    private:
+        /**
+         * Number of frames whose queries may be outstanding at once. Drivers commonly queue
+         * up to three frames, so the queries of a frame are read back three frames later.
+         */
+        static constexpr size_t num_frames_in_flight = 3;
+
+        /**
+         * Scopes recorded beyond this many in a frame are ignored.
+         */
+        static constexpr size_t max_records_per_frame = 64;
+
+        /**
+         * @brief One run of a scope within a frame.
+         */
+        struct Record
+        {
+            size_t scope_idx;
+            std::chrono::steady_clock::time_point cpu_begin;
+            std::chrono::steady_clock::time_point cpu_end;
+        };
+
+        /**
+         * @brief Everything recorded in one frame.
+         */
+        struct Frame
+        {
+            /**
+             * Begin and end timestamp query of each record.
+             */
+            std::array<GLuint, 2 * max_records_per_frame> queries;
+
+            std::vector<Record> records;
+        };
+
+        void collect(Frame &frame);
+
+        size_t find_scope(const char *name);
+
+        /**
+         * Returned by begin_scope() for scopes which are not recorded, either because they
+         * are outside of a frame or beyond max_records_per_frame.
+         */
+        static constexpr size_t no_record = static_cast<size_t>(-1);
+
+        std::array<Frame, num_frames_in_flight> frames;
+        size_t frame_idx;
+
+        bool is_in_frame;
+
+        /**
+         * Number of open scopes.
+         */
+        int depth;
+
+        /**
+         * Record of the root scope of the current frame.
+         */
+        size_t frame_record_idx;
+
+        std::vector<ScopeStats> scopes;
+        size_t history_idx;
+        uint64_t num_frames_collected;
+    };
+}
@@ -0,0 +1,75 @@
+#include "RenderQueue.h"
+
+#include <array>
+
+namespace Engine
+{
+    /**
+     * @brief Sort the commands by key, keeping commands with equal keys in the order they
+     * were pushed.
+     *
+     * Larger queues are sorted with an LSD radix sort on 8-bit digits. The histograms of
+     * all digits are counted in a single pass, and digits which are the same in every key,
+     * usually most of the pass and shader bits, are skipped.
+     */
+    void RenderQueue::sort()
+    {
+        if (commands.size() <= insertion_sort_threshold)
+        {
+            for (size_t i = 1; i < commands.size(); i++)
+            {
+                const Command command = commands[i];
+                size_t j = i;
+                for (; j > 0 && commands[j - 1].key > command.key; j--)
+                {
+                    commands[j] = commands[j - 1];
+                }
+                commands[j] = command;
+            }
+            return;
+        }
+
+        static constexpr int digit_bits = 8;
+        static constexpr int num_digits = 64 / digit_bits;
+        static constexpr size_t num_buckets = 1 << digit_bits;
+
+        std::array<std::array<uint32_t, num_buckets>, num_digits> histograms = {};
+        for (const Command &command : commands)
+        {
+            for (int digit = 0; digit < num_digits; digit++)
+            {
+                histograms[digit][(command.key >> (digit * digit_bits)) & (num_buckets - 1)]++;
+            }
+        }
+
+        scratch.resize(commands.size());
+        for (int digit = 0; digit < num_digits; digit++)
+        {
+            std::array<uint32_t, num_buckets> &histogram = histograms[digit];
+            const uint32_t first_bucket_count =
+                histogram[(commands[0].key >> (digit * digit_bits)) & (num_buckets - 1)];
+            if (first_bucket_count == commands.size())
+            {
+                continue;
+            }
+
+            /*
+             * Turn the counts into the offset each bucket starts at.
+             */
+            uint32_t offset = 0;
+            for (uint32_t &count : histogram)
+            {
+                const uint32_t bucket_count = count;
+                count = offset;
+                offset += bucket_count;
+            }
+
+            for (const Command &command : commands)
+            {
+                scratch[histogram[(command.key >> (digit * digit_bits)) & (num_buckets - 1)]++] =
+                    command;
+            }
+            commands.swap(scratch);
+        }
+    }
+}
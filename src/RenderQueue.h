@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Draw commands recorded in any order and replayed sorted by a 64-bit key.
+     *
+     * The key packs, from the most significant bits down, the pass, the shader, the
+     * material, the texture and the depth of a draw, so sorting groups draws by the state
+     * that is most expensive to change and, within the same state, draws near geometry
+     * first so that it occludes what is behind. Commands are compact, everything else
+     * about a draw lives in whatever @p item indexes into.
+     */
+    class RenderQueue
+    {
+    public:
+        /**
+         * Widths of the fields of a key.
+         * @{
+         */
+        static constexpr int pass_bits = 4;
+        static constexpr int shader_bits = 6;
+        static constexpr int material_bits = 16;
+        static constexpr int texture_bits = 16;
+        static constexpr int depth_bits = 22;
+        static_assert(pass_bits + shader_bits + material_bits + texture_bits + depth_bits == 64);
+        /**
+         * @}
+         */
+
+        struct Command
+        {
+            uint64_t key;
+            uint32_t item;
+        };
+
+        /**
+         * @brief Pack a sort key. Fields wider than their width are truncated.
+         *
+         * @param pass Pass of the draw.
+         * @param shader Shader of the draw.
+         * @param material Material of the draw, e.g. its texture ID.
+         * @param texture Other texture of the draw.
+         * @param depth Depth of the draw in [0, 1], 0 being nearest.
+         *
+         * @return Sort key.
+         */
+        static uint64_t make_key(const uint8_t pass,
+                                 const uint8_t shader,
+                                 const uint32_t material,
+                                 const uint32_t texture,
+                                 const float depth)
+        {
+            const float clamped_depth = depth < 0.f ? 0.f : (depth > 1.f ? 1.f : depth);
+            const uint64_t depth_field =
+                static_cast<uint64_t>(clamped_depth * static_cast<float>(field_mask(depth_bits)));
+
+            uint64_t key = pass & field_mask(pass_bits);
+            key = (key << shader_bits) | (shader & field_mask(shader_bits));
+            key = (key << material_bits) | (material & field_mask(material_bits));
+            key = (key << texture_bits) | (texture & field_mask(texture_bits));
+            key = (key << depth_bits) | depth_field;
+            return key;
+        }
+
+        static uint8_t get_pass(const uint64_t key)
+        {
+            return key >> (64 - pass_bits);
+        }
+
+        static uint8_t get_shader(const uint64_t key)
+        {
+            return (key >> (64 - pass_bits - shader_bits)) & field_mask(shader_bits);
+        }
+
+        /**
+         * @return Pass and shader of a key, which together identify the state its draw is
+         * set up with.
+         */
+        static uint16_t get_pass_and_shader(const uint64_t key)
+        {
+            return key >> (64 - pass_bits - shader_bits);
+        }
+
+        void push(const uint64_t key, const uint32_t item)
+        {
+            commands.push_back({key, item});
+        }
+
+        void sort();
+
+        const std::vector<Command> &get_commands() const
+        {
+            return commands;
+        }
+
+        void clear()
+        {
+            commands.clear();
+        }
+
+    private:
+        static constexpr uint64_t field_mask(const int bits)
+        {
+            return (uint64_t(1) << bits) - 1;
+        }
+
+        /**
+         * Queues of up to this many commands are insertion sorted instead, which beats
+         * clearing the radix histograms.
+         */
+        static constexpr size_t insertion_sort_threshold = 32;
+
+        std::vector<Command> commands;
+
+        /**
+         * Buffer the radix sort scatters into.
+         */
+        std::vector<Command> scratch;
+    };
+}
@@ -1,19 +1,158 @@
 #include "Renderer.h"
 
 #include "FramebufferTexture.h"
+#include "Frustum.h"
+#include "TerrainMesh.h"
 #include "TexturedMaterial.h"
 #include "Vertex.h"
 #include "VertexArray.h"
+#include "parallel.h"
 
 #include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <glm/common.hpp>
+#include <glm/exponential.hpp>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
+#include <glm/geometric.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/trigonometric.hpp>
 
 namespace Engine
 {
     static constexpr GLsizei shadow_map_resolution = 2048;
 
+    /**
+     * Directory the linked shader programs are cached in.
+     */
+    static constexpr const char *shader_cache_directory = "shader_cache";
+
+    /**
+     * Distance to the far clip plane, which the depth of queued draws is normalized by.
+     */
+    static constexpr float far_clip = 5000.f;
+
+    /**
+     * Bloom chain levels, the first being half the window resolution. Levels smaller than
+     * min_bloom_level_size pixels are not created.
+     * @{
+     */
+    static constexpr int max_bloom_levels = 6;
+    static constexpr int min_bloom_level_size = 8;
+    /**
+     * @}
+     */
+
+    /**
+     * Shadow cascades. The cascades split the view frustum up to shadow_distance, blending
+     * between logarithmic and uniform splits by shadow_split_lambda. Casters up to
+     * shadow_caster_margin beyond a cascade towards the light still cast into it.
+     * @{
+     */
+    static constexpr float shadow_distance = 500.f;
+    static constexpr float shadow_near_depth = 1.f;
+    static constexpr float shadow_split_lambda = 0.8f;
+    static constexpr float shadow_caster_margin = 200.f;
+    static constexpr float shadow_bias_texels = 1.5f;
+    /**
+     * @}
+     */
+
+    /**
+     * Cached cascades are rebuilt once the light has turned by more than this.
+     */
+    static const float shadow_recache_min_cos = glm::cos(glm::radians(0.25f));
+
+    /**
+     * Uniform block binding points. These must match the layout(binding = N) qualifiers of
+     * the FrameData and LightData blocks in shaders/include.
+     */
+    static constexpr GLuint frame_uniform_binding = 0;
+    static constexpr GLuint light_uniform_binding = 1;
+
+    /**
+     * Shader storage block binding point of the materials. This must match the MaterialBuffer
+     * block in shaders/include/material.glsl.
+     */
+    static constexpr GLuint material_storage_binding = 2;
+
+    /**
+     * Shader storage block binding points of the point lights and of the lights of each
+     * cluster. These must match the PointLightBuffer and ClusterBuffer blocks in
+     * shaders/include/lights.glsl.
+     */
+    static constexpr GLuint point_light_storage_binding = 6;
+    static constexpr GLuint cluster_storage_binding = 7;
+
+    /**
+     * Vertex attribute location of the first column of the per-instance model matrix. The
+     * matrix takes up this and the following three locations, matching the l_model input
+     * of the instanced vertex shaders.
+     */
+    static constexpr GLuint instance_model_attrib_location = 4;
+
+    /**
+     * Vertex attribute location of the per-instance material index, matching the l_material
+     * input of the regular object vertex shader.
+     */
+    static constexpr GLuint instance_material_attrib_location = 8;
+
+    /**
+     * Number of regular object instances per frame the instance buffer is first sized for.
+     * It grows when more are added.
+     */
+    static constexpr size_t initial_regular_object_instances = 1024;
+
+    /**
+     * Number of point lights per frame the point light buffer is first sized for. It grows
+     * when more are added.
+     */
+    static constexpr size_t initial_point_lights = 256;
+
+    /**
+     * Attenuation of point lights. These must match shaders/include/lights.glsl.
+     * @{
+     */
+    static constexpr float point_light_constant = 1.0f;
+    static constexpr float point_light_linear = 0.007f;
+    static constexpr float point_light_quadratic = 0.002f;
+    /**
+     * @}
+     */
+
+    /**
+     * Attenuated intensity below which a point light is cut off, which sets its radius.
+     */
+    static constexpr float point_light_cutoff = 0.02f;
+
+    /**
+     * Size of the cluster grid, and how many lights each cluster holds at most. These must
+     * match shaders/include/lights.glsl.
+     * @{
+     */
+    static constexpr GLuint cluster_grid_x = 16;
+    static constexpr GLuint cluster_grid_y = 9;
+    static constexpr GLuint cluster_grid_z = 24;
+    static constexpr GLuint num_clusters = cluster_grid_x * cluster_grid_y * cluster_grid_z;
+    static constexpr GLuint max_lights_per_cluster = 128;
+    /**
+     * @}
+     */
+
+    /**
+     * Local size of shaders/light_cluster.comp.
+     */
+    static constexpr GLuint light_cluster_group_size = 64;
+
+    /**
+     * View depth at which the second cluster slice starts. The slices are spaced
+     * exponentially from there to the far plane, so that clusters are about as deep as they
+     * are wide, and the first slice covers everything nearer.
+     */
+    static constexpr float cluster_near_depth = 1.f;
+
     /**
      * Relative to the terrain, the skybox spins around it. We draw a sun
      * on the skybox in its model space so that it rotates with it with an
@@ -53,7 +192,27 @@ namespace Engine
     /**
      * @brief Constructor.
      */
-    Renderer::Renderer(): exposure(1.0f), gamma(0.5f), sharpness(1.0f)
+    Renderer::Renderer():
+        frame_arena_idx(0),
+        num_gl_calls(0),
+        num_gl_calls_skipped(0),
+        render_width(0),
+        render_height(0),
+        num_terrain_chunks_drawn(0),
+        is_gpu_culling(true),
+        hiz_view_projection(1.0f),
+        hiz_texture_coord_scale(1.0f),
+        is_hiz_valid(false),
+        is_depth_prepass(true),
+        overdraw_queries {},
+        overdraw_query_idx(0),
+        overdraw(0.0f),
+        num_regular_object_batches_drawn(0),
+        cluster_buffer(0),
+        shadow_cascades {},
+        num_shadow_cascades(max_shadow_cascades),
+        num_shadow_cascades_recached(0),
+        shadow_terrain_generation(0)
     {}
 
     /**
@@ -68,13 +227,126 @@ namespace Engine
     {
         window_width = _window_width;
         window_height = _window_height;
+        render_width = window_width;
+        render_height = window_height;
 
         static constexpr float fov_deg = 75.f;
-        static constexpr const float far_clip = 5000.f;
         const float aspect = static_cast<float>(window_width) / window_height;
         const float near_clip = 0.001f;
         projection = glm::perspective(glm::radians(fov_deg), aspect, near_clip, far_clip);
 
+        frame_uniform_buffer.create(frame_uniform_binding);
+        light_uniform_buffer.create(light_uniform_binding);
+
+        /*
+         * Start all programs up front, loading them from the cache or else handing them to
+         * the driver to compile in parallel, and only wait for each where it is first set
+         * up below.
+         */
+        ASSERT_RET_IF_NOT(shader_cache.init(shader_cache_directory), false);
+        ASSERT_RET_IF_NOT(post_process.begin_init(&shader_cache), false);
+        ASSERT_RET_IF_NOT(bloom_downsample_shader.begin_compile(
+                              {
+                                  {"bloom.vert", GL_VERTEX_SHADER},
+                                  {"bloom_downsample.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(bloom_upsample_shader.begin_compile(
+                              {
+                                  {"bloom.vert", GL_VERTEX_SHADER},
+                                  {"bloom_upsample.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(skybox_shader.begin_compile(
+                              {
+                                  {"skybox.vert", GL_VERTEX_SHADER},
+                                  {"skybox.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(regular_object_shader.begin_compile(
+                              {
+                                  {"regular_object.vert", GL_VERTEX_SHADER},
+                                  {"regular_object.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(point_light_shader.begin_compile(
+                              {
+                                  {"point_light.vert", GL_VERTEX_SHADER},
+                                  {"point_light.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(light_cluster_shader.begin_compile(
+                              {
+                                  {"light_cluster.comp", GL_COMPUTE_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(depth_shader.begin_compile(
+                              {
+                                  {"terrain_depth.vert", GL_VERTEX_SHADER},
+                                  {"depth.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(depth_instanced_shader.begin_compile(
+                              {
+                                  {"depth_instanced.vert", GL_VERTEX_SHADER},
+                                  {"depth.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(depth_prepass_shader.begin_compile(
+                              {
+                                  {"terrain_depth_prepass.vert", GL_VERTEX_SHADER},
+                                  {"depth.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(depth_prepass_instanced_shader.begin_compile(
+                              {
+                                  {"depth_prepass_instanced.vert", GL_VERTEX_SHADER},
+                                  {"depth.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(debug_shader.begin_compile(
+                              {
+                                  {"debug.vert", GL_VERTEX_SHADER},
+                                  {"debug.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(terrain_shader.begin_compile(
+                              {
+                                  {"terrain.vert", GL_VERTEX_SHADER},
+                                  {"terrain.frag", GL_FRAGMENT_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(terrain_cull_shader.begin_compile(
+                              {
+                                  {"terrain_cull.comp", GL_COMPUTE_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+        ASSERT_RET_IF_NOT(hiz_shader.begin_compile(
+                              {
+                                  {"hiz_downsample.comp", GL_COMPUTE_SHADER},
+                              },
+                              &shader_cache),
+                          false);
+
+        texture_loader.init();
+
+        ASSERT_RET_IF_NOT(material_table.init(material_storage_binding), false);
+
+        profiler.init();
+
         LOG("Creating screen quad...\n");
         {
             /* clang-format off */
@@ -122,40 +394,50 @@ namespace Engine
                                         GL_CLAMP_TO_EDGE /* wrap_mode */);
 
             /*
-             * Create a render buffer to hold the depth and stencil buffer.
+             * Create a texture to hold the depth buffer, which the Hi-Z pyramid is built
+             * from.
              */
-            GLuint depth_stencil_render_buffer;
-            glGenRenderbuffers(1, &depth_stencil_render_buffer);
-            glBindRenderbuffer(GL_RENDERBUFFER, depth_stencil_render_buffer);
-            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, window_width, window_height);
-            glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER,
-                                      GL_DEPTH_STENCIL_ATTACHMENT,
-                                      GL_RENDERBUFFER,
-                                      depth_stencil_render_buffer);
+            screen_depth_texture.create(window_width,
+                                        window_height,
+                                        GL_DEPTH_ATTACHMENT,
+                                        4 /* slot */,
+                                        GL_DEPTH_COMPONENT32F /* internal_format */,
+                                        GL_DEPTH_COMPONENT /* format */,
+                                        GL_NEAREST /* min_filter */,
+                                        GL_NEAREST /* max_filter */,
+                                        GL_CLAMP_TO_EDGE /* wrap_mode */);
 
             ASSERT_RET_IF_NOT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE,
                               false);
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
             /*
-             * Create ping-pong frame buffers for blurring the bloom texture.
+             * Create the bloom mip chain, stopping before the levels get so small that they
+             * no longer add any visible spread, and a frame buffer per level.
              */
-            for (uint8_t i = 0; i < ping_pong_frame_buffer.size(); i++)
+            int num_bloom_levels = 1;
+            while (num_bloom_levels < max_bloom_levels &&
+                   std::min(window_width, window_height) >> (num_bloom_levels + 1) >=
+                       min_bloom_level_size)
+            {
+                num_bloom_levels++;
+            }
+
+            bloom_chain_texture.create_mipmapped(std::max(window_width / 2, 1),
+                                                 std::max(window_height / 2, 1),
+                                                 num_bloom_levels,
+                                                 GL_COLOR_ATTACHMENT0,
+                                                 screen_bloom_texture.get_slot(),
+                                                 GL_RGBA16F /* internal_format */,
+                                                 GL_LINEAR /* filter */,
+                                                 GL_CLAMP_TO_EDGE /* wrap_mode */);
+
+            bloom_chain_frame_buffers.resize(num_bloom_levels);
+            for (int i = 0; i < num_bloom_levels; i++)
             {
-                glGenFramebuffers(1, &ping_pong_frame_buffer[i]);
-                glBindFramebuffer(GL_FRAMEBUFFER, ping_pong_frame_buffer[i]);
-
-                ping_pong_texture[i].create(screen_bloom_texture.get_width(),
-                                            screen_bloom_texture.get_height(),
-                                            GL_COLOR_ATTACHMENT0,
-                                            screen_bloom_texture.get_slot(),
-                                            GL_RGBA16F /* internal_format */,
-                                            GL_RGBA /* format */,
-                                            GL_LINEAR /* min_filter */,
-                                            GL_LINEAR /* max_filter */,
-                                            GL_CLAMP_TO_EDGE /* wrap_mode */);
+                glGenFramebuffers(1, &bloom_chain_frame_buffers[i]);
+                glBindFramebuffer(GL_FRAMEBUFFER, bloom_chain_frame_buffers[i]);
+                bloom_chain_texture.attach_level(i);
 
                 ASSERT_RET_IF_NOT(glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
                                       GL_FRAMEBUFFER_COMPLETE,
@@ -163,12 +445,40 @@ namespace Engine
             }
 
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            /*
+             * Create the Hi-Z pyramid, starting at half the window resolution and going all
+             * the way down to a single texel.
+             */
+            const int hiz_width = std::max(window_width / 2, 1);
+            const int hiz_height = std::max(window_height / 2, 1);
+            int num_hiz_levels = 1;
+            while (std::max(hiz_width, hiz_height) >> num_hiz_levels > 0)
+            {
+                num_hiz_levels++;
+            }
+            hiz_texture.create_mipmapped(hiz_width,
+                                         hiz_height,
+                                         num_hiz_levels,
+                                         GL_NONE /* attachment */,
+                                         3 /* slot */,
+                                         GL_R32F /* internal_format */,
+                                         GL_NEAREST /* filter */,
+                                         GL_CLAMP_TO_EDGE /* wrap_mode */);
         }
 
         LOG("Loading skybox\n");
         {
-            ASSERT_RET_IF_NOT(
-                skybox_texture.create_from_file("textures/skybox/", ".jpg", 0 /* slot */), false);
+            /*
+             * Night sky blue until the faces have been loaded.
+             */
+            static constexpr std::array<uint8_t, 4> skybox_placeholder = {0x10, 0x18, 0x30, 0xFF};
+            ASSERT_RET_IF_NOT(skybox_texture.create_from_file(texture_loader,
+                                                              "textures/skybox/",
+                                                              ".jpg",
+                                                              0 /* slot */,
+                                                              skybox_placeholder),
+                              false);
 
             static const std::array<Vertex3d, 36> skybox_vertices = {
                 /* clang-format off */
@@ -223,69 +533,93 @@ namespace Engine
         }
 
         /*
-         * Create shadow map frame buffer.
+         * Create shadow map frame buffers, one per cascade for both the shadow map and the
+         * cached terrain depth.
          */
-        LOG("Creating shadow map frame buffer\n");
+        LOG("Creating shadow map frame buffers\n");
         {
-            glGenFramebuffers(1, &shadow_map_frame_buffer);
-            glBindFramebuffer(GL_FRAMEBUFFER, shadow_map_frame_buffer);
-            shadow_map_texture.create(shadow_map_resolution,
-                                      shadow_map_resolution,
-                                      GL_DEPTH_ATTACHMENT,
-                                      2 /* slot */,
-                                      GL_DEPTH_COMPONENT /* internal_format */,
-                                      GL_DEPTH_COMPONENT /* format */,
-                                      GL_NEAREST /* min_filter */,
-                                      GL_NEAREST /* max_filter */,
-                                      GL_CLAMP_TO_BORDER /* wrap_mode */);
-            glDrawBuffer(GL_NONE);
-            glReadBuffer(GL_NONE);
+            shadow_map_texture.create_layered(shadow_map_resolution,
+                                              shadow_map_resolution,
+                                              max_shadow_cascades,
+                                              GL_DEPTH_ATTACHMENT,
+                                              2 /* slot */,
+                                              GL_DEPTH_COMPONENT32F /* internal_format */,
+                                              GL_DEPTH_COMPONENT /* format */,
+                                              GL_NEAREST /* min_filter */,
+                                              GL_NEAREST /* max_filter */,
+                                              GL_CLAMP_TO_BORDER /* wrap_mode */);
+            shadow_terrain_texture.create_layered(shadow_map_resolution,
+                                                  shadow_map_resolution,
+                                                  max_shadow_cascades,
+                                                  GL_DEPTH_ATTACHMENT,
+                                                  2 /* slot */,
+                                                  GL_DEPTH_COMPONENT32F /* internal_format */,
+                                                  GL_DEPTH_COMPONENT /* format */,
+                                                  GL_NEAREST /* min_filter */,
+                                                  GL_NEAREST /* max_filter */,
+                                                  GL_CLAMP_TO_BORDER /* wrap_mode */);
+
+            for (int i = 0; i < max_shadow_cascades; i++)
+            {
+                ShadowCascade &cascade = shadow_cascades[i];
+
+                glGenFramebuffers(1, &cascade.frame_buffer);
+                glBindFramebuffer(GL_FRAMEBUFFER, cascade.frame_buffer);
+                shadow_map_texture.attach_layer(i);
+                glDrawBuffer(GL_NONE);
+                glReadBuffer(GL_NONE);
+                ASSERT_RET_IF_NOT(glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+                                      GL_FRAMEBUFFER_COMPLETE,
+                                  false);
+
+                glGenFramebuffers(1, &cascade.terrain_frame_buffer);
+                glBindFramebuffer(GL_FRAMEBUFFER, cascade.terrain_frame_buffer);
+                shadow_terrain_texture.attach_layer(i);
+                glDrawBuffer(GL_NONE);
+                glReadBuffer(GL_NONE);
+                ASSERT_RET_IF_NOT(glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+                                      GL_FRAMEBUFFER_COMPLETE,
+                                  false);
+
+                cascade.view_projection = glm::mat4(1.0f);
+                cascade.is_terrain_cached = false;
+            }
 
-            ASSERT_RET_IF_NOT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE,
-                              false);
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
         }
 
         /*
          * Initialize screen shader.
          */
-        ASSERT_RET_IF_NOT(screen_shader.compile({
-                              {"screen.vert", GL_VERTEX_SHADER},
-                              {"screen.frag", GL_FRAGMENT_SHADER},
-                          }),
-                          false);
-        screen_shader.use();
-        ASSERT_RET_IF_NOT(screen_shader.set_int("u_color_texture_sampler",
-                                                screen_color_texture.get_slot()),
+        ASSERT_RET_IF_NOT(post_process.finish_init(window_width,
+                                                   window_height,
+                                                   screen_color_texture.get_slot(),
+                                                   bloom_chain_texture.get_slot()),
                           false);
-        ASSERT_RET_IF_NOT(screen_shader.set_int("u_bloom_texture_sampler",
-                                                screen_bloom_texture.get_slot()),
-                          false);
-        ASSERT_RET_IF_NOT(screen_shader.set_float("u_exposure", exposure), false);
-        ASSERT_RET_IF_NOT(screen_shader.set_float("u_gamma", gamma), false);
-        ASSERT_RET_IF_NOT(screen_shader.set_float("u_sharpness", sharpness), false);
+        post_process.set_bloom_intensity(1.0f / bloom_chain_frame_buffers.size());
 
         /*
-         * Initialize gaussian blur shader.
+         * Initialize bloom shaders.
          */
-        ASSERT_RET_IF_NOT(gaussian_blur_shader.compile({
-                              {"gaussian_blur.vert", GL_VERTEX_SHADER},
-                              {"gaussian_blur.frag", GL_FRAGMENT_SHADER},
-                          }),
+        ASSERT_RET_IF_NOT(bloom_downsample_shader.finish_compile(), false);
+        bloom_downsample_shader.use();
+        ASSERT_RET_IF_NOT(bloom_downsample_shader.set_int("u_texture_sampler",
+                                                          bloom_chain_texture.get_slot()),
                           false);
-        gaussian_blur_shader.use();
-        ASSERT_RET_IF_NOT(gaussian_blur_shader.set_int("u_texture_sampler",
-                                                       screen_bloom_texture.get_slot()),
+        ASSERT_RET_IF_NOT(
+            bloom_downsample_shader.get_uniform("u_texture_coord_scale",
+                                                bloom_downsample_texture_coord_scale_uniform),
+            false);
+        ASSERT_RET_IF_NOT(bloom_upsample_shader.finish_compile(), false);
+        bloom_upsample_shader.use();
+        ASSERT_RET_IF_NOT(bloom_upsample_shader.set_int("u_texture_sampler",
+                                                        bloom_chain_texture.get_slot()),
                           false);
 
         /*
          * Initialize cube shader.
          */
-        ASSERT_RET_IF_NOT(skybox_shader.compile({
-                              {"skybox.vert", GL_VERTEX_SHADER},
-                              {"skybox.frag", GL_FRAGMENT_SHADER},
-                          }),
-                          false);
+        ASSERT_RET_IF_NOT(skybox_shader.finish_compile(), false);
         skybox_shader.use();
         ASSERT_RET_IF_NOT(skybox_shader.set_mat4("u_projection", projection), false);
         ASSERT_RET_IF_NOT(skybox_shader.set_float("u_sun_angular_radius", sun_angular_radius),
@@ -294,69 +628,190 @@ namespace Engine
                           false);
         ASSERT_RET_IF_NOT(skybox_shader.set_int("u_texture_sampler", skybox_texture.get_slot()),
                           false);
+        ASSERT_RET_IF_NOT(skybox_shader.get_uniform("u_view", skybox_view_uniform), false);
+        ASSERT_RET_IF_NOT(skybox_shader.get_uniform("u_sun_color", skybox_sun_color_uniform),
+                          false);
 
         /*
          * Initialize regular object shader.
          */
-        ASSERT_RET_IF_NOT(regular_object_shader.compile({
-                              {"regular_object.vert", GL_VERTEX_SHADER},
-                              {"regular_object.frag", GL_FRAGMENT_SHADER},
-                          }),
-                          false);
+        ASSERT_RET_IF_NOT(regular_object_shader.finish_compile(), false);
         regular_object_shader.use();
-        ASSERT_RET_IF_NOT(regular_object_shader.set_mat4("u_projection", projection), false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_int("u_texture_sampler", 0), false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_int("u_normal_map_sampler", 1), false);
         ASSERT_RET_IF_NOT(regular_object_shader.set_int("u_shadow_map_sampler",
                                                         shadow_map_texture.get_slot()),
                           false);
+        if (!material_table.is_bindless())
+        {
+            ASSERT_RET_IF_NOT(regular_object_shader.set_int("u_texture_sampler",
+                                                            MaterialTable::texture_unit),
+                              false);
+            ASSERT_RET_IF_NOT(regular_object_shader.set_int(
+                                  "u_normal_map_sampler", MaterialTable::normal_map_texture_unit),
+                              false);
+        }
+        ASSERT_RET_IF_NOT(regular_object_instance_buffer.create(GL_ARRAY_BUFFER,
+                                                                initial_regular_object_instances),
+                          false);
 
         /*
          * Initialize point light shader.
          */
-        ASSERT_RET_IF_NOT(point_light_shader.compile({
-                              {"point_light.vert", GL_VERTEX_SHADER},
-                              {"point_light.frag", GL_FRAGMENT_SHADER},
-                          }),
+        ASSERT_RET_IF_NOT(point_light_shader.finish_compile(), false);
+        ASSERT_RET_IF_NOT(point_light_shader.get_uniform("u_model", point_light_model_uniform),
                           false);
-        point_light_shader.use();
-        ASSERT_RET_IF_NOT(point_light_shader.set_mat4("u_projection", projection), false);
+        ASSERT_RET_IF_NOT(
+            point_light_buffer.create(GL_SHADER_STORAGE_BUFFER, initial_point_lights), false);
+
+        /*
+         * Initialize clustered lighting. The cluster buffer is only written and read on the
+         * GPU.
+         */
+        ASSERT_RET_IF_NOT(light_cluster_shader.finish_compile(), false);
+        glGenBuffers(1, &cluster_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, cluster_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+                     (num_clusters + num_clusters * max_lights_per_cluster) * sizeof(GLuint),
+                     nullptr,
+                     GL_DYNAMIC_COPY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cluster_storage_binding, cluster_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
         /*
          * Initialize depth shader.
          */
-        ASSERT_RET_IF_NOT(depth_shader.compile({
-                              {"depth.vert", GL_VERTEX_SHADER},
-                              {"depth.frag", GL_FRAGMENT_SHADER},
-                          }),
+        ASSERT_RET_IF_NOT(depth_shader.finish_compile(), false);
+        ASSERT_RET_IF_NOT(depth_shader.get_uniform("u_model", depth_model_uniform), false);
+        ASSERT_RET_IF_NOT(depth_shader.get_uniform("u_light_view_projection",
+                                                   depth_light_view_projection_uniform),
                           false);
+        ASSERT_RET_IF_NOT(depth_instanced_shader.finish_compile(), false);
+        ASSERT_RET_IF_NOT(
+            depth_instanced_shader.get_uniform("u_light_view_projection",
+                                               depth_instanced_light_view_projection_uniform),
+            false);
+
+        /*
+         * Initialize depth pre-pass shaders, and the queries measuring the overdraw they
+         * save. The queries are created rather than generated so that they can be read back
+         * before they first ran.
+         */
+        ASSERT_RET_IF_NOT(depth_prepass_shader.finish_compile(), false);
+        depth_prepass_shader.use();
+        ASSERT_RET_IF_NOT(depth_prepass_shader.set_mat4("u_model", glm::mat4(1)), false);
+        ASSERT_RET_IF_NOT(depth_prepass_instanced_shader.finish_compile(), false);
+        for (OverdrawQueries &queries : overdraw_queries)
+        {
+            glCreateQueries(GL_SAMPLES_PASSED, 1, &queries.opaque);
+            glCreateQueries(GL_SAMPLES_PASSED, 1, &queries.sky);
+        }
 
         /*
          * Initialize debug shader.
          */
-        ASSERT_RET_IF_NOT(debug_shader.compile({
-                              {"debug.vert", GL_VERTEX_SHADER},
-                              {"debug.frag", GL_FRAGMENT_SHADER},
-                          }),
-                          false);
-        debug_shader.use();
-        ASSERT_RET_IF_NOT(debug_shader.set_mat4("u_projection", projection), false);
+        ASSERT_RET_IF_NOT(debug_shader.finish_compile(), false);
+        ASSERT_RET_IF_NOT(debug_shader.get_uniform("u_model", debug_model_uniform), false);
+        ASSERT_RET_IF_NOT(debug_shader.get_uniform("u_color", debug_color_uniform), false);
 
         /*
          * Initialize terrain shader.
          */
-        ASSERT_RET_IF_NOT(terrain_shader.compile({
-                              {"terrain.vert", GL_VERTEX_SHADER},
-                              {"terrain.frag", GL_FRAGMENT_SHADER},
-                          }),
-                          false);
+        ASSERT_RET_IF_NOT(terrain_shader.finish_compile(), false);
         terrain_shader.use();
-        ASSERT_RET_IF_NOT(terrain_shader.set_mat4("u_projection", projection), false);
         ASSERT_RET_IF_NOT(terrain_shader.set_mat4("u_model", glm::mat4(1)), false);
+        ASSERT_RET_IF_NOT(TexturedMaterial::get_uniforms(terrain_shader, terrain_material_uniforms),
+                          false);
+
+        /*
+         * Initialize GPU culling shaders.
+         */
+        ASSERT_RET_IF_NOT(terrain_cull_shader.finish_compile(), false);
+        terrain_cull_shader.use();
+        ASSERT_RET_IF_NOT(terrain_cull_shader.set_int("u_hiz_sampler", hiz_texture.get_slot()),
+                          false);
+        ASSERT_RET_IF_NOT(terrain_cull_shader.get_uniform("u_view_projection",
+                                                          terrain_cull_view_projection_uniform),
+                          false);
+        ASSERT_RET_IF_NOT(
+            terrain_cull_shader.get_uniform("u_lod_origin", terrain_cull_lod_origin_uniform),
+            false);
+        ASSERT_RET_IF_NOT(
+            terrain_cull_shader.get_uniform("u_is_occlusion_culling",
+                                            terrain_cull_is_occlusion_culling_uniform),
+            false);
+        ASSERT_RET_IF_NOT(
+            terrain_cull_shader.get_uniform("u_occlusion_view_projection",
+                                            terrain_cull_occlusion_view_projection_uniform),
+            false);
+        ASSERT_RET_IF_NOT(
+            terrain_cull_shader.get_uniform("u_occlusion_texture_coord_scale",
+                                            terrain_cull_occlusion_texture_coord_scale_uniform),
+            false);
+
+        ASSERT_RET_IF_NOT(hiz_shader.finish_compile(), false);
+        ASSERT_RET_IF_NOT(
+            hiz_shader.get_uniform("u_source_sampler", hiz_source_sampler_uniform), false);
+        ASSERT_RET_IF_NOT(hiz_shader.get_uniform("u_source_level", hiz_source_level_uniform),
+                          false);
+
+        return true;
+    }
+
+    /**
+     * @brief Start rebuilding shaders on a background context when their files change.
+     * Must be called from the main thread after init().
+     *
+     * @param window Window whose context the renderer draws with.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Renderer::start_hot_reload(GLFWwindow *const window)
+    {
+        ASSERT_RET_IF_NOT(shader_reloader.init(window), false);
+
+        for (Shader *const shader : {&post_process.get_shader(),
+                                     &terrain_shader,
+                                     &terrain_cull_shader,
+                                     &hiz_shader,
+                                     &depth_prepass_shader,
+                                     &depth_prepass_instanced_shader,
+                                     &regular_object_shader,
+                                     &point_light_shader,
+                                     &light_cluster_shader,
+                                     &bloom_downsample_shader,
+                                     &bloom_upsample_shader,
+                                     &skybox_shader,
+                                     &depth_shader,
+                                     &depth_instanced_shader,
+                                     &debug_shader})
+        {
+            shader_reloader.add(*shader);
+        }
 
         return true;
     }
 
+    /**
+     * @brief Stop rebuilding shaders. Must be called from the main thread before the
+     * window is destroyed.
+     */
+    void Renderer::stop_hot_reload()
+    {
+        shader_reloader.stop();
+    }
+
+    /**
+     * @brief Reload the shaders and textures made from any of the changed files. Shaders are
+     * swapped in and textures uploaded over the next frames, the current ones are used
+     * until then.
+     *
+     * @param changed_paths Paths to the changed files.
+     */
+    void Renderer::reload(const std::vector<std::string> &changed_paths)
+    {
+        shader_reloader.reload(changed_paths);
+        texture_loader.reload(changed_paths);
+    }
+
     /**
      * @brief Set the terrain to be rendered.
      *
@@ -367,7 +822,7 @@ namespace Engine
     bool Renderer::set_terrain(const Terrain &_terrain)
     {
         terrain_shader.use();
-        ASSERT_RET_IF_NOT(_terrain.material.apply(terrain_shader), false);
+        _terrain.material.apply(terrain_shader, terrain_material_uniforms);
         ASSERT_RET_IF_NOT(
             terrain_shader.set_int("u_normal_map_sampler", _terrain.normal_map.get_slot()), false);
         ASSERT_RET_IF_NOT(
@@ -375,6 +830,11 @@ namespace Engine
 
         terrain = std::make_unique<Terrain>(_terrain);
 
+        for (ShadowCascade &cascade : shadow_cascades)
+        {
+            cascade.is_terrain_cached = false;
+        }
+
         return true;
     }
 
@@ -385,398 +845,1315 @@ namespace Engine
      */
     void Renderer::add_regular_object(const RegularObject &object)
     {
-        regular_objects.push_back(object);
+        RegularObjectBatch &batch = get_regular_object_batch(object.drawable);
+        batch.transforms.push_back(get_frame_arena(), object.transform);
+        batch.materials.push_back(get_frame_arena(),
+                                  material_table.get_index(object.material, object.normal_map));
     }
 
     /**
-     * @brief Add a point light object to be rendered.
+     * @brief Add many instances of a regular object to be rendered.
      *
-     * @param object Point light object to add.
+     * @param objects Instances to add.
      */
-    void Renderer::add_point_light_object(const PointLightObject &object)
+    void Renderer::add_regular_object_instances(const RegularObjectInstances &objects)
     {
-        point_light_objects.push_back(object);
+        if (unlikely(objects.count == 0))
+        {
+            return;
+        }
+
+        get_regular_object_batch(objects.drawable)
+            .instance_arrays.push_back(get_frame_arena(), objects);
     }
 
     /**
-     * @brief Add a directional light object to be rendered.
+     * @brief Get the index of a material in the material table, for instances added with
+     * add_regular_object_instances().
      *
-     * @param object Directional light object to add.
+     * @param material Material, whose texture is the color texture.
+     * @param normal_map Normal map used with the material.
+     *
+     * @return Index of the material.
      */
-    void Renderer::add_directional_light_object(const DirectionalLightObject &object)
+    GLuint Renderer::get_material_index(const TexturedMaterial &material,
+                                        const Texture &normal_map)
     {
-        directional_light_objects.push_back(object);
+        return material_table.get_index(material, normal_map);
     }
 
     /**
-     * @brief Add a debug object to be rendered.
+     * @brief Get the arena of the frame being submitted, for data which must live until
+     * the frame is rendered, such as the arrays of add_regular_object_instances(). It stays
+     * valid until the end of the next frame.
      *
-     * @param object Debug object to add.
+     * @return The arena.
      */
-    void Renderer::add_debug_object(const DebugObject &object)
+    FrameArena &Renderer::get_frame_arena()
     {
-        debug_objects.push_back(object);
+        return frame_arenas[frame_arena_idx];
     }
 
     /**
-     * @brief Render the scene.
+     * @brief Get the batch of a drawable, adding it if there is none yet.
      *
-     * @param camera_view Camera view matrix.
-     * @param skybox_view Skybox view matrix.
-     * @param camera_position Camera position in world space.
+     * @param drawable Drawable of the batch.
      *
-     * @return True if successful, otherwise false.
+     * @return The batch.
      */
-    bool Renderer::render(const glm::mat4 &camera_view,
-                          const glm::mat4 &skybox_view,
-                          const glm::vec3 &camera_position,
-                          const glm::vec3 &camera_direction)
+    Renderer::RegularObjectBatch &Renderer::get_regular_object_batch(const Drawable &drawable)
     {
         /*
-         * For now, only one directional and point light is supported.
-         */
-        ASSERT_RET_IF_NOT(directional_light_objects.size() == 1, false);
-        ASSERT_RET_IF_NOT(point_light_objects.size() == 1, false);
-
-        glm::mat4 light_view_projection;
-
-        /*
-         * If the directional light is shining, render the depth map. It is a bit more
-         * sensicle to make this a function of the light's position above the horizon,
-         * but for now we rely on the color already being a function of it.
-         *
-         * We place `likely` here since the shadow rendering code is the heaviest part
-         * so it saves cycles when the light is shining.
+         * Objects of the same type tend to be added one after another, so search the
+         * batches starting from the most recent one.
          */
-        if (likely(directional_light_objects[0].color != glm::vec3(0.0f)))
+        auto batch = std::find_if(regular_object_batches.rbegin(),
+                                  regular_object_batches.rend(),
+                                  [&drawable](const RegularObjectBatch &batch) {
+                                      return batch.drawable == &drawable;
+                                  });
+        if (unlikely(batch == regular_object_batches.rend()))
         {
-            /*
-             * The directional light is infinitely far away, but we cannot afford
-             * to render an infinite area for the shadow map. Instead, we want to only
-             * render what the camera can see. We can accomplish this by picking a point
-             * in front of the camera, `light_target` and compute the `light_position`
-             * by moving back along the light's direction and draw an orthographic
-             * projection frustrum from the light, pointed at the `light_target`.
-             *
-             * There are a few settings that we must decide on:
-             * - `shadow_frustrum_start`: How close to the light the frustrum starts.
-             *   This should just start at the `light_position`, so 0.
-             *
-             * - `shadow_frustrum_end`: How far from the light the frustrum ends. This
-             *   should be long enough to reach the ground from the `light_position`. We
-             *   should eventually set this programmatically, but for now we just have a
-             *   large fixed value.
-             *
-             * - `shadow_frustrum_width`: How wide the frustrum is in each direction
-             *   from the center. This sets how much field of view resides in the
-             *   frustrum. We should also set this programmatically, but for now we just
-             *   make it the same as the `shadow_frustrum_end` (it is divided by 2
-             *   because it extends in both left and right directions).
-             *
-             * - `shadow_render_distance_from_camera`: How far in front of the camera we
-             *   should place the `light_target`. This should be set so that objects
-             *   near the camera are rendered with shadows. We set it to be half the
-             *   length of the frustrum so that it resides in the center of the
-             *   frustrum.
-             *
-             * - `shadow_render_distance_from_light`: How far back from the
-             *   `light_target` we place the `light_position`. To make it so
-             *   `light_target` is in the center of the frustrum we set it to be half
-             *   the length of the frustrum.
-             *
-             * Also important to note is that a big frustrum means more area will have
-             * shadows rendered, but the resolution of the shadow map will be spread
-             * thinner, leading to blocky shadows. A smaller frustrum means less area
-             * will have shadows rendered, but the resolution of the shadow map will be
-             * more dense, leading to sharper shadows.
-             */
-            static constexpr float shadow_frustrum_start = 0.f;
-            static constexpr float shadow_frustrum_end = 150.f;
-            static constexpr float shadow_frustrum_width = shadow_frustrum_end / 2.f;
-            static constexpr float shadow_render_distance_from_camera = shadow_frustrum_end / 2.f;
-            const float shadow_render_distance_from_light = shadow_frustrum_end / 2.f;
-
-            const glm::vec3 light_target =
-                camera_position + camera_direction * shadow_render_distance_from_camera;
-
-            const glm::vec3 light_position = light_target - directional_light_objects[0].direction *
-                                                                shadow_render_distance_from_light;
+            regular_object_batches.push_back({
+                .drawable = &drawable,
+                .transforms = {},
+                .materials = {},
+                .instance_arrays = {},
+                .material_runs = {},
+                .base_instance = 0,
+                .num_instances = 0,
+            });
+            return regular_object_batches.back();
+        }
 
-            const glm::mat4 light_projection = glm::ortho(-shadow_frustrum_width,
-                                                          shadow_frustrum_width,
-                                                          -shadow_frustrum_width,
-                                                          shadow_frustrum_width,
-                                                          shadow_frustrum_start,
-                                                          shadow_frustrum_end);
+        return *batch;
+    }
 
-            /*
-             * Get the light's view, starting at its position, looking at the target,
-             * with "up" being the y axis.
-             */
-            const glm::mat4 light_view =
-                glm::lookAt(light_position, light_target, glm::vec3(0.0f, 1.0f, 0.0f));
+    /**
+     * @brief Append the runs of instances of one material among consecutive instances of a
+     * batch, extending the last run of the batch if it has the same material.
+     *
+     * @param batch Batch of the instances.
+     * @param materials Material index of every instance.
+     * @param count Number of instances.
+     * @param base_instance Index of the first instance in the instance buffer.
+     */
+    void Renderer::add_material_runs(RegularObjectBatch &batch,
+                                     const GLuint *materials,
+                                     const size_t count,
+                                     GLuint base_instance)
+    {
+        for (size_t i = 0; i < count; i++, base_instance++)
+        {
+            FrameArena::Array<RegularObjectMaterialRun> &runs = batch.material_runs;
+            if (likely(!runs.empty() && runs[runs.size() - 1].material == materials[i]))
+            {
+                runs[runs.size() - 1].num_instances++;
+                continue;
+            }
+            runs.push_back(get_frame_arena(),
+                           {
+                               .material = materials[i],
+                               .base_instance = base_instance,
+                               .num_instances = 1,
+                           });
+        }
+    }
 
-            /*
-             * Get the light's view projection matrix which models can be multiplied by
-             * to transform from world space to light space. This rotates the
-             * orthographic projection box to emit from the light's point of view.
-             */
-            light_view_projection = light_projection * light_view;
+    /**
+     * @brief Build the model matrices of all regular object batches on the job system,
+     * straight into the current region of the instance buffer along with the material
+     * indices, and point the per-instance attributes of each batch's drawable at it.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Renderer::upload_regular_object_instances()
+    {
+        size_t num_instances = 0;
+        for (RegularObjectBatch &batch : regular_object_batches)
+        {
+            size_t num_batch_instances = batch.transforms.size();
+            for (const RegularObjectInstances &instance_array : batch.instance_arrays)
+            {
+                num_batch_instances += instance_array.count;
+            }
+            batch.num_instances = num_batch_instances;
+            num_instances += num_batch_instances;
+        }
 
-            glViewport(0, 0, shadow_map_resolution, shadow_map_resolution);
-            glBindFramebuffer(GL_FRAMEBUFFER, shadow_map_frame_buffer);
-            glClear(GL_DEPTH_BUFFER_BIT);
+        if (unlikely(num_instances == 0))
+        {
+            return true;
+        }
 
-            depth_shader.use();
-            ASSERT_RET_IF_NOT(
-                depth_shader.set_mat4("u_light_view_projection", light_view_projection), false);
+        RegularObjectInstance *const instances =
+            regular_object_instance_buffer.begin(num_instances);
+        ASSERT_RET_IF(instances == nullptr, false);
 
-            glCullFace(GL_FRONT);
+        const GLuint region_first = regular_object_instance_buffer.get_region_first();
+        size_t instance_idx = 0;
+        for (RegularObjectBatch &batch : regular_object_batches)
+        {
+            batch.base_instance = region_first + instance_idx;
+            RegularObjectInstance *const batch_instances = instances + instance_idx;
+            parallel_for(
+                0,
+                batch.transforms.size(),
+                [&batch, batch_instances](const size_t begin, const size_t end) {
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        batch_instances[i] = {
+                            .model = batch.transforms[i].model(),
+                            .material = batch.materials[i],
+                        };
+                    }
+                },
+                instances_per_model_job);
 
             /*
-             * Draw regular objects into shadow map.
+             * Instances which come with their model matrices only need to be interleaved.
              */
-            for (RegularObject &object : regular_objects)
+            RegularObjectInstance *array_instances = batch_instances + batch.transforms.size();
+            for (const RegularObjectInstances &instance_array : batch.instance_arrays)
             {
-                ASSERT_RET_IF_NOT(depth_shader.set_mat4("u_model", object.transform.model()),
-                                  false);
-                object.drawable.draw();
+                parallel_for(
+                    0,
+                    instance_array.count,
+                    [&instance_array, array_instances](const size_t begin, const size_t end) {
+                        for (size_t i = begin; i < end; i++)
+                        {
+                            array_instances[i] = {
+                                .model = instance_array.models[i],
+                                .material = instance_array.materials[i],
+                            };
+                        }
+                    },
+                    instances_per_copy_job);
+                array_instances += instance_array.count;
             }
 
-            /*
-             * Draw terrain into shadow map.
-             */
-            if (likely(terrain))
+            if (!material_table.is_bindless())
             {
-                ASSERT_RET_IF_NOT(depth_shader.set_mat4("u_model", glm::mat4(1)), false);
-                terrain->drawable.draw();
+                GLuint run_base_instance = batch.base_instance;
+                add_material_runs(
+                    batch, batch.materials.begin(), batch.transforms.size(), run_base_instance);
+                run_base_instance += batch.transforms.size();
+                for (const RegularObjectInstances &instance_array : batch.instance_arrays)
+                {
+                    add_material_runs(
+                        batch, instance_array.materials, instance_array.count, run_base_instance);
+                    run_base_instance += instance_array.count;
+                }
             }
 
-            glCullFace(GL_BACK);
-        }
-        else
-        {
-            light_view_projection = glm::mat4(1.0f);
-        }
-
-        /*
-         * Render scene into the screen frame buffer.
-         */
-        glViewport(0, 0, window_width, window_height);
-        glBindFramebuffer(GL_FRAMEBUFFER, screen_frame_buffer);
-        {
-            const std::array<GLenum, 2> buffers = {
-                screen_color_texture.get_attachment(),
-                screen_bloom_texture.get_attachment(),
-            };
-            glDrawBuffers(buffers.size(), buffers.data());
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            instance_idx += batch.num_instances;
         }
 
         /*
-         * Render debug objects.
+         * The buffer may have been reallocated to fit the instances, so the attributes are
+         * pointed at it on every frame.
          */
-        if (unlikely(debug_objects.empty()))
+        glBindBuffer(GL_ARRAY_BUFFER, regular_object_instance_buffer.get_id());
+        for (const RegularObjectBatch &batch : regular_object_batches)
         {
+            batch.drawable->bind(gl_state);
+            for (GLuint column = 0; column < 4; column++)
             {
-                const std::array<GLenum, 1> buffers = {
-                    screen_color_texture.get_attachment(),
-                };
-                glDrawBuffers(buffers.size(), buffers.data());
-            }
-            debug_shader.use();
-            ASSERT_RET_IF_NOT(debug_shader.set_mat4("u_view", camera_view), false);
-            for (const DebugObject &object : debug_objects)
-            {
-                ASSERT_RET_IF_NOT(debug_shader.set_mat4("u_model", object.transform.model()),
-                                  false);
-                ASSERT_RET_IF_NOT(debug_shader.set_vec3("u_color", object.color), false);
-                object.drawable.draw();
+                const GLuint idx = instance_model_attrib_location + column;
+                glVertexAttribPointer(idx,
+                                      4,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(RegularObjectInstance),
+                                      reinterpret_cast<GLvoid *>(
+                                          offsetof(RegularObjectInstance, model) +
+                                          column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(idx, 1);
+                glEnableVertexAttribArray(idx);
             }
-        }
 
-        /*
-         * Render regular objects.
-         */
-        {
-            const std::array<GLenum, 1> buffers = {
-                screen_color_texture.get_attachment(),
-            };
-            glDrawBuffers(buffers.size(), buffers.data());
+            glVertexAttribIPointer(
+                instance_material_attrib_location,
+                1,
+                GL_UNSIGNED_INT,
+                sizeof(RegularObjectInstance),
+                reinterpret_cast<GLvoid *>(offsetof(RegularObjectInstance, material)));
+            glVertexAttribDivisor(instance_material_attrib_location, 1);
+            glEnableVertexAttribArray(instance_material_attrib_location);
         }
-        regular_object_shader.use();
-        ASSERT_RET_IF_NOT(regular_object_shader.set_mat4("u_view", camera_view), false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_vec3("u_camera_position", camera_position),
-                          false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_mat4("u_light_view_projection",
-                                                         light_view_projection),
-                          false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_vec3("u_point_light.position",
-                                                         point_light_objects[0].transform.position),
-                          false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_vec3("u_point_light.ambient",
-                                                         point_light_objects[0].color),
-                          false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_vec3("u_point_light.diffuse",
-                                                         point_light_objects[0].color),
-                          false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_vec3("u_point_light.specular",
-                                                         point_light_objects[0].color),
-                          false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_vec3("u_directional_light.direction",
-                                                         directional_light_objects[0].direction),
-                          false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_vec3("u_directional_light.ambient",
-                                                         directional_light_objects[0].color),
-                          false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_vec3("u_directional_light.diffuse",
-                                                         directional_light_objects[0].color),
-                          false);
-        ASSERT_RET_IF_NOT(regular_object_shader.set_vec3("u_directional_light.specular",
-                                                         directional_light_objects[0].color),
-                          false);
-        shadow_map_texture.use();
-        for (RegularObject &object : regular_objects)
+
+        return true;
+    }
+
+    /**
+     * @brief Add a point light object to be rendered.
+     *
+     * @param object Point light object to add.
+     */
+    void Renderer::add_point_light_object(const PointLightObject &object)
+    {
+        point_light_objects.push_back(get_frame_arena(),
+                                      {
+                                          .color = object.color,
+                                          .transform = object.transform,
+                                          .drawable = &object.drawable,
+                                      });
+    }
+
+    /**
+     * @brief Add a directional light object to be rendered.
+     *
+     * @param object Directional light object to add.
+     */
+    void Renderer::add_directional_light_object(const DirectionalLightObject &object)
+    {
+        directional_light_objects.push_back(get_frame_arena(),
+                                            {
+                                                .direction = object.direction,
+                                                .color = object.color,
+                                            });
+    }
+
+    /**
+     * @brief Add a debug object to be rendered.
+     *
+     * @param object Debug object to add.
+     */
+    void Renderer::add_debug_object(const DebugObject &object)
+    {
+        debug_objects.push_back(get_frame_arena(),
+                                {
+                                    .transform = object.transform,
+                                    .color = object.color,
+                                    .drawable = &object.drawable,
+                                });
+    }
+
+    /**
+     * @brief Render the scene.
+     *
+     * @param camera_view Camera view matrix.
+     * @param skybox_view Skybox view matrix.
+     * @param camera_position Camera position in world space.
+     *
+     * @return True if successful, otherwise false.
+     */
+    bool Renderer::render(const glm::mat4 &camera_view,
+                          const glm::mat4 &skybox_view,
+                          const glm::vec3 &camera_position,
+                          const glm::vec3 &camera_direction)
+    {
+        Profiler::Scope render_scope(profiler, "render");
+
+        /*
+         * Upload textures which finished loading in the background.
+         */
         {
-            ASSERT_RET_IF_NOT(regular_object_shader.set_mat4("u_model", object.transform.model()),
-                              false);
-            object.material.apply(regular_object_shader);
-            object.normal_map.use();
-            object.drawable.draw();
+            Profiler::Scope scope(profiler, "texture uploads");
+            texture_loader.update();
         }
+        material_table.update();
 
         /*
-         * Render terrain.
+         * Swap in shaders which finished rebuilding in the background.
+         */
+        shader_reloader.update();
+
+        /*
+         * Pick the resolution of the scene from the GPU time of earlier frames.
+         */
+        dynamic_resolution.update(profiler);
+        render_width = std::max(
+            static_cast<int>(std::lround(window_width * dynamic_resolution.get_scale())), 1);
+        render_height = std::max(
+            static_cast<int>(std::lround(window_height * dynamic_resolution.get_scale())), 1);
+        const glm::vec2 render_scale(static_cast<float>(render_width) / window_width,
+                                     static_cast<float>(render_height) / window_height);
+
+        /*
+         * The directional light is the sun, which the shadow map and skybox are built
+         * around, so there is exactly one. There can be any number of point lights.
+         */
+        ASSERT_RET_IF_NOT(directional_light_objects.size() == 1, false);
+
+        /*
+         * The color of the directional light is already a function of its position above
+         * the horizon, so there are no shadows to render once it is black.
+         *
+         * We place `likely` here since the shadow rendering code is the heaviest part
+         * so it saves cycles when the light is shining.
+         */
+        const bool is_directional_light_shining =
+            directional_light_objects[0].color != glm::vec3(0.0f);
+
+        /*
+         * Bindings made by the texture uploads, the GUI and last frame's post-processing are
+         * not tracked.
+         */
+        gl_state.begin_frame();
+
+        ASSERT_RET_IF_NOT(upload_regular_object_instances(), false);
+        ASSERT_RET_IF_NOT(upload_point_lights(), false);
+
+        num_shadow_cascades_recached = 0;
+        if (likely(is_directional_light_shining))
+        {
+            render_shadows(
+                camera_position, camera_direction, directional_light_objects[0].direction);
+        }
+
+        /*
+         * Upload the camera and light state shared by all shaders in one update per
+         * uniform buffer.
          */
-        if (likely(terrain))
         {
+            FrameUniforms frame_uniforms = {
+                .view = camera_view,
+                .projection = projection,
+                .light_view_projections = {},
+                .shadow_cascade_splits = glm::vec4(0.0f),
+                .shadow_cascade_biases = glm::vec4(0.0f),
+                .camera_position = camera_position,
+                .num_shadow_cascades = num_shadow_cascades,
+            };
+            for (int i = 0; i < num_shadow_cascades; i++)
             {
-                const std::array<GLenum, 1> buffers = {
-                    screen_color_texture.get_attachment(),
-                };
-                glDrawBuffers(buffers.size(), buffers.data());
+                frame_uniforms.light_view_projections[i] = shadow_cascades[i].view_projection;
+                frame_uniforms.shadow_cascade_splits[i] = shadow_cascades[i].split_depth;
+                frame_uniforms.shadow_cascade_biases[i] = shadow_cascades[i].bias;
             }
+            frame_uniform_buffer.update(frame_uniforms);
 
-            shadow_map_texture.use();
-            terrain_shader.use();
-            ASSERT_RET_IF_NOT(terrain_shader.set_mat4("u_view", camera_view), false);
-            ASSERT_RET_IF_NOT(
-                terrain_shader.set_mat4("u_light_view_projection", light_view_projection), false);
-            ASSERT_RET_IF_NOT(terrain_shader.set_vec3("u_camera_position", camera_position), false);
-            ASSERT_RET_IF_NOT(terrain_shader.set_vec3("u_point_light.position",
-                                                      point_light_objects[0].transform.position),
-                              false);
-            ASSERT_RET_IF_NOT(terrain_shader.set_vec3("u_point_light.ambient",
-                                                      point_light_objects[0].color),
-                              false);
-            ASSERT_RET_IF_NOT(terrain_shader.set_vec3("u_point_light.diffuse",
-                                                      point_light_objects[0].color),
-                              false);
-            ASSERT_RET_IF_NOT(terrain_shader.set_vec3("u_point_light.specular",
-                                                      point_light_objects[0].color),
-                              false);
-            ASSERT_RET_IF_NOT(terrain_shader.set_vec3("u_directional_light.direction",
-                                                      directional_light_objects[0].direction),
-                              false);
-            ASSERT_RET_IF_NOT(terrain_shader.set_vec3("u_directional_light.ambient",
-                                                      directional_light_objects[0].color),
-                              false);
-            ASSERT_RET_IF_NOT(terrain_shader.set_vec3("u_directional_light.diffuse",
-                                                      directional_light_objects[0].color),
-                              false);
-            ASSERT_RET_IF_NOT(terrain_shader.set_vec3("u_directional_light.specular",
-                                                      directional_light_objects[0].color),
-                              false);
-            terrain->normal_map.use();
-            terrain->material.apply(terrain_shader);
-            terrain->drawable.draw();
+            /*
+             * A view depth d is in cluster slice log(d) * scale + bias, which is 1 at
+             * cluster_near_depth and cluster_grid_z at the far plane.
+             */
+            const float cluster_depth_scale =
+                (cluster_grid_z - 1) / glm::log(far_clip / cluster_near_depth);
+            const float cluster_depth_bias =
+                1.0f - glm::log(cluster_near_depth) * cluster_depth_scale;
+
+            const DirectionalLightCommand &directional_light = directional_light_objects[0];
+            const LightUniforms light_uniforms = {
+                .directional_light =
+                    {
+                        .direction = glm::vec4(directional_light.direction, 0.0f),
+                        .ambient = glm::vec4(directional_light.color, 0.0f),
+                        .diffuse = glm::vec4(directional_light.color, 0.0f),
+                        .specular = glm::vec4(directional_light.color, 0.0f),
+                    },
+                .cluster_tiles_per_pixel =
+                    glm::vec2(static_cast<float>(cluster_grid_x) / render_width,
+                              static_cast<float>(cluster_grid_y) / render_height),
+                .cluster_depth_scale_bias = glm::vec2(cluster_depth_scale, cluster_depth_bias),
+                .num_point_lights = static_cast<uint32_t>(point_light_objects.size()),
+                .padding = {},
+            };
+            light_uniform_buffer.update(light_uniforms);
         }
 
+        assign_lights_to_clusters();
+
         /*
-         * Render point light objects.
+         * Render the scene into the screen frame buffer, sorted by the state each draw needs
+         * so that every pass, shader and material is only set up once.
          */
+        glViewport(0, 0, render_width, render_height);
+        gl_state.bind_framebuffer(screen_frame_buffer);
         {
             const std::array<GLenum, 2> buffers = {
                 screen_color_texture.get_attachment(),
                 screen_bloom_texture.get_attachment(),
             };
-            glDrawBuffers(buffers.size(), buffers.data());
+            gl_state.set_draw_buffers(buffers.size(), buffers.data());
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         }
-        point_light_shader.use();
-        ASSERT_RET_IF_NOT(point_light_shader.set_mat4("u_view", camera_view), false);
-        for (PointLightObject &object : point_light_objects)
+
+        queue_scene(camera_position);
+        draw_scene(camera_view, skybox_view, camera_position);
+        regular_object_instance_buffer.end();
+        point_light_buffer.end();
+
+        if (likely(is_gpu_culling && terrain))
         {
-            ASSERT_RET_IF_NOT(point_light_shader.set_mat4("u_model", object.transform.model()),
-                              false);
-            object.drawable.draw();
+            build_hiz(projection * camera_view);
         }
 
         /*
-         * Render skybox.
+         * The passes below bind their state directly, so the statistics end here.
          */
-        glDepthFunc(GL_LEQUAL);
+        num_gl_calls = gl_state.get_num_calls();
+        num_gl_calls_skipped = gl_state.get_num_calls_skipped();
 
-        skybox_texture.use();
+        /*
+         * Spread the bloom texture out by downsampling it through the bloom chain, then
+         * upsampling back up while adding each level into the next larger one.
+         */
+        if (likely(post_process.get_stage_enabled(PostProcess::Stage::BLOOM)))
+        {
+            Profiler::Scope scope(profiler, "bloom");
 
-        skybox_shader.use();
-        ASSERT_RET_IF_NOT(skybox_shader.set_mat4("u_view", skybox_view), false);
-        ASSERT_RET_IF_NOT(skybox_shader.set_vec3("u_sun_color", directional_light_objects[0].color),
-                          false);
-        cube->draw();
+            const GLint num_bloom_levels = bloom_chain_frame_buffers.size();
 
+            bloom_downsample_shader.use();
+            screen_bloom_texture.use();
+            for (GLint level = 0; level < num_bloom_levels; level++)
+            {
+                glViewport(0,
+                           0,
+                           bloom_chain_texture.get_level_width(level),
+                           bloom_chain_texture.get_level_height(level));
+                glBindFramebuffer(GL_FRAMEBUFFER, bloom_chain_frame_buffers[level]);
+                if (likely(level > 0))
+                {
+                    bloom_chain_texture.sample_level(level - 1);
+                }
+
+                /*
+                 * Only the first level reads the scene, from the rectangle it covers.
+                 */
+                bloom_downsample_shader.set(bloom_downsample_texture_coord_scale_uniform,
+                                            level == 0 ? render_scale : glm::vec2(1.0f));
+                screen->draw();
+            }
+
+            bloom_upsample_shader.use();
+            glBlendFunc(GL_ONE, GL_ONE);
+            for (GLint level = num_bloom_levels - 1; level > 0; level--)
+            {
+                glViewport(0,
+                           0,
+                           bloom_chain_texture.get_level_width(level - 1),
+                           bloom_chain_texture.get_level_height(level - 1));
+                glBindFramebuffer(GL_FRAMEBUFFER, bloom_chain_frame_buffers[level - 1]);
+                bloom_chain_texture.sample_level(level);
+                screen->draw();
+            }
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+
+        /*
+         * Post-process the scene into the default frame buffer.
+         */
+        {
+            Profiler::Scope scope(profiler, "post");
+
+            bloom_chain_texture.sample_level(0);
+            screen_color_texture.use();
+            post_process.run(render_scale);
+            glViewport(0, 0, window_width, window_height);
+        }
+
+        /*
+         * Clear object buffers and start recording the next frame into the other arena.
+         */
+        clear_regular_object_batches();
+        point_light_objects.clear();
+        directional_light_objects.clear();
+        debug_objects.clear();
+        render_queue.clear();
+        frame_arena_idx = (frame_arena_idx + 1) % frame_arenas.size();
+        frame_arenas[frame_arena_idx].reset();
+
+        return true;
+    }
+
+    /**
+     * @brief Write the point lights of the frame into the point light buffer and bind the
+     * region holding them. The radius of each light is the distance at which its brightest
+     * channel is attenuated to point_light_cutoff.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Renderer::upload_point_lights()
+    {
+        /*
+         * An empty range cannot be bound, so there is always room for at least one light.
+         */
+        const size_t num_point_lights = point_light_objects.size();
+        const size_t num_bound = std::max<size_t>(num_point_lights, 1);
+        PointLightData *const point_lights = point_light_buffer.begin(num_bound);
+        ASSERT_RET_IF(point_lights == nullptr, false);
+
+        for (size_t i = 0; i < num_point_lights; i++)
+        {
+            const PointLightCommand &object = point_light_objects[i];
+
+            /*
+             * Solve constant + linear * r + quadratic * r^2 = intensity / cutoff for r.
+             */
+            const float intensity = std::max({object.color.x, object.color.y, object.color.z});
+            float radius = 0.0f;
+            if (likely(intensity > point_light_cutoff))
+            {
+                const float c = point_light_constant - intensity / point_light_cutoff;
+                radius = (-point_light_linear +
+                          glm::sqrt(point_light_linear * point_light_linear -
+                                    4.0f * point_light_quadratic * c)) /
+                         (2.0f * point_light_quadratic);
+            }
+
+            point_lights[i] = {
+                .position = object.transform.position,
+                .radius = radius,
+                .ambient = glm::vec4(object.color, 0.0f),
+                .diffuse = glm::vec4(object.color, 0.0f),
+                .specular = glm::vec4(object.color, 0.0f),
+            };
+        }
+
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER,
+                          point_light_storage_binding,
+                          point_light_buffer.get_id(),
+                          point_light_buffer.get_region_first() * sizeof(PointLightData),
+                          num_bound * sizeof(PointLightData));
+
+        return true;
+    }
+
+    /**
+     * @brief List the point lights reaching each cluster, for the lit shaders to read.
+     * Must run after the frame and light uniforms are updated.
+     */
+    void Renderer::assign_lights_to_clusters()
+    {
+        Profiler::Scope scope(profiler, "light clusters");
+
+        light_cluster_shader.use(gl_state);
+        glDispatchCompute(
+            (num_clusters + light_cluster_group_size - 1) / light_cluster_group_size, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    /**
+     * @brief Queue a command for every draw of the scene.
+     *
+     * Regular object batches take their materials from the material table rather than
+     * from bound state, so they need no material key. Like the terrain and skybox, they
+     * span too much of the scene for a single depth, whereas debug objects and point
+     * lights are keyed by their distance to the camera so that they are drawn front to
+     * back.
+     *
+     * @param camera_position Camera position in world space.
+     */
+    void Renderer::queue_scene(const glm::vec3 &camera_position)
+    {
+        const auto key = [](const RenderPass pass,
+                            const SceneShader shader,
+                            const uint32_t material,
+                            const uint32_t texture,
+                            const float depth) {
+            return RenderQueue::make_key(static_cast<uint8_t>(pass),
+                                         static_cast<uint8_t>(shader),
+                                         material,
+                                         texture,
+                                         depth);
+        };
+
+        for (uint32_t i = 0; i < debug_objects.size(); i++)
+        {
+            const float distance =
+                glm::distance(debug_objects[i].transform.position, camera_position);
+            render_queue.push(
+                key(RenderPass::OPAQUE, SceneShader::DEBUG, 0, 0, distance / far_clip), i);
+        }
+
+        for (uint32_t i = 0; i < regular_object_batches.size(); i++)
+        {
+            render_queue.push(key(RenderPass::OPAQUE, SceneShader::REGULAR_OBJECT, 0, 0, 0.f), i);
+        }
+        num_regular_object_batches_drawn = regular_object_batches.size();
+
+        if (likely(terrain))
+        {
+            render_queue.push(key(RenderPass::OPAQUE, SceneShader::TERRAIN, 0, 0, 0.f), 0);
+        }
+
+        for (uint32_t i = 0; i < point_light_objects.size(); i++)
+        {
+            const float distance =
+                glm::distance(point_light_objects[i].transform.position, camera_position);
+            render_queue.push(
+                key(RenderPass::EMISSIVE, SceneShader::POINT_LIGHT, 0, 0, distance / far_clip),
+                i);
+        }
+
+        render_queue.push(key(RenderPass::SKY, SceneShader::SKYBOX, 0, 0, 0.f), 0);
+
+        render_queue.sort();
+    }
+
+    /**
+     * @brief Draw the queued commands in order, setting up each pass and shader once for
+     * the run of commands which use it. The opaque geometry is first drawn into the depth
+     * buffer alone if the depth pre-pass is on.
+     *
+     * @param camera_view Camera view matrix.
+     * @param skybox_view Skybox view matrix.
+     * @param camera_position Camera position in world space.
+     */
+    void Renderer::draw_scene(const glm::mat4 &camera_view,
+                              const glm::mat4 &skybox_view,
+                              const glm::vec3 &camera_position)
+    {
+        static constexpr std::array<const char *, 3> pass_names = {
+            "opaque",
+            "emissive",
+            "sky",
+        };
+
+        /*
+         * Collect the queries of the oldest frame before they are reused for this one.
+         */
+        read_back_overdraw();
+        OverdrawQueries &queries = overdraw_queries[overdraw_query_idx];
+        queries.num_pixels = render_width * render_height;
+
+        if (likely(is_depth_prepass))
+        {
+            draw_depth_prepass(camera_view, camera_position);
+        }
+
+        const std::vector<RenderQueue::Command> &commands = render_queue.get_commands();
+        size_t i = 0;
+        while (i < commands.size())
+        {
+            const uint8_t pass = RenderQueue::get_pass(commands[i].key);
+            Profiler::Scope scope(profiler, pass_names[pass]);
+            begin_render_pass(static_cast<RenderPass>(pass));
+
+            GLuint query = 0;
+            if (pass == static_cast<uint8_t>(RenderPass::OPAQUE))
+            {
+                query = queries.opaque;
+            }
+            else if (pass == static_cast<uint8_t>(RenderPass::SKY))
+            {
+                query = queries.sky;
+            }
+            if (likely(query != 0))
+            {
+                glBeginQuery(GL_SAMPLES_PASSED, query);
+            }
+
+            while (i < commands.size() && RenderQueue::get_pass(commands[i].key) == pass)
+            {
+                const uint16_t pass_and_shader = RenderQueue::get_pass_and_shader(commands[i].key);
+                const SceneShader shader =
+                    static_cast<SceneShader>(RenderQueue::get_shader(commands[i].key));
+                use_scene_shader(shader, skybox_view);
+                set_scene_depth_test(static_cast<RenderPass>(pass), shader);
+
+                for (; i < commands.size() &&
+                       RenderQueue::get_pass_and_shader(commands[i].key) == pass_and_shader;
+                     i++)
+                {
+                    const uint32_t item = commands[i].item;
+                    switch (shader)
+                    {
+                    case SceneShader::DEBUG:
+                    {
+                        const DebugCommand &object = debug_objects[item];
+                        debug_shader.set(debug_model_uniform, object.transform.model());
+                        debug_shader.set(debug_color_uniform, object.color);
+                        object.drawable->draw(gl_state);
+                        break;
+                    }
+                    case SceneShader::REGULAR_OBJECT:
+                    {
+                        const RegularObjectBatch &batch = regular_object_batches[item];
+                        if (likely(material_table.is_bindless()))
+                        {
+                            batch.drawable->draw_instanced(
+                                gl_state, batch.num_instances, batch.base_instance);
+                            break;
+                        }
+                        for (const RegularObjectMaterialRun &run : batch.material_runs)
+                        {
+                            material_table.bind(run.material, gl_state);
+                            batch.drawable->draw_instanced(
+                                gl_state, run.num_instances, run.base_instance);
+                        }
+                        break;
+                    }
+                    case SceneShader::TERRAIN:
+                        draw_terrain(camera_view, camera_position);
+                        break;
+                    case SceneShader::POINT_LIGHT:
+                    {
+                        const PointLightCommand &object = point_light_objects[item];
+                        point_light_shader.set(point_light_model_uniform,
+                                               object.transform.model());
+                        object.drawable->draw(gl_state);
+                        break;
+                    }
+                    case SceneShader::SKYBOX:
+                        cube->draw(gl_state);
+                        break;
+                    }
+                }
+            }
+
+            if (likely(query != 0))
+            {
+                glEndQuery(GL_SAMPLES_PASSED);
+            }
+        }
+
+        overdraw_query_idx = (overdraw_query_idx + 1) % num_overdraw_queries;
+
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    /**
+     * @brief Draw the regular objects and the terrain into the depth buffer only, with no
+     * draw buffers. The objects go first since they are more likely to occlude the
+     * terrain than to be occluded by it.
+     *
+     * On the GPU, the terrain is culled here for the lit pass as well, so that both draw
+     * the same chunks at the same LODs.
+     *
+     * @param camera_view Camera view matrix.
+     * @param camera_position Camera position in world space.
+     */
+    void Renderer::draw_depth_prepass(const glm::mat4 &camera_view,
+                                      const glm::vec3 &camera_position)
+    {
+        Profiler::Scope scope(profiler, "depth pre-pass");
+
+        const std::array<GLenum, 1> buffers = {GL_NONE};
+        gl_state.set_draw_buffers(buffers.size(), buffers.data());
         glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+
+        if (!regular_object_batches.empty())
+        {
+            depth_prepass_instanced_shader.use(gl_state);
+            for (const RegularObjectBatch &batch : regular_object_batches)
+            {
+                batch.drawable->draw_instanced(gl_state, batch.num_instances, batch.base_instance);
+            }
+        }
+
+        if (likely(terrain))
+        {
+            const glm::mat4 view_projection = projection * camera_view;
+            if (likely(is_gpu_culling))
+            {
+                cull_terrain_on_gpu(view_projection, camera_position, true);
+                depth_prepass_shader.use(gl_state);
+                terrain->mesh.draw_indirect(gl_state);
+            }
+            else
+            {
+                depth_prepass_shader.use(gl_state);
+                terrain->mesh.draw(gl_state, Frustum(view_projection), camera_position);
+            }
+        }
+    }
+
+    /**
+     * @brief Set up the depth test for the draws of a scene shader. What the depth pre-pass
+     * drew only passes where its depth was kept, and already holds that depth.
+     *
+     * @param pass Pass the shader is drawn in.
+     * @param shader Shader to set the depth test up for.
+     */
+    void Renderer::set_scene_depth_test(const RenderPass pass, const SceneShader shader)
+    {
+        const bool is_prepassed =
+            is_depth_prepass &&
+            (shader == SceneShader::REGULAR_OBJECT || shader == SceneShader::TERRAIN);
+        if (is_prepassed)
+        {
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+            return;
+        }
+
+        /*
+         * The skybox is drawn at the far plane, behind everything but the cleared depth.
+         */
+        glDepthFunc(pass == RenderPass::SKY ? GL_LEQUAL : GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    /**
+     * @brief Update the overdraw from the oldest queries, if the GPU is done with them.
+     * The sky query ends last, so once it is available so is the opaque one.
+     */
+    void Renderer::read_back_overdraw()
+    {
+        const OverdrawQueries &queries = overdraw_queries[overdraw_query_idx];
+
+        GLint is_available;
+        glGetQueryObjectiv(queries.sky, GL_QUERY_RESULT_AVAILABLE, &is_available);
+        if (unlikely(!is_available))
+        {
+            return;
+        }
+
+        GLuint num_opaque_samples;
+        GLuint num_sky_samples;
+        glGetQueryObjectuiv(queries.opaque, GL_QUERY_RESULT, &num_opaque_samples);
+        glGetQueryObjectuiv(queries.sky, GL_QUERY_RESULT, &num_sky_samples);
+
+        const GLuint num_covered_pixels =
+            num_sky_samples < queries.num_pixels ? queries.num_pixels - num_sky_samples : 0;
+        overdraw = num_covered_pixels > 0
+                       ? static_cast<float>(num_opaque_samples) / num_covered_pixels
+                       : 0.0f;
+    }
+
+    /**
+     * @brief Cull the terrain on the GPU for a pass, ready for TerrainMesh::draw_indirect().
+     * Leaves the culling shader in use.
+     *
+     * @param view_projection View projection matrix of the pass.
+     * @param lod_origin Position the LODs are chosen relative to.
+     * @param is_occlusion_culling Whether to also cull against the Hi-Z pyramid, if there is
+     * one yet. Only meaningful for the camera.
+     */
+    void Renderer::cull_terrain_on_gpu(const glm::mat4 &view_projection,
+                                       const glm::vec3 &lod_origin,
+                                       const bool is_occlusion_culling)
+    {
+        const bool is_hiz_used = is_occlusion_culling && is_hiz_valid;
+
+        terrain_cull_shader.use(gl_state);
+        terrain_cull_shader.set(terrain_cull_view_projection_uniform, view_projection);
+        terrain_cull_shader.set(terrain_cull_lod_origin_uniform, lod_origin);
+        terrain_cull_shader.set(terrain_cull_is_occlusion_culling_uniform, is_hiz_used);
+        if (is_hiz_used)
+        {
+            terrain_cull_shader.set(terrain_cull_occlusion_view_projection_uniform,
+                                    hiz_view_projection);
+            terrain_cull_shader.set(terrain_cull_occlusion_texture_coord_scale_uniform,
+                                    hiz_texture_coord_scale);
+            hiz_texture.use(gl_state);
+        }
+
+        terrain->mesh.cull_on_gpu();
+    }
+
+    /**
+     * @brief Draw the terrain in the lit pass, culled on the GPU or on the CPU.
+     *
+     * On the GPU, the number of chunks drawn is read back a few frames late.
+     *
+     * @param camera_view Camera view matrix.
+     * @param camera_position Camera position in world space.
+     */
+    void Renderer::draw_terrain(const glm::mat4 &camera_view, const glm::vec3 &camera_position)
+    {
+        const glm::mat4 view_projection = projection * camera_view;
 
         /*
-         * Apply a gaussian blur to the bloom texture.
+         * With the depth pre-pass, the terrain was already culled for this pass.
          */
-        uint8_t horizontal = 1;
-        bool first_iteration = true;
-        static constexpr uint8_t passes = 10;
-        gaussian_blur_shader.use();
-        for (uint8_t i = 0; i < passes; ++i)
+        if (likely(is_gpu_culling && !is_depth_prepass))
+        {
+            cull_terrain_on_gpu(view_projection, camera_position, true);
+            terrain_shader.use(gl_state);
+        }
+
+        terrain->normal_map.use(gl_state);
+        terrain->material.apply(terrain_shader, terrain_material_uniforms, gl_state);
+
+        if (likely(is_gpu_culling))
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, ping_pong_frame_buffer[horizontal]);
-            ASSERT_RET_IF_NOT(gaussian_blur_shader.set_int("u_horizontal", horizontal), false);
+            terrain->mesh.draw_indirect(gl_state);
+            num_terrain_chunks_drawn = terrain->mesh.read_back_num_drawn();
+        }
+        else
+        {
+            num_terrain_chunks_drawn =
+                terrain->mesh.draw(gl_state, Frustum(view_projection), camera_position);
+        }
+    }
+
+    /**
+     * @brief Build the Hi-Z pyramid from the depth buffer of the frame just drawn, for the
+     * next frame to occlusion cull against. Each level is reduced from the one above it,
+     * the first straight from the depth buffer.
+     *
+     * @param view_projection View projection matrix the frame was drawn with.
+     */
+    void Renderer::build_hiz(const glm::mat4 &view_projection)
+    {
+        Profiler::Scope scope(profiler, "hi-z");
 
-            horizontal = 1 ^ horizontal;
+        hiz_shader.use(gl_state);
 
-            if (unlikely(first_iteration))
+        const GLint num_levels = hiz_texture.get_num_levels();
+        for (GLint level = 0; level < num_levels; level++)
+        {
+            if (unlikely(level == 0))
             {
-                screen_bloom_texture.use();
-                first_iteration = false;
+                screen_depth_texture.use(gl_state);
+                hiz_shader.set(hiz_source_sampler_uniform, screen_depth_texture.get_slot());
+                hiz_shader.set(hiz_source_level_uniform, 0);
             }
             else
             {
-                ping_pong_texture[horizontal].use();
+                hiz_texture.use(gl_state);
+                hiz_shader.set(hiz_source_sampler_uniform, hiz_texture.get_slot());
+                hiz_shader.set(hiz_source_level_uniform, level - 1);
             }
 
-            screen->draw();
+            static constexpr GLuint group_size = 8;
+            glBindImageTexture(
+                0, hiz_texture.get_id(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            glDispatchCompute((hiz_texture.get_level_width(level) + group_size - 1) / group_size,
+                              (hiz_texture.get_level_height(level) + group_size - 1) / group_size,
+                              1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        }
+
+        hiz_view_projection = view_projection;
+        hiz_texture_coord_scale = glm::vec2(static_cast<float>(render_width) / window_width,
+                                            static_cast<float>(render_height) / window_height);
+        is_hiz_valid = true;
+    }
+
+    /**
+     * @brief Set up the draw buffers of a pass. Only the emissive and sky passes write into
+     * the bloom texture.
+     *
+     * @param pass Pass to set up.
+     */
+    void Renderer::begin_render_pass(const RenderPass pass)
+    {
+        if (pass == RenderPass::OPAQUE)
+        {
+            const std::array<GLenum, 1> buffers = {
+                screen_color_texture.get_attachment(),
+            };
+            gl_state.set_draw_buffers(buffers.size(), buffers.data());
+        }
+        else
+        {
+            const std::array<GLenum, 2> buffers = {
+                screen_color_texture.get_attachment(),
+                screen_bloom_texture.get_attachment(),
+            };
+            gl_state.set_draw_buffers(buffers.size(), buffers.data());
+        }
+    }
+
+    /**
+     * @brief Use a scene shader and bind the state shared by all its draws.
+     *
+     * @param shader Shader to use.
+     * @param skybox_view Skybox view matrix.
+     */
+    void Renderer::use_scene_shader(const SceneShader shader, const glm::mat4 &skybox_view)
+    {
+        switch (shader)
+        {
+        case SceneShader::DEBUG:
+            debug_shader.use(gl_state);
+            break;
+        case SceneShader::REGULAR_OBJECT:
+            regular_object_shader.use(gl_state);
+            shadow_map_texture.use(gl_state);
+            break;
+        case SceneShader::TERRAIN:
+            terrain_shader.use(gl_state);
+            shadow_map_texture.use(gl_state);
+            break;
+        case SceneShader::POINT_LIGHT:
+            point_light_shader.use(gl_state);
+            break;
+        case SceneShader::SKYBOX:
+            skybox_shader.use(gl_state);
+            skybox_texture.use(gl_state);
+            skybox_shader.set(skybox_view_uniform, skybox_view);
+            skybox_shader.set(skybox_sun_color_uniform, directional_light_objects[0].color);
+            break;
         }
+    }
+
+    /**
+     * @brief Render the shadow map of every cascade.
+     *
+     * The cascades share the shadow map resolution, so near cascades cover a small area at
+     * a high resolution and far cascades a large area at a low one. Terrain depth is only
+     * rendered for cascades whose bounds changed, every other cascade reuses its cached
+     * terrain depth and only redraws the regular objects over it.
+     *
+     * @param camera_position Camera position in world space.
+     * @param camera_direction Unit vector the camera is looking along.
+     * @param light_direction Unit vector the directional light is shining along.
+     */
+    void Renderer::render_shadows(const glm::vec3 &camera_position,
+                                  const glm::vec3 &camera_direction,
+                                  const glm::vec3 &light_direction)
+    {
+        Profiler::Scope scope(profiler, "shadows");
 
         /*
-         * Go back to default frame buffer and draw the screen texture over a
-         * quad.
+         * Tiles streamed in or out change the terrain under every cascade.
          */
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (likely(terrain) && terrain->mesh.get_generation() != shadow_terrain_generation)
+        {
+            shadow_terrain_generation = terrain->mesh.get_generation();
+            for (ShadowCascade &cascade : shadow_cascades)
+            {
+                cascade.is_terrain_cached = false;
+            }
+        }
+
+        glViewport(0, 0, shadow_map_resolution, shadow_map_resolution);
+        glCullFace(GL_FRONT);
+
+        float near_depth = 0.0f;
+        for (int i = 0; i < num_shadow_cascades; i++)
+        {
+            ShadowCascade &cascade = shadow_cascades[i];
+
+            const float t = static_cast<float>(i + 1) / num_shadow_cascades;
+            const float log_split =
+                shadow_near_depth * glm::pow(shadow_distance / shadow_near_depth, t);
+            const float uniform_split =
+                shadow_near_depth + (shadow_distance - shadow_near_depth) * t;
+            cascade.split_depth = glm::mix(uniform_split, log_split, shadow_split_lambda);
+
+            /*
+             * Re-render the terrain into the cache if the cascade moved. LODs are still
+             * chosen relative to the camera so that the shadows match the geometry drawn in
+             * the lit pass.
+             */
+            if (update_shadow_cascade(cascade,
+                                      near_depth,
+                                      cascade.split_depth,
+                                      camera_position,
+                                      camera_direction,
+                                      light_direction))
+            {
+                gl_state.bind_framebuffer(cascade.terrain_frame_buffer);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                if (likely(terrain))
+                {
+                    if (likely(is_gpu_culling))
+                    {
+                        cull_terrain_on_gpu(cascade.view_projection, camera_position, false);
+                    }
+
+                    depth_shader.use(gl_state);
+                    depth_shader.set(depth_model_uniform, glm::mat4(1));
+                    depth_shader.set(depth_light_view_projection_uniform,
+                                     cascade.view_projection);
+                    if (likely(is_gpu_culling))
+                    {
+                        terrain->mesh.draw_indirect(gl_state);
+                    }
+                    else
+                    {
+                        terrain->mesh.draw(
+                            gl_state, Frustum(cascade.view_projection), camera_position);
+                    }
+                }
+                cascade.is_terrain_cached = true;
+                num_shadow_cascades_recached++;
+            }
+
+            /*
+             * Start from the cached terrain depth and draw the regular objects over it, one
+             * instanced draw per batch.
+             */
+            glCopyImageSubData(shadow_terrain_texture.get_id(),
+                               GL_TEXTURE_2D_ARRAY,
+                               0,
+                               0,
+                               0,
+                               i,
+                               shadow_map_texture.get_id(),
+                               GL_TEXTURE_2D_ARRAY,
+                               0,
+                               0,
+                               0,
+                               i,
+                               shadow_map_resolution,
+                               shadow_map_resolution,
+                               1);
+
+            gl_state.bind_framebuffer(cascade.frame_buffer);
+            depth_instanced_shader.use(gl_state);
+            depth_instanced_shader.set(depth_instanced_light_view_projection_uniform,
+                                       cascade.view_projection);
+            for (const RegularObjectBatch &batch : regular_object_batches)
+            {
+                batch.drawable->draw_instanced(gl_state, batch.num_instances, batch.base_instance);
+            }
+
+            near_depth = cascade.split_depth;
+        }
+
+        glCullFace(GL_BACK);
+    }
 
-        screen_shader.use();
-        ping_pong_texture[horizontal].use();
-        screen_shader.set_int("u_bloom_texture_sampler", ping_pong_texture[horizontal].get_slot());
-        screen_color_texture.use();
-        screen->draw();
+    /**
+     * @brief Fit a cascade around a slice of the view frustum.
+     *
+     * The cascade is an orthographic box around the bounding sphere of the slice, which
+     * unlike a tight fit does not change size as the camera turns. Its center is snapped to
+     * whole shadow map texels in light space, so as the camera moves the shadow map moves
+     * in whole texels and shadow edges do not shimmer. The cascade is only changed once the
+     * snapped center moves or the light turns by more than shadow_recache_min_cos.
+     *
+     * @param[in,out] cascade Cascade to fit.
+     * @param near_depth View space depth at which the slice starts.
+     * @param far_depth View space depth at which the slice ends.
+     * @param camera_position Camera position in world space.
+     * @param camera_direction Unit vector the camera is looking along.
+     * @param light_direction Unit vector the directional light is shining along.
+     *
+     * @return True if the cascade changed and its cached terrain depth must be re-rendered,
+     * otherwise false.
+     */
+    bool Renderer::update_shadow_cascade(ShadowCascade &cascade,
+                                         const float near_depth,
+                                         const float far_depth,
+                                         const glm::vec3 &camera_position,
+                                         const glm::vec3 &camera_direction,
+                                         const glm::vec3 &light_direction) const
+    {
+        /*
+         * The corners of the slice at depth d are at (±d * tan_x, ±d * tan_y, -d) in view
+         * space. The center of the sphere through the near and far corners lies on the view
+         * axis, clamped to the far plane for wide slices.
+         */
+        const float tan_half_fov_x = 1.0f / projection[0][0];
+        const float tan_half_fov_y = 1.0f / projection[1][1];
+        const float k2 = tan_half_fov_x * tan_half_fov_x + tan_half_fov_y * tan_half_fov_y;
+        const float center_depth =
+            glm::min(0.5f * (near_depth + far_depth) * (1.0f + k2), far_depth);
+        float radius = glm::sqrt((far_depth - center_depth) * (far_depth - center_depth) +
+                                 far_depth * far_depth * k2);
 
         /*
-         * Clear object buffers.
+         * Round the radius up so that float error does not change it from frame to frame.
          */
-        regular_objects.clear();
-        point_light_objects.clear();
-        directional_light_objects.clear();
-        debug_objects.clear();
+        radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+        /*
+         * Only rotate into light space so that the camera moving translates the cascade.
+         */
+        const glm::vec3 up = glm::abs(light_direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f)
+                                                                 : glm::vec3(0.0f, 1.0f, 0.0f);
+        const glm::mat4 light_view = glm::lookAt(glm::vec3(0.0f), light_direction, up);
+
+        const float texel_size = 2.0f * radius / shadow_map_resolution;
+        const glm::vec3 center = camera_position + camera_direction * center_depth;
+        const glm::vec3 snapped_center =
+            glm::floor(glm::vec3(light_view * glm::vec4(center, 1.0f)) / texel_size) * texel_size;
+
+        if (cascade.is_terrain_cached && snapped_center == cascade.snapped_center &&
+            radius == cascade.radius &&
+            glm::dot(light_direction, cascade.light_direction) >= shadow_recache_min_cos)
+        {
+            return false;
+        }
+
+        /*
+         * Light view space looks down -Z, so the box spans from the far side of the sphere
+         * to the near side plus the caster margin towards the light.
+         */
+        const float depth_near = -snapped_center.z - radius - shadow_caster_margin;
+        const float depth_far = -snapped_center.z + radius;
+        const glm::mat4 light_projection = glm::ortho(snapped_center.x - radius,
+                                                      snapped_center.x + radius,
+                                                      snapped_center.y - radius,
+                                                      snapped_center.y + radius,
+                                                      depth_near,
+                                                      depth_far);
+
+        cascade.view_projection = light_projection * light_view;
+        cascade.bias = shadow_bias_texels * texel_size / (depth_far - depth_near);
+        cascade.snapped_center = snapped_center;
+        cascade.radius = radius;
+        cascade.light_direction = light_direction;
+
+        return true;
+    }
+
+    /**
+     * @brief Remove all regular objects while keeping the batches that were used this frame,
+     * together with their allocations, for the next frame.
+     */
+    void Renderer::clear_regular_object_batches()
+    {
+        regular_object_batches.erase(std::remove_if(regular_object_batches.begin(),
+                                                    regular_object_batches.end(),
+                                                    [](const RegularObjectBatch &batch) {
+                                                        return batch.num_instances == 0;
+                                                    }),
+                                     regular_object_batches.end());
+        for (RegularObjectBatch &batch : regular_object_batches)
+        {
+            batch.transforms.clear();
+            batch.materials.clear();
+            batch.instance_arrays.clear();
+            batch.material_runs.clear();
+            batch.num_instances = 0;
+        }
+    }
+
+    /**
+     * @brief Set the number of shadow cascades. All cascades are rebuilt.
+     *
+     * @param _num_shadow_cascades Number of cascades in [1, max_shadow_cascades].
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Renderer::set_num_shadow_cascades(const int _num_shadow_cascades)
+    {
+        if (_num_shadow_cascades < 1 || _num_shadow_cascades > max_shadow_cascades)
+        {
+            LOG_ERROR("Invalid number of shadow cascades %d\n", _num_shadow_cascades);
+            return false;
+        }
+
+        if (_num_shadow_cascades != num_shadow_cascades)
+        {
+            num_shadow_cascades = _num_shadow_cascades;
+            for (ShadowCascade &cascade : shadow_cascades)
+            {
+                cascade.is_terrain_cached = false;
+            }
+        }
 
         return true;
     }
 
+    /**
+     * @brief Switch between culling the terrain on the GPU, with occlusion culling, and
+     * on the CPU.
+     *
+     * @param _is_gpu_culling Whether to cull on the GPU.
+     */
+    void Renderer::set_gpu_culling(const bool _is_gpu_culling)
+    {
+        is_gpu_culling = _is_gpu_culling;
+
+        /*
+         * The pyramid is not kept up to date while culling on the CPU.
+         */
+        is_hiz_valid = false;
+    }
+
+    /**
+     * @brief Switch the depth pre-pass of the terrain and regular objects on or off.
+     *
+     * @param _is_depth_prepass Whether to draw the depth pre-pass.
+     */
+    void Renderer::set_depth_prepass(const bool _is_depth_prepass)
+    {
+        is_depth_prepass = _is_depth_prepass;
+    }
+
     /**
      * @brief Set exposure.
      *
@@ -784,9 +2161,7 @@ namespace Engine
      */
     bool Renderer::set_exposure(const float _exposure)
     {
-        exposure = _exposure;
-        screen_shader.use();
-        ASSERT_RET_IF_NOT(screen_shader.set_float("u_exposure", _exposure), false);
+        post_process.set_exposure(_exposure);
         return true;
     }
 
@@ -797,9 +2172,7 @@ namespace Engine
      */
     bool Renderer::set_gamma(const float _gamma)
     {
-        gamma = _gamma;
-        screen_shader.use();
-        ASSERT_RET_IF_NOT(screen_shader.set_float("u_gamma", _gamma), false);
+        post_process.set_gamma(_gamma);
         return true;
     }
 
@@ -812,9 +2185,7 @@ namespace Engine
      */
     bool Renderer::set_sharpness(const float _sharpness)
     {
-        sharpness = _sharpness;
-        screen_shader.use();
-        ASSERT_RET_IF_NOT(screen_shader.set_float("u_sharpness", _sharpness), false);
+        post_process.set_sharpness(_sharpness);
         return true;
     }
 
@@ -823,7 +2194,7 @@ namespace Engine
      */
     float Renderer::get_exposure() const
     {
-        return exposure;
+        return post_process.get_exposure();
     }
 
     /**
@@ -831,7 +2202,7 @@ namespace Engine
      */
     float Renderer::get_gamma() const
     {
-        return gamma;
+        return post_process.get_gamma();
     }
 
     /**
@@ -839,6 +2210,129 @@ namespace Engine
      */
     float Renderer::get_sharpness() const
     {
-        return sharpness;
+        return post_process.get_sharpness();
+    }
+
+    /**
+     * @return Number of shadow cascades.
+     */
+    int Renderer::get_num_shadow_cascades() const
+    {
+        return num_shadow_cascades;
+    }
+
+    /**
+     * @return Whether the terrain is culled on the GPU.
+     */
+    bool Renderer::get_gpu_culling() const
+    {
+        return is_gpu_culling;
+    }
+
+    /**
+     * @return Whether the depth pre-pass is drawn.
+     */
+    bool Renderer::get_depth_prepass() const
+    {
+        return is_depth_prepass;
+    }
+
+    /**
+     * @return Number of shadow cascades whose terrain depth was re-rendered in the last
+     * frame.
+     */
+    size_t Renderer::get_num_shadow_cascades_recached() const
+    {
+        return num_shadow_cascades_recached;
+    }
+
+    /**
+     * @return Number of terrain chunks which passed frustum culling in the last lit pass.
+     */
+    size_t Renderer::get_num_terrain_chunks_drawn() const
+    {
+        return num_terrain_chunks_drawn;
+    }
+
+    /**
+     * @return Number of regular object batches, i.e. instanced draw calls, in the last lit
+     * pass.
+     */
+    size_t Renderer::get_num_regular_object_batches_drawn() const
+    {
+        return num_regular_object_batches_drawn;
+    }
+
+    /**
+     * @return Number of binds the last frame requested through the GL state tracker.
+     */
+    size_t Renderer::get_num_gl_calls() const
+    {
+        return num_gl_calls;
+    }
+
+    /**
+     * @return Number of binds the last frame skipped since they were redundant.
+     */
+    size_t Renderer::get_num_gl_calls_skipped() const
+    {
+        return num_gl_calls_skipped;
+    }
+
+    /**
+     * @return Fragments the opaque pass shaded per pixel it covered, a few frames ago. It
+     * is 1 for no overdraw, which the depth pre-pass gets close to.
+     */
+    float Renderer::get_overdraw() const
+    {
+        return overdraw;
+    }
+
+    /**
+     * @return Loader for textures used by the renderer.
+     */
+    TextureLoader &Renderer::get_texture_loader()
+    {
+        return texture_loader;
+    }
+
+    /**
+     * @return Profiler the render passes are recorded in.
+     */
+    Profiler &Renderer::get_profiler()
+    {
+        return profiler;
+    }
+
+    /**
+     * @return Post-processing of the scene into the window.
+     */
+    PostProcess &Renderer::get_post_process()
+    {
+        return post_process;
+    }
+
+    /**
+     * @return Controller of the resolution the scene is rendered at.
+     */
+    DynamicResolution &Renderer::get_dynamic_resolution()
+    {
+        return dynamic_resolution;
+    }
+
+    /**
+     * @return Width the scene was last rendered at, at most the window width.
+     */
+    int Renderer::get_render_width() const
+    {
+        return render_width;
+    }
+
+    /**
+     * @return Height the scene was last rendered at, at most the window height.
+     */
+    int Renderer::get_render_height() const
+    {
+        return render_height;
     }
-}
\ No newline at end of file
+}
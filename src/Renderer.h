@@ -1,18 +1,43 @@
 #pragma once
 
 #include "CubemapTexture.h"
+#include "DynamicResolution.h"
+#include "FrameArena.h"
 #include "FramebufferTexture.h"
+#include "GLState.h"
+#include "MaterialTable.h"
+#include "PostProcess.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "ShaderCache.h"
+#include "ShaderReloader.h"
+#include "StreamBuffer.h"
+#include "TextureLoader.h"
 #include "TexturedMaterial.h"
+#include "UniformBuffer.h"
 
 #include <GL/glew.h>
+#include <array>
+#include <cstdint>
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace Engine
 {
+    class TerrainMesh;
+
     class Renderer
     {
     public:
+        /**
+         * Maximum number of shadow cascades. Must match MAX_SHADOW_CASCADES in
+         * shaders/include/frame.glsl.
+         */
+        static constexpr int max_shadow_cascades = 4;
+
         Renderer();
 
         /**
@@ -23,7 +48,59 @@ namespace Engine
         public:
             virtual ~Drawable() = default;
 
-            virtual void draw() const = 0;
+            /**
+             * @return OpenGL ID of the vertex array object of the drawable.
+             */
+            virtual GLuint get_vertex_array_id() const = 0;
+
+            /**
+             * @brief Issue the draw call. The vertex array object must be bound.
+             */
+            virtual void draw_bound() const = 0;
+
+            /**
+             * @brief Issue the draw call for several instances of the drawable. The vertex
+             * array object must be bound. Per-instance vertex attributes are sourced
+             * starting at @p base_instance.
+             *
+             * @param instance_count Number of instances to draw.
+             * @param base_instance First instance to fetch per-instance attributes for.
+             */
+            virtual void draw_instanced_bound(const GLsizei instance_count,
+                                              const GLuint base_instance) const = 0;
+
+            /**
+             * @brief Bind the vertex array object of the drawable.
+             */
+            void bind() const
+            {
+                glBindVertexArray(get_vertex_array_id());
+            }
+
+            void bind(GLState &state) const
+            {
+                state.bind_vertex_array(get_vertex_array_id());
+            }
+
+            void draw() const
+            {
+                bind();
+                draw_bound();
+            }
+
+            void draw(GLState &state) const
+            {
+                bind(state);
+                draw_bound();
+            }
+
+            void draw_instanced(GLState &state,
+                                const GLsizei instance_count,
+                                const GLuint base_instance) const
+            {
+                bind(state);
+                draw_instanced_bound(instance_count, base_instance);
+            }
         };
 
         /**
@@ -49,13 +126,13 @@ namespace Engine
         };
 
         /**
-         * @brief Terrain object has a material, normal map, and drawable component.
+         * @brief Terrain object has a material, normal map, and chunked mesh component.
          */
         struct Terrain
         {
             const TexturedMaterial &material;
             const Texture &normal_map;
-            const Drawable &drawable;
+            TerrainMesh &mesh;
         };
 
         /**
@@ -69,6 +146,25 @@ namespace Engine
             const Drawable &drawable;
         };
 
+        /**
+         * @brief Many instances of a regular object whose model matrices and material
+         * indices are already laid out in arrays, such as the components of an
+         * EntityStore. They are copied straight into the instance buffer, so the arrays must
+         * stay valid and unchanged until the frame is rendered.
+         */
+        struct RegularObjectInstances
+        {
+            const glm::mat4 *models;
+
+            /**
+             * Index of the material of each instance, from get_material_index().
+             */
+            const GLuint *materials;
+
+            size_t count;
+            const Drawable &drawable;
+        };
+
         /**
          * @brief A point light object has a transform and drawable component. It does
          * not have a material.
@@ -101,10 +197,20 @@ namespace Engine
 
         bool init(const int _window_width, const int _window_height);
 
+        bool start_hot_reload(GLFWwindow *const window);
+
+        void stop_hot_reload();
+
+        void reload(const std::vector<std::string> &changed_paths);
+
         bool set_terrain(const Terrain &_terrain);
 
         void add_regular_object(const RegularObject &object);
 
+        void add_regular_object_instances(const RegularObjectInstances &objects);
+
+        GLuint get_material_index(const TexturedMaterial &material, const Texture &normal_map);
+
         void add_point_light_object(const PointLightObject &object);
 
         void add_directional_light_object(const DirectionalLightObject &object);
@@ -122,29 +228,420 @@ namespace Engine
 
         bool set_sharpness(const float _sharpness);
 
+        bool set_num_shadow_cascades(const int _num_shadow_cascades);
+
+        void set_gpu_culling(const bool _is_gpu_culling);
+
+        void set_depth_prepass(const bool _is_depth_prepass);
+
         float get_exposure() const;
 
         float get_gamma() const;
 
         float get_sharpness() const;
 
+        int get_num_shadow_cascades() const;
+
+        bool get_gpu_culling() const;
+
+        bool get_depth_prepass() const;
+
+        size_t get_num_shadow_cascades_recached() const;
+
+        size_t get_num_terrain_chunks_drawn() const;
+
+        size_t get_num_regular_object_batches_drawn() const;
+
+        size_t get_num_gl_calls() const;
+
+        size_t get_num_gl_calls_skipped() const;
+
+        float get_overdraw() const;
+
+        TextureLoader &get_texture_loader();
+
+        Profiler &get_profiler();
+
+        PostProcess &get_post_process();
+
+        DynamicResolution &get_dynamic_resolution();
+
+        int get_render_width() const;
+
+        int get_render_height() const;
+
+        FrameArena &get_frame_arena();
+
     private:
+        /**
+         * @brief Copies of the objects added this frame, which own their transforms and
+         * colors rather than referring to the caller's.
+         * @{
+         */
+        struct PointLightCommand
+        {
+            glm::vec3 color;
+            Transform transform;
+            const Drawable *drawable;
+        };
+
+        struct DirectionalLightCommand
+        {
+            glm::vec3 direction;
+            glm::vec3 color;
+        };
+
+        struct DebugCommand
+        {
+            TranslateTransform transform;
+            glm::vec3 color;
+            const Drawable *drawable;
+        };
+        /**
+         * @}
+         */
+
+        /**
+         * @brief Consecutive instances of a batch which share a material, drawn together
+         * when the material table is not bindless.
+         */
+        struct RegularObjectMaterialRun
+        {
+            GLuint material;
+            GLuint base_instance;
+            GLsizei num_instances;
+        };
+
+        /**
+         * @brief Regular objects which share a drawable and so can be drawn with a single
+         * instanced draw call. Each instance brings its own material.
+         */
+        struct RegularObjectBatch
+        {
+            const Drawable *drawable;
+
+            /**
+             * Transforms of the instances added this frame. Their model matrices are only
+             * built when the instances are uploaded.
+             */
+            FrameArena::Array<Transform> transforms;
+
+            /**
+             * Index of the material of each instance in the material table.
+             */
+            FrameArena::Array<GLuint> materials;
+
+            /**
+             * Instances added this frame with their model matrices already built, which
+             * follow the instances of the transforms in the instance buffer.
+             */
+            FrameArena::Array<RegularObjectInstances> instance_arrays;
+
+            /**
+             * Runs of instances of one material, in instance buffer order. Only built when
+             * the material table is not bindless, since the lit pass then has to bind the
+             * textures of every material.
+             */
+            FrameArena::Array<RegularObjectMaterialRun> material_runs;
+
+            /**
+             * Index of the first instance of the batch in the instance buffer.
+             */
+            GLuint base_instance;
+
+            /**
+             * Number of instances of the batch in the instance buffer.
+             */
+            GLsizei num_instances;
+        };
+
+        /**
+         * @brief Per-instance vertex attributes of a regular object.
+         */
+        struct RegularObjectInstance
+        {
+            glm::mat4 model;
+            GLuint material;
+        };
+
+        /**
+         * Number of instances whose model matrices are built per job.
+         */
+        static constexpr size_t instances_per_model_job = 256;
+
+        /**
+         * Number of instances with prebuilt model matrices copied per job.
+         */
+        static constexpr size_t instances_per_copy_job = 4096;
+
+        RegularObjectBatch &get_regular_object_batch(const Drawable &drawable);
+
+        void add_material_runs(RegularObjectBatch &batch,
+                               const GLuint *materials,
+                               const size_t count,
+                               GLuint base_instance);
+
+        bool upload_regular_object_instances();
+
+        /**
+         * @brief Passes of the scene, in the order they are drawn. Each pass writes to its
+         * own set of draw buffers.
+         */
+        enum class RenderPass : uint8_t
+        {
+            OPAQUE,
+            EMISSIVE,
+            SKY,
+        };
+
+        /**
+         * @brief Shaders of the scene, in the order they are drawn within a pass. The item
+         * of a queued command indexes into the objects drawn with its shader.
+         */
+        enum class SceneShader : uint8_t
+        {
+            DEBUG,
+            REGULAR_OBJECT,
+            TERRAIN,
+            POINT_LIGHT,
+            SKYBOX,
+        };
+
+        void queue_scene(const glm::vec3 &camera_position);
+
+        void draw_scene(const glm::mat4 &camera_view,
+                        const glm::mat4 &skybox_view,
+                        const glm::vec3 &camera_position);
+
+        void begin_render_pass(const RenderPass pass);
+
+        void draw_depth_prepass(const glm::mat4 &camera_view, const glm::vec3 &camera_position);
+
+        void set_scene_depth_test(const RenderPass pass, const SceneShader shader);
+
+        void read_back_overdraw();
+
+        void cull_terrain_on_gpu(const glm::mat4 &view_projection,
+                                 const glm::vec3 &lod_origin,
+                                 const bool is_occlusion_culling);
+
+        void draw_terrain(const glm::mat4 &camera_view, const glm::vec3 &camera_position);
+
+        void build_hiz(const glm::mat4 &view_projection);
+
+        void use_scene_shader(const SceneShader shader, const glm::mat4 &skybox_view);
+
+        void clear_regular_object_batches();
+
+        /**
+         * @brief Per-frame camera state, mirroring the std140 FrameData block in
+         * shaders/include/frame.glsl.
+         */
+        struct FrameUniforms
+        {
+            glm::mat4 view;
+            glm::mat4 projection;
+            std::array<glm::mat4, max_shadow_cascades> light_view_projections;
+            glm::vec4 shadow_cascade_splits;
+            glm::vec4 shadow_cascade_biases;
+
+            /*
+             * std140 packs the int into the padding after the vec3.
+             */
+            glm::vec3 camera_position;
+            int32_t num_shadow_cascades;
+        };
+        static_assert(max_shadow_cascades == 4, "cascade splits and biases are a vec4");
+        static_assert(sizeof(FrameUniforms) ==
+                      (2 + max_shadow_cascades) * sizeof(glm::mat4) + 3 * sizeof(glm::vec4));
+
+        /**
+         * @brief A shadow cascade, covering a slice of the view frustum with one layer of the
+         * shadow map.
+         *
+         * Its bounds only change when the slice moves by at least a shadow map texel or the
+         * light turns far enough, and the depth of the terrain is cached in a layer of its
+         * own until then, or until tiles of the terrain are streamed in or out. Each frame,
+         * the cached terrain depth is copied into the shadow map and the regular objects are
+         * drawn over it.
+         */
+        struct ShadowCascade
+        {
+            /**
+             * World to light clip space, as of the last time the terrain was cached.
+             */
+            glm::mat4 view_projection;
+
+            /**
+             * View space depth at which the cascade ends.
+             */
+            float split_depth;
+
+            /**
+             * Depth bias, in the depth units of the cascade.
+             */
+            float bias;
+
+            /**
+             * Center of the cascade in light view space, snapped to whole texels, and the
+             * light direction the cascade was built for.
+             * @{
+             */
+            glm::vec3 snapped_center;
+            float radius;
+            glm::vec3 light_direction;
+            /**
+             * @}
+             */
+
+            bool is_terrain_cached;
+
+            GLuint frame_buffer;
+            GLuint terrain_frame_buffer;
+        };
+
+        bool update_shadow_cascade(ShadowCascade &cascade,
+                                   const float near_depth,
+                                   const float far_depth,
+                                   const glm::vec3 &camera_position,
+                                   const glm::vec3 &camera_direction,
+                                   const glm::vec3 &light_direction) const;
+
+        void render_shadows(const glm::vec3 &camera_position,
+                            const glm::vec3 &camera_direction,
+                            const glm::vec3 &light_direction);
+
+        /**
+         * @brief Point light, mirroring the std430 PointLight struct in
+         * shaders/include/lights.glsl. The radius fills the padding after the position.
+         */
+        struct PointLightData
+        {
+            glm::vec3 position;
+            float radius;
+            glm::vec4 ambient;
+            glm::vec4 diffuse;
+            glm::vec4 specular;
+        };
+        static_assert(sizeof(PointLightData) == 4 * sizeof(glm::vec4));
+
+        /**
+         * @brief Directional light, mirroring DirectionalLight in
+         * shaders/include/lights.glsl.
+         */
+        struct DirectionalLightUniforms
+        {
+            glm::vec4 direction;
+            glm::vec4 ambient;
+            glm::vec4 diffuse;
+            glm::vec4 specular;
+        };
+
+        /**
+         * @brief Lights, mirroring the std140 LightData block in
+         * shaders/include/lights.glsl. The point lights themselves are in a storage buffer.
+         */
+        struct LightUniforms
+        {
+            DirectionalLightUniforms directional_light;
+            glm::vec2 cluster_tiles_per_pixel;
+            glm::vec2 cluster_depth_scale_bias;
+            uint32_t num_point_lights;
+            uint32_t padding[3];
+        };
+        static_assert(sizeof(LightUniforms) == 6 * sizeof(glm::vec4));
+
+        bool upload_point_lights();
+
+        void assign_lights_to_clusters();
+
         int window_width;
         int window_height;
         glm::mat4 projection;
 
         /**
-         * Screen quad.
+         * Cache of linked shader programs, which all shaders are compiled through.
+         */
+        ShaderCache shader_cache;
+
+        /**
+         * Rebuilds shaders whose files changed in the background, swapping them in at the
+         * start of each frame.
+         */
+        ShaderReloader shader_reloader;
+
+        /**
+         * Background texture loader, uploading finished textures at the start of each frame.
+         */
+        TextureLoader texture_loader;
+
+        /**
+         * Profiler each stage of render() is recorded in as a scope.
+         */
+        Profiler profiler;
+
+        /**
+         * Uniform buffers shared by all shaders, updated once per frame.
+         * @{
+         */
+        UniformBuffer<FrameUniforms> frame_uniform_buffer;
+        UniformBuffer<LightUniforms> light_uniform_buffer;
+        /**
+         * @}
+         */
+
+        /**
+         * Arenas of this frame and the last, which everything submitted for a frame is
+         * allocated in. Submissions go to the arena of the current frame, while the arena
+         * of the last frame stays intact, so that a frame can be read while the next one is
+         * recorded.
+         * @{
+         */
+        std::array<FrameArena, 2> frame_arenas;
+        size_t frame_arena_idx;
+        /**
+         * @}
+         */
+
+        /**
+         * Scene draws of the frame, and the GL state they are drawn with.
+         * @{
+         */
+        RenderQueue render_queue;
+
+        GLState gl_state;
+        size_t num_gl_calls;
+        size_t num_gl_calls_skipped;
+        /**
+         * @}
+         */
+
+        /**
+         * Screen quad, which the bloom passes are drawn with, and the targets the scene is
+         * rendered into.
          * @{
          */
         std::unique_ptr<Drawable> screen;
-        float exposure;
-        float gamma;
-        float sharpness;
-        Shader screen_shader;
         GLuint screen_frame_buffer;
         FramebufferTexture screen_color_texture;
         FramebufferTexture screen_bloom_texture;
+        FramebufferTexture screen_depth_texture;
+        /**
+         * @}
+         */
+
+        PostProcess post_process;
+
+        /**
+         * Dynamic resolution. The scene is rendered into the bottom left render_width by
+         * render_height pixels of the screen textures, which are allocated at the window
+         * resolution, and post-processing upscales that rectangle to the window.
+         * @{
+         */
+        DynamicResolution dynamic_resolution;
+        int render_width;
+        int render_height;
+        Shader::Uniform<glm::vec2> bloom_downsample_texture_coord_scale_uniform;
         /**
          * @}
          */
@@ -154,7 +651,76 @@ namespace Engine
          * @{
          */
         Shader terrain_shader;
+        TexturedMaterial::Uniforms terrain_material_uniforms;
         std::unique_ptr<Terrain> terrain;
+        size_t num_terrain_chunks_drawn;
+        /**
+         * @}
+         */
+
+        /**
+         * GPU culling. With it on, the terrain is culled by a compute shader in every pass
+         * and drawn with one indirect multi-draw. The lit pass also culls against a Hi-Z
+         * pyramid, a mip chain of the farthest depth, of the previous frame's depth buffer.
+         * @{
+         */
+        bool is_gpu_culling;
+        Shader terrain_cull_shader;
+        Shader::Uniform<glm::mat4> terrain_cull_view_projection_uniform;
+        Shader::Uniform<glm::vec3> terrain_cull_lod_origin_uniform;
+        Shader::Uniform<GLint> terrain_cull_is_occlusion_culling_uniform;
+        Shader::Uniform<glm::mat4> terrain_cull_occlusion_view_projection_uniform;
+        Shader::Uniform<glm::vec2> terrain_cull_occlusion_texture_coord_scale_uniform;
+        Shader hiz_shader;
+        Shader::Uniform<GLint> hiz_source_sampler_uniform;
+        Shader::Uniform<GLint> hiz_source_level_uniform;
+        FramebufferTexture hiz_texture;
+
+        /**
+         * View projection the Hi-Z pyramid was built with, and the fraction of it covered by
+         * the depth buffer at the resolution of that frame, valid once is_hiz_valid.
+         */
+        glm::mat4 hiz_view_projection;
+        glm::vec2 hiz_texture_coord_scale;
+        bool is_hiz_valid;
+        /**
+         * @}
+         */
+
+        /**
+         * Depth pre-pass. With it on, the terrain and regular objects are first drawn into
+         * the depth buffer only, and the lit pass then shades just the fragments whose depth
+         * matches, i.e. the visible ones.
+         * @{
+         */
+        bool is_depth_prepass;
+        Shader depth_prepass_shader;
+        Shader depth_prepass_instanced_shader;
+        /**
+         * @}
+         */
+
+        /**
+         * Overdraw, the number of fragments the opaque pass shaded per pixel it covered. It
+         * is measured with a GL_SAMPLES_PASSED query around the opaque pass, and one around
+         * the sky pass which, being drawn behind everything, passes exactly the pixels
+         * nothing else covered. The queries are read back a few frames late.
+         * @{
+         */
+        struct OverdrawQueries
+        {
+            GLuint opaque;
+            GLuint sky;
+
+            /**
+             * Number of pixels rendered in the frame of the queries.
+             */
+            GLuint num_pixels;
+        };
+        static constexpr size_t num_overdraw_queries = 3;
+        std::array<OverdrawQueries, num_overdraw_queries> overdraw_queries;
+        size_t overdraw_query_idx;
+        float overdraw;
         /**
          * @}
          */
@@ -164,7 +730,14 @@ namespace Engine
          * @{
          */
         Shader regular_object_shader;
-        std::vector<RegularObject> regular_objects;
+        MaterialTable material_table;
+        std::vector<RegularObjectBatch> regular_object_batches;
+        size_t num_regular_object_batches_drawn;
+
+        /**
+         * Per-instance attributes of all batches, written once per frame.
+         */
+        StreamBuffer<RegularObjectInstance> regular_object_instance_buffer;
         /**
          * @}
          */
@@ -174,7 +747,25 @@ namespace Engine
          * @{
          */
         Shader point_light_shader;
-        std::vector<PointLightObject> point_light_objects;
+        Shader::Uniform<glm::mat4> point_light_model_uniform;
+        FrameArena::Array<PointLightCommand> point_light_objects;
+
+        /**
+         * Point lights of all objects, written once per frame.
+         */
+        StreamBuffer<PointLightData> point_light_buffer;
+        /**
+         * @}
+         */
+
+        /**
+         * Clustered lighting. The view frustum is divided into a grid of clusters, and a
+         * compute shader lists the point lights reaching each cluster so that fragments
+         * only light themselves with those of their own cluster.
+         * @{
+         */
+        Shader light_cluster_shader;
+        GLuint cluster_buffer;
         /**
          * @}
          */
@@ -182,15 +773,18 @@ namespace Engine
         /**
          * Directional light objects.
          */
-        std::vector<DirectionalLightObject> directional_light_objects;
+        FrameArena::Array<DirectionalLightCommand> directional_light_objects;
 
         /**
-         * Gaussian blur.
+         * Bloom. The bloom texture is progressively downsampled into a mip chain starting
+         * at half the window resolution, which is then upsampled back up, adding each level
+         * into the next larger one.
          * @{
          */
-        Shader gaussian_blur_shader;
-        std::array<GLuint, 2> ping_pong_frame_buffer;
-        std::array<FramebufferTexture, 2> ping_pong_texture;
+        Shader bloom_downsample_shader;
+        Shader bloom_upsample_shader;
+        FramebufferTexture bloom_chain_texture;
+        std::vector<GLuint> bloom_chain_frame_buffers;
         /**
          * @}
          */
@@ -205,6 +799,8 @@ namespace Engine
          * @{
          */
         Shader skybox_shader;
+        Shader::Uniform<glm::mat4> skybox_view_uniform;
+        Shader::Uniform<glm::vec3> skybox_sun_color_uniform;
         CubemapTexture skybox_texture;
         /**
          * @}
@@ -215,8 +811,30 @@ namespace Engine
          * @{
          */
         Shader depth_shader;
+        Shader::Uniform<glm::mat4> depth_model_uniform;
+        Shader::Uniform<glm::mat4> depth_light_view_projection_uniform;
+        Shader depth_instanced_shader;
+        Shader::Uniform<glm::mat4> depth_instanced_light_view_projection_uniform;
+
+        /**
+         * Shadow map sampled by the lit shaders, and the cached terrain depth it is
+         * composited from, one layer per cascade.
+         * @{
+         */
         FramebufferTexture shadow_map_texture;
-        GLuint shadow_map_frame_buffer;
+        FramebufferTexture shadow_terrain_texture;
+        /**
+         * @}
+         */
+
+        std::array<ShadowCascade, max_shadow_cascades> shadow_cascades;
+        int num_shadow_cascades;
+        size_t num_shadow_cascades_recached;
+
+        /**
+         * Generation of the terrain tiles the cascades were cached with.
+         */
+        uint64_t shadow_terrain_generation;
         /**
          * @}
          */
@@ -226,7 +844,9 @@ namespace Engine
          * @{
          */
         Shader debug_shader;
-        std::vector<DebugObject> debug_objects;
+        Shader::Uniform<glm::mat4> debug_model_uniform;
+        Shader::Uniform<glm::vec3> debug_color_uniform;
+        FrameArena::Array<DebugCommand> debug_objects;
         /**
          * @}
          */
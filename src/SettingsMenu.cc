@@ -43,9 +43,32 @@ namespace Engine
         ASSERT_RET_IF_NOT(renderer.set_gamma(gamma), false);
 
         float sharpness = renderer.get_sharpness();
-        ImGui::SliderFloat("Sharpness", &sharpness, 1.f, 1000.f);
+        ImGui::SliderFloat("Sharpness", &sharpness, 0.f, 2.f);
         ASSERT_RET_IF_NOT(renderer.set_sharpness(sharpness), false);
 
+        PostProcess &post_process = renderer.get_post_process();
+        for (size_t i = 0; i < PostProcess::num_stages; i++)
+        {
+            const PostProcess::Stage stage = static_cast<PostProcess::Stage>(i);
+            bool is_stage_enabled = post_process.get_stage_enabled(stage);
+            ImGui::Checkbox(PostProcess::get_stage_name(stage), &is_stage_enabled);
+            post_process.set_stage_enabled(stage, is_stage_enabled);
+        }
+
+        int num_shadow_cascades = renderer.get_num_shadow_cascades();
+        ImGui::SliderInt(
+            "Shadow Cascades", &num_shadow_cascades, 1, Renderer::max_shadow_cascades);
+        ASSERT_RET_IF_NOT(renderer.set_num_shadow_cascades(num_shadow_cascades), false);
+
+        DynamicResolution &dynamic_resolution = renderer.get_dynamic_resolution();
+        bool is_dynamic_resolution = dynamic_resolution.get_enabled();
+        ImGui::Checkbox("Dynamic Resolution", &is_dynamic_resolution);
+        dynamic_resolution.set_enabled(is_dynamic_resolution);
+
+        float frame_budget_ms = dynamic_resolution.get_frame_budget_ms();
+        ImGui::SliderFloat("Frame Budget (ms)", &frame_budget_ms, 4.f, 50.f);
+        dynamic_resolution.set_frame_budget_ms(frame_budget_ms);
+
         ImGui::Checkbox("V-Sync", &working_settings.vsync_enabled);
 
         if (ImGui::Button("Apply Settings"))
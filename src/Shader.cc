@@ -1,70 +1,592 @@
 #include "Shader.h"
 
+#include "ShaderCache.h"
 #include "assert_util.h"
 
+#include <algorithm>
+#include <array>
+#include <cinttypes>
 #include <fstream>
+#include <mutex>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 namespace Engine
 {
     namespace
     {
         /**
-         * Cache of shader includes to avoid redundant file reads.
+         * @brief A preprocessed include, along with the files it was read from.
          */
-        std::unordered_map<std::string, std::string> shader_include_cache;
+        struct CachedInclude
+        {
+            std::string src;
+            std::vector<std::string> dependencies;
+        };
+
+        /**
+         * Cache of shader includes to avoid redundant file reads. Locked by
+         * shader_include_cache_mutex, since shaders are also built on the reload thread.
+         */
+        std::unordered_map<std::string, CachedInclude> shader_include_cache;
+        std::mutex shader_include_cache_mutex;
 
         /**
          * Base path for shader files.
          */
         const std::string base_path = "shaders/";
+
+        /**
+         * @brief Add a path to a list of dependencies unless it is already there.
+         *
+         * @param dependencies List of dependencies.
+         * @param file_path Path to add.
+         */
+        void add_dependency(std::vector<std::string> &dependencies, const std::string &file_path)
+        {
+            if (std::find(dependencies.begin(), dependencies.end(), file_path) ==
+                dependencies.end())
+            {
+                dependencies.push_back(file_path);
+            }
+        }
+
+        /**
+         * @brief Number and kind of the components of the uniform types which can be copied
+         * between programs.
+         */
+        struct UniformLayout
+        {
+            GLint num_components;
+            bool is_float;
+        };
+
+        /**
+         * @param type GL type of a uniform.
+         * @param[out] layout Layout of the type.
+         *
+         * @return True if uniforms of the type can be copied, otherwise false.
+         */
+        bool get_uniform_layout(const GLenum type, UniformLayout &layout)
+        {
+            switch (type)
+            {
+            case GL_FLOAT:
+                layout = {1, true};
+                return true;
+            case GL_FLOAT_VEC2:
+                layout = {2, true};
+                return true;
+            case GL_FLOAT_VEC3:
+                layout = {3, true};
+                return true;
+            case GL_FLOAT_VEC4:
+                layout = {4, true};
+                return true;
+            case GL_FLOAT_MAT3:
+                layout = {9, true};
+                return true;
+            case GL_FLOAT_MAT4:
+                layout = {16, true};
+                return true;
+            case GL_INT:
+            case GL_BOOL:
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_2D_SHADOW:
+            case GL_SAMPLER_2D_ARRAY:
+            case GL_SAMPLER_2D_ARRAY_SHADOW:
+            case GL_SAMPLER_CUBE:
+            case GL_IMAGE_2D:
+                layout = {1, false};
+                return true;
+            case GL_INT_VEC2:
+                layout = {2, false};
+                return true;
+            case GL_INT_VEC3:
+                layout = {3, false};
+                return true;
+            case GL_INT_VEC4:
+                layout = {4, false};
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * @brief Copy the values of the uniforms outside of uniform blocks from one program
+         * to another, for those which exist in both with the same type. Uniforms which are
+         * only set once, such as samplers and the projection, then keep their values when a
+         * program is recompiled.
+         *
+         * @param from Program to copy from.
+         * @param to Program to copy to.
+         */
+        void copy_uniforms(const GLuint from, const GLuint to)
+        {
+            GLint num_uniforms = 0;
+            glGetProgramInterfaceiv(from, GL_UNIFORM, GL_ACTIVE_RESOURCES, &num_uniforms);
+
+            GLint max_name_length = 0;
+            glGetProgramInterfaceiv(from, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_name_length);
+            std::string name(max_name_length, '\0');
+
+            for (GLint i = 0; i < num_uniforms; i++)
+            {
+                static constexpr std::array<GLenum, 3> properties = {
+                    GL_LOCATION,
+                    GL_TYPE,
+                    GL_ARRAY_SIZE,
+                };
+                std::array<GLint, 3> values = {};
+                glGetProgramResourceiv(from,
+                                       GL_UNIFORM,
+                                       i,
+                                       properties.size(),
+                                       properties.data(),
+                                       values.size(),
+                                       nullptr,
+                                       values.data());
+                const auto [from_location, type, array_size] = values;
+
+                UniformLayout layout;
+                if (from_location == -1 || !get_uniform_layout(type, layout))
+                {
+                    continue;
+                }
+
+                GLsizei name_length = 0;
+                glGetProgramResourceName(
+                    from, GL_UNIFORM, i, name.size(), &name_length, name.data());
+
+                const GLuint to_idx = glGetProgramResourceIndex(to, GL_UNIFORM, name.data());
+                if (to_idx == GL_INVALID_INDEX)
+                {
+                    continue;
+                }
+                std::array<GLint, 3> to_values = {};
+                glGetProgramResourceiv(to,
+                                       GL_UNIFORM,
+                                       to_idx,
+                                       properties.size(),
+                                       properties.data(),
+                                       to_values.size(),
+                                       nullptr,
+                                       to_values.data());
+                const auto [to_location, to_type, to_array_size] = to_values;
+                if (to_location == -1 || to_type != type)
+                {
+                    continue;
+                }
+
+                /*
+                 * Elements of an array of basic types have consecutive locations.
+                 */
+                const GLint num_elements = std::min(array_size, to_array_size);
+                for (GLint element = 0; element < num_elements; element++)
+                {
+                    if (layout.is_float)
+                    {
+                        std::array<GLfloat, 16> value;
+                        glGetUniformfv(from, from_location + element, value.data());
+                        const GLint location = to_location + element;
+                        switch (type)
+                        {
+                        case GL_FLOAT:
+                            glProgramUniform1fv(to, location, 1, value.data());
+                            break;
+                        case GL_FLOAT_VEC2:
+                            glProgramUniform2fv(to, location, 1, value.data());
+                            break;
+                        case GL_FLOAT_VEC3:
+                            glProgramUniform3fv(to, location, 1, value.data());
+                            break;
+                        case GL_FLOAT_VEC4:
+                            glProgramUniform4fv(to, location, 1, value.data());
+                            break;
+                        case GL_FLOAT_MAT3:
+                            glProgramUniformMatrix3fv(to, location, 1, GL_FALSE, value.data());
+                            break;
+                        case GL_FLOAT_MAT4:
+                            glProgramUniformMatrix4fv(to, location, 1, GL_FALSE, value.data());
+                            break;
+                        }
+                    }
+                    else
+                    {
+                        std::array<GLint, 4> value;
+                        glGetUniformiv(from, from_location + element, value.data());
+                        const GLint location = to_location + element;
+                        switch (layout.num_components)
+                        {
+                        case 1:
+                            glProgramUniform1iv(to, location, 1, value.data());
+                            break;
+                        case 2:
+                            glProgramUniform2iv(to, location, 1, value.data());
+                            break;
+                        case 3:
+                            glProgramUniform3iv(to, location, 1, value.data());
+                            break;
+                        case 4:
+                            glProgramUniform4iv(to, location, 1, value.data());
+                            break;
+                        }
+                    }
+                }
+            }
+        }
     }
 
     /**
-     * @brief Compile shader program and import into OpenGL.
+     * @brief Constructor.
+     */
+    Shader::Shader(): shader_id(0), cache(nullptr)
+    {
+        handle_names.emplace_back();
+        handle_locations.push_back(-1);
+    }
+
+    /**
+     * @brief Compile shader program and import into OpenGL, waiting for it to link.
+     *
+     * @param _descriptors List of shader descriptors.
+     * @param _cache Cache to load the program from and store it to, or null.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Shader::compile(const std::initializer_list<Descriptor> _descriptors,
+                         ShaderCache *_cache)
+    {
+        ASSERT_RET_IF_NOT(begin_compile(_descriptors, _cache), false);
+        return finish_compile();
+    }
+
+    /**
+     * @brief Load the program from the cache, or else start compiling and linking it
+     * without waiting for either. With GL_KHR_parallel_shader_compile, the driver works on
+     * the programs whose compiles were started in the background, so all programs should
+     * be started before any is finished with finish_compile().
+     *
+     * @param _descriptors List of shader descriptors.
+     * @param _cache Cache to load the program from and store it to, or null.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Shader::begin_compile(const std::initializer_list<Descriptor> _descriptors,
+                               ShaderCache *_cache)
+    {
+        descriptors = _descriptors;
+        cache = _cache;
+        build = {};
+        ASSERT_RET_IF_NOT(begin_build(descriptors, cache, build), false);
+        shader_id = build.program_id;
+
+        return true;
+    }
+
+    /**
+     * @brief Wait for the program started with begin_compile() to link, and store it to the
+     * cache if it was not loaded from there.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Shader::finish_compile()
+    {
+        ASSERT_RET_IF_NOT(finish_build(cache, build), false);
+
+#ifndef NDEBUG
+        /*
+         * Validation checks the program against the current GL state, which is not the
+         * state it will be drawn with, so it is only a debugging aid.
+         */
+        glValidateProgram(shader_id);
+        GLint valid = GL_FALSE;
+        glGetProgramiv(shader_id, GL_VALIDATE_STATUS, &valid);
+        if (valid != GL_TRUE)
+        {
+            char message[4096];
+            glGetProgramInfoLog(shader_id, sizeof(message), nullptr, message);
+            LOG_WARN("Program validation: %s\n", message);
+        }
+#endif
+
+        reflect_uniforms();
+
+        return true;
+    }
+
+    /**
+     * @brief Create a program and load it from the cache, or else start compiling and
+     * linking it without waiting for either. Uses no state of any shader, so it may be
+     * called from any thread with a GL context current.
      *
      * @param descriptors List of shader descriptors.
+     * @param cache Cache to load the program from, or null.
+     * @param[out] build Program being built.
      *
      * @return True on success, otherwise false.
      */
-    bool Shader::compile(const std::initializer_list<Descriptor> descriptors)
+    bool Shader::begin_build(const std::vector<Descriptor> &descriptors,
+                             ShaderCache *cache,
+                             Build &build)
     {
-        shader_id = glCreateProgram();
-        ASSERT_RET_IF(shader_id == 0, false);
+        build.program_id = glCreateProgram();
+        ASSERT_RET_IF(build.program_id == 0, false);
 
+        /*
+         * The key covers the type and preprocessed source of every stage, so editing any
+         * of the files a stage includes misses the cache too.
+         */
+        std::vector<std::pair<GLuint, std::string>> stages;
+        std::string key_sources;
+        std::string stage_names;
         for (const Descriptor &descriptor : descriptors)
         {
+            stage_names += (stage_names.empty() ? "" : ", ") + std::string(descriptor.file_name);
+
             std::string src;
             const std::string file_name = base_path + std::string(descriptor.file_name);
-            LOG("Compiling shader %s\n", file_name.c_str());
-            ASSERT_RET_IF_NOT(get_shader_src(file_name, src), false);
+            ASSERT_RET_IF_NOT(get_shader_src(file_name, src, build.dependencies), false);
 
-            LOG_DEBUG("Shader source:\n%s\n", src.c_str());
+            LOG_DEBUG("Shader %s source:\n%s\n", file_name.c_str(), src.c_str());
 
-            GLuint shader_type_id;
-            ASSERT_RET_IF_NOT(compile_shader(shader_type_id, descriptor.type, src), false);
+            key_sources += std::to_string(descriptor.type) + "\n" + src;
+            stages.emplace_back(descriptor.type, std::move(src));
+        }
 
-            glAttachShader(shader_id, shader_type_id);
-            glDeleteShader(shader_type_id);
+        if (cache != nullptr)
+        {
+            build.cache_key = cache->make_key(key_sources);
+            if (cache->load(build.cache_key, build.program_id))
+            {
+                LOG("Loaded shader %s from cache %016" PRIx64 "\n",
+                    stage_names.c_str(),
+                    build.cache_key);
+                build.is_cached = true;
+                return true;
+            }
         }
 
-        glLinkProgram(shader_id);
+        LOG("Compiling shader %s, cache %016" PRIx64 "\n", stage_names.c_str(), build.cache_key);
+        for (const auto &[type, src] : stages)
+        {
+            const GLuint stage_id = glCreateShader(type);
+            ASSERT_RET_IF(stage_id == 0, false);
+
+            const char *_src = src.c_str();
+            glShaderSource(stage_id, 1, &_src, nullptr);
+            glCompileShader(stage_id);
+            glAttachShader(build.program_id, stage_id);
+            build.stage_ids.push_back(stage_id);
+        }
+
+        if (cache != nullptr)
+        {
+            glProgramParameteri(build.program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(build.program_id);
+
+        return true;
+    }
+
+    /**
+     * @brief Wait for a program started with begin_build() to link, and store it to the
+     * cache if it was not loaded from there.
+     *
+     * @param cache Cache to store the program to, or null.
+     * @param build Program being built.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Shader::finish_build(ShaderCache *cache, Build &build)
+    {
+        if (build.is_cached)
+        {
+            return true;
+        }
 
         GLint linked = 0;
-        glGetProgramiv(shader_id, GL_LINK_STATUS, &linked);
+        glGetProgramiv(build.program_id, GL_LINK_STATUS, &linked);
         if (!linked)
         {
+            /*
+             * A stage which failed to compile fails the link, so its log is the one which
+             * explains why.
+             */
+            for (const GLuint stage_id : build.stage_ids)
+            {
+                GLint compiled = GL_FALSE;
+                glGetShaderiv(stage_id, GL_COMPILE_STATUS, &compiled);
+                if (compiled != GL_TRUE)
+                {
+                    char message[4096];
+                    glGetShaderInfoLog(stage_id, sizeof(message), nullptr, message);
+                    LOG_ERROR("Failed to compile shader: %s\n", message);
+                }
+            }
+
             char message[4096];
-            glGetProgramInfoLog(shader_id, sizeof(message), nullptr, message);
+            glGetProgramInfoLog(build.program_id, sizeof(message), nullptr, message);
             LOG_ERROR("Program link error: %s\n", message);
+
+            delete_stages(build);
             return false;
         }
 
-        glValidateProgram(shader_id);
+        delete_stages(build);
+
+        if (cache != nullptr && !cache->store(build.cache_key, build.program_id))
+        {
+            LOG_WARN("Failed to cache program %u, it will be compiled on the next launch\n",
+                     build.program_id);
+        }
 
         return true;
     }
 
+    /**
+     * @brief Replace the program with one rebuilt from the same descriptors, carrying the
+     * values of its uniforms over and re-resolving the uniform handles, which stay valid.
+     * A handle whose uniform is gone from the new program sets nothing until the uniform
+     * comes back. Must be called from the GL thread, between frames.
+     *
+     * @param new_build Finished build of the new program.
+     */
+    void Shader::swap_program(Build &new_build)
+    {
+        copy_uniforms(shader_id, new_build.program_id);
+
+        /*
+         * A program in use is only deleted once it no longer is.
+         */
+        glDeleteProgram(shader_id);
+        shader_id = new_build.program_id;
+        build = std::move(new_build);
+        new_build = {};
+
+        reflect_uniforms();
+
+        for (size_t slot = 1; slot < handle_names.size(); slot++)
+        {
+            const auto it = uniform_location_cache.find(handle_names[slot]);
+            if (it == uniform_location_cache.end())
+            {
+                LOG_WARN("Uniform %s is no longer active\n", handle_names[slot].c_str());
+                handle_locations[slot] = -1;
+            }
+            else
+            {
+                handle_locations[slot] = it->second;
+            }
+        }
+    }
+
+    /**
+     * @param file_path Path to a shader file.
+     *
+     * @return True if the program was built from the file, directly or through an include,
+     * otherwise false.
+     */
+    bool Shader::depends_on(const std::string &file_path) const
+    {
+        return std::find(build.dependencies.begin(), build.dependencies.end(), file_path) !=
+               build.dependencies.end();
+    }
+
+    /**
+     * @brief Forget the cached sources of a changed shader file and of every include which
+     * includes it, so that the next build reads them again.
+     *
+     * @param file_path Path to the changed file.
+     */
+    void Shader::invalidate_include(const std::string &file_path)
+    {
+        std::lock_guard<std::mutex> lock(shader_include_cache_mutex);
+        for (auto it = shader_include_cache.begin(); it != shader_include_cache.end();)
+        {
+            const std::vector<std::string> &dependencies = it->second.dependencies;
+            if (std::find(dependencies.begin(), dependencies.end(), file_path) !=
+                dependencies.end())
+            {
+                it = shader_include_cache.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+    }
+
+    /**
+     * @brief Detach and delete the stages of a program, which are no longer needed once it
+     * is linked.
+     *
+     * @param build Program being built.
+     */
+    void Shader::delete_stages(Build &build)
+    {
+        for (const GLuint stage_id : build.stage_ids)
+        {
+            glDetachShader(build.program_id, stage_id);
+            glDeleteShader(stage_id);
+        }
+        build.stage_ids.clear();
+    }
+
+    /**
+     * @brief Cache the locations of all active uniforms of the linked program so that
+     * looking them up never goes to the driver.
+     */
+    void Shader::reflect_uniforms()
+    {
+        uniform_location_cache.clear();
+
+        GLint num_uniforms = 0;
+        glGetProgramInterfaceiv(shader_id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &num_uniforms);
+
+        GLint max_name_length = 0;
+        glGetProgramInterfaceiv(shader_id, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_name_length);
+        std::string name(max_name_length, '\0');
+
+        for (GLint i = 0; i < num_uniforms; i++)
+        {
+            /*
+             * Uniforms inside uniform blocks have no location, they are set through their
+             * uniform buffer.
+             */
+            static constexpr GLenum property = GL_LOCATION;
+            GLint location = -1;
+            glGetProgramResourceiv(shader_id, GL_UNIFORM, i, 1, &property, 1, nullptr, &location);
+            if (location == -1)
+            {
+                continue;
+            }
+
+            GLsizei name_length = 0;
+            glGetProgramResourceName(
+                shader_id, GL_UNIFORM, i, name.size(), &name_length, name.data());
+            const std::string uniform_name = name.substr(0, name_length);
+            uniform_location_cache[uniform_name] = location;
+
+            /*
+             * Arrays are reported as "name[0]", also allow looking them up by "name".
+             */
+            static const std::string array_suffix = "[0]";
+            if (uniform_name.size() > array_suffix.size() &&
+                uniform_name.compare(uniform_name.size() - array_suffix.size(),
+                                     array_suffix.size(),
+                                     array_suffix) == 0)
+            {
+                uniform_location_cache[uniform_name.substr(
+                    0, uniform_name.size() - array_suffix.size())] = location;
+            }
+        }
+
+        LOG_DEBUG("Reflected %zu uniforms\n", uniform_location_cache.size());
+    }
+
     /**
      * @brief Use the shader program.
      */
@@ -73,6 +595,16 @@ namespace Engine
         glUseProgram(shader_id);
     }
 
+    /**
+     * @brief Use the shader program unless it is already in use.
+     *
+     * @param state Tracked GL state.
+     */
+    void Shader::use(GLState &state) const
+    {
+        state.use_program(shader_id);
+    }
+
     /**
      * @brief Get the location of a uniform variable in the shader.
      *
@@ -81,19 +613,45 @@ namespace Engine
      *
      * @return True on success, otherwise false.
      */
-    bool Shader::get_uniform_location(const std::string &uniform_name, GLint &location)
+    bool Shader::get_uniform_location(const std::string &uniform_name, GLint &location) const
     {
-        if (uniform_location_cache.find(uniform_name) == uniform_location_cache.end())
+        const auto it = uniform_location_cache.find(uniform_name);
+        if (it == uniform_location_cache.end())
         {
-            location = glGetUniformLocation(shader_id, uniform_name.c_str());
-            ASSERT_RET_IF(location == -1, false);
-            uniform_location_cache[uniform_name] = location;
+            LOG_ERROR("No active uniform named %s\n", uniform_name.c_str());
+            return false;
         }
-        else
+
+        location = it->second;
+
+        return true;
+    }
+
+    /**
+     * @brief Get the slot of a uniform handle, adding one for the uniform unless it already
+     * has one.
+     *
+     * @param uniform_name Name of the uniform variable.
+     * @param[out] slot Slot of the handle.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool Shader::get_uniform_slot(const std::string &uniform_name, size_t &slot)
+    {
+        const auto it = std::find(handle_names.begin() + 1, handle_names.end(), uniform_name);
+        if (it != handle_names.end())
         {
-            location = uniform_location_cache.at(uniform_name);
+            slot = it - handle_names.begin();
+            return true;
         }
 
+        GLint location;
+        ASSERT_RET_IF_NOT(get_uniform_location(uniform_name, location), false);
+
+        slot = handle_names.size();
+        handle_names.push_back(uniform_name);
+        handle_locations.push_back(location);
+
         return true;
     }
 
@@ -164,10 +722,23 @@ namespace Engine
         return true;
     }
 
+    /**
+     * @brief Load shader source code from file, expanding its includes.
+     *
+     * @param file_path Path to the shader source file.
+     * @param[out] shader_src Output shader source code.
+     * @param is_include Whether the file is an include, which has no version directive.
+     * @param[out] dependencies Paths to the file and everything it includes are added to it.
+     *
+     * @return True on success, otherwise false.
+     */
     bool Shader::get_shader_src_helper(const std::string &file_path,
                                        std::string &shader_src,
-                                       const bool is_include)
+                                       const bool is_include,
+                                       std::vector<std::string> &dependencies)
     {
+        add_dependency(dependencies, file_path);
+
         std::ifstream file(file_path);
         ASSERT_RET_IF_NOT(file, false);
 
@@ -199,7 +770,7 @@ namespace Engine
                  */
                 include_file = include_file.substr(1, include_file.size() - 2);
 
-                std::string include_src;
+                CachedInclude include;
                 const std::string include_path = base_path + include_file;
 
                 LOG("Adding include: %s\n", include_path.c_str());
@@ -207,21 +778,39 @@ namespace Engine
                 /*
                  * If we have already loaded this include, use the cached version.
                  */
-                if (shader_include_cache.find(include_path) != shader_include_cache.end())
+                bool is_cached;
                 {
-                    include_src = shader_include_cache.at(include_path);
+                    std::lock_guard<std::mutex> lock(shader_include_cache_mutex);
+                    const auto it = shader_include_cache.find(include_path);
+                    is_cached = it != shader_include_cache.end();
+                    if (is_cached)
+                    {
+                        include = it->second;
+                    }
                 }
+
                 /*
-                 * Otherwise, load it from file and add to cache.
+                 * Otherwise, load it from file and add to cache, along with the files it
+                 * was read from so that changing any of them invalidates it.
                  */
-                else
+                if (!is_cached)
                 {
-                    ASSERT_RET_IF_NOT(get_shader_src_helper(include_path, include_src, true),
+                    ASSERT_RET_IF_NOT(get_shader_src_helper(include_path,
+                                                            include.src,
+                                                            true /* is_include */,
+                                                            include.dependencies),
                                       false);
-                    shader_include_cache[include_path] = include_src;
+
+                    std::lock_guard<std::mutex> lock(shader_include_cache_mutex);
+                    shader_include_cache[include_path] = include;
                 }
 
-                shader_src += include_src + "\n";
+                for (const std::string &dependency : include.dependencies)
+                {
+                    add_dependency(dependencies, dependency);
+                }
+
+                shader_src += include.src + "\n";
             }
 
             /*
@@ -242,50 +831,15 @@ namespace Engine
      *
      * @param file_path Path to the shader source file.
      * @param[out] shader_src Output shader source code.
+     * @param[out] dependencies Paths to the file and everything it includes are added to it.
      *
      * @return True on success, otherwise false.
      */
-    bool Shader::get_shader_src(const std::string &file_path, std::string &shader_src)
-    {
-        return get_shader_src_helper(file_path, shader_src, false /* is_include */);
-    }
-
-    /**
-     * @brief Compile a shader of given type from source code.
-     *
-     * @param shader_id Output OpenGL shader ID.
-     * @param type Shader type (e.g., GL_VERTEX_SHADER, GL_FRAGMENT_SHADER).
-     * @param src Shader source code.
-     *
-     * @return True on success, otherwise false.
-     */
-    bool Shader::compile_shader(GLuint &shader_id, const GLuint type, const std::string &src)
+    bool Shader::get_shader_src(const std::string &file_path,
+                                std::string &shader_src,
+                                std::vector<std::string> &dependencies)
     {
-        shader_id = glCreateShader(type);
-        ASSERT_RET_IF(shader_id == 0, false);
-
-        const char *_src = src.c_str();
-        glShaderSource(shader_id, 1, &_src, nullptr);
-        glCompileShader(shader_id);
-
-        GLint shader_compiled;
-        glGetShaderiv(shader_id, GL_COMPILE_STATUS, &shader_compiled);
-        if (shader_compiled != GL_TRUE)
-        {
-            GLsizei length;
-            glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &length);
-
-            char message[4096];
-            ASSERT_RET_IF(length > sizeof(message), false);
-
-            glGetShaderInfoLog(shader_id, length, &length, message);
-            LOG_ERROR("Failed to compile shader: %s\n", message);
-
-            glDeleteShader(shader_id);
-
-            return false;
-        }
-
-        return true;
+        return get_shader_src_helper(
+            file_path, shader_src, false /* is_include */, dependencies);
     }
 }
\ No newline at end of file
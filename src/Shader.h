@@ -1,29 +1,168 @@
 #pragma once
 
+#include "GLState.h"
 #include "assert_util.h"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace Engine
 {
+    class ShaderCache;
+
     class Shader
     {
     public:
         struct Descriptor
         {
             const char *file_name;
-            const GLuint type;
+            GLuint type;
+        };
+
+        /**
+         * @brief Handle to a uniform variable of type @p T. Get one once after compiling
+         * with get_uniform() and reuse it, setting it costs no lookups.
+         *
+         * The handle refers to a slot of the shader rather than to the location itself, so
+         * that it stays valid when the program is swapped for a recompiled one.
+         */
+        template <typename T>
+        class Uniform
+        {
+        public:
+            Uniform(): slot(0)
+            {}
+
+        private:
+            friend class Shader;
+
+            size_t slot;
         };
 
-        bool compile(const std::initializer_list<Descriptor> descriptors);
+        /**
+         * @brief A program being compiled and linked, independent of any shader so that it
+         * can be built on another thread's GL context.
+         */
+        struct Build
+        {
+            GLuint program_id = 0;
+            uint64_t cache_key = 0;
+            bool is_cached = false;
+            std::vector<GLuint> stage_ids;
+
+            /**
+             * Paths to the files of all stages and everything they include.
+             */
+            std::vector<std::string> dependencies;
+        };
+
+        Shader();
+
+        bool compile(const std::initializer_list<Descriptor> _descriptors,
+                     ShaderCache *_cache = nullptr);
+
+        bool begin_compile(const std::initializer_list<Descriptor> _descriptors,
+                           ShaderCache *_cache = nullptr);
+
+        bool finish_compile();
+
+        static bool begin_build(const std::vector<Descriptor> &descriptors,
+                                ShaderCache *cache,
+                                Build &build);
+
+        static bool finish_build(ShaderCache *cache, Build &build);
+
+        void swap_program(Build &new_build);
+
+        bool depends_on(const std::string &file_path) const;
+
+        static void invalidate_include(const std::string &file_path);
+
+        /**
+         * @return Descriptors of the stages the shader was compiled from.
+         */
+        const std::vector<Descriptor> &get_descriptors() const
+        {
+            return descriptors;
+        }
+
+        /**
+         * @return Cache the shader was compiled through, or null.
+         */
+        ShaderCache *get_cache() const
+        {
+            return cache;
+        }
 
         void use() const;
 
+        void use(GLState &state) const;
+
+        /**
+         * @return OpenGL program ID.
+         */
+        GLuint get_id() const
+        {
+            return shader_id;
+        }
+
+        /**
+         * @brief Get a handle to a uniform variable in the shader.
+         *
+         * @tparam T C++ type of the uniform variable.
+         *
+         * @param uniform_name Name of the uniform variable.
+         * @param[out] uniform Uniform handle.
+         *
+         * @return True on success, otherwise false.
+         */
+        template <typename T>
+        bool get_uniform(const std::string &uniform_name, Uniform<T> &uniform)
+        {
+            return get_uniform_slot(uniform_name, uniform.slot);
+        }
+
+        bool get_uniform_location(const std::string &uniform_name, GLint &location) const;
+
+        /**
+         * @brief Set uniform variables through their handles. The shader must be in use.
+         * @{
+         */
+        void set(const Uniform<glm::mat4> &uniform, const glm::mat4 &value) const
+        {
+            glUniformMatrix4fv(handle_locations[uniform.slot], 1, GL_FALSE, &value[0][0]);
+        }
+
+        void set(const Uniform<GLint> &uniform, const GLint value) const
+        {
+            glUniform1i(handle_locations[uniform.slot], value);
+        }
+
+        void set(const Uniform<glm::vec2> &uniform, const glm::vec2 &value) const
+        {
+            glUniform2f(handle_locations[uniform.slot], value.x, value.y);
+        }
+
+        void set(const Uniform<glm::vec3> &uniform, const glm::vec3 &value) const
+        {
+            glUniform3f(handle_locations[uniform.slot], value.x, value.y, value.z);
+        }
+
+        void set(const Uniform<float> &uniform, const float value) const
+        {
+            glUniform1f(handle_locations[uniform.slot], value);
+        }
+        /**
+         * @}
+         */
+
         bool set_mat4(const std::string &uniform_name, const glm::mat4 &value);
 
         /**
@@ -63,27 +202,46 @@ namespace Engine
         GLuint shader_id;
 
         /**
-         * Cache of uniform locations.
+         * Locations of all active uniforms outside of uniform blocks, reflected once after
+         * linking.
          */
         std::unordered_map<std::string, GLint> uniform_location_cache;
 
-        bool get_uniform_location(const std::string &uniform_name, GLint &location);
+        /**
+         * Names and locations of the uniforms handed out by get_uniform(), indexed by the
+         * slots of the handles. Slot 0 is never resolved, so a default handle has location
+         * -1 and setting it does nothing.
+         * @{
+         */
+        std::vector<std::string> handle_names;
+        std::vector<GLint> handle_locations;
+        /**
+         * @}
+         */
 
-        static bool get_shader_src_helper(const std::string &file_path,
-                                          std::string &shader_src,
-                                          const bool is_include);
+        std::vector<Descriptor> descriptors;
 
-        static bool get_shader_src(const std::string &file_path, std::string &shader_src);
+        ShaderCache *cache;
 
         /**
-         * @brief Compile a shader of given type from source code.
-         *
-         * @param shader_id Output OpenGL shader ID.
-         * @param type Shader type (e.g., GL_VERTEX_SHADER, GL_FRAGMENT_SHADER).
-         * @param src Shader source code.
-         *
-         * @return True on success, otherwise false.
+         * The program from begin_compile() until it is finished, then the files it was
+         * built from.
          */
-        static bool compile_shader(GLuint &shader_id, const GLuint type, const std::string &src);
+        Build build;
+
+        static void delete_stages(Build &build);
+
+        void reflect_uniforms();
+
+        bool get_uniform_slot(const std::string &uniform_name, size_t &slot);
+
+        static bool get_shader_src_helper(const std::string &file_path,
+                                          std::string &shader_src,
+                                          const bool is_include,
+                                          std::vector<std::string> &dependencies);
+
+        static bool get_shader_src(const std::string &file_path,
+                                   std::string &shader_src,
+                                   std::vector<std::string> &dependencies);
     };
 }
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "ShaderCache.h"
+
+#include "log.h"
+#include "perf.h"
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <vector>
+
+namespace Engine
+{
+    static constexpr char magic[8] = {'E', 'N', 'G', 'P', 'R', 'O', 'G', '\0'};
+
+    /**
+     * @brief Continue a 64-bit FNV-1a hash over some bytes.
+     *
+     * @param hash Hash so far.
+     * @param data Bytes to hash.
+     * @param size Number of bytes.
+     *
+     * @return Hash including the bytes.
+     */
+    static uint64_t hash_bytes(uint64_t hash, const void *data, const size_t size)
+    {
+        const uint8_t *const bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Constructor.
+     */
+    ShaderCache::ShaderCache(): driver_hash(0), is_enabled(false)
+    {}
+
+    /**
+     * @brief Initialize the cache, creating its directory if needed, and turn on parallel
+     * shader compilation if the driver supports it. Must be called from the GL thread.
+     *
+     * A cache which cannot be used is disabled rather than failing, since every program
+     * can still be compiled from source.
+     *
+     * @param _directory Directory the programs are stored in.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool ShaderCache::init(const std::string &_directory)
+    {
+        directory = _directory;
+
+        if (GLEW_KHR_parallel_shader_compile)
+        {
+            /*
+             * Let the driver use as many threads as it likes.
+             */
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        }
+        else
+        {
+            LOG_WARN("GL_KHR_parallel_shader_compile is not supported, shaders are compiled "
+                     "one after another\n");
+        }
+
+        GLint num_binary_formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+        if (num_binary_formats == 0)
+        {
+            LOG_WARN("Driver has no program binary formats, shader cache disabled\n");
+            return true;
+        }
+
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            LOG_WARN("Failed to create %s: %s, shader cache disabled\n",
+                     directory.c_str(),
+                     std::strerror(errno));
+            return true;
+        }
+
+        driver_hash = 0xcbf29ce484222325;
+        for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        {
+            const GLubyte *const string = glGetString(name);
+            if (string != nullptr)
+            {
+                driver_hash = hash_bytes(
+                    driver_hash, string, std::strlen(reinterpret_cast<const char *>(string)) + 1);
+            }
+        }
+
+        is_enabled = true;
+
+        return true;
+    }
+
+    /**
+     * @param sources Preprocessed sources of all stages of a program, along with anything
+     * else the program depends on.
+     *
+     * @return Key of the program.
+     */
+    uint64_t ShaderCache::make_key(const std::string &sources) const
+    {
+        return hash_bytes(driver_hash, sources.data(), sources.size());
+    }
+
+    /**
+     * @brief Load a program from the cache.
+     *
+     * @param key Key of the program.
+     * @param program_id Program to load the binary into.
+     *
+     * @return True if the program was cached and the driver accepted it, otherwise false.
+     */
+    bool ShaderCache::load(const uint64_t key, const GLuint program_id) const
+    {
+        if (!is_enabled)
+        {
+            return false;
+        }
+
+        const std::string path = get_path(key);
+        std::FILE *file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        Header header;
+        std::vector<uint8_t> binary;
+        bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                  std::memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+                  header.version == version && header.key == key;
+        if (ok)
+        {
+            binary.resize(header.binary_size);
+            ok = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+        }
+        std::fclose(file);
+
+        if (unlikely(!ok))
+        {
+            LOG_WARN("Ignoring invalid shader cache %s\n", path.c_str());
+            return false;
+        }
+
+        glProgramBinary(program_id, header.binary_format, binary.data(), binary.size());
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program_id, GL_LINK_STATUS, &linked);
+        if (unlikely(linked != GL_TRUE))
+        {
+            LOG_WARN("Driver rejected shader cache %s\n", path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Store a linked program in the cache. The file is written under a temporary
+     * name and then renamed, so a crash never leaves a partial file behind.
+     *
+     * @param key Key of the program.
+     * @param program_id Program, linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool ShaderCache::store(const uint64_t key, const GLuint program_id) const
+    {
+        if (!is_enabled)
+        {
+            return true;
+        }
+
+        GLint binary_size = 0;
+        glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+        if (unlikely(binary_size <= 0))
+        {
+            LOG_ERROR("Program %u has no binary\n", program_id);
+            return false;
+        }
+
+        Header header = {};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.key = key;
+
+        std::vector<uint8_t> binary(binary_size);
+        GLsizei length = 0;
+        glGetProgramBinary(
+            program_id, binary_size, &length, &header.binary_format, binary.data());
+        header.binary_size = length;
+
+        const std::string path = get_path(key);
+        const std::string tmp_path = path + ".tmp";
+        std::FILE *file = std::fopen(tmp_path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            LOG_ERROR("Failed to open %s: %s\n", tmp_path.c_str(), std::strerror(errno));
+            return false;
+        }
+
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(binary.data(), 1, length, file) == static_cast<size_t>(length);
+        ok = (std::fclose(file) == 0) && ok;
+        if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+        {
+            LOG_ERROR("Failed to write %s: %s\n", path.c_str(), std::strerror(errno));
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @param key Key of a program.
+     *
+     * @return Path to the file of the program.
+     */
+    std::string ShaderCache::get_path(const uint64_t key) const
+    {
+        char file_name[32];
+        std::snprintf(file_name, sizeof(file_name), "%016" PRIx64 ".bin", key);
+        return directory + "/" + file_name;
+    }
+}
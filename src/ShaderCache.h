@@ -0,0 +1,69 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+namespace Engine
+{
+    /**
+     * @brief On-disk cache of linked shader programs, so that later launches can skip
+     * compiling them.
+     *
+     * Each program is stored in its own file as the driver's program binary
+     * (glGetProgramBinary), named after a hash of its preprocessed sources and the GL
+     * vendor, renderer and version strings, so that editing a shader or updating the driver
+     * simply misses the cache. A binary the driver rejects anyway is compiled from source
+     * again and replaced.
+     *
+     * The cache also turns on GL_KHR_parallel_shader_compile where available, so that
+     * programs whose compiles are all started before the first one is waited on are
+     * compiled in parallel by the driver.
+     */
+    class ShaderCache
+    {
+    public:
+        ShaderCache();
+
+        bool init(const std::string &_directory);
+
+        uint64_t make_key(const std::string &sources) const;
+
+        bool load(const uint64_t key, const GLuint program_id) const;
+
+        bool store(const uint64_t key, const GLuint program_id) const;
+
+    private:
+        /**
+         * Version of the file format. Bump whenever the header changes.
+         */
+        static constexpr uint32_t version = 1;
+
+        /**
+         * @brief File header, followed by the program binary.
+         */
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            GLenum binary_format;
+            uint64_t key;
+            uint64_t binary_size;
+        };
+
+        std::string get_path(const uint64_t key) const;
+
+        std::string directory;
+
+        /**
+         * Hash of the GL vendor, renderer and version strings, which every key starts from.
+         */
+        uint64_t driver_hash;
+
+        /**
+         * Whether programs are looked up in and stored to the cache. It is disabled if the
+         * driver has no program binary formats or the directory cannot be created.
+         */
+        bool is_enabled;
+    };
+}
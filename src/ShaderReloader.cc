@@ -0,0 +1,250 @@
+#include "ShaderReloader.h"
+
+#include "log.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor.
+     */
+    ShaderReloader::ShaderReloader(): context_window(nullptr), is_stopping(false)
+    {}
+
+    /**
+     * @brief Destructor. Stops the reload thread.
+     */
+    ShaderReloader::~ShaderReloader()
+    {
+        stop();
+    }
+
+    /**
+     * @brief Create the background context and start the reload thread. Must be called from
+     * the main thread, since GLFW only creates windows there.
+     *
+     * @param shared_window Window whose context the background context shares objects
+     * with.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool ShaderReloader::init(GLFWwindow *const shared_window)
+    {
+        /*
+         * The other hints are still those the shared window was created with, so the
+         * contexts match.
+         */
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        context_window = glfwCreateWindow(1, 1, "Shader reload", nullptr, shared_window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (unlikely(context_window == nullptr))
+        {
+            LOG_ERROR("Failed to create shader reload context\n");
+            return false;
+        }
+
+        thread = std::thread(&ShaderReloader::reload_main, this);
+
+        return true;
+    }
+
+    /**
+     * @brief Stop the reload thread, dropping any shaders it has not rebuilt or swapped in
+     * yet, and destroy the background context. Must be called from the main thread.
+     */
+    void ShaderReloader::stop()
+    {
+        if (thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                is_stopping = true;
+            }
+            condition.notify_one();
+            thread.join();
+        }
+
+        /* The thread is gone, so the queues may be accessed without the lock. */
+        for (std::vector<Result> *queue : {&results, &pending_results})
+        {
+            for (Result &result : *queue)
+            {
+                glDeleteProgram(result.build.program_id);
+                glDeleteSync(result.fence);
+            }
+            queue->clear();
+        }
+
+        if (context_window != nullptr)
+        {
+            glfwDestroyWindow(context_window);
+            context_window = nullptr;
+        }
+    }
+
+    /**
+     * @brief Rebuild a shader whenever one of its files changes. The shader must be
+     * compiled and outlive the reloader.
+     *
+     * @param shader Shader to rebuild.
+     */
+    void ShaderReloader::add(Shader &shader)
+    {
+        shaders.push_back(&shader);
+    }
+
+    /**
+     * @brief Queue the shaders which depend on any of the changed files to be rebuilt.
+     * Cached includes of the changed files are invalidated first, so the rebuilds read
+     * them again. Must be called from the GL thread.
+     *
+     * @param changed_paths Paths to the changed files. Files no shader depends on are
+     * ignored.
+     */
+    void ShaderReloader::reload(const std::vector<std::string> &changed_paths)
+    {
+        if (unlikely(!thread.joinable()))
+        {
+            return;
+        }
+
+        for (const std::string &path : changed_paths)
+        {
+            Shader::invalidate_include(path);
+        }
+
+        std::vector<Request> new_requests;
+        for (Shader *const shader : shaders)
+        {
+            const bool is_affected =
+                std::any_of(changed_paths.begin(),
+                            changed_paths.end(),
+                            [shader](const std::string &path) { return shader->depends_on(path); });
+            if (is_affected)
+            {
+                LOG("Reloading shader %s\n", shader->get_descriptors().front().file_name);
+                new_requests.push_back({
+                    .shader = shader,
+                    .descriptors = shader->get_descriptors(),
+                    .cache = shader->get_cache(),
+                });
+            }
+        }
+
+        if (new_requests.empty())
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Request &request : new_requests)
+            {
+                /*
+                 * A shader still waiting from an earlier change reads its files when it is
+                 * built, so it already picks up this change.
+                 */
+                const bool is_queued = std::any_of(
+                    requests.begin(), requests.end(), [&request](const Request &queued) {
+                        return queued.shader == request.shader;
+                    });
+                if (!is_queued)
+                {
+                    requests.push_back(std::move(request));
+                }
+            }
+        }
+        condition.notify_one();
+    }
+
+    /**
+     * @brief Swap in the rebuilt programs whose fences have signaled, without waiting for
+     * the others. Must be called from the GL thread, between frames.
+     */
+    void ShaderReloader::update()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (likely(results.empty() && pending_results.empty()))
+            {
+                return;
+            }
+            std::move(results.begin(), results.end(), std::back_inserter(pending_results));
+            results.clear();
+        }
+
+        /*
+         * Results are swapped in the order they were built, so that the latest build of a
+         * shader is the one which stays.
+         */
+        size_t num_swapped = 0;
+        for (Result &result : pending_results)
+        {
+            const GLenum status = glClientWaitSync(result.fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                break;
+            }
+            glDeleteSync(result.fence);
+
+            result.shader->swap_program(result.build);
+            LOG("Swapped in shader %s\n", result.shader->get_descriptors().front().file_name);
+            num_swapped++;
+        }
+        pending_results.erase(pending_results.begin(), pending_results.begin() + num_swapped);
+    }
+
+    /**
+     * @brief Entry point of the reload thread, which builds the requested shaders in the
+     * background context until stopped.
+     */
+    void ShaderReloader::reload_main()
+    {
+        glfwMakeContextCurrent(context_window);
+
+        while (true)
+        {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]() { return is_stopping || !requests.empty(); });
+                if (is_stopping)
+                {
+                    break;
+                }
+                request = std::move(requests.front());
+                requests.pop_front();
+            }
+
+            Shader::Build build;
+            if (!Shader::begin_build(request.descriptors, request.cache, build) ||
+                !Shader::finish_build(request.cache, build))
+            {
+                LOG_ERROR("Failed to rebuild shader %s, keeping the old program\n",
+                          request.descriptors.front().file_name);
+                glDeleteProgram(build.program_id);
+                continue;
+            }
+
+            /*
+             * The GL thread may only use the program once the commands which built it have
+             * completed, which it learns from the fence.
+             */
+            const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            results.push_back({
+                .shader = request.shader,
+                .build = std::move(build),
+                .fence = fence,
+            });
+        }
+
+        glfwMakeContextCurrent(nullptr);
+    }
+}
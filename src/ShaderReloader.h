@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Engine
+{
+    class ShaderCache;
+
+    /**
+     * @brief Rebuilds shaders whose files changed on a background GL context and swaps them
+     * in between frames.
+     *
+     * The reload thread owns a hidden window whose context shares objects with the main
+     * one. It compiles and links each affected program there, waiting for the link on its
+     * own rather than on the GL thread, and fences it. Once the fence has signaled, the GL
+     * thread swaps the program into its shader from update(), which never waits. A program
+     * which fails to build is dropped with its errors logged, and the shader keeps the old
+     * one.
+     */
+    class ShaderReloader
+    {
+    public:
+        ShaderReloader();
+
+        ~ShaderReloader();
+
+        ShaderReloader(const ShaderReloader &) = delete;
+        ShaderReloader &operator=(const ShaderReloader &) = delete;
+
+        bool init(GLFWwindow *const shared_window);
+
+        void stop();
+
+        void add(Shader &shader);
+
+        void reload(const std::vector<std::string> &changed_paths);
+
+        void update();
+
+    private:
+        /**
+         * @brief A shader to rebuild.
+         */
+        struct Request
+        {
+            Shader *shader;
+            std::vector<Shader::Descriptor> descriptors;
+            ShaderCache *cache;
+        };
+
+        /**
+         * @brief A rebuilt program waiting to be swapped in.
+         */
+        struct Result
+        {
+            Shader *shader;
+            Shader::Build build;
+            GLsync fence;
+        };
+
+        void reload_main();
+
+        /**
+         * Hidden window whose context the reload thread builds programs in.
+         */
+        GLFWwindow *context_window;
+
+        /**
+         * Shaders which are rebuilt when their files change.
+         */
+        std::vector<Shader *> shaders;
+
+        /**
+         * Programs which were built but whose fences have not signaled yet. Only accessed
+         * by the GL thread.
+         */
+        std::vector<Result> pending_results;
+
+        /**
+         * State shared with the reload thread.
+         * @{
+         */
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<Request> requests;
+        std::vector<Result> results;
+        bool is_stopping;
+        /**
+         * @}
+         */
+    };
+}
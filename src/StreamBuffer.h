@@ -0,0 +1,229 @@
+#pragma once
+
+#include "log.h"
+#include "perf.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <array>
+
+namespace Engine
+{
+    /**
+     * @brief Buffer for data which is rewritten every frame, e.g. per-instance attributes.
+     *
+     * The buffer is allocated with immutable storage and stays persistently and coherently
+     * mapped, so the CPU writes straight into GPU-visible memory without any
+     * glBufferSubData copies or implicit synchronization. The storage is split into
+     * num_regions frame-sized regions which are used round robin. A fence is placed after
+     * the last draw reading a region, and the CPU waits on it before writing into the
+     * region again, which in practice never blocks unless the GPU is num_regions frames
+     * behind.
+     *
+     * A frame looks like:
+     *   T *data = buffer.begin(count);
+     *   ... write count elements to data ...
+     *   ... draw, sourcing elements from buffer.get_region_first() onwards ...
+     *   buffer.end();
+     *
+     * @tparam T Element type.
+     */
+    template <typename T>
+    class StreamBuffer
+    {
+    public:
+        /**
+         * Number of regions, i.e. how many frames the CPU may be ahead of the GPU.
+         */
+        static constexpr size_t num_regions = 3;
+
+        StreamBuffer():
+            target(0),
+            buffer_id(0),
+            mapping(nullptr),
+            region_capacity(0),
+            region_idx(0),
+            fences {}
+        {}
+
+        /**
+         * @brief Create the buffer.
+         *
+         * @param _target Target the buffer is bound to, e.g. GL_ARRAY_BUFFER.
+         * @param _region_capacity Number of elements which fit in each region.
+         *
+         * @return True on success, otherwise false.
+         */
+        bool create(const GLenum _target, const size_t _region_capacity)
+        {
+            destroy();
+
+            target = _target;
+            region_capacity = _region_capacity;
+            region_idx = 0;
+
+            static constexpr GLbitfield flags =
+                GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            const GLsizeiptr size = num_regions * region_capacity * sizeof(T);
+
+            glGenBuffers(1, &buffer_id);
+            glBindBuffer(target, buffer_id);
+            glBufferStorage(target, size, nullptr, flags);
+            mapping = static_cast<T *>(glMapBufferRange(target, 0, size, flags));
+            if (unlikely(mapping == nullptr))
+            {
+                LOG_ERROR("Failed to map stream buffer of %td bytes\n", size);
+                destroy();
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Unmap and free the buffer. It must not be in use by any pending draw.
+         */
+        void destroy()
+        {
+            for (GLsync &fence : fences)
+            {
+                if (fence != nullptr)
+                {
+                    glDeleteSync(fence);
+                    fence = nullptr;
+                }
+            }
+
+            if (buffer_id != 0)
+            {
+                glBindBuffer(target, buffer_id);
+                glUnmapBuffer(target);
+                glDeleteBuffers(1, &buffer_id);
+                buffer_id = 0;
+            }
+
+            mapping = nullptr;
+        }
+
+        /**
+         * @brief Start writing into the current region, waiting for the GPU to finish
+         * reading it. The region, and the buffer with it, grows if it cannot hold @p count
+         * elements.
+         *
+         * @param count Number of elements which will be written.
+         *
+         * @return Pointer to write the elements to, or null on failure.
+         */
+        T *begin(const size_t count)
+        {
+            if (unlikely(count > region_capacity))
+            {
+                /*
+                 * Other regions may still be read by the GPU and have to be drained before
+                 * the storage can be replaced.
+                 */
+                for (size_t i = 0; i < num_regions; i++)
+                {
+                    wait(i);
+                }
+                if (!create(target, std::max(count, 2 * region_capacity)))
+                {
+                    return nullptr;
+                }
+            }
+            else
+            {
+                wait(region_idx);
+            }
+
+            return mapping + region_idx * region_capacity;
+        }
+
+        /**
+         * @brief Finish the current region after the last draw reading it has been issued.
+         */
+        void end()
+        {
+            fences[region_idx] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            region_idx = (region_idx + 1) % num_regions;
+        }
+
+        /**
+         * @return Index of the first element of the current region in the entire buffer,
+         * e.g. the base instance to draw with.
+         */
+        GLuint get_region_first() const
+        {
+            return region_idx * region_capacity;
+        }
+
+        /**
+         * @return OpenGL buffer ID.
+         */
+        GLuint get_id() const
+        {
+            return buffer_id;
+        }
+
+    private:
+        /**
+         * @brief Wait for the GPU to finish reading a region.
+         *
+         * @param idx Index of the region.
+         */
+        void wait(const size_t idx)
+        {
+            GLsync &fence = fences[idx];
+            if (fence == nullptr)
+            {
+                return;
+            }
+
+            static constexpr GLuint64 timeout_ns = 1000000000;
+            GLenum status;
+            do
+            {
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_ns);
+            } while (unlikely(status == GL_TIMEOUT_EXPIRED));
+
+            if (unlikely(status == GL_WAIT_FAILED))
+            {
+                LOG_ERROR("Failed to wait for stream buffer region %zu\n", idx);
+            }
+
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        /**
+         * Target the buffer is bound to.
+         */
+        GLenum target;
+
+        /**
+         * OpenGL buffer ID.
+         */
+        GLuint buffer_id;
+
+        /**
+         * Persistent mapping of the entire buffer.
+         */
+        T *mapping;
+
+        /**
+         * Number of elements in each region.
+         */
+        size_t region_capacity;
+
+        /**
+         * Index of the region being written this frame.
+         */
+        size_t region_idx;
+
+        /**
+         * Fence after the last draw reading each region, null if there is none pending.
+         */
+        std::array<GLsync, num_regions> fences;
+    };
+}
@@ -0,0 +1,427 @@
+#include "TerrainHeightField.h"
+
+#include "assert_util.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+
+/**
+ * The AVX2 kernels are compiled for AVX2 and FMA on their own, so that the rest of the
+ * engine still runs on CPUs without them, and only called once the CPU is known to have
+ * them.
+ */
+#define AVX2_KERNEL __attribute__((target("avx2,fma")))
+#endif
+
+namespace Engine
+{
+#ifdef __x86_64__
+    /**
+     * @brief Grid of a height field, with its scalars broadcast to every lane.
+     */
+    struct GridAvx2
+    {
+        const float *heights;
+        __m256i num_cols;
+        __m256 offset_x;
+        __m256 offset_z;
+        __m256 max_x;
+        __m256 max_z;
+    };
+
+    /**
+     * @brief Sample 8 points at once, the same way as TerrainHeightField::sample().
+     *
+     * @param grid Grid to sample.
+     * @param xs X world coordinates of the points.
+     * @param zs Z world coordinates of the points.
+     * @param[out] height Height at the points.
+     * @param[out] x_slope Rise of the triangles of the points along X.
+     * @param[out] z_slope Rise of the triangles of the points along Z.
+     */
+    AVX2_KERNEL static inline void sample_avx2(const GridAvx2 &grid,
+                                               const float *xs,
+                                               const float *zs,
+                                               __m256 &height,
+                                               __m256 &x_slope,
+                                               __m256 &z_slope)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 x = _mm256_min_ps(
+            _mm256_max_ps(_mm256_add_ps(_mm256_loadu_ps(xs), grid.offset_x), zero), grid.max_x);
+        const __m256 z = _mm256_min_ps(
+            _mm256_max_ps(_mm256_add_ps(_mm256_loadu_ps(zs), grid.offset_z), zero), grid.max_z);
+
+        const __m256 x_left = _mm256_floor_ps(x);
+        const __m256 z_down = _mm256_floor_ps(z);
+        const __m256 dx = _mm256_sub_ps(x, x_left);
+        const __m256 dz = _mm256_sub_ps(z, z_down);
+
+        const __m256i left = _mm256_cvttps_epi32(x_left);
+        const __m256i right = _mm256_cvttps_epi32(_mm256_ceil_ps(x));
+        const __m256i down_row = _mm256_mullo_epi32(_mm256_cvttps_epi32(z_down), grid.num_cols);
+        const __m256i up_row =
+            _mm256_mullo_epi32(_mm256_cvttps_epi32(_mm256_ceil_ps(z)), grid.num_cols);
+
+        /*
+         * Rather than gathering all 4 corners, gather only the third corner of the
+         * triangle each point is in: 3 in the bottom-right triangle and 1 in the top-left.
+         */
+        const __m256 is_bottom_right = _mm256_cmp_ps(dx, dz, _CMP_GT_OQ);
+        const __m256i corner_idx = _mm256_blendv_epi8(_mm256_add_epi32(up_row, left),
+                                                      _mm256_add_epi32(down_row, right),
+                                                      _mm256_castps_si256(is_bottom_right));
+
+        const __m256 y0 = _mm256_i32gather_ps(grid.heights, _mm256_add_epi32(down_row, left), 4);
+        const __m256 y2 = _mm256_i32gather_ps(grid.heights, _mm256_add_epi32(up_row, right), 4);
+        const __m256 y_corner = _mm256_i32gather_ps(grid.heights, corner_idx, 4);
+
+        const __m256 corner_to_y2 = _mm256_sub_ps(y2, y_corner);
+        const __m256 y0_to_corner = _mm256_sub_ps(y_corner, y0);
+        x_slope = _mm256_blendv_ps(corner_to_y2, y0_to_corner, is_bottom_right);
+        z_slope = _mm256_blendv_ps(y0_to_corner, corner_to_y2, is_bottom_right);
+        height = _mm256_fmadd_ps(z_slope, dz, _mm256_fmadd_ps(x_slope, dx, y0));
+    }
+
+    /**
+     * @brief Broadcast the grid of a height field.
+     *
+     * @param heights Height at every vertex, row by row.
+     * @param num_cols Number of columns.
+     * @param offset_x Added to X world coordinates to get grid coordinates.
+     * @param offset_z Added to Z world coordinates to get grid coordinates.
+     * @param max_x Largest X grid coordinate.
+     * @param max_z Largest Z grid coordinate.
+     *
+     * @return The broadcast grid.
+     */
+    AVX2_KERNEL static inline GridAvx2 make_grid_avx2(const float *heights,
+                                                     const int num_cols,
+                                                     const float offset_x,
+                                                     const float offset_z,
+                                                     const float max_x,
+                                                     const float max_z)
+    {
+        return {
+            .heights = heights,
+            .num_cols = _mm256_set1_epi32(num_cols),
+            .offset_x = _mm256_set1_ps(offset_x),
+            .offset_z = _mm256_set1_ps(offset_z),
+            .max_x = _mm256_set1_ps(max_x),
+            .max_z = _mm256_set1_ps(max_z),
+        };
+    }
+#endif
+
+    /**
+     * @brief Constructor.
+     */
+    TerrainHeightField::TerrainHeightField():
+        num_rows(0),
+        num_cols(0),
+        offset_x(0.f),
+        offset_z(0.f),
+        max_x(0.f),
+        max_z(0.f),
+        has_avx2(false)
+    {}
+
+    /**
+     * @brief Create the height field.
+     *
+     * @param _heights Height at every vertex, row by row.
+     * @param _num_rows Number of rows.
+     * @param _num_cols Number of columns.
+     * @param _offset_x Added to X world coordinates to get grid coordinates.
+     * @param _offset_z Added to Z world coordinates to get grid coordinates.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainHeightField::create(std::vector<float> _heights,
+                                    const int _num_rows,
+                                    const int _num_cols,
+                                    const float _offset_x,
+                                    const float _offset_z)
+    {
+        ASSERT_RET_IF(_num_rows < 1 || _num_cols < 1, false);
+        ASSERT_RET_IF(_heights.size() != static_cast<size_t>(_num_rows) * _num_cols, false);
+
+        vertex_heights = std::move(_heights);
+        num_rows = _num_rows;
+        num_cols = _num_cols;
+        offset_x = _offset_x;
+        offset_z = _offset_z;
+        max_x = static_cast<float>(num_cols - 1);
+        max_z = static_cast<float>(num_rows - 1);
+
+#ifdef __x86_64__
+        has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+
+        return true;
+    }
+
+    /**
+     * @return Terrain height at given (x, z) world coordinates.
+     *
+     * @param x X world coordinate.
+     * @param z Z world coordinate.
+     */
+    float TerrainHeightField::get_height(const float x, const float z) const
+    {
+        return sample(x, z).height;
+    }
+
+    /**
+     * @brief Get the terrain height at many points.
+     *
+     * @param xs X world coordinates of the points.
+     * @param zs Z world coordinates of the points.
+     * @param count Number of points.
+     * @param[out] heights Height at each point.
+     */
+    void TerrainHeightField::get_heights(const float *xs,
+                                         const float *zs,
+                                         const size_t count,
+                                         float *heights) const
+    {
+        size_t i = 0;
+#ifdef __x86_64__
+        if (likely(has_avx2))
+        {
+            i = count / 8 * 8;
+            get_heights_avx2(xs, zs, i, heights);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            heights[i] = sample(xs[i], zs[i]).height;
+        }
+    }
+
+    /**
+     * @brief Get the terrain normal and slope at many points.
+     *
+     * @param xs X world coordinates of the points.
+     * @param zs Z world coordinates of the points.
+     * @param count Number of points.
+     * @param[out] normal_xs X component of the unit normal at each point.
+     * @param[out] normal_ys Y component of the unit normal at each point.
+     * @param[out] normal_zs Z component of the unit normal at each point.
+     * @param[out] slopes Slope at each point, as the rise over run along the steepest
+     * direction, i.e. the tangent of the angle to the horizontal.
+     */
+    void TerrainHeightField::get_normals(const float *xs,
+                                         const float *zs,
+                                         const size_t count,
+                                         float *normal_xs,
+                                         float *normal_ys,
+                                         float *normal_zs,
+                                         float *slopes) const
+    {
+        size_t i = 0;
+#ifdef __x86_64__
+        if (likely(has_avx2))
+        {
+            i = count / 8 * 8;
+            get_normals_avx2(xs, zs, i, normal_xs, normal_ys, normal_zs, slopes);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            get_normal(sample(xs[i], zs[i]), normal_xs[i], normal_ys[i], normal_zs[i], slopes[i]);
+        }
+    }
+
+    /**
+     * @brief Get the normal and slope of the triangle a point is in.
+     *
+     * @param s Sample of the point.
+     * @param[out] normal_x X component of the unit normal.
+     * @param[out] normal_y Y component of the unit normal.
+     * @param[out] normal_z Z component of the unit normal.
+     * @param[out] slope Slope, see get_normals().
+     */
+    void TerrainHeightField::get_normal(const Sample &s,
+                                        float &normal_x,
+                                        float &normal_y,
+                                        float &normal_z,
+                                        float &slope)
+    {
+        /*
+         * The surface rises by the slopes along X and Z, so (1, x_slope, 0) and
+         * (0, z_slope, 1) lie on it and their cross product is the normal.
+         */
+        const float slope_squared = s.x_slope * s.x_slope + s.z_slope * s.z_slope;
+        const float inv_length = 1.f / std::sqrt(slope_squared + 1.f);
+        normal_x = -s.x_slope * inv_length;
+        normal_y = inv_length;
+        normal_z = -s.z_slope * inv_length;
+        slope = std::sqrt(slope_squared);
+    }
+
+    /**
+     * @brief Find the triangle a point is in.
+     *
+     * @param x X world coordinate.
+     * @param z Z world coordinate.
+     *
+     * @return Height at the point and the slopes of its triangle.
+     */
+    TerrainHeightField::Sample TerrainHeightField::sample(const float x, const float z) const
+    {
+        /*
+         * Convert from world coordinates to heightmap coordinates. To be smooth,
+         * linearly interpolate the height between the 3 vertices of the triangle the
+         * point is in.
+         *
+         *     |
+         *     |   0--2
+         *     |   |P/|
+         *     |   |/ |
+         *     |   1--3
+         * x ---------------
+         *     |
+         *     z
+         */
+        const float x_terrain = std::clamp(x + offset_x, 0.f, max_x);
+        const float z_terrain = std::clamp(z + offset_z, 0.f, max_z);
+
+        const int cell_x_left = static_cast<int>(std::floor(x_terrain));
+        const int cell_x_right = static_cast<int>(std::ceil(x_terrain));
+        const int cell_z_down = static_cast<int>(std::floor(z_terrain));
+        const int cell_z_up = static_cast<int>(std::ceil(z_terrain));
+
+        const float dx = x_terrain - cell_x_left;
+        const float dz = z_terrain - cell_z_down;
+
+        return sample_cell(vertex_heights[num_cols * cell_z_down + cell_x_left],
+                           vertex_heights[num_cols * cell_z_up + cell_x_left],
+                           vertex_heights[num_cols * cell_z_up + cell_x_right],
+                           vertex_heights[num_cols * cell_z_down + cell_x_right],
+                           dx,
+                           dz);
+    }
+
+    /**
+     * @brief Find the triangle a point is in within a single cell, for callers which have
+     * the heights of the cell at hand without a whole height field.
+     *
+     * @param y0 Height of vertex 0 of the cell, see sample().
+     * @param y1 Height of vertex 1 of the cell.
+     * @param y2 Height of vertex 2 of the cell.
+     * @param y3 Height of vertex 3 of the cell.
+     * @param dx Position of the point in the cell along X, in [0, 1].
+     * @param dz Position of the point in the cell along Z, in [0, 1].
+     *
+     * @return Height at the point and the slopes of its triangle.
+     */
+    TerrainHeightField::Sample TerrainHeightField::sample_cell(const float y0,
+                                                               const float y1,
+                                                               const float y2,
+                                                               const float y3,
+                                                               const float dx,
+                                                               const float dz)
+    {
+        float x_slope;
+        float z_slope;
+
+        /*
+         * In bottom-right triangle.
+         */
+        if (dx > dz)
+        {
+            x_slope = y3 - y0;
+            z_slope = y2 - y3;
+        }
+
+        /*
+         * In top-left triangle.
+         */
+        else
+        {
+            x_slope = y2 - y1;
+            z_slope = y1 - y0;
+        }
+
+        return {
+            .height = y0 + x_slope * dx + z_slope * dz,
+            .x_slope = x_slope,
+            .z_slope = z_slope,
+        };
+    }
+
+#ifdef __x86_64__
+    /**
+     * @brief get_heights() for a multiple of 8 points, with AVX2.
+     *
+     * @param xs X world coordinates of the points.
+     * @param zs Z world coordinates of the points.
+     * @param count Number of points, a multiple of 8.
+     * @param[out] heights Height at each point.
+     */
+    AVX2_KERNEL void TerrainHeightField::get_heights_avx2(const float *xs,
+                                                          const float *zs,
+                                                          const size_t count,
+                                                          float *heights) const
+    {
+        const GridAvx2 grid =
+            make_grid_avx2(vertex_heights.data(), num_cols, offset_x, offset_z, max_x, max_z);
+        for (size_t i = 0; i < count; i += 8)
+        {
+            __m256 height;
+            __m256 x_slope;
+            __m256 z_slope;
+            sample_avx2(grid, xs + i, zs + i, height, x_slope, z_slope);
+            _mm256_storeu_ps(heights + i, height);
+        }
+    }
+
+    /**
+     * @brief get_normals() for a multiple of 8 points, with AVX2.
+     *
+     * @param xs X world coordinates of the points.
+     * @param zs Z world coordinates of the points.
+     * @param count Number of points, a multiple of 8.
+     * @param[out] normal_xs X component of the unit normal at each point.
+     * @param[out] normal_ys Y component of the unit normal at each point.
+     * @param[out] normal_zs Z component of the unit normal at each point.
+     * @param[out] slopes Slope at each point.
+     */
+    AVX2_KERNEL void TerrainHeightField::get_normals_avx2(const float *xs,
+                                                          const float *zs,
+                                                          const size_t count,
+                                                          float *normal_xs,
+                                                          float *normal_ys,
+                                                          float *normal_zs,
+                                                          float *slopes) const
+    {
+        const GridAvx2 grid =
+            make_grid_avx2(vertex_heights.data(), num_cols, offset_x, offset_z, max_x, max_z);
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 sign = _mm256_set1_ps(-0.f);
+        for (size_t i = 0; i < count; i += 8)
+        {
+            __m256 height;
+            __m256 x_slope;
+            __m256 z_slope;
+            sample_avx2(grid, xs + i, zs + i, height, x_slope, z_slope);
+
+            const __m256 slope_squared =
+                _mm256_fmadd_ps(z_slope, z_slope, _mm256_mul_ps(x_slope, x_slope));
+            const __m256 inv_length =
+                _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(slope_squared, one)));
+            _mm256_storeu_ps(normal_xs + i,
+                             _mm256_xor_ps(_mm256_mul_ps(x_slope, inv_length), sign));
+            _mm256_storeu_ps(normal_ys + i, inv_length);
+            _mm256_storeu_ps(normal_zs + i,
+                             _mm256_xor_ps(_mm256_mul_ps(z_slope, inv_length), sign));
+            _mm256_storeu_ps(slopes + i, _mm256_sqrt_ps(slope_squared));
+        }
+    }
+#endif
+}
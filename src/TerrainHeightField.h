@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Height of the terrain at every vertex of its grid, for placing things on the
+     * ground.
+     *
+     * The grid has one vertex per unit along X and Z. In between, the height is linearly
+     * interpolated across the triangle the point is in, which is exactly the surface the
+     * terrain mesh draws. Points off the grid are clamped onto its border.
+     *
+     * Besides single queries, there are batched queries taking the coordinates as separate
+     * X and Z arrays, which process 8 points at a time with AVX2 when the CPU has it.
+     */
+    class TerrainHeightField
+    {
+    public:
+        TerrainHeightField();
+
+        bool create(std::vector<float> _heights,
+                    const int _num_rows,
+                    const int _num_cols,
+                    const float _offset_x,
+                    const float _offset_z);
+
+        float get_height(const float x, const float z) const;
+
+        void get_heights(const float *xs,
+                         const float *zs,
+                         const size_t count,
+                         float *heights) const;
+
+        void get_normals(const float *xs,
+                         const float *zs,
+                         const size_t count,
+                         float *normal_xs,
+                         float *normal_ys,
+                         float *normal_zs,
+                         float *slopes) const;
+
+        /**
+         * @return Height at every vertex, row by row.
+         */
+        const std::vector<float> &get_vertex_heights() const
+        {
+            return vertex_heights;
+        }
+
+        /**
+         * @return Number of rows.
+         */
+        int get_num_rows() const
+        {
+            return num_rows;
+        }
+
+        /**
+         * @return Number of columns.
+         */
+        int get_num_cols() const
+        {
+            return num_cols;
+        }
+
+        /**
+         * @brief The triangle a point is in, as the height at the point and how fast it
+         * rises along X and Z.
+         */
+        struct Sample
+        {
+            float height;
+            float x_slope;
+            float z_slope;
+        };
+
+        static Sample sample_cell(const float y0,
+                                  const float y1,
+                                  const float y2,
+                                  const float y3,
+                                  const float dx,
+                                  const float dz);
+
+        static void get_normal(const Sample &s,
+                               float &normal_x,
+                               float &normal_y,
+                               float &normal_z,
+                               float &slope);
+
+    private:
+        Sample sample(const float x, const float z) const;
+
+        void get_heights_avx2(const float *xs,
+                              const float *zs,
+                              const size_t count,
+                              float *heights) const;
+
+        void get_normals_avx2(const float *xs,
+                              const float *zs,
+                              const size_t count,
+                              float *normal_xs,
+                              float *normal_ys,
+                              float *normal_zs,
+                              float *slopes) const;
+
+        /**
+         * Height at every vertex, row by row.
+         */
+        std::vector<float> vertex_heights;
+        int num_rows;
+        int num_cols;
+
+        /**
+         * Added to world coordinates to get grid coordinates.
+         * @{
+         */
+        float offset_x;
+        float offset_z;
+        /**
+         * @}
+         */
+
+        /**
+         * Largest grid coordinates, which points are clamped to.
+         * @{
+         */
+        float max_x;
+        float max_z;
+        /**
+         * @}
+         */
+
+        /**
+         * Whether the batched queries can use AVX2 and FMA.
+         */
+        bool has_avx2;
+    };
+}
@@ -0,0 +1,687 @@
+#include "TerrainMesh.h"
+
+#include "assert_util.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <glm/common.hpp>
+#include <limits>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor.
+     */
+    TerrainMesh::TerrainMesh():
+        index_buffer_obj(0),
+        lod_ranges {},
+        max_tile_chunks(0),
+        num_chunks(0),
+        generation(0),
+        chunk_buffer(0),
+        draw_buffer(0),
+        draw_count_buffer(0),
+        draw_count_readback_buffer(0),
+        draw_count_readbacks(nullptr),
+        draw_count_readback_idx(0)
+    {}
+
+    /**
+     * @brief Split a grid of terrain vertices into chunks, to be set as a tile of a mesh.
+     *
+     * @param grid_vertices Terrain vertices in row-major order.
+     * @param num_rows Number of rows in the grid.
+     * @param num_cols Number of columns in the grid.
+     * @param[out] geometry Layout, chunked vertices and chunk table.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainMesh::build(const Vertex3dNormal *grid_vertices,
+                            const int num_rows,
+                            const int num_cols,
+                            Geometry &geometry)
+    {
+        ASSERT_RET_IF(num_rows < 2 || num_cols < 2, false);
+
+        const int num_chunks_z = (num_rows - 1 + chunk_size - 1) / chunk_size;
+        const int num_chunks_x = (num_cols - 1 + chunk_size - 1) / chunk_size;
+
+        /*
+         * Heights are quantized over the range of the whole grid, skirts included.
+         */
+        const size_t num_grid_vertices = static_cast<size_t>(num_rows) * num_cols;
+        float height_min = std::numeric_limits<float>::max();
+        float height_max = std::numeric_limits<float>::lowest();
+        for (size_t i = 0; i < num_grid_vertices; i++)
+        {
+            height_min = std::min(height_min, grid_vertices[i].position.y);
+            height_max = std::max(height_max, grid_vertices[i].position.y);
+        }
+        height_min -= skirt_depth;
+
+        Layout &layout = geometry.layout;
+        layout = {
+            .origin = glm::vec2(grid_vertices[0].position.x, grid_vertices[0].position.z),
+            .height_min = height_min,
+            .height_range = height_max - height_min,
+            .num_chunks_x = num_chunks_x,
+        };
+
+        /*
+         * Encode the vertices of each chunk into its own block. The skirt vertices follow
+         * the grid vertices in the order: top edge, bottom edge, left edge, right edge.
+         * Chunks are independent of each other, so they are filled in parallel.
+         */
+        const size_t num_chunks = static_cast<size_t>(num_chunks_z) * num_chunks_x;
+        ASSERT_RET_IF(num_chunks * chunk_num_vertices > INT32_MAX, false);
+        std::vector<TerrainVertex> &chunk_vertices = geometry.vertices;
+        std::vector<Chunk> &chunks = geometry.chunks;
+        chunk_vertices.resize(num_chunks * chunk_num_vertices);
+        chunks.resize(num_chunks);
+
+        parallel_for(0, num_chunks, [&](const size_t chunk_begin, const size_t chunk_end) {
+            for (size_t chunk_idx = chunk_begin; chunk_idx < chunk_end; chunk_idx++)
+            {
+                const int chunk_z = chunk_idx / num_chunks_x;
+                const int chunk_x = chunk_idx % num_chunks_x;
+                const size_t base_vertex = chunk_idx * chunk_num_vertices;
+                TerrainVertex *out = chunk_vertices.data() + base_vertex;
+
+                Chunk &chunk = chunks[chunk_idx];
+                chunk.base_vertex = static_cast<GLint>(base_vertex);
+                chunk.bounds.min = glm::vec3(std::numeric_limits<float>::max());
+                chunk.bounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+
+                /*
+                 * The bounds are grown by the quantized heights, which are what is drawn.
+                 */
+                auto push_vertex = [&](const int row, const int col, const float depth) {
+                    const int grid_row = std::min(chunk_z * chunk_size + row, num_rows - 1);
+                    const int grid_col = std::min(chunk_x * chunk_size + col, num_cols - 1);
+                    Vertex3dNormal vertex =
+                        grid_vertices[static_cast<size_t>(grid_row) * num_cols + grid_col];
+                    vertex.position.y -= depth;
+
+                    const glm::ivec2 chunk_position(grid_col - chunk_x * chunk_size,
+                                                    grid_row - chunk_z * chunk_size);
+                    *out = encode_vertex(vertex, chunk_position, layout);
+
+                    const glm::vec3 position(vertex.position.x,
+                                             decode_height(out->height, layout),
+                                             vertex.position.z);
+                    chunk.bounds.min = glm::min(chunk.bounds.min, position);
+                    chunk.bounds.max = glm::max(chunk.bounds.max, position);
+                    out++;
+                };
+
+                for (int row = 0; row < chunk_vertices_per_side; row++)
+                {
+                    for (int col = 0; col < chunk_vertices_per_side; col++)
+                    {
+                        push_vertex(row, col, 0.f);
+                    }
+                }
+
+                for (int col = 0; col < chunk_vertices_per_side; col++)
+                {
+                    push_vertex(0, col, skirt_depth);
+                }
+                for (int col = 0; col < chunk_vertices_per_side; col++)
+                {
+                    push_vertex(chunk_size, col, skirt_depth);
+                }
+                for (int row = 0; row < chunk_vertices_per_side; row++)
+                {
+                    push_vertex(row, 0, skirt_depth);
+                }
+                for (int row = 0; row < chunk_vertices_per_side; row++)
+                {
+                    push_vertex(row, chunk_size, skirt_depth);
+                }
+            }
+        });
+
+        LOG_DEBUG("Built terrain tile: %zu chunks (%d x %d), %zu vertices\n",
+                  chunks.size(),
+                  num_chunks_x,
+                  num_chunks_z,
+                  chunk_vertices.size());
+
+        return true;
+    }
+
+    /**
+     * @brief Build the index list of each LOD, which every chunk of every tile shares.
+     *
+     * @param[out] indices Index lists of all LODs, one after the other.
+     * @param[out] lod_ranges Range of each LOD in @p indices.
+     */
+    void TerrainMesh::build_index_lists(std::vector<IndexType> &indices,
+                                        std::array<LodRange, num_lods> &lod_ranges)
+    {
+        /*
+         * Triangles are wound the same way for every LOD:
+         *
+         *   this----right
+         *    |      /|
+         *    |    /  |
+         *    |  /    |
+         *    |/      |
+         *   bottom--bottom_right
+         */
+        indices.clear();
+        auto grid_index = [](const int row, const int col) -> IndexType {
+            return row * chunk_vertices_per_side + col;
+        };
+        auto skirt_index = [](const int edge, const int i) -> IndexType {
+            return chunk_num_grid_vertices + edge * chunk_vertices_per_side + i;
+        };
+
+        for (int lod = 0; lod < num_lods; lod++)
+        {
+            const int step = 1 << lod;
+            lod_ranges[lod].offset = indices.size() * sizeof(IndexType);
+
+            for (int row = 0; row < chunk_size; row += step)
+            {
+                for (int col = 0; col < chunk_size; col += step)
+                {
+                    const IndexType this_vertex = grid_index(row, col);
+                    const IndexType right_vertex = grid_index(row, col + step);
+                    const IndexType bottom_vertex = grid_index(row + step, col);
+                    const IndexType bottom_right_vertex = grid_index(row + step, col + step);
+
+                    indices.push_back(this_vertex);
+                    indices.push_back(bottom_vertex);
+                    indices.push_back(right_vertex);
+
+                    indices.push_back(right_vertex);
+                    indices.push_back(bottom_vertex);
+                    indices.push_back(bottom_right_vertex);
+                }
+            }
+
+            /*
+             * Hang a quad below every edge segment of the chunk.
+             */
+            auto push_skirt = [&](const IndexType a,
+                                  const IndexType b,
+                                  const IndexType skirt_a,
+                                  const IndexType skirt_b) {
+                indices.push_back(a);
+                indices.push_back(skirt_a);
+                indices.push_back(b);
+
+                indices.push_back(b);
+                indices.push_back(skirt_a);
+                indices.push_back(skirt_b);
+            };
+
+            for (int i = 0; i < chunk_size; i += step)
+            {
+                push_skirt(grid_index(0, i),
+                           grid_index(0, i + step),
+                           skirt_index(0, i),
+                           skirt_index(0, i + step));
+                push_skirt(grid_index(chunk_size, i + step),
+                           grid_index(chunk_size, i),
+                           skirt_index(1, i + step),
+                           skirt_index(1, i));
+                push_skirt(grid_index(i + step, 0),
+                           grid_index(i, 0),
+                           skirt_index(2, i + step),
+                           skirt_index(2, i));
+                push_skirt(grid_index(i, chunk_size),
+                           grid_index(i + step, chunk_size),
+                           skirt_index(3, i),
+                           skirt_index(3, i + step));
+            }
+
+            lod_ranges[lod].count =
+                indices.size() - lod_ranges[lod].offset / sizeof(IndexType);
+        }
+    }
+
+    /**
+     * @brief Encode a vertex into a compact terrain vertex.
+     *
+     * The normal is projected onto the octahedron |x| + |y| + |z| = 1, whose lower half is
+     * folded out over the corners of the upper half so that the whole octahedron lies flat
+     * on the XZ plane.
+     *
+     * @param vertex Vertex to encode, in world space.
+     * @param chunk_position Grid indices of the vertex within its chunk, column then row.
+     * @param layout Layout of the terrain.
+     *
+     * @return Encoded vertex.
+     */
+    TerrainVertex TerrainMesh::encode_vertex(const Vertex3dNormal &vertex,
+                                             const glm::ivec2 &chunk_position,
+                                             const Layout &layout)
+    {
+        const float t = layout.height_range > 0.f
+                            ? (vertex.position.y - layout.height_min) / layout.height_range
+                            : 0.f;
+
+        const glm::vec3 &n = vertex.norm;
+        const float l1_norm = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+        float x = n.x / l1_norm;
+        float z = n.z / l1_norm;
+        if (n.y < 0.f)
+        {
+            const float folded_x = (1.f - glm::abs(z)) * (x >= 0.f ? 1.f : -1.f);
+            const float folded_z = (1.f - glm::abs(x)) * (z >= 0.f ? 1.f : -1.f);
+            x = folded_x;
+            z = folded_z;
+        }
+
+        return {
+            .chunk_position = glm::u8vec2(chunk_position.x, chunk_position.y),
+            .height = static_cast<uint16_t>(glm::round(glm::clamp(t, 0.f, 1.f) * UINT16_MAX)),
+            .normal = glm::i16vec2(static_cast<int16_t>(glm::round(x * INT16_MAX)),
+                                   static_cast<int16_t>(glm::round(z * INT16_MAX))),
+        };
+    }
+
+    /**
+     * @return World space height of a quantized height, as the shaders decode it.
+     */
+    float TerrainMesh::decode_height(const uint16_t height, const Layout &layout)
+    {
+        return layout.height_min + static_cast<float>(height) / UINT16_MAX * layout.height_range;
+    }
+
+    /**
+     * @brief Create the buffers of a mesh with room for the given number of tiles, all of
+     * which start out cleared.
+     *
+     * @param _num_tiles Number of tiles, at most max_num_tiles.
+     * @param _max_tile_chunks Number of chunks each tile has room for.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainMesh::create(const size_t _num_tiles, const size_t _max_tile_chunks)
+    {
+        ASSERT_RET_IF(_num_tiles == 0 || _num_tiles > max_num_tiles, false);
+        ASSERT_RET_IF(_max_tile_chunks == 0, false);
+
+        const size_t max_num_chunks = _num_tiles * _max_tile_chunks;
+        ASSERT_RET_IF(max_num_chunks * chunk_num_vertices > INT32_MAX, false);
+
+        max_tile_chunks = _max_tile_chunks;
+        chunks.assign(max_num_chunks, Chunk {});
+        tile_num_chunks.assign(_num_tiles, 0);
+        num_chunks = 0;
+
+        vertex_array.create<TerrainVertex>(nullptr, max_num_chunks * chunk_num_vertices);
+        TerrainVertex::setup_vertex_array_attribs(vertex_array);
+
+        /*
+         * The layout buffer is created the first time only.
+         */
+        if (layout_uniform_buffer.get_binding() != layout_uniform_binding)
+        {
+            layout_uniform_buffer.create(layout_uniform_binding);
+        }
+        layout_uniforms = {
+            .tile_num_chunks = static_cast<GLint>(max_tile_chunks),
+            .padding = {},
+            .tiles = {},
+        };
+        layout_uniform_buffer.update(layout_uniforms);
+
+        /*
+         * The vertex array is still bound, so it captures the index buffer binding.
+         */
+        std::vector<IndexType> indices;
+        build_index_lists(indices, lod_ranges);
+        if (index_buffer_obj != 0)
+        {
+            glDeleteBuffers(1, &index_buffer_obj);
+        }
+        glGenBuffers(1, &index_buffer_obj);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_obj);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     indices.size() * sizeof(IndexType),
+                     indices.data(),
+                     GL_STATIC_DRAW);
+
+        draw_counts.reserve(max_num_chunks);
+        draw_offsets.reserve(max_num_chunks);
+        draw_base_vertices.reserve(max_num_chunks);
+
+        ASSERT_RET_IF_NOT(create_gpu_culling_buffers(), false);
+
+        generation++;
+
+        return true;
+    }
+
+    /**
+     * @brief Replace the contents of a tile in place, without allocating any GL objects.
+     * The geometry is only read during the call, so it may point straight into a
+     * memory-mapped file.
+     *
+     * @param tile Index of the tile.
+     * @param geometry Geometry built with TerrainMesh::build(), of at most as many chunks as
+     * the tiles have room for.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainMesh::set_tile(const size_t tile, const GeometryView &geometry)
+    {
+        ASSERT_RET_IF(chunk_buffer == 0, false);
+        ASSERT_RET_IF(tile >= tile_num_chunks.size(), false);
+        ASSERT_RET_IF(geometry.num_chunks == 0 || geometry.num_chunks > max_tile_chunks, false);
+        ASSERT_RET_IF(geometry.num_vertices != geometry.num_chunks * chunk_num_vertices, false);
+
+        /*
+         * Base vertices of the geometry are relative to the tile, which owns the vertices of
+         * max_tile_chunks chunks.
+         */
+        const size_t first_chunk = tile * max_tile_chunks;
+        const GLint tile_base_vertex = static_cast<GLint>(first_chunk * chunk_num_vertices);
+        for (size_t i = 0; i < geometry.num_chunks; i++)
+        {
+            chunks[first_chunk + i] = {
+                .bounds = geometry.chunks[i].bounds,
+                .base_vertex = tile_base_vertex + geometry.chunks[i].base_vertex,
+            };
+        }
+        num_chunks = num_chunks - tile_num_chunks[tile] + geometry.num_chunks;
+        tile_num_chunks[tile] = geometry.num_chunks;
+
+        vertex_array.update(geometry.vertices, geometry.num_vertices, tile_base_vertex);
+
+        const Layout &layout = geometry.layout;
+        layout_uniforms.tiles[tile] = {
+            .origin = layout.origin,
+            .height_min = layout.height_min,
+            .height_range = layout.height_range,
+            .num_chunks_x = layout.num_chunks_x,
+            .padding = {},
+        };
+        layout_uniform_buffer.update(layout_uniforms);
+
+        upload_gpu_chunks(tile);
+        generation++;
+
+        return true;
+    }
+
+    /**
+     * @brief Clear a tile so that none of its chunks are drawn.
+     *
+     * @param tile Index of the tile.
+     */
+    void TerrainMesh::clear_tile(const size_t tile)
+    {
+        if (unlikely(tile >= tile_num_chunks.size()))
+        {
+            LOG_ERROR("Cannot clear terrain tile %zu of %zu\n", tile, tile_num_chunks.size());
+            return;
+        }
+
+        num_chunks -= tile_num_chunks[tile];
+        tile_num_chunks[tile] = 0;
+        upload_gpu_chunks(tile);
+        generation++;
+    }
+
+    /**
+     * @brief Create the buffers the culling compute shader reads the chunks from and writes
+     * the draws to, replacing any from a previous mesh, with every tile cleared.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainMesh::create_gpu_culling_buffers()
+    {
+        if (chunk_buffer != 0)
+        {
+            const std::array<GLuint, 4> buffers = {
+                chunk_buffer,
+                draw_buffer,
+                draw_count_buffer,
+                draw_count_readback_buffer,
+            };
+            glDeleteBuffers(buffers.size(), buffers.data());
+        }
+
+        glGenBuffers(1, &chunk_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, chunk_buffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER,
+                        sizeof(GPUChunkHeader) + chunks.size() * sizeof(GPUChunk),
+                        nullptr,
+                        GL_DYNAMIC_STORAGE_BIT);
+
+        GPUChunkHeader header = {
+            .lod_counts = {},
+            .lod_first_indices = {},
+            .lod_base_distance = lod_base_distance,
+            .num_chunks = static_cast<GLuint>(chunks.size()),
+            .padding = {},
+        };
+        for (int lod = 0; lod < num_lods; lod++)
+        {
+            header.lod_counts[lod] = lod_ranges[lod].count;
+            header.lod_first_indices[lod] = lod_ranges[lod].offset / sizeof(IndexType);
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GPUChunkHeader), &header);
+        for (size_t tile = 0; tile < tile_num_chunks.size(); tile++)
+        {
+            upload_gpu_chunks(tile);
+        }
+
+        glGenBuffers(1, &draw_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, draw_buffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER,
+                        chunks.size() * sizeof(DrawElementsIndirectCommand),
+                        nullptr,
+                        0);
+
+        glGenBuffers(1, &draw_count_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, draw_count_buffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        static constexpr GLbitfield readback_flags =
+            GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const std::array<GLuint, num_draw_count_readbacks> zeros = {};
+        glGenBuffers(1, &draw_count_readback_buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, draw_count_readback_buffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, sizeof(zeros), zeros.data(), readback_flags);
+        draw_count_readbacks = static_cast<const GLuint *>(
+            glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, sizeof(zeros), readback_flags));
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        draw_count_readback_idx = 0;
+        if (unlikely(draw_count_readbacks == nullptr))
+        {
+            LOG_ERROR("Failed to map terrain draw count readback buffer\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Write the chunks of a tile into the chunk buffer read by the culling compute
+     * shader. Chunks the tile does not use are written as unused.
+     *
+     * @param tile Index of the tile.
+     */
+    void TerrainMesh::upload_gpu_chunks(const size_t tile) const
+    {
+        const size_t first_chunk = tile * max_tile_chunks;
+        std::vector<GPUChunk> gpu_chunks(max_tile_chunks,
+                                         {
+                                             .bounds_min = {},
+                                             .base_vertex = 0,
+                                             .bounds_max = {},
+                                             .tile = no_tile,
+                                         });
+        for (size_t i = 0; i < tile_num_chunks[tile]; i++)
+        {
+            const Chunk &chunk = chunks[first_chunk + i];
+            gpu_chunks[i] = {
+                .bounds_min = chunk.bounds.min,
+                .base_vertex = chunk.base_vertex,
+                .bounds_max = chunk.bounds.max,
+                .tile = static_cast<GLint>(tile),
+            };
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, chunk_buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                        sizeof(GPUChunkHeader) + first_chunk * sizeof(GPUChunk),
+                        gpu_chunks.size() * sizeof(GPUChunk),
+                        gpu_chunks.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /**
+     * @brief Get the LOD to draw a chunk with.
+     *
+     * @param chunk Chunk.
+     * @param lod_origin Position the LOD is chosen relative to.
+     *
+     * @return LOD of the chunk.
+     */
+    int TerrainMesh::get_lod(const Chunk &chunk, const glm::vec3 &lod_origin) const
+    {
+        const float distance = chunk.bounds.distance_to(lod_origin);
+
+        int lod = 0;
+        float lod_distance = lod_base_distance;
+        while (lod < num_lods - 1 && distance >= lod_distance)
+        {
+            lod++;
+            lod_distance *= 2.f;
+        }
+
+        return lod;
+    }
+
+    /**
+     * @brief Draw all chunks of all tiles which intersect the given frustum with a single
+     * multi-draw. The chunks are culled and their LODs chosen in parallel, then gathered in
+     * order.
+     *
+     * @param state Tracked GL state.
+     * @param frustum Frustum to cull chunks against.
+     * @param lod_origin Position the LODs are chosen relative to. This should be the camera
+     * position in every pass so that shadows match the geometry that is drawn.
+     *
+     * @return Number of chunks drawn.
+     */
+    size_t TerrainMesh::draw(GLState &state, const Frustum &frustum, const glm::vec3 &lod_origin)
+    {
+        chunk_lods.resize(chunks.size());
+        parallel_for(
+            0,
+            chunks.size(),
+            [&](const size_t chunk_begin, const size_t chunk_end) {
+                for (size_t chunk_idx = chunk_begin; chunk_idx < chunk_end; chunk_idx++)
+                {
+                    const Chunk &chunk = chunks[chunk_idx];
+                    chunk_lods[chunk_idx] =
+                        (is_chunk_used(chunk_idx) && frustum.intersects(chunk.bounds))
+                            ? get_lod(chunk, lod_origin)
+                            : culled_lod;
+                }
+            },
+            chunks_per_cull_job);
+
+        draw_counts.clear();
+        draw_offsets.clear();
+        draw_base_vertices.clear();
+
+        for (size_t chunk_idx = 0; chunk_idx < chunks.size(); chunk_idx++)
+        {
+            if (chunk_lods[chunk_idx] == culled_lod)
+            {
+                continue;
+            }
+
+            const LodRange &range = lod_ranges[chunk_lods[chunk_idx]];
+            draw_counts.push_back(range.count);
+            draw_offsets.push_back(reinterpret_cast<const void *>(range.offset));
+            draw_base_vertices.push_back(chunks[chunk_idx].base_vertex);
+        }
+
+        if (likely(!draw_counts.empty()))
+        {
+            vertex_array.bind(state);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES,
+                                          draw_counts.data(),
+                                          IndexGLtype,
+                                          draw_offsets.data(),
+                                          draw_counts.size(),
+                                          draw_base_vertices.data());
+        }
+
+        return draw_counts.size();
+    }
+
+    /**
+     * @brief Cull the chunks of all tiles and write a draw for each visible one on the GPU,
+     * to be drawn with draw_indirect(). The culling compute shader, shaders/terrain_cull.comp,
+     * must be in use with its uniforms set.
+     */
+    void TerrainMesh::cull_on_gpu() const
+    {
+        static constexpr GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, draw_count_buffer);
+        glClearBufferData(
+            GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cull_chunk_binding, chunk_buffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cull_draw_binding, draw_buffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cull_draw_count_binding, draw_count_buffer);
+
+        glDispatchCompute((chunks.size() + cull_group_size - 1) / cull_group_size, 1, 1);
+
+        /*
+         * The draws are read as indirect commands, and the draw count is also copied out by
+         * read_back_num_drawn().
+         */
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+    /**
+     * @brief Draw the chunks written by the last cull_on_gpu() with a single multi-draw,
+     * whose draw count is sourced from the GPU too.
+     *
+     * @param state Tracked GL state.
+     */
+    void TerrainMesh::draw_indirect(GLState &state)
+    {
+        vertex_array.bind(state);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw_buffer);
+        glBindBuffer(GL_PARAMETER_BUFFER, draw_count_buffer);
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, IndexGLtype, nullptr, 0, chunks.size(), 0);
+    }
+
+    /**
+     * @brief Queue a copy of the draw count of the last cull_on_gpu() and read back the
+     * oldest one queued. No fence is waited on, the ring is deep enough for the copy to be
+     * done by the time it is read. Call at most once per frame.
+     *
+     * @return Number of chunks drawn num_draw_count_readbacks - 1 calls ago.
+     */
+    size_t TerrainMesh::read_back_num_drawn()
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, draw_count_buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, draw_count_readback_buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                            GL_COPY_WRITE_BUFFER,
+                            0,
+                            draw_count_readback_idx * sizeof(GLuint),
+                            sizeof(GLuint));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        draw_count_readback_idx = (draw_count_readback_idx + 1) % num_draw_count_readbacks;
+        return draw_count_readbacks[draw_count_readback_idx];
+    }
+}
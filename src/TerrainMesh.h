@@ -0,0 +1,417 @@
+#pragma once
+
+#include "Frustum.h"
+#include "UniformBuffer.h"
+#include "Vertex.h"
+#include "VertexArray.h"
+
+#include <GL/glew.h>
+#include <array>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Terrain mesh made of square tiles, each split into fixed-size square chunks
+     * which are frustum culled and drawn at a level of detail (LOD) chosen by distance.
+     *
+     * Every chunk owns a block of vertices of the same size laid out the same way, so all
+     * chunks share one index list per LOD and a chunk is selected purely by its base vertex.
+     * Chunks on the far edges of a tile are padded by clamping to the last row and column,
+     * which only produces degenerate triangles.
+     *
+     * Neighbouring chunks drawn at different LODs do not share all of their edge vertices,
+     * so each chunk has a skirt hanging down from its edges to hide the cracks.
+     *
+     * Vertices are stored as compact TerrainVertex, a third of the size of a float position
+     * and normal. Decoding them takes the layout of their tile, which the mesh keeps in a
+     * uniform buffer for the terrain shaders.
+     *
+     * The mesh has room for a fixed number of tiles of up to a fixed number of chunks each,
+     * all in the same buffers. Each tile owns a range of the vertices and of the chunks, so
+     * shaders find the tile of a chunk from its base vertex, and tiles are set and cleared
+     * in place without allocating. That is how TerrainStreamer streams a terrain of any
+     * size through a bounded amount of GPU memory.
+     *
+     * Chunks of all tiles are culled either on the CPU with draw(), or on the GPU with
+     * cull_on_gpu() followed by draw_indirect(), in which case shaders/terrain_cull.comp
+     * writes the draws and the CPU cost no longer depends on the number of chunks or tiles.
+     * Either way, the whole terrain is a single multi-draw.
+     */
+    class TerrainMesh
+    {
+    public:
+        /**
+         * Number of cells along each side of a chunk.
+         */
+        static constexpr int chunk_size = 64;
+
+        /**
+         * Number of levels of detail. LOD i samples every 2^i-th vertex.
+         */
+        static constexpr int num_lods = 4;
+
+        /**
+         * Number of vertices along each side of a chunk.
+         */
+        static constexpr int chunk_vertices_per_side = chunk_size + 1;
+
+        /**
+         * Number of grid vertices in a chunk, followed by the skirt vertices of its four
+         * edges.
+         */
+        static constexpr int chunk_num_grid_vertices =
+            chunk_vertices_per_side * chunk_vertices_per_side;
+        static constexpr int chunk_num_vertices =
+            chunk_num_grid_vertices + 4 * chunk_vertices_per_side;
+        static_assert(chunk_num_vertices <= UINT16_MAX + 1);
+
+        /**
+         * Number of tiles a mesh may have room for. This must match TERRAIN_MAX_TILES in
+         * shaders/include/terrain_vertex.glsl.
+         */
+        static constexpr size_t max_num_tiles = 256;
+
+        /**
+         * Index type of the shared LOD index lists.
+         */
+        using IndexType = uint16_t;
+        static constexpr GLenum IndexGLtype = GL_UNSIGNED_SHORT;
+
+        /**
+         * @brief A chunk of the terrain.
+         */
+        struct Chunk
+        {
+            BoundingBox bounds;
+            GLint base_vertex;
+        };
+
+        /**
+         * @brief What decoding a TerrainVertex takes besides the vertex itself.
+         */
+        struct Layout
+        {
+            /**
+             * World position of the first grid vertex along X and Z. Grid vertices are one
+             * unit apart.
+             */
+            glm::vec2 origin;
+
+            /**
+             * Heights are quantized over [height_min, height_min + height_range].
+             * @{
+             */
+            float height_min;
+            float height_range;
+            /**
+             * @}
+             */
+
+            int32_t num_chunks_x;
+        };
+
+        /**
+         * @brief Non-owning view of the contents of a tile, ready to be uploaded.
+         */
+        struct GeometryView
+        {
+            Layout layout;
+            const TerrainVertex *vertices;
+            size_t num_vertices;
+            const Chunk *chunks;
+            size_t num_chunks;
+        };
+
+        /**
+         * @brief Contents of a tile built from a grid of vertices.
+         */
+        struct Geometry
+        {
+            Layout layout;
+            std::vector<TerrainVertex> vertices;
+            std::vector<Chunk> chunks;
+
+            /**
+             * @return View of the geometry.
+             */
+            GeometryView view() const
+            {
+                return {
+                    .layout = layout,
+                    .vertices = vertices.data(),
+                    .num_vertices = vertices.size(),
+                    .chunks = chunks.data(),
+                    .num_chunks = chunks.size(),
+                };
+            }
+        };
+
+        TerrainMesh();
+
+        static bool build(const Vertex3dNormal *grid_vertices,
+                          const int num_rows,
+                          const int num_cols,
+                          Geometry &geometry);
+
+        bool create(const size_t _num_tiles, const size_t _max_tile_chunks);
+
+        bool set_tile(const size_t tile, const GeometryView &geometry);
+
+        void clear_tile(const size_t tile);
+
+        size_t draw(GLState &state, const Frustum &frustum, const glm::vec3 &lod_origin);
+
+        void cull_on_gpu() const;
+
+        void draw_indirect(GLState &state);
+
+        size_t read_back_num_drawn();
+
+        /**
+         * @return Number of chunks of all tiles which are set.
+         */
+        size_t get_num_chunks() const
+        {
+            return num_chunks;
+        }
+
+        /**
+         * @return Number of tiles the mesh has room for.
+         */
+        size_t get_num_tiles() const
+        {
+            return tile_num_chunks.size();
+        }
+
+        /**
+         * @return Counter bumped whenever a tile is set or cleared, for caches of the drawn
+         * terrain to notice that it changed.
+         */
+        uint64_t get_generation() const
+        {
+            return generation;
+        }
+
+    private:
+        /**
+         * Distance from a chunk at which LOD 1 starts. Each following LOD starts at double
+         * the distance of the previous.
+         */
+        static constexpr float lod_base_distance = 128.f;
+
+        /**
+         * How far the skirts hang below the chunk edges.
+         */
+        static constexpr float skirt_depth = 8.f;
+
+        static_assert((chunk_size % (1 << (num_lods - 1))) == 0);
+        static_assert(chunk_vertices_per_side <= UINT8_MAX + 1,
+                      "chunk positions of vertices are 8-bit");
+
+        /**
+         * @brief Range of a LOD index list in the index buffer.
+         */
+        struct LodRange
+        {
+            GLsizei count;
+            size_t offset;
+        };
+
+        static void build_index_lists(std::vector<IndexType> &indices,
+                                      std::array<LodRange, num_lods> &lod_ranges);
+
+        static TerrainVertex encode_vertex(const Vertex3dNormal &vertex,
+                                           const glm::ivec2 &chunk_position,
+                                           const Layout &layout);
+
+        static float decode_height(const uint16_t height, const Layout &layout);
+
+        int get_lod(const Chunk &chunk, const glm::vec3 &lod_origin) const;
+
+        static constexpr int culled_lod = -1;
+
+        /**
+         * Number of chunks culled per job when culling in parallel.
+         */
+        static constexpr size_t chunks_per_cull_job = 256;
+
+        /**
+         * @brief Chunk, mirroring TerrainChunk in shaders/terrain_cull.comp.
+         */
+        struct GPUChunk
+        {
+            glm::vec3 bounds_min;
+            GLint base_vertex;
+            glm::vec3 bounds_max;
+
+            /**
+             * Tile of the chunk, or no_tile if the chunk is not in use.
+             */
+            GLint tile;
+        };
+        static constexpr GLint no_tile = -1;
+
+        /**
+         * @brief Start of the TerrainChunkBuffer block in shaders/terrain_cull.comp, which
+         * the chunks follow.
+         */
+        struct GPUChunkHeader
+        {
+            glm::ivec4 lod_counts;
+            glm::ivec4 lod_first_indices;
+            float lod_base_distance;
+            GLuint num_chunks;
+            float padding[2];
+        };
+        static_assert(num_lods == 4, "LOD ranges are an ivec4");
+
+        /**
+         * @brief Arguments of one indirect indexed draw, as laid out by OpenGL.
+         */
+        struct DrawElementsIndirectCommand
+        {
+            GLuint count;
+            GLuint instance_count;
+            GLuint first_index;
+            GLint base_vertex;
+            GLuint base_instance;
+        };
+        static_assert(sizeof(GPUChunkHeader) % sizeof(glm::vec4) == 0);
+
+        /**
+         * @brief Layout of a tile, mirroring the std140 TerrainTile struct in
+         * shaders/include/terrain_vertex.glsl.
+         */
+        struct TileLayoutUniforms
+        {
+            glm::vec2 origin;
+            float height_min;
+            float height_range;
+            GLint num_chunks_x;
+            GLint padding[3];
+        };
+        static_assert(sizeof(TileLayoutUniforms) == 2 * sizeof(glm::vec4));
+
+        /**
+         * @brief Layouts of all tiles, mirroring the std140 TerrainData block in
+         * shaders/include/terrain_vertex.glsl.
+         */
+        struct LayoutUniforms
+        {
+            GLint tile_num_chunks;
+            GLint padding[3];
+            std::array<TileLayoutUniforms, max_num_tiles> tiles;
+        };
+
+        /**
+         * Uniform block binding point of the layout. This must match the TerrainData block
+         * in shaders/include/terrain_vertex.glsl.
+         */
+        static constexpr GLuint layout_uniform_binding = 2;
+
+        /**
+         * Shader storage binding points and local size of shaders/terrain_cull.comp.
+         * @{
+         */
+        static constexpr GLuint cull_chunk_binding = 3;
+        static constexpr GLuint cull_draw_binding = 4;
+        static constexpr GLuint cull_draw_count_binding = 5;
+        static constexpr GLuint cull_group_size = 64;
+        /**
+         * @}
+         */
+
+        /**
+         * Number of draw counts in flight between the GPU writing them and the CPU reading
+         * them back.
+         */
+        static constexpr size_t num_draw_count_readbacks = 3;
+
+        bool create_gpu_culling_buffers();
+
+        void upload_gpu_chunks(const size_t tile) const;
+
+        /**
+         * @return Whether a chunk slot belongs to a tile which is set and is one of its
+         * chunks.
+         */
+        bool is_chunk_used(const size_t chunk_idx) const
+        {
+            return chunk_idx % max_tile_chunks < tile_num_chunks[chunk_idx / max_tile_chunks];
+        }
+
+        /**
+         * Vertices of all chunks, and the layouts of the tiles they are decoded with.
+         * @{
+         */
+        VertexArray vertex_array;
+        LayoutUniforms layout_uniforms;
+        UniformBuffer<LayoutUniforms> layout_uniform_buffer;
+        /**
+         * @}
+         */
+
+        /**
+         * OpenGL index buffer holding the index list of each LOD.
+         */
+        GLuint index_buffer_obj;
+
+        std::array<LodRange, num_lods> lod_ranges;
+
+        /**
+         * Chunks of every tile, max_tile_chunks per tile whether the tile uses them all or
+         * not, with base vertices into the vertices of the whole mesh.
+         */
+        std::vector<Chunk> chunks;
+
+        /**
+         * Number of chunks of each tile, zero if the tile is not set, and in all.
+         * @{
+         */
+        std::vector<size_t> tile_num_chunks;
+        size_t max_tile_chunks;
+        size_t num_chunks;
+        /**
+         * @}
+         */
+
+        uint64_t generation;
+
+        /**
+         * Scratch arrays for multi-draw submission.
+         * @{
+         */
+
+        /**
+         * LOD of each chunk, or culled_lod if it is culled.
+         */
+        std::vector<int> chunk_lods;
+
+        std::vector<GLsizei> draw_counts;
+        std::vector<const void *> draw_offsets;
+        std::vector<GLint> draw_base_vertices;
+        /**
+         * @}
+         */
+
+        /**
+         * GPU culling. The compute shader reads the chunks and appends indirect draws and
+         * their count, which is copied into a persistently mapped ring to be read back a
+         * few frames later without stalling.
+         * @{
+         */
+        GLuint chunk_buffer;
+        GLuint draw_buffer;
+        GLuint draw_count_buffer;
+        GLuint draw_count_readback_buffer;
+        const GLuint *draw_count_readbacks;
+        size_t draw_count_readback_idx;
+        /**
+         * @}
+         */
+    };
+}
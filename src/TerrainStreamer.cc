@@ -0,0 +1,579 @@
+#include "TerrainStreamer.h"
+
+#include "assert_util.h"
+#include "log.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec2.hpp>
+
+namespace Engine
+{
+    /**
+     * @brief Constructor.
+     */
+    TerrainStreamer::TerrainStreamer(): file(nullptr), num_resident_tiles(0)
+    {}
+
+    /**
+     * @brief Destructor. Waits for the tiles still loading.
+     */
+    TerrainStreamer::~TerrainStreamer()
+    {
+        JobSystem::get().wait(load_counter);
+    }
+
+    /**
+     * @brief Set up streaming from a tile file. No tiles are loaded until the first
+     * update.
+     *
+     * @param _file Open tile file, which must outlive the streamer.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainStreamer::init(const TerrainTileFile &_file)
+    {
+        ASSERT_RET_IF(_file.get_tile_size() % TerrainMesh::chunk_size != 0, false);
+
+        file = &_file;
+
+        const size_t num_tiles =
+            static_cast<size_t>(file->get_num_tiles_x()) * file->get_num_tiles_z();
+        tile_slots.assign(num_tiles, no_slot);
+
+        /*
+         * Tiles are in range if they are closer than load_distance, so at most this many
+         * along each axis and its square in all are in range at once.
+         */
+        const int tile_size = file->get_tile_size();
+        const size_t num_tiles_per_side =
+            2 * static_cast<size_t>(std::ceil(load_distance / tile_size)) + 1;
+        const size_t num_slots = std::min(num_tiles_per_side * num_tiles_per_side, num_tiles);
+        const size_t num_chunks_per_side = tile_size / TerrainMesh::chunk_size;
+        if (unlikely(num_slots > TerrainMesh::max_num_tiles))
+        {
+            LOG_ERROR("Terrain tiles of size %d need %zu slots, more than the %zu possible\n",
+                      tile_size,
+                      num_slots,
+                      TerrainMesh::max_num_tiles);
+            return false;
+        }
+        slots = std::vector<Slot>(num_slots);
+        num_resident_tiles = 0;
+        ASSERT_RET_IF_NOT(mesh.create(num_slots, num_chunks_per_side * num_chunks_per_side),
+                          false);
+
+        LOG("Streaming %zu terrain tiles through %zu slots\n", num_tiles, num_slots);
+
+        return true;
+    }
+
+    /**
+     * @brief Stream the tiles around a point: upload tiles which finished loading, drop
+     * those out of range and start loading those missing. Must be called from the GL
+     * thread, typically once per frame.
+     *
+     * @param focus Point to stream the tiles around, usually the camera.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainStreamer::update(const glm::vec3 &focus)
+    {
+        return stream(focus, max_num_pending_tiles, max_uploads_per_update);
+    }
+
+    /**
+     * @brief Load every tile within range of a point and wait for them, so that there is
+     * terrain to stand on from the first frame. All of them are loaded at once and uploaded
+     * together, since nothing is drawn in the meantime. Must be called from the GL thread.
+     *
+     * @param focus Point to load the tiles around.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainStreamer::load_around(const glm::vec3 &focus)
+    {
+        do
+        {
+            ASSERT_RET_IF_NOT(stream(focus, slots.size(), slots.size()), false);
+            JobSystem::get().wait(load_counter);
+        } while (!pending_tiles.empty());
+
+        return true;
+    }
+
+    /**
+     * @brief Upload tiles which finished loading, drop those out of range and start loading
+     * those missing.
+     *
+     * @param focus Point to stream the tiles around.
+     * @param max_num_pending Number of tiles which may be loading or waiting to be uploaded
+     * at once.
+     * @param max_num_uploads Number of tiles to upload at most.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainStreamer::stream(const glm::vec3 &focus,
+                                 const size_t max_num_pending,
+                                 const size_t max_num_uploads)
+    {
+        {
+            std::lock_guard<std::mutex> lock(loaded_mutex);
+            for (LoadedTile &tile : loaded_tiles)
+            {
+                ready_tiles.push_back(std::move(tile));
+            }
+            loaded_tiles.clear();
+        }
+
+        for (size_t slot = 0; slot < slots.size(); slot++)
+        {
+            const int tile_idx = slots[slot].tile_idx;
+            if (tile_idx != no_tile && get_distance(tile_idx, focus) > unload_distance)
+            {
+                evict(slot);
+            }
+        }
+
+        size_t num_uploads = 0;
+        auto tile = ready_tiles.begin();
+        while (tile != ready_tiles.end())
+        {
+            if (unlikely(!tile->is_loaded))
+            {
+                LOG_ERROR("Failed to load terrain tile %d\n", tile->tile_idx);
+                return false;
+            }
+
+            /*
+             * Tiles which went out of range while loading are not worth a slot.
+             */
+            if (get_distance(tile->tile_idx, focus) > unload_distance)
+            {
+                remove_pending(tile->tile_idx);
+                tile = ready_tiles.erase(tile);
+                continue;
+            }
+
+            if (num_uploads == max_num_uploads)
+            {
+                break;
+            }
+
+            const int slot = find_slot(focus);
+            if (unlikely(slot == no_slot))
+            {
+                break;
+            }
+
+            ASSERT_RET_IF_NOT(install(*tile, slot), false);
+            num_uploads++;
+            tile = ready_tiles.erase(tile);
+        }
+
+        schedule_loads(focus, max_num_pending);
+
+        return true;
+    }
+
+    /**
+     * @return Terrain height at given (x, z) world coordinates.
+     *
+     * @param x X world coordinate.
+     * @param z Z world coordinate.
+     */
+    float TerrainStreamer::get_height(const float x, const float z) const
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(slots_mutex);
+            const TerrainHeightField *const height_field = get_height_field(get_tile_idx(x, z));
+            if (likely(height_field != nullptr))
+            {
+                return height_field->get_height(x, z);
+            }
+        }
+
+        return sample_file(x, z).height;
+    }
+
+    /**
+     * @brief Get the terrain height at many points. Consecutive points on the same tile
+     * are handed to its height field together, so points which are sorted or clustered
+     * keep the batched queries of TerrainHeightField.
+     *
+     * @param xs X world coordinates of the points.
+     * @param zs Z world coordinates of the points.
+     * @param count Number of points.
+     * @param[out] heights Height at each point.
+     */
+    void TerrainStreamer::get_heights(const float *xs,
+                                      const float *zs,
+                                      const size_t count,
+                                      float *heights) const
+    {
+        std::shared_lock<std::shared_mutex> lock(slots_mutex);
+        size_t begin = 0;
+        while (begin < count)
+        {
+            const int tile_idx = get_tile_idx(xs[begin], zs[begin]);
+            size_t end = begin + 1;
+            while (end < count && get_tile_idx(xs[end], zs[end]) == tile_idx)
+            {
+                end++;
+            }
+
+            const TerrainHeightField *const height_field = get_height_field(tile_idx);
+            if (likely(height_field != nullptr))
+            {
+                height_field->get_heights(xs + begin, zs + begin, end - begin, heights + begin);
+            }
+            else
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    heights[i] = sample_file(xs[i], zs[i]).height;
+                }
+            }
+
+            begin = end;
+        }
+    }
+
+    /**
+     * @brief Get the terrain normal and slope at many points, grouped by tile like
+     * get_heights().
+     *
+     * @param xs X world coordinates of the points.
+     * @param zs Z world coordinates of the points.
+     * @param count Number of points.
+     * @param[out] normal_xs X component of the unit normal at each point.
+     * @param[out] normal_ys Y component of the unit normal at each point.
+     * @param[out] normal_zs Z component of the unit normal at each point.
+     * @param[out] slopes Slope at each point, see TerrainHeightField::get_normals().
+     */
+    void TerrainStreamer::get_normals(const float *xs,
+                                      const float *zs,
+                                      const size_t count,
+                                      float *normal_xs,
+                                      float *normal_ys,
+                                      float *normal_zs,
+                                      float *slopes) const
+    {
+        std::shared_lock<std::shared_mutex> lock(slots_mutex);
+        size_t begin = 0;
+        while (begin < count)
+        {
+            const int tile_idx = get_tile_idx(xs[begin], zs[begin]);
+            size_t end = begin + 1;
+            while (end < count && get_tile_idx(xs[end], zs[end]) == tile_idx)
+            {
+                end++;
+            }
+
+            const TerrainHeightField *const height_field = get_height_field(tile_idx);
+            if (likely(height_field != nullptr))
+            {
+                height_field->get_normals(xs + begin,
+                                          zs + begin,
+                                          end - begin,
+                                          normal_xs + begin,
+                                          normal_ys + begin,
+                                          normal_zs + begin,
+                                          slopes + begin);
+            }
+            else
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    TerrainHeightField::get_normal(sample_file(xs[i], zs[i]),
+                                                   normal_xs[i],
+                                                   normal_ys[i],
+                                                   normal_zs[i],
+                                                   slopes[i]);
+                }
+            }
+
+            begin = end;
+        }
+    }
+
+    /**
+     * @brief Read a tile into memory and build its height field. Its mesh is already built
+     * in the file and is uploaded from there. Runs on the job system.
+     *
+     * @param file File to read the tile from.
+     * @param[in,out] tile Tile whose index is set, to fill in.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainStreamer::load_tile(const TerrainTileFile &file, LoadedTile &tile)
+    {
+        const int tile_x = tile.tile_idx % file.get_num_tiles_x();
+        const int tile_z = tile.tile_idx / file.get_num_tiles_x();
+        const TerrainTileFile::TileRect rect = file.get_tile_rect(tile_x, tile_z);
+
+        /*
+         * Fault the whole record in here rather than in the upload on the GL thread.
+         */
+        file.prefetch_tile(tile_x, tile_z);
+        ASSERT_RET_IF_NOT(file.get_tile_geometry(tile_x, tile_z, tile.geometry), false);
+
+        std::vector<float> heights(static_cast<size_t>(rect.num_rows) * rect.num_cols);
+        file.read_heights(
+            rect.row_begin, rect.col_begin, rect.num_rows, rect.num_cols, heights.data());
+
+        const glm::vec2 origin = file.get_origin();
+        tile.height_field = std::make_unique<TerrainHeightField>();
+        ASSERT_RET_IF_NOT(tile.height_field->create(std::move(heights),
+                                                    rect.num_rows,
+                                                    rect.num_cols,
+                                                    -(origin.x + rect.col_begin),
+                                                    -(origin.y + rect.row_begin)),
+                          false);
+
+        return true;
+    }
+
+    /**
+     * @return Index of the tile the point at given (x, z) world coordinates is on, with
+     * points off the terrain clamped onto its border.
+     *
+     * @param x X world coordinate.
+     * @param z Z world coordinate.
+     */
+    int TerrainStreamer::get_tile_idx(const float x, const float z) const
+    {
+        const glm::vec2 origin = file->get_origin();
+        const float tile_size = file->get_tile_size();
+        const int tile_x = std::clamp(static_cast<int>(std::floor((x - origin.x) / tile_size)),
+                                      0,
+                                      file->get_num_tiles_x() - 1);
+        const int tile_z = std::clamp(static_cast<int>(std::floor((z - origin.y) / tile_size)),
+                                      0,
+                                      file->get_num_tiles_z() - 1);
+        return tile_z * file->get_num_tiles_x() + tile_x;
+    }
+
+    /**
+     * @param tile_idx Index of a tile.
+     * @param focus Point to measure from.
+     *
+     * @return Distance along the X-Z plane from the point to the nearest point of the tile.
+     */
+    float TerrainStreamer::get_distance(const int tile_idx, const glm::vec3 &focus) const
+    {
+        const TerrainTileFile::TileRect rect = file->get_tile_rect(
+            tile_idx % file->get_num_tiles_x(), tile_idx / file->get_num_tiles_x());
+        const glm::vec2 rect_min =
+            file->get_origin() + glm::vec2(rect.col_begin, rect.row_begin);
+        const glm::vec2 rect_max = rect_min + glm::vec2(rect.num_cols - 1, rect.num_rows - 1);
+        const glm::vec2 point(focus.x, focus.z);
+        return glm::distance(point, glm::clamp(point, rect_min, rect_max));
+    }
+
+    /**
+     * @brief Start loading the nearest tiles in range which are neither resident nor
+     * pending, as long as there is room for more pending tiles.
+     *
+     * @param focus Point to stream the tiles around.
+     * @param max_num_pending Number of tiles which may be pending at once.
+     */
+    void TerrainStreamer::schedule_loads(const glm::vec3 &focus, const size_t max_num_pending)
+    {
+        if (pending_tiles.size() >= max_num_pending)
+        {
+            return;
+        }
+
+        const int min_tile_idx = get_tile_idx(focus.x - load_distance, focus.z - load_distance);
+        const int max_tile_idx = get_tile_idx(focus.x + load_distance, focus.z + load_distance);
+        const int num_tiles_x = file->get_num_tiles_x();
+
+        candidate_tiles.clear();
+        for (int tile_z = min_tile_idx / num_tiles_x; tile_z <= max_tile_idx / num_tiles_x;
+             tile_z++)
+        {
+            for (int tile_x = min_tile_idx % num_tiles_x; tile_x <= max_tile_idx % num_tiles_x;
+                 tile_x++)
+            {
+                const int tile_idx = tile_z * num_tiles_x + tile_x;
+                const float distance = get_distance(tile_idx, focus);
+                if (distance < load_distance && tile_slots[tile_idx] == no_slot &&
+                    std::find(pending_tiles.begin(), pending_tiles.end(), tile_idx) ==
+                        pending_tiles.end())
+                {
+                    candidate_tiles.emplace_back(distance, tile_idx);
+                }
+            }
+        }
+        std::sort(candidate_tiles.begin(), candidate_tiles.end());
+
+        JobSystem &job_system = JobSystem::get();
+        for (const auto &[distance, tile_idx] : candidate_tiles)
+        {
+            if (pending_tiles.size() >= max_num_pending)
+            {
+                break;
+            }
+
+            pending_tiles.push_back(tile_idx);
+            job_system.run_background(
+                [this, tile_idx = tile_idx]() {
+                    LoadedTile tile;
+                    tile.tile_idx = tile_idx;
+                    tile.is_loaded = load_tile(*file, tile);
+
+                    std::lock_guard<std::mutex> lock(loaded_mutex);
+                    loaded_tiles.push_back(std::move(tile));
+                },
+                &load_counter);
+        }
+    }
+
+    /**
+     * @brief Find a slot for a tile to be uploaded to: a free one, or else the one holding
+     * the furthest tile out of range, which is evicted.
+     *
+     * @param focus Point to stream the tiles around.
+     *
+     * @return The slot, or no_slot if every slot holds a tile in range.
+     */
+    int TerrainStreamer::find_slot(const glm::vec3 &focus)
+    {
+        int furthest_slot = no_slot;
+        float furthest_distance = load_distance;
+        for (size_t slot = 0; slot < slots.size(); slot++)
+        {
+            if (slots[slot].tile_idx == no_tile)
+            {
+                return slot;
+            }
+
+            const float distance = get_distance(slots[slot].tile_idx, focus);
+            if (distance >= furthest_distance)
+            {
+                furthest_slot = slot;
+                furthest_distance = distance;
+            }
+        }
+
+        if (furthest_slot != no_slot)
+        {
+            evict(furthest_slot);
+        }
+
+        return furthest_slot;
+    }
+
+    /**
+     * @brief Upload a loaded tile into a free slot and make it resident.
+     *
+     * @param tile Loaded tile, whose height field is taken.
+     * @param slot Free slot.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainStreamer::install(LoadedTile &tile, const size_t slot)
+    {
+        ASSERT_RET_IF_NOT(mesh.set_tile(slot, tile.geometry), false);
+        num_resident_tiles++;
+
+        /*
+         * The mesh and the height field have their own copies of the tile now.
+         */
+        file->release_tile(tile.tile_idx % file->get_num_tiles_x(),
+                           tile.tile_idx / file->get_num_tiles_x());
+
+        {
+            std::unique_lock<std::shared_mutex> lock(slots_mutex);
+            slots[slot].tile_idx = tile.tile_idx;
+            slots[slot].height_field = std::move(tile.height_field);
+            tile_slots[tile.tile_idx] = slot;
+        }
+
+        remove_pending(tile.tile_idx);
+
+        return true;
+    }
+
+    /**
+     * @brief Drop the tile in a slot, freeing the slot.
+     *
+     * @param slot Slot holding a tile.
+     */
+    void TerrainStreamer::evict(const size_t slot)
+    {
+        const int tile_idx = slots[slot].tile_idx;
+        mesh.clear_tile(slot);
+        num_resident_tiles--;
+
+        /*
+         * The height field is freed after the lock is released.
+         */
+        std::unique_ptr<TerrainHeightField> height_field;
+        {
+            std::unique_lock<std::shared_mutex> lock(slots_mutex);
+            height_field = std::move(slots[slot].height_field);
+            slots[slot].tile_idx = no_tile;
+            tile_slots[tile_idx] = no_slot;
+        }
+    }
+
+    /**
+     * @brief Forget that a tile is pending.
+     *
+     * @param tile_idx Index of the tile.
+     */
+    void TerrainStreamer::remove_pending(const int tile_idx)
+    {
+        const auto it = std::find(pending_tiles.begin(), pending_tiles.end(), tile_idx);
+        if (it != pending_tiles.end())
+        {
+            pending_tiles.erase(it);
+        }
+    }
+
+    /**
+     * @brief Sample the terrain at a point straight from the file, the same way as
+     * TerrainHeightField, for points on tiles which are not resident. Only the corners of
+     * the cell the point is in are read. Safe to call without holding the slots mutex.
+     *
+     * @param x X world coordinate.
+     * @param z Z world coordinate.
+     *
+     * @return Height at the point and the slopes of its triangle.
+     */
+    TerrainHeightField::Sample TerrainStreamer::sample_file(const float x, const float z) const
+    {
+        const glm::vec2 origin = file->get_origin();
+        const int num_rows = file->get_num_rows();
+        const int num_cols = file->get_num_cols();
+        const float x_terrain = std::clamp(x - origin.x, 0.f, num_cols - 1.f);
+        const float z_terrain = std::clamp(z - origin.y, 0.f, num_rows - 1.f);
+
+        /*
+         * Corners are picked with floor and ceil like TerrainHeightField picks them, within
+         * the 2x2 block of vertices read.
+         */
+        const float x_floor = std::floor(x_terrain);
+        const float z_floor = std::floor(z_terrain);
+        const int col = std::min(static_cast<int>(x_floor), num_cols - 2);
+        const int row = std::min(static_cast<int>(z_floor), num_rows - 2);
+        const int left = static_cast<int>(x_floor) - col;
+        const int right = static_cast<int>(std::ceil(x_terrain)) - col;
+        const int down = static_cast<int>(z_floor) - row;
+        const int up = static_cast<int>(std::ceil(z_terrain)) - row;
+
+        float heights[4];
+        file->read_heights(row, col, 2, 2, heights);
+        return TerrainHeightField::sample_cell(heights[2 * down + left],
+                                               heights[2 * up + left],
+                                               heights[2 * up + right],
+                                               heights[2 * down + right],
+                                               x_terrain - x_floor,
+                                               z_terrain - z_floor);
+    }
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "TerrainHeightField.h"
+#include "TerrainMesh.h"
+#include "TerrainTileFile.h"
+
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Keeps the tiles of a terrain around a point resident, loading them from a
+     * TerrainTileFile in the background and dropping them once they are far away.
+     *
+     * Tiles within load_distance of the point are loaded, and are only dropped once they
+     * are further than unload_distance, so that moving back and forth across a tile border
+     * does not load the same tile over and over. Loading a tile reads it from the file and
+     * builds its height field in a background job; its mesh, which the file already holds,
+     * is then uploaded from the mapping into a slot, that is a tile of a TerrainMesh, on the
+     * GL thread, max_uploads_per_update tiles per update(). The mesh has just enough slots
+     * for every tile within load_distance, and tiles between the two distances give their
+     * slot up when one is needed, so both the GPU and the CPU memory of the terrain are
+     * bounded by the distances alone, however large the terrain is.
+     *
+     * Height queries go to the height fields of the resident tiles, and fall back to
+     * reading the heights straight from the file for points on tiles which are not. They
+     * may be made from any thread while the GL thread streams tiles in and out.
+     */
+    class TerrainStreamer
+    {
+    public:
+        TerrainStreamer();
+
+        ~TerrainStreamer();
+
+        TerrainStreamer(const TerrainStreamer &) = delete;
+        TerrainStreamer &operator=(const TerrainStreamer &) = delete;
+
+        bool init(const TerrainTileFile &_file);
+
+        bool update(const glm::vec3 &focus);
+
+        bool load_around(const glm::vec3 &focus);
+
+        float get_height(const float x, const float z) const;
+
+        void get_heights(const float *xs,
+                         const float *zs,
+                         const size_t count,
+                         float *heights) const;
+
+        void get_normals(const float *xs,
+                         const float *zs,
+                         const size_t count,
+                         float *normal_xs,
+                         float *normal_ys,
+                         float *normal_zs,
+                         float *slopes) const;
+
+        /**
+         * @return Mesh of the resident tiles.
+         */
+        TerrainMesh &get_mesh()
+        {
+            return mesh;
+        }
+
+        /**
+         * @return File the tiles are streamed from.
+         */
+        const TerrainTileFile &get_file() const
+        {
+            return *file;
+        }
+
+        /**
+         * @return Number of tiles which are resident.
+         */
+        size_t get_num_resident_tiles() const
+        {
+            return num_resident_tiles;
+        }
+
+        /**
+         * @return Number of tiles being loaded or waiting to be uploaded.
+         */
+        size_t get_num_pending_tiles() const
+        {
+            return pending_tiles.size();
+        }
+
+    private:
+        /**
+         * Tiles are loaded within this distance of the point they are streamed around,
+         * and dropped beyond the larger distance.
+         * @{
+         */
+        static constexpr float load_distance = 1536.f;
+        static constexpr float unload_distance = 2048.f;
+        static_assert(unload_distance > load_distance);
+        /**
+         * @}
+         */
+
+        /**
+         * Number of tiles which may be loading or waiting to be uploaded at once while
+         * streaming, which bounds the memory of tiles in flight.
+         */
+        static constexpr size_t max_num_pending_tiles = 2;
+
+        /**
+         * Number of tiles uploaded per update, to spread the cost of a burst of tiles over
+         * several frames.
+         */
+        static constexpr size_t max_uploads_per_update = 1;
+
+        static constexpr int no_tile = -1;
+        static constexpr int no_slot = -1;
+
+        /**
+         * @brief A tile loaded on the job system, ready to be uploaded.
+         */
+        struct LoadedTile
+        {
+            int tile_idx;
+            bool is_loaded;
+            TerrainMesh::GeometryView geometry;
+            std::unique_ptr<TerrainHeightField> height_field;
+        };
+
+        /**
+         * @brief The resident tile in a slot of the mesh, if any.
+         */
+        struct Slot
+        {
+            int tile_idx = no_tile;
+            std::unique_ptr<TerrainHeightField> height_field;
+        };
+
+        static bool load_tile(const TerrainTileFile &file, LoadedTile &tile);
+
+        int get_tile_idx(const float x, const float z) const;
+
+        float get_distance(const int tile_idx, const glm::vec3 &focus) const;
+
+        bool stream(const glm::vec3 &focus,
+                    const size_t max_num_pending,
+                    const size_t max_num_uploads);
+
+        void schedule_loads(const glm::vec3 &focus, const size_t max_num_pending);
+
+        int find_slot(const glm::vec3 &focus);
+
+        bool install(LoadedTile &tile, const size_t slot);
+
+        void evict(const size_t slot);
+
+        void remove_pending(const int tile_idx);
+
+        TerrainHeightField::Sample sample_file(const float x, const float z) const;
+
+        /**
+         * @return Height field of a tile if it is resident, otherwise null. The slots
+         * mutex must be held.
+         */
+        const TerrainHeightField *get_height_field(const int tile_idx) const
+        {
+            const int slot = tile_slots[tile_idx];
+            return slot == no_slot ? nullptr : slots[slot].height_field.get();
+        }
+
+        const TerrainTileFile *file;
+
+        TerrainMesh mesh;
+
+        /**
+         * Slot of every tile, or no_slot if it is not resident, and the tile in every
+         * slot. Written only on the GL thread with the mutex held exclusively, and read by
+         * height queries with it shared.
+         * @{
+         */
+        std::vector<int32_t> tile_slots;
+        std::vector<Slot> slots;
+        mutable std::shared_mutex slots_mutex;
+        /**
+         * @}
+         */
+
+        size_t num_resident_tiles;
+
+        /**
+         * Tiles being loaded or waiting to be uploaded.
+         */
+        std::vector<int> pending_tiles;
+
+        /**
+         * Tiles loaded by the job system which have not been picked up by the GL thread.
+         * @{
+         */
+        std::mutex loaded_mutex;
+        std::vector<LoadedTile> loaded_tiles;
+        /**
+         * @}
+         */
+
+        /**
+         * Tiles picked up by the GL thread, waiting for their turn to be uploaded.
+         */
+        std::vector<LoadedTile> ready_tiles;
+
+        /**
+         * Tiles in range which are neither resident nor pending, nearest first, kept to
+         * avoid allocating on every update.
+         */
+        std::vector<std::pair<float, int>> candidate_tiles;
+
+        /**
+         * Load jobs in flight.
+         */
+        JobSystem::Counter load_counter;
+    };
+}
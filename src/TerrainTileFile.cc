@@ -0,0 +1,654 @@
+#include "TerrainTileFile.h"
+
+#include "Heightmap.h"
+#include "assert_util.h"
+#include "log.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace Engine
+{
+    static constexpr char magic[8] = {'E', 'N', 'G', 'T', 'I', 'L', 'E', '\0'};
+
+    /**
+     * @return @p offset rounded up to a multiple of @p alignment.
+     */
+    static constexpr uint64_t align_up(const uint64_t offset, const uint64_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    /**
+     * @brief Constructor.
+     */
+    TerrainTileFile::TerrainTileFile():
+        mapping(nullptr),
+        mapping_size(0),
+        header(nullptr),
+        record_layout {},
+        num_rows(0),
+        num_cols(0),
+        origin(0.f),
+        tile_size(0),
+        num_tiles_x(0),
+        num_tiles_z(0)
+    {}
+
+    /**
+     * @brief Destructor.
+     */
+    TerrainTileFile::~TerrainTileFile()
+    {
+        close();
+    }
+
+    /**
+     * @brief Compute the 64-bit FNV-1a hash of the contents of a file.
+     *
+     * @param path Path to the file.
+     * @param[out] hash Hash of the file.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainTileFile::hash_file(const std::string &path, uint64_t &hash)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            LOG_ERROR("Failed to open %s\n", path.c_str());
+            return false;
+        }
+
+        hash = 0xcbf29ce484222325;
+        std::array<char, 1 << 16> buffer;
+        while (file)
+        {
+            file.read(buffer.data(), buffer.size());
+            const std::streamsize count = file.gcount();
+            for (std::streamsize i = 0; i < count; i++)
+            {
+                hash ^= static_cast<uint8_t>(buffer[i]);
+                hash *= 0x100000001b3;
+            }
+        }
+
+        return file.eof();
+    }
+
+    /**
+     * @return Header with the magic, version and key filled in and everything else zeroed.
+     */
+    TerrainTileFile::Header TerrainTileFile::make_header(const Key &key)
+    {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.header_size = sizeof(Header);
+        header.key = key;
+        return header;
+    }
+
+    /**
+     * @param _tile_size Number of cells along each side of a tile.
+     *
+     * @return Layout of the records of tiles of the given size, with room for the mesh of
+     * a full tile.
+     */
+    TerrainTileFile::RecordLayout TerrainTileFile::get_record_layout(const int _tile_size)
+    {
+        static constexpr uint64_t part_alignment = 64;
+
+        const uint64_t record_side = _tile_size + 1;
+        const size_t chunks_per_side =
+            (_tile_size + TerrainMesh::chunk_size - 1) / TerrainMesh::chunk_size;
+
+        RecordLayout layout;
+        layout.max_num_chunks = chunks_per_side * chunks_per_side;
+        layout.tile_header_offset =
+            align_up(record_side * record_side * sizeof(uint16_t), part_alignment);
+        layout.chunks_offset =
+            align_up(layout.tile_header_offset + sizeof(TileHeader), part_alignment);
+        layout.vertices_offset =
+            align_up(layout.chunks_offset + layout.max_num_chunks * sizeof(TerrainMesh::Chunk),
+                     part_alignment);
+        layout.size = align_up(layout.vertices_offset + layout.max_num_chunks *
+                                                            TerrainMesh::chunk_num_vertices *
+                                                            sizeof(TerrainVertex),
+                               record_alignment);
+        return layout;
+    }
+
+    /**
+     * @brief Build the mesh of a tile from the heights it is read back with. One more
+     * vertex is used on every side the grid goes on, so that the normals along the edges
+     * of the tile are the same as those of its neighbours.
+     *
+     * @param heights Quantized and decoded height grid in row-major order, which may be a
+     * band of the whole grid.
+     * @param num_rows Number of rows in the height grid.
+     * @param num_cols Number of columns in the height grid.
+     * @param origin World position of the first vertex of @p heights along X and Z.
+     * @param rect Vertices of the tile in @p heights.
+     * @param[out] geometry Mesh of the tile.
+     *
+     * @return True on success, otherwise false.
+     */
+    static bool build_tile_geometry(const float *heights,
+                                    const int num_rows,
+                                    const int num_cols,
+                                    const glm::vec2 &origin,
+                                    const TerrainTileFile::TileRect &rect,
+                                    TerrainMesh::Geometry &geometry)
+    {
+        const int row_begin = std::max(rect.row_begin - 1, 0);
+        const int col_begin = std::max(rect.col_begin - 1, 0);
+        const int row_end = std::min(rect.row_begin + rect.num_rows + 1, num_rows);
+        const int col_end = std::min(rect.col_begin + rect.num_cols + 1, num_cols);
+        const int apron_num_rows = row_end - row_begin;
+        const int apron_num_cols = col_end - col_begin;
+
+        std::vector<Vertex3dNormal> vertices(static_cast<size_t>(apron_num_rows) *
+                                             apron_num_cols);
+        for (int row = 0; row < apron_num_rows; row++)
+        {
+            const float *const src =
+                heights + static_cast<size_t>(row_begin + row) * num_cols + col_begin;
+            Vertex3dNormal *const dst = vertices.data() + static_cast<size_t>(row) * apron_num_cols;
+            for (int col = 0; col < apron_num_cols; col++)
+            {
+                dst[col].position = {
+                    origin.x + col_begin + col,
+                    src[col],
+                    origin.y + row_begin + row,
+                };
+            }
+        }
+        Heightmap::compute_normals(vertices.data(), apron_num_rows, apron_num_cols);
+
+        /*
+         * Crop the border off again.
+         */
+        const int row_offset = rect.row_begin - row_begin;
+        const int col_offset = rect.col_begin - col_begin;
+        std::vector<Vertex3dNormal> tile_vertices;
+        tile_vertices.reserve(static_cast<size_t>(rect.num_rows) * rect.num_cols);
+        for (int row = 0; row < rect.num_rows; row++)
+        {
+            const size_t i = static_cast<size_t>(row + row_offset) * apron_num_cols + col_offset;
+            tile_vertices.insert(
+                tile_vertices.end(), vertices.begin() + i, vertices.begin() + i + rect.num_cols);
+        }
+
+        return TerrainMesh::build(tile_vertices.data(), rect.num_rows, rect.num_cols, geometry);
+    }
+
+    /**
+     * @brief Split a height grid into tiles, build their meshes and write them to a file.
+     * The grid is read one band of tile rows at a time, so that only a band of it is ever
+     * held in memory. The file is written under a temporary name and then renamed, so a
+     * crash never leaves a partial file behind.
+     *
+     * @param path Path to the file.
+     * @param key Key of the heights.
+     * @param get_rows Source of the height grid.
+     * @param _num_rows Number of rows in the height grid.
+     * @param _num_cols Number of columns in the height grid.
+     * @param _origin World position of the first vertex along X and Z.
+     * @param height_min Lowest height the grid may have.
+     * @param height_range Range of heights above @p height_min the grid may have. Heights
+     * outside of the range are clamped to it.
+     * @param _tile_size Number of cells along each side of a tile.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainTileFile::write(const std::string &path,
+                                const Key &key,
+                                const RowSource &get_rows,
+                                const int _num_rows,
+                                const int _num_cols,
+                                const glm::vec2 &_origin,
+                                const float height_min,
+                                const float height_range,
+                                const int _tile_size)
+    {
+        ASSERT_RET_IF(_num_rows < 2 || _num_cols < 2 || _tile_size < 1, false);
+        ASSERT_RET_IF(height_range < 0.f, false);
+
+        const int record_side = _tile_size + 1;
+        const RecordLayout layout = get_record_layout(_tile_size);
+        Header header = make_header(key);
+        header.num_rows = _num_rows;
+        header.num_cols = _num_cols;
+        header.origin_x = _origin.x;
+        header.origin_z = _origin.y;
+        header.tile_size = _tile_size;
+        header.num_tiles_x = (_num_cols - 1 + _tile_size - 1) / _tile_size;
+        header.num_tiles_z = (_num_rows - 1 + _tile_size - 1) / _tile_size;
+        header.height_min = height_min;
+        header.height_range = height_range;
+        header.tiles_offset = align_up(sizeof(Header), record_alignment);
+        header.record_size = layout.size;
+        header.file_size = header.tiles_offset + static_cast<uint64_t>(header.num_tiles_x) *
+                                                     header.num_tiles_z * header.record_size;
+
+        const std::string tmp_path = path + ".tmp";
+        std::FILE *file = std::fopen(tmp_path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            LOG_ERROR("Failed to open %s: %s\n", tmp_path.c_str(), std::strerror(errno));
+            return false;
+        }
+
+        std::vector<uint8_t> padding(header.tiles_offset - sizeof(Header));
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(padding.data(), 1, padding.size(), file) == padding.size();
+
+        /*
+         * A band is a row of tiles plus one more row on either side the grid goes on, for
+         * the normals along the edges of the tiles. The meshes are built from the heights
+         * as they are read back, so that they match the height fields exactly.
+         */
+        const float scale = height_range > 0.f ? UINT16_MAX / height_range : 0.f;
+        const float inverse_scale = height_range / UINT16_MAX;
+        const size_t max_band_size = static_cast<size_t>(record_side + 2) * _num_cols;
+        std::vector<float> band_heights(max_band_size);
+        std::vector<uint16_t> quantized_heights(max_band_size);
+
+        /*
+         * Samples of a record past the edges of a smaller tile, and room past the mesh of a
+         * tile with fewer chunks, are left at zero.
+         */
+        std::vector<uint8_t> record(header.record_size);
+        TerrainMesh::Geometry geometry;
+        for (int tile_z = 0; ok && tile_z < header.num_tiles_z; tile_z++)
+        {
+            const int row_begin = tile_z * _tile_size;
+            const int num_rows = std::min(record_side, _num_rows - row_begin);
+            const int band_row_begin = std::max(row_begin - 1, 0);
+            const int band_num_rows =
+                std::min(row_begin + num_rows + 1, _num_rows) - band_row_begin;
+            const size_t band_size = static_cast<size_t>(band_num_rows) * _num_cols;
+
+            get_rows(band_row_begin, band_num_rows, band_heights.data());
+            for (size_t i = 0; i < band_size; i++)
+            {
+                const float t = std::clamp(band_heights[i] - height_min, 0.f, height_range);
+                quantized_heights[i] = static_cast<uint16_t>(std::lround(t * scale));
+                band_heights[i] = height_min + quantized_heights[i] * inverse_scale;
+            }
+
+            for (int tile_x = 0; ok && tile_x < header.num_tiles_x; tile_x++)
+            {
+                std::fill(record.begin(), record.end(), 0);
+
+                /*
+                 * The rectangle of the tile within the band.
+                 */
+                const TileRect rect = {
+                    .row_begin = row_begin - band_row_begin,
+                    .col_begin = tile_x * _tile_size,
+                    .num_rows = num_rows,
+                    .num_cols = std::min(record_side, _num_cols - tile_x * _tile_size),
+                };
+                uint16_t *const record_heights = reinterpret_cast<uint16_t *>(record.data());
+                for (int row = 0; row < rect.num_rows; row++)
+                {
+                    std::copy_n(quantized_heights.data() +
+                                    static_cast<size_t>(rect.row_begin + row) * _num_cols +
+                                    rect.col_begin,
+                                rect.num_cols,
+                                record_heights + row * record_side);
+                }
+
+                ok = build_tile_geometry(band_heights.data(),
+                                         band_num_rows,
+                                         _num_cols,
+                                         _origin + glm::vec2(0.f, band_row_begin),
+                                         rect,
+                                         geometry) &&
+                     geometry.chunks.size() <= layout.max_num_chunks;
+                if (unlikely(!ok))
+                {
+                    LOG_ERROR("Failed to build terrain tile (%d, %d)\n", tile_x, tile_z);
+                    break;
+                }
+
+                const TileHeader tile_header = {
+                    .layout = geometry.layout,
+                    .num_chunks = static_cast<uint32_t>(geometry.chunks.size()),
+                    .num_vertices = static_cast<uint32_t>(geometry.vertices.size()),
+                };
+                std::memcpy(record.data() + layout.tile_header_offset,
+                            &tile_header,
+                            sizeof(tile_header));
+                std::memcpy(record.data() + layout.chunks_offset,
+                            geometry.chunks.data(),
+                            geometry.chunks.size() * sizeof(TerrainMesh::Chunk));
+                std::memcpy(record.data() + layout.vertices_offset,
+                            geometry.vertices.data(),
+                            geometry.vertices.size() * sizeof(TerrainVertex));
+
+                ok = std::fwrite(record.data(), 1, header.record_size, file) ==
+                     header.record_size;
+            }
+        }
+
+        ok = (std::fclose(file) == 0) && ok;
+        if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+        {
+            LOG_ERROR("Failed to write %s: %s\n", path.c_str(), std::strerror(errno));
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+
+        LOG("Wrote terrain tiles %s: %d x %d tiles (%" PRIu64 " MB)\n",
+            path.c_str(),
+            header.num_tiles_x,
+            header.num_tiles_z,
+            header.file_size >> 20);
+
+        return true;
+    }
+
+    /**
+     * @brief Map a tile file into memory and check that it matches the given key. Nothing
+     * is read until tiles are asked for.
+     *
+     * @param path Path to the file.
+     * @param key Key the file must match.
+     *
+     * @return True if the file can be used, otherwise false, which includes the file not
+     * existing.
+     */
+    bool TerrainTileFile::open(const std::string &path, const Key &key)
+    {
+        close();
+
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            LOG("No terrain tiles at %s\n", path.c_str());
+            return false;
+        }
+
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(Header))
+        {
+            LOG_WARN("Terrain tiles %s are truncated\n", path.c_str());
+            ::close(fd);
+            return false;
+        }
+
+        mapping_size = file_stat.st_size;
+        mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            LOG_ERROR("Failed to map %s: %s\n", path.c_str(), std::strerror(errno));
+            mapping = nullptr;
+            mapping_size = 0;
+            return false;
+        }
+
+        header = static_cast<const Header *>(mapping);
+
+        const bool is_key_valid = std::memcmp(header->magic, magic, sizeof(magic)) == 0 &&
+                                  header->version == version &&
+                                  header->header_size == sizeof(Header) &&
+                                  header->key.source_hash == key.source_hash &&
+                                  header->key.blur_iterations == key.blur_iterations &&
+                                  header->key.y_scale == key.y_scale &&
+                                  header->key.y_bottom == key.y_bottom;
+        if (!is_key_valid)
+        {
+            LOG("Terrain tiles %s are stale\n", path.c_str());
+            close();
+            return false;
+        }
+
+        const bool is_size_valid =
+            header->num_rows >= 2 && header->num_cols >= 2 && header->tile_size >= 1 &&
+            header->num_tiles_x == (header->num_cols - 1 + header->tile_size - 1) /
+                                       header->tile_size &&
+            header->num_tiles_z == (header->num_rows - 1 + header->tile_size - 1) /
+                                       header->tile_size &&
+            header->tiles_offset % record_alignment == 0 &&
+            header->record_size % record_alignment == 0 &&
+            header->record_size == get_record_layout(header->tile_size).size &&
+            header->file_size == mapping_size &&
+            header->tiles_offset + static_cast<uint64_t>(header->num_tiles_x) *
+                                       header->num_tiles_z * header->record_size <=
+                mapping_size;
+        if (!is_size_valid)
+        {
+            LOG_WARN("Terrain tiles %s are corrupt\n", path.c_str());
+            close();
+            return false;
+        }
+
+        record_layout = get_record_layout(header->tile_size);
+        num_rows = header->num_rows;
+        num_cols = header->num_cols;
+        origin = glm::vec2(header->origin_x, header->origin_z);
+        tile_size = header->tile_size;
+        num_tiles_x = header->num_tiles_x;
+        num_tiles_z = header->num_tiles_z;
+
+        LOG("Opened terrain tiles %s: %d x %d vertices in %d x %d tiles\n",
+            path.c_str(),
+            num_cols,
+            num_rows,
+            num_tiles_x,
+            num_tiles_z);
+
+        return true;
+    }
+
+    /**
+     * @brief Unmap the file.
+     */
+    void TerrainTileFile::close()
+    {
+        if (mapping != nullptr)
+        {
+            munmap(mapping, mapping_size);
+        }
+
+        mapping = nullptr;
+        mapping_size = 0;
+        header = nullptr;
+        record_layout = {};
+        num_rows = 0;
+        num_cols = 0;
+        origin = glm::vec2(0.f);
+        tile_size = 0;
+        num_tiles_x = 0;
+        num_tiles_z = 0;
+    }
+
+    /**
+     * @param tile_x Index of the tile along X.
+     * @param tile_z Index of the tile along Z.
+     *
+     * @return Vertices of the tile.
+     */
+    TerrainTileFile::TileRect TerrainTileFile::get_tile_rect(const int tile_x,
+                                                             const int tile_z) const
+    {
+        const int row_begin = tile_z * tile_size;
+        const int col_begin = tile_x * tile_size;
+        return {
+            .row_begin = row_begin,
+            .col_begin = col_begin,
+            .num_rows = std::min(tile_size + 1, num_rows - row_begin),
+            .num_cols = std::min(tile_size + 1, num_cols - col_begin),
+        };
+    }
+
+    /**
+     * @brief Decode the heights of a block of vertices, which may span several tiles. Safe
+     * to call from any thread.
+     *
+     * @param row_begin First row of the block.
+     * @param col_begin First column of the block.
+     * @param _num_rows Number of rows in the block.
+     * @param _num_cols Number of columns in the block.
+     * @param[out] heights Heights of the block in row-major order.
+     */
+    void TerrainTileFile::read_heights(const int row_begin,
+                                       const int col_begin,
+                                       const int _num_rows,
+                                       const int _num_cols,
+                                       float *heights) const
+    {
+        if (unlikely(row_begin < 0 || col_begin < 0 || row_begin + _num_rows > num_rows ||
+                     col_begin + _num_cols > num_cols))
+        {
+            LOG_ERROR("Block of %d x %d heights at (%d, %d) is outside the %d x %d terrain\n",
+                      _num_cols,
+                      _num_rows,
+                      col_begin,
+                      row_begin,
+                      num_cols,
+                      num_rows);
+            return;
+        }
+
+        const int record_side = tile_size + 1;
+        const float height_min = header->height_min;
+        const float scale = header->height_range / UINT16_MAX;
+        for (int row = 0; row < _num_rows; row++)
+        {
+            /*
+             * Vertices on the shared edge of two tiles are taken from the first, except on
+             * the far edges of the terrain where there is no next tile.
+             */
+            const int grid_row = row_begin + row;
+            const int tile_z = std::min(grid_row / tile_size, num_tiles_z - 1);
+            const int tile_row = grid_row - tile_z * tile_size;
+            float *const out = heights + static_cast<size_t>(row) * _num_cols;
+
+            int col = 0;
+            while (col < _num_cols)
+            {
+                const int grid_col = col_begin + col;
+                const int tile_x = std::min(grid_col / tile_size, num_tiles_x - 1);
+                const int tile_col = grid_col - tile_x * tile_size;
+                const int count = std::min(_num_cols - col, record_side - tile_col);
+
+                const uint16_t *const src =
+                    get_tile_heights(tile_x, tile_z) + tile_row * record_side + tile_col;
+                for (int i = 0; i < count; i++)
+                {
+                    out[col + i] = height_min + src[i] * scale;
+                }
+                col += count;
+            }
+        }
+    }
+
+    /**
+     * @brief Get the mesh of a tile, pointing straight into the mapping. Safe to call from
+     * any thread.
+     *
+     * @param tile_x Index of the tile along X.
+     * @param tile_z Index of the tile along Z.
+     * @param[out] geometry Mesh of the tile, valid until the file is closed.
+     *
+     * @return True on success, otherwise false.
+     */
+    bool TerrainTileFile::get_tile_geometry(const int tile_x,
+                                            const int tile_z,
+                                            TerrainMesh::GeometryView &geometry) const
+    {
+        const uint8_t *const record = get_record(tile_x, tile_z);
+        const TileHeader *const tile_header =
+            reinterpret_cast<const TileHeader *>(record + record_layout.tile_header_offset);
+        const TerrainMesh::Chunk *const chunks =
+            reinterpret_cast<const TerrainMesh::Chunk *>(record + record_layout.chunks_offset);
+
+        /*
+         * The shaders find the chunk of a vertex from its base vertex and the chunk grid
+         * from num_chunks_x, so both have to be laid out exactly as TerrainMesh::build()
+         * lays them out.
+         */
+        const uint32_t num_chunks = tile_header->num_chunks;
+        const int32_t num_chunks_x = tile_header->layout.num_chunks_x;
+        bool is_valid = num_chunks != 0 && num_chunks <= record_layout.max_num_chunks &&
+                        tile_header->num_vertices ==
+                            static_cast<uint64_t>(num_chunks) * TerrainMesh::chunk_num_vertices &&
+                        num_chunks_x > 0 && num_chunks % num_chunks_x == 0;
+        for (uint32_t i = 0; is_valid && i < num_chunks; i++)
+        {
+            is_valid = chunks[i].base_vertex ==
+                       static_cast<GLint>(i * TerrainMesh::chunk_num_vertices);
+        }
+        if (unlikely(!is_valid))
+        {
+            LOG_ERROR("Terrain tile (%d, %d) is corrupt\n", tile_x, tile_z);
+            return false;
+        }
+
+        geometry = {
+            .layout = tile_header->layout,
+            .vertices =
+                reinterpret_cast<const TerrainVertex *>(record + record_layout.vertices_offset),
+            .num_vertices = tile_header->num_vertices,
+            .chunks = chunks,
+            .num_chunks = num_chunks,
+        };
+
+        return true;
+    }
+
+    /**
+     * @brief Read every page of a tile into memory, so that using the tile afterwards does
+     * not wait on the disk. Safe to call from any thread.
+     *
+     * @param tile_x Index of the tile along X.
+     * @param tile_z Index of the tile along Z.
+     */
+    void TerrainTileFile::prefetch_tile(const int tile_x, const int tile_z) const
+    {
+        static const size_t page_size = sysconf(_SC_PAGESIZE);
+
+        const volatile uint8_t *const record = get_record(tile_x, tile_z);
+        for (uint64_t offset = 0; offset < header->record_size; offset += page_size)
+        {
+            record[offset];
+        }
+    }
+
+    /**
+     * @brief Drop the pages of a tile from memory, to be read from the file again the next
+     * time the tile is used.
+     *
+     * @param tile_x Index of the tile along X.
+     * @param tile_z Index of the tile along Z.
+     */
+    void TerrainTileFile::release_tile(const int tile_x, const int tile_z) const
+    {
+        void *const tile = const_cast<uint8_t *>(get_record(tile_x, tile_z));
+        if (unlikely(madvise(tile, header->record_size, MADV_DONTNEED) != 0))
+        {
+            LOG_WARN("Failed to release terrain tile (%d, %d): %s\n",
+                     tile_x,
+                     tile_z,
+                     std::strerror(errno));
+        }
+    }
+}
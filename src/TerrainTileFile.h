@@ -0,0 +1,269 @@
+#pragma once
+
+#include "TerrainMesh.h"
+
+#include <cstdint>
+#include <functional>
+#include <glm/vec2.hpp>
+#include <string>
+
+namespace Engine
+{
+    /**
+     * @brief Heights and meshes of a terrain split into square tiles, in a file which is
+     * memory-mapped rather than read, so that only the tiles in use are ever paged in.
+     *
+     * The terrain is a grid of vertices one unit apart. Tile (x, z) holds the vertices from
+     * (x * tile_size, z * tile_size) up to and including those tile_size further along each
+     * axis, so neighbouring tiles share their edge vertices. Tiles on the far edges of the
+     * grid are smaller, but every tile is stored in a record of the same size aligned to
+     * the page size, which makes finding a tile a multiplication and lets a tile which is
+     * no longer needed be dropped from memory on its own.
+     *
+     * Heights are quantized to 16 bits over the range the terrain may span. Every tile
+     * also holds its mesh as built by TerrainMesh::build() from those heights, ready to be
+     * uploaded straight from the mapping. The file is written from a heightmap once, and
+     * later launches only check its header against the key the heightmap would be
+     * processed with.
+     */
+    class TerrainTileFile
+    {
+    public:
+        /**
+         * @brief Everything the tiles are derived from. A file is only used if its key
+         * matches exactly.
+         */
+        struct Key
+        {
+            uint64_t source_hash;
+            int32_t blur_iterations;
+            float y_scale;
+            float y_bottom;
+        };
+
+        /**
+         * @brief Vertices of a tile in the grid of the whole terrain.
+         */
+        struct TileRect
+        {
+            int row_begin;
+            int col_begin;
+            int num_rows;
+            int num_cols;
+        };
+
+        TerrainTileFile();
+
+        ~TerrainTileFile();
+
+        TerrainTileFile(const TerrainTileFile &) = delete;
+        TerrainTileFile &operator=(const TerrainTileFile &) = delete;
+
+        static bool hash_file(const std::string &path, uint64_t &hash);
+
+        /**
+         * @brief Source of the heights of a grid, filling in a band of whole rows of it in
+         * row-major order.
+         */
+        using RowSource =
+            std::function<void(const int row_begin, const int num_rows, float *heights)>;
+
+        static bool write(const std::string &path,
+                          const Key &key,
+                          const RowSource &get_rows,
+                          const int _num_rows,
+                          const int _num_cols,
+                          const glm::vec2 &_origin,
+                          const float height_min,
+                          const float height_range,
+                          const int _tile_size);
+
+        bool open(const std::string &path, const Key &key);
+
+        void close();
+
+        TileRect get_tile_rect(const int tile_x, const int tile_z) const;
+
+        void read_heights(const int row_begin,
+                          const int col_begin,
+                          const int _num_rows,
+                          const int _num_cols,
+                          float *heights) const;
+
+        bool get_tile_geometry(const int tile_x,
+                               const int tile_z,
+                               TerrainMesh::GeometryView &geometry) const;
+
+        void prefetch_tile(const int tile_x, const int tile_z) const;
+
+        void release_tile(const int tile_x, const int tile_z) const;
+
+        /**
+         * @return Number of rows of vertices of the whole terrain.
+         */
+        int get_num_rows() const
+        {
+            return num_rows;
+        }
+
+        /**
+         * @return Number of columns of vertices of the whole terrain.
+         */
+        int get_num_cols() const
+        {
+            return num_cols;
+        }
+
+        /**
+         * @return World position of the first vertex along X and Z.
+         */
+        glm::vec2 get_origin() const
+        {
+            return origin;
+        }
+
+        /**
+         * @return Number of cells along each side of a full tile.
+         */
+        int get_tile_size() const
+        {
+            return tile_size;
+        }
+
+        /**
+         * @return Number of tiles along X.
+         */
+        int get_num_tiles_x() const
+        {
+            return num_tiles_x;
+        }
+
+        /**
+         * @return Number of tiles along Z.
+         */
+        int get_num_tiles_z() const
+        {
+            return num_tiles_z;
+        }
+
+    private:
+        /**
+         * Version of the file format. Bump whenever the header or the layout of the tiles
+         * changes.
+         */
+        static constexpr uint32_t version = 2;
+
+        /**
+         * Alignment of the tile records, the largest page size they are dropped from
+         * memory in.
+         */
+        static constexpr uint64_t record_alignment = 1 << 16;
+
+        /**
+         * @brief File header.
+         */
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t header_size;
+
+            Key key;
+
+            int32_t num_rows;
+            int32_t num_cols;
+            float origin_x;
+            float origin_z;
+            int32_t tile_size;
+            int32_t num_tiles_x;
+            int32_t num_tiles_z;
+
+            /**
+             * Heights are quantized over [height_min, height_min + height_range].
+             * @{
+             */
+            float height_min;
+            float height_range;
+            /**
+             * @}
+             */
+
+            /**
+             * Offset of the first tile record from the start of the file, and the size of
+             * each record.
+             * @{
+             */
+            uint64_t tiles_offset;
+            uint64_t record_size;
+            /**
+             * @}
+             */
+
+            uint64_t file_size;
+        };
+
+        /**
+         * @brief Start of the mesh of a tile, which its chunks and vertices follow.
+         */
+        struct TileHeader
+        {
+            TerrainMesh::Layout layout;
+            uint32_t num_chunks;
+            uint32_t num_vertices;
+        };
+
+        /**
+         * @brief Where the parts of a tile record are, as offsets from its start. The
+         * quantized heights come first.
+         */
+        struct RecordLayout
+        {
+            uint64_t tile_header_offset;
+            uint64_t chunks_offset;
+            uint64_t vertices_offset;
+            uint64_t size;
+
+            /**
+             * Number of chunks a tile has room for.
+             */
+            size_t max_num_chunks;
+        };
+
+        static Header make_header(const Key &key);
+
+        static RecordLayout get_record_layout(const int _tile_size);
+
+        /**
+         * @return Start of the record of a tile.
+         */
+        const uint8_t *get_record(const int tile_x, const int tile_z) const
+        {
+            return static_cast<const uint8_t *>(mapping) + header->tiles_offset +
+                   (static_cast<uint64_t>(tile_z) * num_tiles_x + tile_x) * header->record_size;
+        }
+
+        /**
+         * @return Quantized heights of a tile, row by row with tile_size + 1 per row.
+         */
+        const uint16_t *get_tile_heights(const int tile_x, const int tile_z) const
+        {
+            return reinterpret_cast<const uint16_t *>(get_record(tile_x, tile_z));
+        }
+
+        /**
+         * Memory mapping of the file, null if not open.
+         */
+        void *mapping;
+        size_t mapping_size;
+
+        const Header *header;
+        RecordLayout record_layout;
+
+        int num_rows;
+        int num_cols;
+        glm::vec2 origin;
+        int tile_size;
+        int num_tiles_x;
+        int num_tiles_z;
+    };
+}
@@ -1,10 +1,12 @@
 #pragma once
 
-#include "assert_util.h"
+#include "GLState.h"
+#include "TextureLoader.h"
+#include "log.h"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
-#include <stb/stb_image.h>
+#include <array>
 #include <string>
 
 namespace Engine
@@ -16,15 +18,41 @@ namespace Engine
         {}
 
         /**
-         * @brief Load texture from file into the given slot.
+         * @brief Texel a texture is filled with until its image has been loaded.
+         */
+        using Texel = std::array<uint8_t, 4>;
+
+        /**
+         * Placeholder for color textures.
+         */
+        static constexpr Texel placeholder_color = {0x80, 0x80, 0x80, 0xFF};
+
+        /**
+         * Placeholder for normal maps, a normal pointing straight out of the surface.
+         */
+        static constexpr Texel placeholder_normal = {0x80, 0x80, 0xFF, 0xFF};
+
+        /**
+         * @brief Create the texture in the given slot and load it from file in the
+         * background. The texture holds a single placeholder texel until the image has been
+         * uploaded.
          *
+         * @param loader Loader to load the image with.
          * @param file_name Path to the texture file.
+         * @param _slot Texture slot.
+         * @param placeholder Placeholder texel.
          *
          * @return True on success, otherwise false.
          */
-        bool create_from_file(const std::string &file_name, const uint8_t _slot)
+        bool create_from_file(TextureLoader &loader,
+                              const std::string &file_name,
+                              const uint8_t _slot,
+                              const Texel &placeholder = placeholder_color)
         {
             slot = _slot;
+            width = 1;
+            height = 1;
+            loaded = false;
 
             glGenTextures(1, &texture_id);
             glBindTexture(GL_TEXTURE_2D, texture_id);
@@ -43,24 +71,26 @@ namespace Engine
             glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &max_anistropy);
             glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, max_anistropy);
 
-            stbi_set_flip_vertically_on_load(1);
-            int channels;
-            uint8_t *texture_buffer = stbi_load(file_name.c_str(), &width, &height, &channels, 0);
-            ASSERT_RET_IF_NOT(texture_buffer, false);
-            const GLenum internal_format = (channels == 4) ? GL_RGBA8 : GL_RGB8;
-            const GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
             glTexImage2D(GL_TEXTURE_2D,
                          0,
-                         internal_format,
+                         GL_RGBA8,
                          width,
                          height,
                          0,
-                         format,
+                         GL_RGBA,
                          GL_UNSIGNED_BYTE,
-                         texture_buffer);
-            stbi_image_free(texture_buffer);
-
-            glGenerateMipmap(GL_TEXTURE_2D);
+                         placeholder.data());
+
+            loader.load(texture_id,
+                        GL_TEXTURE_2D,
+                        {file_name},
+                        true /* flip_vertically */,
+                        true /* generate_mipmap */,
+                        [this](const int _width, const int _height) {
+                            width = _width;
+                            height = _height;
+                            loaded = true;
+                        });
 
             LOG("Created texture %s id: %x, slot: %u\n", file_name.c_str(), texture_id, slot);
 
@@ -76,6 +106,24 @@ namespace Engine
             glBindTexture(GL_TEXTURE_2D, texture_id);
         }
 
+        /**
+         * @brief Use the texture unless it is already bound to its slot.
+         *
+         * @param state Tracked GL state.
+         */
+        void use(GLState &state) const
+        {
+            state.bind_texture(slot, GL_TEXTURE_2D, texture_id);
+        }
+
+        /**
+         * @return OpenGL texture ID.
+         */
+        GLuint get_id() const
+        {
+            return texture_id;
+        }
+
         /**
          * @return The texture slot.
          */
@@ -84,6 +132,14 @@ namespace Engine
             return slot;
         }
 
+        /**
+         * @return True once the image has replaced the placeholder, otherwise false.
+         */
+        bool is_loaded() const
+        {
+            return loaded;
+        }
+
         /**
          * @return Texture width in pixels.
          */
@@ -105,5 +161,6 @@ namespace Engine
         uint8_t slot;
         int width;
         int height;
+        bool loaded;
     };
 }
\ No newline at end of file
@@ -0,0 +1,407 @@
+#include "TextureLoader.h"
+
+#include "log.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stb/stb_image.h>
+
+namespace Engine
+{
+    /**
+     * Internal formats and formats of images by their number of channels, minus one.
+     * @{
+     */
+    static constexpr std::array<GLenum, 4> internal_formats = {
+        GL_R8,
+        GL_RG8,
+        GL_RGB8,
+        GL_RGBA8,
+    };
+    static constexpr std::array<GLenum, 4> formats = {
+        GL_RED,
+        GL_RG,
+        GL_RGB,
+        GL_RGBA,
+    };
+    /**
+     * @}
+     */
+
+    /**
+     * Swizzles of images by their number of channels, minus one, so that grayscale images
+     * sample as gray rather than red, and their second channel as alpha.
+     */
+    static constexpr std::array<std::array<GLint, 4>, 4> swizzles = {{
+        {GL_RED, GL_RED, GL_RED, GL_ONE},
+        {GL_RED, GL_RED, GL_RED, GL_GREEN},
+        {GL_RED, GL_GREEN, GL_BLUE, GL_ONE},
+        {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA},
+    }};
+
+    /**
+     * @brief Constructor.
+     */
+    TextureLoader::TextureLoader(): is_stopping(false), pixel_buffer(0)
+    {}
+
+    /**
+     * @brief Destructor. Waits for the images being decoded, skips those which have not
+     * started and drops everything not yet uploaded.
+     */
+    TextureLoader::~TextureLoader()
+    {
+        is_stopping = true;
+        JobSystem::get().wait(decode_counter);
+    }
+
+    /**
+     * @brief Create the pixel buffer. Must be called from the GL thread.
+     */
+    void TextureLoader::init()
+    {
+        glGenBuffers(1, &pixel_buffer);
+    }
+
+    /**
+     * @brief Queue a texture to be loaded. The texture must already exist and should hold
+     * a placeholder until it is loaded.
+     *
+     * @param texture OpenGL texture ID.
+     * @param target GL_TEXTURE_2D, or GL_TEXTURE_CUBE_MAP with one file per face in the
+     * order +X, -X, +Y, -Y, +Z, -Z.
+     * @param file_names Images to load.
+     * @param flip_vertically Whether to flip the images so the first row is the bottom.
+     * @param generate_mipmap Whether to generate mipmaps after uploading.
+     * @param on_loaded Called after the texture has been uploaded, may be empty.
+     */
+    void TextureLoader::load(const GLuint texture,
+                             const GLenum target,
+                             std::vector<std::string> file_names,
+                             const bool flip_vertically,
+                             const bool generate_mipmap,
+                             Callback on_loaded)
+    {
+        queue(texture,
+              target,
+              std::move(file_names),
+              flip_vertically,
+              generate_mipmap,
+              std::move(on_loaded),
+              false /* is_reload */);
+    }
+
+    /**
+     * @brief Queue the loaded textures made from any of the changed files to be loaded
+     * again. Must be called from the GL thread.
+     *
+     * @param changed_paths Paths to the changed files. Files no texture was loaded from are
+     * ignored.
+     */
+    void TextureLoader::reload(const std::vector<std::string> &changed_paths)
+    {
+        for (const Loaded &texture : loaded)
+        {
+            const bool is_affected = std::any_of(
+                changed_paths.begin(), changed_paths.end(), [&texture](const std::string &path) {
+                    return std::find(texture.file_names.begin(),
+                                     texture.file_names.end(),
+                                     path) != texture.file_names.end();
+                });
+            if (is_affected)
+            {
+                LOG("Reloading texture %s\n", texture.file_names[0].c_str());
+                queue(texture.texture,
+                      texture.target,
+                      texture.file_names,
+                      texture.flip_vertically,
+                      texture.generate_mipmap,
+                      {},
+                      true /* is_reload */);
+            }
+        }
+    }
+
+    /**
+     * @brief Queue a texture to be decoded and uploaded.
+     *
+     * @param texture OpenGL texture ID.
+     * @param target Target of the texture.
+     * @param file_names Images to load.
+     * @param flip_vertically Whether to flip the images so the first row is the bottom.
+     * @param generate_mipmap Whether to generate mipmaps after uploading.
+     * @param on_loaded Called after the texture has been uploaded, may be empty.
+     * @param is_reload Whether the texture was loaded before.
+     */
+    void TextureLoader::queue(const GLuint texture,
+                              const GLenum target,
+                              std::vector<std::string> file_names,
+                              const bool flip_vertically,
+                              const bool generate_mipmap,
+                              Callback on_loaded,
+                              const bool is_reload)
+    {
+        std::unique_ptr<Job> job = std::make_unique<Job>();
+        job->texture = texture;
+        job->target = target;
+        job->file_names = std::move(file_names);
+        job->flip_vertically = flip_vertically;
+        job->generate_mipmap = generate_mipmap;
+        job->on_loaded = std::move(on_loaded);
+        job->is_reload = is_reload;
+        job->images.resize(job->file_names.size());
+        job->num_remaining = job->file_names.size();
+        job->failed = false;
+
+        JobSystem &job_system = JobSystem::get();
+        for (size_t i = 0; i < job->file_names.size(); i++)
+        {
+            job_system.run_background(
+                [this, pending_job = job.get(), i]() { decode(*pending_job, i); },
+                &decode_counter);
+        }
+
+        jobs.push_back(std::move(job));
+    }
+
+    /**
+     * @brief Upload textures whose images have all been decoded, until the per-frame budget
+     * is spent. Must be called from the GL thread.
+     */
+    void TextureLoader::update()
+    {
+        size_t uploaded_bytes = 0;
+        while (uploaded_bytes < upload_budget_bytes)
+        {
+            Job *job;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (likely(ready_queue.empty()))
+                {
+                    break;
+                }
+                job = ready_queue.front();
+                ready_queue.pop_front();
+            }
+
+            uploaded_bytes += upload(*job);
+
+            jobs.erase(std::find_if(
+                jobs.begin(), jobs.end(), [job](const std::unique_ptr<Job> &pending_job) {
+                    return pending_job.get() == job;
+                }));
+        }
+    }
+
+    /**
+     * @brief Decode one image of a job.
+     *
+     * @param job Job the image belongs to.
+     * @param image_idx Index of the image in the job.
+     */
+    void TextureLoader::decode(Job &job, const size_t image_idx)
+    {
+        if (unlikely(is_stopping))
+        {
+            return;
+        }
+
+        Image &image = job.images[image_idx];
+        const std::string &file_name = job.file_names[image_idx];
+
+        stbi_set_flip_vertically_on_load_thread(job.flip_vertically);
+        image.pixels = {
+            stbi_load(file_name.c_str(), &image.width, &image.height, &image.channels, 0),
+            stbi_image_free,
+        };
+        if (unlikely(!image.pixels))
+        {
+            LOG_ERROR("Failed to decode %s: %s\n", file_name.c_str(), stbi_failure_reason());
+            job.failed = true;
+        }
+
+        /*
+         * Whoever decodes the last image hands the job over to the GL thread.
+         */
+        if (job.num_remaining.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready_queue.push_back(&job);
+        }
+    }
+
+    /**
+     * @brief Upload the images of a job into its texture.
+     *
+     * All images are copied into the pixel buffer, which is orphaned first so that the
+     * copy never waits on a previous upload, and the texture is then specified from it.
+     *
+     * @param job Job to upload.
+     *
+     * @return Number of bytes uploaded.
+     */
+    size_t TextureLoader::upload(Job &job)
+    {
+        if (unlikely(job.failed))
+        {
+            LOG_ERROR("Keeping %s for texture %x\n",
+                      job.is_reload ? "old image" : "placeholder",
+                      job.texture);
+            return 0;
+        }
+
+        if (job.is_reload && !matches_texture(job))
+        {
+            LOG_WARN("Size of %s changed, restart to load it\n", job.file_names[0].c_str());
+            return 0;
+        }
+
+        std::vector<size_t> offsets;
+        size_t size = 0;
+        for (const Image &image : job.images)
+        {
+            offsets.push_back(size);
+            size += static_cast<size_t>(image.width) * image.height * image.channels;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        uint8_t *const staging = static_cast<uint8_t *>(glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        if (unlikely(staging == nullptr))
+        {
+            LOG_ERROR("Failed to map pixel buffer of %zu bytes\n", size);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return 0;
+        }
+
+        for (size_t i = 0; i < job.images.size(); i++)
+        {
+            const Image &image = job.images[i];
+            std::memcpy(staging + offsets[i],
+                        image.pixels.get(),
+                        static_cast<size_t>(image.width) * image.height * image.channels);
+        }
+        if (unlikely(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE))
+        {
+            /*
+             * The contents of the buffer were lost while it was mapped.
+             */
+            LOG_ERROR("Pixel buffer of %s was corrupted, keeping %s for texture %x\n",
+                      job.file_names[0].c_str(),
+                      job.is_reload ? "old image" : "placeholder",
+                      job.texture);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return 0;
+        }
+
+        glBindTexture(job.target, job.texture);
+        if (!job.is_reload)
+        {
+            glTexParameteriv(
+                job.target, GL_TEXTURE_SWIZZLE_RGBA, swizzles[job.images[0].channels - 1].data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t i = 0; i < job.images.size(); i++)
+        {
+            const Image &image = job.images[i];
+
+            const GLenum image_target = (job.target == GL_TEXTURE_CUBE_MAP)
+                                            ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+                                            : job.target;
+            const void *const pixels = reinterpret_cast<const void *>(offsets[i]);
+            if (job.is_reload)
+            {
+                glTexSubImage2D(image_target,
+                                0,
+                                0,
+                                0,
+                                image.width,
+                                image.height,
+                                formats[image.channels - 1],
+                                GL_UNSIGNED_BYTE,
+                                pixels);
+            }
+            else
+            {
+                glTexImage2D(image_target,
+                             0,
+                             internal_formats[image.channels - 1],
+                             image.width,
+                             image.height,
+                             0,
+                             formats[image.channels - 1],
+                             GL_UNSIGNED_BYTE,
+                             pixels);
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (job.generate_mipmap)
+        {
+            glGenerateMipmap(job.target);
+        }
+
+        if (job.on_loaded)
+        {
+            job.on_loaded(job.images[0].width, job.images[0].height);
+        }
+
+        if (!job.is_reload)
+        {
+            loaded.push_back({
+                .texture = job.texture,
+                .target = job.target,
+                .file_names = job.file_names,
+                .flip_vertically = job.flip_vertically,
+                .generate_mipmap = job.generate_mipmap,
+            });
+        }
+
+        LOG("Loaded texture %s id: %x (%d x %d x %d)\n",
+            job.file_names[0].c_str(),
+            job.texture,
+            job.images[0].width,
+            job.images[0].height,
+            job.images[0].channels);
+
+        return size;
+    }
+
+    /**
+     * @brief Check that the images of a reload have the size and format of the images
+     * they replace.
+     *
+     * @param job Job to check.
+     *
+     * @return True if the images match the texture, otherwise false.
+     */
+    bool TextureLoader::matches_texture(const Job &job) const
+    {
+        glBindTexture(job.target, job.texture);
+        for (size_t i = 0; i < job.images.size(); i++)
+        {
+            const Image &image = job.images[i];
+            const GLenum image_target = (job.target == GL_TEXTURE_CUBE_MAP)
+                                            ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+                                            : job.target;
+
+            GLint width = 0;
+            GLint height = 0;
+            GLint internal_format = 0;
+            glGetTexLevelParameteriv(image_target, 0, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(image_target, 0, GL_TEXTURE_HEIGHT, &height);
+            glGetTexLevelParameteriv(
+                image_target, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+            if (width != image.width || height != image.height ||
+                static_cast<GLenum>(internal_format) != internal_formats[image.channels - 1])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+    /**
+     * @brief Loads textures in the background.
+     *
+     * Images are decoded in background jobs on the job system, one per image. Once all
+     * images of a texture are decoded, the GL thread uploads them through a pixel buffer
+     * object from update(), which is called once per frame and stops after a per-frame
+     * byte budget. Until then, the texture keeps whatever placeholder it was created with.
+     *
+     * Loaded textures are remembered, so that they can be loaded again when their files
+     * change. A texture may have a bindless handle by then, which freezes its storage, so a
+     * reloaded image replaces the old one in place and must have the same size and number
+     * of channels.
+     */
+    class TextureLoader
+    {
+    public:
+        /**
+         * @brief Called on the GL thread after a texture has been uploaded, with the size
+         * of its first image.
+         */
+        using Callback = std::function<void(const int width, const int height)>;
+
+        TextureLoader();
+
+        ~TextureLoader();
+
+        TextureLoader(const TextureLoader &) = delete;
+        TextureLoader &operator=(const TextureLoader &) = delete;
+
+        void init();
+
+        void load(const GLuint texture,
+                  const GLenum target,
+                  std::vector<std::string> file_names,
+                  const bool flip_vertically,
+                  const bool generate_mipmap,
+                  Callback on_loaded);
+
+        void reload(const std::vector<std::string> &changed_paths);
+
+        void update();
+
+        /**
+         * @return Number of textures which have not been uploaded yet.
+         */
+        size_t get_num_pending() const
+        {
+            return jobs.size();
+        }
+
+    private:
+        /**
+         * @brief Decoded image.
+         */
+        struct Image
+        {
+            std::unique_ptr<uint8_t, void (*)(void *)> pixels = {nullptr, nullptr};
+            int width;
+            int height;
+            int channels;
+        };
+
+        /**
+         * @brief A texture to load, made up of one image or, for a cubemap, one per face.
+         */
+        struct Job
+        {
+            GLuint texture;
+            GLenum target;
+            std::vector<std::string> file_names;
+            bool flip_vertically;
+            bool generate_mipmap;
+            Callback on_loaded;
+
+            /**
+             * Whether the texture was loaded before, so its images are replaced in place.
+             */
+            bool is_reload;
+
+            std::vector<Image> images;
+
+            /**
+             * Number of images still being decoded.
+             */
+            std::atomic<size_t> num_remaining;
+
+            std::atomic<bool> failed;
+        };
+
+        /**
+         * Number of bytes uploaded per frame after which update() stops. At least one
+         * texture is uploaded per frame regardless, so large ones still make progress.
+         */
+        static constexpr size_t upload_budget_bytes = 16 << 20;
+
+        /**
+         * @brief A texture which was loaded, so that it can be loaded again.
+         */
+        struct Loaded
+        {
+            GLuint texture;
+            GLenum target;
+            std::vector<std::string> file_names;
+            bool flip_vertically;
+            bool generate_mipmap;
+        };
+
+        void queue(const GLuint texture,
+                   const GLenum target,
+                   std::vector<std::string> file_names,
+                   const bool flip_vertically,
+                   const bool generate_mipmap,
+                   Callback on_loaded,
+                   const bool is_reload);
+
+        void decode(Job &job, const size_t image_idx);
+
+        bool matches_texture(const Job &job) const;
+
+        size_t upload(Job &job);
+
+        /**
+         * Jobs which have not been uploaded yet. Only accessed by the GL thread.
+         */
+        std::vector<std::unique_ptr<Job>> jobs;
+
+        /**
+         * Textures which were loaded. Only accessed by the GL thread.
+         */
+        std::vector<Loaded> loaded;
+
+        /**
+         * State shared with the decode jobs.
+         * @{
+         */
+        JobSystem::Counter decode_counter;
+        std::atomic<bool> is_stopping;
+        std::mutex mutex;
+        std::deque<Job *> ready_queue;
+        /**
+         * @}
+         */
+
+        /**
+         * Pixel unpack buffer the images are staged in.
+         */
+        GLuint pixel_buffer;
+    };
+}
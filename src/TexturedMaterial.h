@@ -11,6 +11,17 @@ namespace Engine
     class TexturedMaterial: public Texture
     {
     public:
+        /**
+         * @brief Handles to the material uniforms (u_material) of one shader.
+         */
+        struct Uniforms
+        {
+            Shader::Uniform<glm::vec3> ambient;
+            Shader::Uniform<glm::vec3> diffuse;
+            Shader::Uniform<glm::vec3> specular;
+            Shader::Uniform<float> shininess;
+        };
+
         TexturedMaterial(const glm::vec3 &_ambient,
                          const glm::vec3 &_diffuse,
                          const glm::vec3 &_specular,
@@ -19,30 +30,85 @@ namespace Engine
         {}
 
         /**
-         * @brief Apply the material properties and texture to the given shader.
+         * @brief Get the handles to the material uniforms of the given shader.
          *
-         * @param shader Shader to apply the material to.
+         * @param shader Shader to get the uniforms of.
+         * @param[out] uniforms Material uniform handles.
          *
          * @return True on success, otherwise false.
          */
-        bool apply(Shader &shader) const
+        static bool get_uniforms(Shader &shader, Uniforms &uniforms)
         {
-            Texture::use();
-
-            ASSERT_RET_IF_NOT(shader.set_vec3("u_material.ambient", ambient), false);
-            ASSERT_RET_IF_NOT(shader.set_vec3("u_material.diffuse", diffuse), false);
-            ASSERT_RET_IF_NOT(shader.set_vec3("u_material.specular", specular), false);
-            ASSERT_RET_IF_NOT(shader.set_float("u_material.shininess", shininess), false);
+            ASSERT_RET_IF_NOT(shader.get_uniform("u_material.ambient", uniforms.ambient), false);
+            ASSERT_RET_IF_NOT(shader.get_uniform("u_material.diffuse", uniforms.diffuse), false);
+            ASSERT_RET_IF_NOT(shader.get_uniform("u_material.specular", uniforms.specular), false);
+            ASSERT_RET_IF_NOT(shader.get_uniform("u_material.shininess", uniforms.shininess),
+                              false);
 
             return true;
         }
 
+        /**
+         * @brief Apply the material properties and texture to the given shader, which must
+         * be in use.
+         *
+         * @param shader Shader to apply the material to.
+         * @param uniforms Handles to the material uniforms of @p shader.
+         */
+        void apply(const Shader &shader, const Uniforms &uniforms) const
+        {
+            Texture::use();
+            set_uniforms(shader, uniforms);
+        }
+
+        /**
+         * @brief Apply the material properties and texture to the given shader, which must
+         * be in use, skipping the texture bind if it is already bound.
+         *
+         * @param shader Shader to apply the material to.
+         * @param uniforms Handles to the material uniforms of @p shader.
+         * @param state Tracked GL state.
+         */
+        void apply(const Shader &shader, const Uniforms &uniforms, GLState &state) const
+        {
+            Texture::use(state);
+            set_uniforms(shader, uniforms);
+        }
+
         /**
          * @brief Do not allow callers to use the texture without applying the material.
          */
         void use() const = delete;
 
+        const glm::vec3 &get_ambient() const
+        {
+            return ambient;
+        }
+
+        const glm::vec3 &get_diffuse() const
+        {
+            return diffuse;
+        }
+
+        const glm::vec3 &get_specular() const
+        {
+            return specular;
+        }
+
+        float get_shininess() const
+        {
+            return shininess;
+        }
+
     private:
+        void set_uniforms(const Shader &shader, const Uniforms &uniforms) const
+        {
+            shader.set(uniforms.ambient, ambient);
+            shader.set(uniforms.diffuse, diffuse);
+            shader.set(uniforms.specular, specular);
+            shader.set(uniforms.shininess, shininess);
+        }
+
         /**
          * Ambient color of the material.
          */
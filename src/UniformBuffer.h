@@ -0,0 +1,61 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+namespace Engine
+{
+    /**
+     * @brief Uniform buffer object holding one std140 uniform block, bound to a fixed binding
+     * point which shaders declare with layout(std140, binding = N).
+     *
+     * @tparam Block C++ mirror of the uniform block. Its layout must match std140, i.e.
+     * vec3 members have to be padded out to vec4.
+     */
+    template <typename Block>
+    class UniformBuffer
+    {
+    public:
+        UniformBuffer(): buffer_id(0), binding(0)
+        {}
+
+        /**
+         * @brief Create the buffer and bind it to a binding point.
+         *
+         * @param _binding Uniform block binding point.
+         */
+        void create(const GLuint _binding)
+        {
+            binding = _binding;
+
+            glGenBuffers(1, &buffer_id);
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer_id);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer_id);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        /**
+         * @brief Replace the contents of the block with a single buffer update.
+         *
+         * @param block New contents.
+         */
+        void update(const Block &block) const
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer_id);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+        }
+
+        /**
+         * @return The uniform block binding point.
+         */
+        GLuint get_binding() const
+        {
+            return binding;
+        }
+
+    private:
+        GLuint buffer_id;
+        GLuint binding;
+    };
+}
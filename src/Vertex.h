@@ -2,6 +2,8 @@
 
 #include "VertexArray.h"
 
+#include <cstdint>
+#include <glm/gtc/type_precision.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
@@ -26,6 +28,31 @@ namespace Engine
     };
     static_assert(sizeof(Vertex3dNormal) == 6 * sizeof(float));
 
+    /**
+     * @brief Compact terrain vertex, decoded by shaders/include/terrain_vertex.glsl.
+     *
+     * The position is given by grid indices within the chunk of the vertex, the chunk itself
+     * being known from the base vertex it is drawn with. The height is quantized over the
+     * height range of the terrain and the normal is octahedral encoded.
+     */
+    struct TerrainVertex
+    {
+        glm::u8vec2 chunk_position;
+        uint16_t height;
+        glm::i16vec2 normal;
+
+        static void setup_vertex_array_attribs(VertexArray &vertex_array)
+        {
+            vertex_array.setup_vertex_attrib(
+                0, &TerrainVertex::chunk_position, VertexArray::AttribFormat::INTEGER);
+            vertex_array.setup_vertex_attrib(
+                1, &TerrainVertex::height, VertexArray::AttribFormat::NORMALIZED);
+            vertex_array.setup_vertex_attrib(
+                2, &TerrainVertex::normal, VertexArray::AttribFormat::NORMALIZED);
+        }
+    };
+    static_assert(sizeof(TerrainVertex) == 8);
+
     struct TexturedVertex3d
     {
         glm::vec3 position;
@@ -4,33 +4,97 @@
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <cstdint>
+#include <type_traits>
 
 namespace Engine
 {
     class VertexArray: public Renderer::Drawable
     {
     public:
-        VertexArray(): vertex_array_id(0)
+        /**
+         * @brief How the components of a vertex attribute reach the shader.
+         */
+        enum class AttribFormat
+        {
+            /**
+             * Converted to float as is, e.g. float components or integers used as floats.
+             */
+            FLOAT,
+
+            /**
+             * Integers mapped to [0, 1] if unsigned or [-1, 1] if signed.
+             */
+            NORMALIZED,
+
+            /**
+             * Kept as integers, for int and uint shader inputs.
+             */
+            INTEGER,
+        };
+
+        VertexArray(): vertex_array_id(0), vertex_buffer_id(0), num_vertices(0)
         {}
 
         /**
-         * @brief Create a vertex array object.
+         * @brief Create a vertex array object. Any previously created one is destroyed.
          *
          * @param vertices Vertices.
          * @param _num_vertices Number of vertices in the vertex array.
+         * @param usage Usage hint of the vertex buffer. Geometry which is rewritten every
+         * frame should rather be sourced from a StreamBuffer.
          */
         template <typename Vertex>
-        void create(const Vertex *vertices, const size_t _num_vertices)
+        void create(const Vertex *vertices,
+                    const size_t _num_vertices,
+                    const GLenum usage = GL_STATIC_DRAW)
         {
+            destroy();
+
             num_vertices = _num_vertices;
             glGenVertexArrays(1, &vertex_array_id);
 
             bind();
 
-            GLuint buffer_id;
-            glGenBuffers(1, &buffer_id);
-            glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * _num_vertices, vertices, GL_STATIC_DRAW);
+            glGenBuffers(1, &vertex_buffer_id);
+            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * _num_vertices, vertices, usage);
+        }
+
+        /**
+         * @brief Overwrite a range of the vertex buffer in place.
+         *
+         * @param vertices Vertices.
+         * @param count Number of vertices.
+         * @param first Index of the first vertex to overwrite. The range must lie within the
+         * vertices the vertex array was created with.
+         */
+        template <typename Vertex>
+        void update(const Vertex *vertices, const size_t count, const size_t first = 0) const
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id);
+            glBufferSubData(
+                GL_ARRAY_BUFFER, sizeof(Vertex) * first, sizeof(Vertex) * count, vertices);
+        }
+
+        /**
+         * @brief Free the vertex array object and its vertex buffer.
+         */
+        void destroy()
+        {
+            if (vertex_buffer_id != 0)
+            {
+                glDeleteBuffers(1, &vertex_buffer_id);
+                vertex_buffer_id = 0;
+            }
+
+            if (vertex_array_id != 0)
+            {
+                glDeleteVertexArrays(1, &vertex_array_id);
+                vertex_array_id = 0;
+            }
+
+            num_vertices = 0;
         }
 
         /**
@@ -44,53 +108,137 @@ namespace Engine
         }
 
         /**
-         * @brief Setup a vertex attribute pointer.
+         * @brief Setup a vertex attribute pointer. The component type and count are taken
+         * from the member, which is either a scalar or a vector of scalars, e.g. a glm
+         * vector.
          *
          * @tparam Vertex Vertex structure type.
          * @tparam Member Member type.
          *
          * @param idx Attribute index.
          * @param member Pointer to member in vertex structure.
+         * @param format How the components reach the shader. Float members can only be
+         * AttribFormat::FLOAT.
          */
         template <typename Vertex, typename Member>
-        void setup_vertex_attrib(const GLuint idx, const Member Vertex::*member)
+        void setup_vertex_attrib(const GLuint idx,
+                                 const Member Vertex::*member,
+                                 const AttribFormat format = AttribFormat::FLOAT)
         {
+            using Component = typename AttribComponent<Member>::type;
+            static_assert(sizeof(Member) % sizeof(Component) == 0);
+
             const GLuint attrib_start_offset = offset_of(member);
-            const GLuint attrib_end_offset = attrib_start_offset + sizeof(Member);
-            const GLuint attrib_size = sizeof(float);
-            const GLuint attrib_count = (attrib_end_offset - attrib_start_offset) / attrib_size;
-            glVertexAttribPointer(idx,
-                                  attrib_count,
-                                  GL_FLOAT,
-                                  GL_FALSE,
-                                  sizeof(Vertex),
-                                  reinterpret_cast<GLvoid *>(attrib_start_offset));
+            const GLint attrib_count = sizeof(Member) / sizeof(Component);
+            const GLvoid *const pointer = reinterpret_cast<GLvoid *>(attrib_start_offset);
+            if (format == AttribFormat::INTEGER)
+            {
+                glVertexAttribIPointer(
+                    idx, attrib_count, gl_type<Component>(), sizeof(Vertex), pointer);
+            }
+            else
+            {
+                glVertexAttribPointer(idx,
+                                      attrib_count,
+                                      gl_type<Component>(),
+                                      format == AttribFormat::NORMALIZED ? GL_TRUE : GL_FALSE,
+                                      sizeof(Vertex),
+                                      pointer);
+            }
             glEnableVertexAttribArray(idx);
         }
 
-        /**
-         * @brief Bind the vertex array object.
-         */
-        void bind() const
+        GLuint get_vertex_array_id() const override
         {
-            glBindVertexArray(vertex_array_id);
+            return vertex_array_id;
         }
 
         /**
          * @brief Draw the vertex array.
          */
-        void draw() const override
+        void draw_bound() const override
         {
-            bind();
             glDrawArrays(GL_TRIANGLES, 0, num_vertices);
         }
 
+        /**
+         * @brief Draw instances of the vertex array.
+         *
+         * @param instance_count Number of instances to draw.
+         * @param base_instance First instance to fetch per-instance attributes for.
+         */
+        void draw_instanced_bound(const GLsizei instance_count,
+                                  const GLuint base_instance) const override
+        {
+            glDrawArraysInstancedBaseInstance(
+                GL_TRIANGLES, 0, num_vertices, instance_count, base_instance);
+        }
+
     private:
+        /**
+         * @brief Component type of a vertex attribute member, either the member itself if
+         * it is a scalar or the value type of the vector it is.
+         */
+        template <typename Member, bool = std::is_arithmetic_v<Member>>
+        struct AttribComponent
+        {
+            using type = Member;
+        };
+
+        template <typename Member>
+        struct AttribComponent<Member, false>
+        {
+            using type = typename Member::value_type;
+        };
+
+        /**
+         * @return OpenGL type of a vertex attribute component.
+         */
+        template <typename Component>
+        static constexpr GLenum gl_type()
+        {
+            if constexpr (std::is_same_v<Component, float>)
+            {
+                return GL_FLOAT;
+            }
+            else if constexpr (std::is_same_v<Component, int8_t>)
+            {
+                return GL_BYTE;
+            }
+            else if constexpr (std::is_same_v<Component, uint8_t>)
+            {
+                return GL_UNSIGNED_BYTE;
+            }
+            else if constexpr (std::is_same_v<Component, int16_t>)
+            {
+                return GL_SHORT;
+            }
+            else if constexpr (std::is_same_v<Component, uint16_t>)
+            {
+                return GL_UNSIGNED_SHORT;
+            }
+            else if constexpr (std::is_same_v<Component, int32_t>)
+            {
+                return GL_INT;
+            }
+            else
+            {
+                static_assert(std::is_same_v<Component, uint32_t>,
+                              "unsupported vertex attribute component type");
+                return GL_UNSIGNED_INT;
+            }
+        }
+
         /**
          * OpenGL vertex array object ID.
          */
         GLuint vertex_array_id;
 
+        /**
+         * OpenGL buffer ID of the vertices.
+         */
+        GLuint vertex_buffer_id;
+
         /**
          * Number of vertices in the vertex array.
          */
@@ -0,0 +1,199 @@
+#include "Microbench.h"
+
+#include "../log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#ifndef GIT_COMMIT
+#define GIT_COMMIT "unknown"
+#endif
+
+namespace Engine::Microbench
+{
+    namespace
+    {
+        /**
+         * @brief A registered benchmark.
+         */
+        struct Entry
+        {
+            const char *name;
+            Function function;
+            std::vector<int64_t> args;
+        };
+
+        /**
+         * @return All registered benchmarks. A function-local static, so that it exists
+         * before the registrations of other translation units run.
+         */
+        std::vector<Entry> &get_benchmarks()
+        {
+            static std::vector<Entry> benchmarks;
+            return benchmarks;
+        }
+
+        /**
+         * Iterations are never increased beyond this, however fast the benchmark.
+         */
+        constexpr uint64_t max_iterations = 1000000000;
+
+        /**
+         * @brief Run a benchmark with an argument, growing the number of iterations until
+         * a run takes at least the minimum time, and print the last run.
+         *
+         * @param benchmark Benchmark to run.
+         * @param name Name of the benchmark and its argument.
+         * @param arg Argument to run it with.
+         * @param min_time_ns Minimum wall time of the measured run.
+         */
+        void run(const Entry &benchmark,
+                 const std::string &name,
+                 const int64_t arg,
+                 const uint64_t min_time_ns)
+        {
+            uint64_t num_iterations = 1;
+            while (true)
+            {
+                State state(arg, num_iterations);
+                benchmark.function(state);
+
+                if (!state.get_skip_reason().empty())
+                {
+                    std::printf("%-48s skipped: %s\n",
+                                name.c_str(),
+                                state.get_skip_reason().c_str());
+                    return;
+                }
+
+                const uint64_t wall_ns = state.get_wall_ns();
+                if (wall_ns >= min_time_ns || num_iterations >= max_iterations)
+                {
+                    const double ns_per_iteration =
+                        static_cast<double>(wall_ns) / num_iterations;
+                    const double cpu_ns_per_iteration =
+                        static_cast<double>(state.get_cpu_ns()) / num_iterations;
+                    std::printf("%-48s %13.0f ns %13.0f ns %12llu",
+                                name.c_str(),
+                                ns_per_iteration,
+                                cpu_ns_per_iteration,
+                                static_cast<unsigned long long>(num_iterations));
+                    if (state.get_num_items_per_iteration() > 0 && wall_ns > 0)
+                    {
+                        const double items_per_second = state.get_num_items_per_iteration() *
+                                                        1e9 / ns_per_iteration;
+                        std::printf(" %10.2fM items/s", items_per_second / 1e6);
+                    }
+                    std::printf("\n");
+                    return;
+                }
+
+                /*
+                 * Aim for the minimum time with some margin, growing at least 2x and at
+                 * most 10x per attempt like Google Benchmark does.
+                 */
+                const double multiplier =
+                    wall_ns == 0 ? 10.0 : 1.4 * static_cast<double>(min_time_ns) / wall_ns;
+                const double clamped_multiplier = multiplier < 2.0    ? 2.0
+                                                  : multiplier > 10.0 ? 10.0
+                                                                      : multiplier;
+                num_iterations = std::min<uint64_t>(
+                    max_iterations, static_cast<uint64_t>(num_iterations * clamped_multiplier));
+            }
+        }
+    }
+
+    /**
+     * @brief Register a benchmark.
+     *
+     * @param name Name of the benchmark.
+     * @param function Benchmark function.
+     * @param args Arguments to run the function with once each, or none to run it once
+     * with 0.
+     */
+    Registration::Registration(const char *name,
+                               const Function function,
+                               std::vector<int64_t> args)
+    {
+        if (args.empty())
+        {
+            args.push_back(0);
+        }
+        get_benchmarks().push_back({name, function, std::move(args)});
+    }
+}
+
+using namespace Engine::Microbench;
+
+/**
+ * Longest minimum time a benchmark may be asked to run for, which keeps it representable
+ * in nanoseconds.
+ */
+static constexpr double max_min_time_s = 3600.0;
+
+int main(int argc, char **argv)
+{
+    const char *filter = nullptr;
+    double min_time_s = 0.5;
+    for (int i = 1; i < argc; i++)
+    {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--filter") == 0 && has_value)
+        {
+            filter = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--min-time") == 0 && has_value)
+        {
+            const char *const arg = argv[++i];
+            char *end;
+            min_time_s = std::strtod(arg, &end);
+            if (end == arg || *end != '\0' || !std::isfinite(min_time_s) ||
+                !(min_time_s > 0.0) || min_time_s > max_min_time_s)
+            {
+                LOG_ERROR("Invalid minimum time %s, expected more than 0 and at most %.0f "
+                          "seconds\n",
+                          arg,
+                          max_min_time_s);
+                LOG("Usage: %s [--filter <substring>] [--min-time <seconds>]\n", argv[0]);
+                return -1;
+            }
+        }
+        else
+        {
+            LOG_ERROR("Unknown or incomplete argument %s\n", argv[i]);
+            LOG("Usage: %s [--filter <substring>] [--min-time <seconds>]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    std::printf("Micro-benchmarks (commit %s)\n", GIT_COMMIT);
+    std::printf("%-48s %16s %16s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    std::printf("%s\n", std::string(95, '-').c_str());
+
+    const uint64_t min_time_ns = static_cast<uint64_t>(min_time_s * 1e9);
+    for (const Entry &benchmark : get_benchmarks())
+    {
+        for (const int64_t arg : benchmark.args)
+        {
+            std::string name = benchmark.name;
+            if (benchmark.args.size() > 1 || arg != 0)
+            {
+                name += "/" + std::to_string(arg);
+            }
+
+            if (filter != nullptr && name.find(filter) == std::string::npos)
+            {
+                continue;
+            }
+
+            run(benchmark, name, arg, min_time_ns);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace Engine::Microbench
+{
+    /**
+     * @brief Timing state of one run of a benchmark, in the style of Google Benchmark.
+     *
+     * A benchmark function does its setup, then loops while keep_running() returns true,
+     * running the code under test once per iteration. The runner calls the function with
+     * more and more iterations until a run takes long enough to be measured reliably.
+     */
+    class State
+    {
+    public:
+        State(const int64_t _arg, const uint64_t _num_iterations):
+            arg(_arg), num_iterations(_num_iterations), num_iterations_left(_num_iterations),
+            num_items_per_iteration(0), is_started(false), is_timing(false), wall_ns(0),
+            cpu_ns(0)
+        {}
+
+        /**
+         * @return True while there are iterations left to run, otherwise false. Timing
+         * starts with the first call and stops with the last.
+         */
+        bool keep_running()
+        {
+            if (!is_started)
+            {
+                is_started = true;
+                resume_timing();
+            }
+            if (num_iterations_left == 0)
+            {
+                pause_timing();
+                return false;
+            }
+            num_iterations_left--;
+            return true;
+        }
+
+        /**
+         * @brief Stop the clocks, e.g. to reset the input between iterations.
+         */
+        void pause_timing()
+        {
+            if (is_timing)
+            {
+                wall_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - wall_begin)
+                               .count();
+                cpu_ns += get_process_cpu_ns() - cpu_begin_ns;
+                is_timing = false;
+            }
+        }
+
+        /**
+         * @brief Start the clocks again after pause_timing().
+         */
+        void resume_timing()
+        {
+            is_timing = true;
+            cpu_begin_ns = get_process_cpu_ns();
+            wall_begin = std::chrono::steady_clock::now();
+        }
+
+        /**
+         * @param _num_items_per_iteration Number of items, such as vertices or queries,
+         * processed per iteration, for reporting throughput.
+         */
+        void set_items_per_iteration(const uint64_t _num_items_per_iteration)
+        {
+            num_items_per_iteration = _num_items_per_iteration;
+        }
+
+        /**
+         * @param reason Why the benchmark cannot run, reported instead of timings.
+         */
+        void skip(const std::string &reason)
+        {
+            skip_reason = reason;
+            num_iterations_left = 0;
+        }
+
+        /**
+         * @return Argument the benchmark is run with, such as the heightmap size.
+         */
+        int64_t get_arg() const
+        {
+            return arg;
+        }
+
+        uint64_t get_num_iterations() const
+        {
+            return num_iterations;
+        }
+
+        uint64_t get_num_items_per_iteration() const
+        {
+            return num_items_per_iteration;
+        }
+
+        const std::string &get_skip_reason() const
+        {
+            return skip_reason;
+        }
+
+        uint64_t get_wall_ns() const
+        {
+            return wall_ns;
+        }
+
+        /**
+         * @return CPU time of the whole process, so that work done on the job system
+         * counts too.
+         */
+        uint64_t get_cpu_ns() const
+        {
+            return cpu_ns;
+        }
+
+    private:
+        static uint64_t get_process_cpu_ns()
+        {
+            timespec time;
+            clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+            return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+        }
+
+        int64_t arg;
+        uint64_t num_iterations;
+        uint64_t num_iterations_left;
+        uint64_t num_items_per_iteration;
+        std::string skip_reason;
+
+        bool is_started;
+        bool is_timing;
+        std::chrono::steady_clock::time_point wall_begin;
+        uint64_t cpu_begin_ns;
+        uint64_t wall_ns;
+        uint64_t cpu_ns;
+    };
+
+    using Function = void (*)(State &state);
+
+    /**
+     * @brief Registers a benchmark at static initialization, to be run once with each of
+     * its arguments.
+     */
+    class Registration
+    {
+    public:
+        Registration(const char *name, const Function function, std::vector<int64_t> args);
+    };
+
+    /**
+     * @brief Keep the compiler from optimizing away the computation of a value.
+     *
+     * @param value Value to keep.
+     */
+    template <typename T>
+    inline void do_not_optimize(const T &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /**
+     * @brief Keep the compiler from assuming memory is unchanged across this point.
+     */
+    inline void clobber_memory()
+    {
+        asm volatile("" : : : "memory");
+    }
+}
+
+/**
+ * @brief Register a benchmark function, optionally with a list of arguments to run it with.
+ */
+#define MICROBENCH(function, ...)                                                         \
+    static const Engine::Microbench::Registration microbench_registration_##function(    \
+        #function, function, {__VA_ARGS__})
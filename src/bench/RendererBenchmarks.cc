@@ -0,0 +1,147 @@
+#include "../Renderer.h"
+#include "../Shader.h"
+#include "Microbench.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Benchmarks of the per-object work of the renderer.
+ */
+
+namespace Engine::Microbench
+{
+    namespace
+    {
+        /**
+         * Number of transforms built per iteration.
+         */
+        constexpr size_t num_transforms = 1024;
+
+        /**
+         * @brief A hidden window whose context is current, shared by all benchmarks needing
+         * GL and kept until exit.
+         *
+         * @return True if the context is current, otherwise false.
+         */
+        bool make_context_current()
+        {
+            static GLFWwindow *window = nullptr;
+            static bool is_tried = false;
+            if (is_tried)
+            {
+                return window != nullptr;
+            }
+            is_tried = true;
+
+            if (glfwInit() != GLFW_TRUE)
+            {
+                return false;
+            }
+
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            window = glfwCreateWindow(1, 1, "microbench", nullptr, nullptr);
+            if (window == nullptr)
+            {
+                glfwTerminate();
+                return false;
+            }
+
+            glfwMakeContextCurrent(window);
+            if (glewInit() != GLEW_OK)
+            {
+                glfwDestroyWindow(window);
+                glfwTerminate();
+                window = nullptr;
+                return false;
+            }
+
+            return true;
+        }
+
+        void Transform_model(State &state)
+        {
+            std::vector<Renderer::Transform> transforms(num_transforms);
+            for (size_t i = 0; i < num_transforms; i++)
+            {
+                const float t = static_cast<float>(i);
+                transforms[i] = {
+                    .position = glm::vec3(t, 0.5f * t, -t),
+                    .rotation = glm::vec3(0.001f * t, 0.002f * t, 0.003f * t),
+                    .scale = glm::vec3(1.f + 0.01f * t),
+                };
+            }
+
+            std::vector<glm::mat4> models(num_transforms);
+            state.set_items_per_iteration(num_transforms);
+            while (state.keep_running())
+            {
+                for (size_t i = 0; i < num_transforms; i++)
+                {
+                    models[i] = transforms[i].model();
+                }
+                do_not_optimize(models.data());
+                clobber_memory();
+            }
+        }
+        MICROBENCH(Transform_model);
+
+        void Shader_get_uniform_location(State &state)
+        {
+            if (!make_context_current())
+            {
+                state.skip("no GL context");
+                return;
+            }
+
+            static Shader shader;
+            static bool is_compiled = shader.compile({
+                {"terrain.vert", GL_VERTEX_SHADER},
+                {"terrain.frag", GL_FRAGMENT_SHADER},
+            });
+            if (!is_compiled)
+            {
+                state.skip("failed to compile shaders/terrain.{vert,frag}");
+                return;
+            }
+
+            /*
+             * Names are made once, to time the lookup rather than building the strings.
+             */
+            std::vector<std::string> uniform_names;
+            for (const char *const uniform_name : {"u_model",
+                                                   "u_texture_sampler",
+                                                   "u_normal_map_sampler",
+                                                   "u_shadow_map_sampler",
+                                                   "u_material.ambient",
+                                                   "u_material.diffuse",
+                                                   "u_material.specular",
+                                                   "u_material.shininess"})
+            {
+                GLint location;
+                if (shader.get_uniform_location(uniform_name, location))
+                {
+                    uniform_names.emplace_back(uniform_name);
+                }
+            }
+
+            state.set_items_per_iteration(uniform_names.size());
+            while (state.keep_running())
+            {
+                for (const std::string &uniform_name : uniform_names)
+                {
+                    GLint location;
+                    do_not_optimize(shader.get_uniform_location(uniform_name, location));
+                    do_not_optimize(location);
+                }
+            }
+        }
+        MICROBENCH(Shader_get_uniform_location);
+    }
+}
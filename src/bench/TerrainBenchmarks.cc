@@ -0,0 +1,232 @@
+#include "../Heightmap.h"
+#include "../TerrainHeightField.h"
+#include "../TerrainMesh.h"
+#include "Microbench.h"
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * Benchmarks of building the terrain from a heightmap and of querying its height, at
+ * several heightmap sizes.
+ */
+
+namespace Engine::Microbench
+{
+    namespace
+    {
+        /**
+         * Scale and bottom the terrain is generated with, as in Game.
+         * @{
+         */
+        constexpr float y_scale = 64.f / 0xFF;
+        constexpr float y_bottom = -27.f;
+        /**
+         * @}
+         */
+
+        /**
+         * Number of points queried per iteration by the height field benchmarks.
+         */
+        constexpr size_t num_query_points = 4096;
+
+        /**
+         * @brief Make a square heightmap of rolling hills with some noise on top, the same
+         * for every run.
+         *
+         * @param size Number of rows and columns.
+         *
+         * @return Pixels of the heightmap.
+         */
+        std::vector<uint8_t> make_pixels(const int size)
+        {
+            std::vector<uint8_t> pixels(static_cast<size_t>(size) * size);
+            uint32_t random = 12345;
+            for (int row = 0; row < size; row++)
+            {
+                for (int col = 0; col < size; col++)
+                {
+                    random = random * 1664525 + 1013904223;
+                    const float hills = std::sin(row * 0.02f) * std::cos(col * 0.03f);
+                    const float noise = static_cast<float>(random >> 24) / 0xFF - 0.5f;
+                    pixels[static_cast<size_t>(row) * size + col] =
+                        static_cast<uint8_t>(127.f + 100.f * hills + 20.f * noise);
+                }
+            }
+            return pixels;
+        }
+
+        /**
+         * @brief Make a heightmap and the terrain vertices generated from it.
+         *
+         * @param size Number of rows and columns.
+         * @param[out] heightmap Heightmap.
+         * @param[out] vertices Vertices of the terrain.
+         * @param[out] vertex_heights Height of every vertex.
+         */
+        void make_terrain(const int size,
+                          Heightmap &heightmap,
+                          std::vector<Vertex3dNormal> &vertices,
+                          std::vector<float> &vertex_heights)
+        {
+            const std::vector<uint8_t> pixels = make_pixels(size);
+            heightmap.create(pixels.data(), size, size, 1);
+            const float middle = size / 2.f;
+            heightmap.generate_vertices(
+                glm::vec3(-middle, y_bottom, -middle), y_scale, vertices, vertex_heights);
+        }
+
+        /**
+         * @brief Make a height field over a terrain and points on it to query, spread over
+         * the whole grid.
+         *
+         * @param size Number of rows and columns.
+         * @param[out] height_field Height field.
+         * @param[out] xs X coordinates of the points.
+         * @param[out] zs Z coordinates of the points.
+         */
+        void make_height_field(const int size,
+                               TerrainHeightField &height_field,
+                               std::vector<float> &xs,
+                               std::vector<float> &zs)
+        {
+            Heightmap heightmap;
+            std::vector<Vertex3dNormal> vertices;
+            std::vector<float> vertex_heights;
+            make_terrain(size, heightmap, vertices, vertex_heights);
+
+            const float middle = size / 2.f;
+            height_field.create(std::move(vertex_heights), size, size, middle, middle);
+
+            xs.resize(num_query_points);
+            zs.resize(num_query_points);
+            uint32_t random = 67890;
+            for (size_t i = 0; i < num_query_points; i++)
+            {
+                random = random * 1664525 + 1013904223;
+                xs[i] = (static_cast<float>(random >> 8) / (1 << 24) - 0.5f) * (size - 1);
+                random = random * 1664525 + 1013904223;
+                zs[i] = (static_cast<float>(random >> 8) / (1 << 24) - 0.5f) * (size - 1);
+            }
+        }
+
+        void Heightmap_blur(State &state)
+        {
+            const int size = state.get_arg();
+            const std::vector<uint8_t> pixels = make_pixels(size);
+            Heightmap heightmap;
+            heightmap.create(pixels.data(), size, size, 1);
+
+            state.set_items_per_iteration(pixels.size());
+            while (state.keep_running())
+            {
+                heightmap.blur(1);
+                clobber_memory();
+            }
+        }
+        MICROBENCH(Heightmap_blur, 256, 512, 1024, 2048);
+
+        void Heightmap_generate_vertices(State &state)
+        {
+            const int size = state.get_arg();
+            const std::vector<uint8_t> pixels = make_pixels(size);
+            Heightmap heightmap;
+            heightmap.create(pixels.data(), size, size, 1);
+            const float middle = size / 2.f;
+
+            std::vector<Vertex3dNormal> vertices;
+            std::vector<float> vertex_heights;
+            state.set_items_per_iteration(pixels.size());
+            while (state.keep_running())
+            {
+                heightmap.generate_vertices(
+                    glm::vec3(-middle, y_bottom, -middle), y_scale, vertices, vertex_heights);
+                do_not_optimize(vertices.data());
+                clobber_memory();
+            }
+        }
+        MICROBENCH(Heightmap_generate_vertices, 256, 512, 1024, 2048);
+
+        void TerrainMesh_build(State &state)
+        {
+            const int size = state.get_arg();
+            Heightmap heightmap;
+            std::vector<Vertex3dNormal> vertices;
+            std::vector<float> vertex_heights;
+            make_terrain(size, heightmap, vertices, vertex_heights);
+
+            state.set_items_per_iteration(vertices.size());
+            while (state.keep_running())
+            {
+                TerrainMesh::Geometry geometry;
+                TerrainMesh::build(vertices.data(), size, size, geometry);
+                do_not_optimize(geometry.vertices.data());
+                clobber_memory();
+            }
+        }
+        MICROBENCH(TerrainMesh_build, 256, 512, 1024, 2048);
+
+        void TerrainHeightField_get_height(State &state)
+        {
+            TerrainHeightField height_field;
+            std::vector<float> xs;
+            std::vector<float> zs;
+            make_height_field(state.get_arg(), height_field, xs, zs);
+
+            state.set_items_per_iteration(num_query_points);
+            while (state.keep_running())
+            {
+                for (size_t i = 0; i < num_query_points; i++)
+                {
+                    do_not_optimize(height_field.get_height(xs[i], zs[i]));
+                }
+            }
+        }
+        MICROBENCH(TerrainHeightField_get_height, 256, 1024, 2048);
+
+        void TerrainHeightField_get_heights(State &state)
+        {
+            TerrainHeightField height_field;
+            std::vector<float> xs;
+            std::vector<float> zs;
+            make_height_field(state.get_arg(), height_field, xs, zs);
+
+            std::vector<float> heights(num_query_points);
+            state.set_items_per_iteration(num_query_points);
+            while (state.keep_running())
+            {
+                height_field.get_heights(xs.data(), zs.data(), num_query_points, heights.data());
+                clobber_memory();
+            }
+        }
+        MICROBENCH(TerrainHeightField_get_heights, 256, 1024, 2048);
+
+        void TerrainHeightField_get_normals(State &state)
+        {
+            TerrainHeightField height_field;
+            std::vector<float> xs;
+            std::vector<float> zs;
+            make_height_field(state.get_arg(), height_field, xs, zs);
+
+            std::vector<float> normal_xs(num_query_points);
+            std::vector<float> normal_ys(num_query_points);
+            std::vector<float> normal_zs(num_query_points);
+            std::vector<float> slopes(num_query_points);
+            state.set_items_per_iteration(num_query_points);
+            while (state.keep_running())
+            {
+                height_field.get_normals(xs.data(),
+                                         zs.data(),
+                                         num_query_points,
+                                         normal_xs.data(),
+                                         normal_ys.data(),
+                                         normal_zs.data(),
+                                         slopes.data());
+                clobber_memory();
+            }
+        }
+        MICROBENCH(TerrainHeightField_get_normals, 256, 1024, 2048);
+    }
+}
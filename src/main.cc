@@ -2,20 +2,165 @@
 #include "assert_util.h"
 #include "log.h"
 
+#include <cctype>
+#include <cmath>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
 #ifndef GIT_COMMIT
 #define GIT_COMMIT "unknown"
 #endif
 
-int main()
+using namespace Engine;
+
+/**
+ * Largest number of chasers accepted on the command line.
+ */
+static constexpr unsigned long max_num_chasers = 1000000;
+
+/**
+ * Largest number of frames a benchmark may be asked to measure.
+ */
+static constexpr unsigned long max_benchmark_frames = 1000000;
+
+/**
+ * Smallest frame budget, in milliseconds, accepted on the command line. DynamicResolution
+ * does not go below it either.
+ */
+static constexpr float min_frame_budget_ms = 1.0f;
+
+/**
+ * @brief Parse a count given on the command line.
+ *
+ * @param arg Argument to parse.
+ * @param min Smallest count accepted.
+ * @param max Largest count accepted.
+ * @param[out] count Parsed count.
+ *
+ * @return True if the argument is a decimal number in [min, max], otherwise false.
+ */
+static bool parse_count(const char *arg,
+                        const unsigned long min,
+                        const unsigned long max,
+                        unsigned long &count)
+{
+    /*
+     * strtoul() takes an empty string as zero, skips leading whitespace and wraps negative
+     * numbers around, so only digits are let through.
+     */
+    if (!std::isdigit(static_cast<unsigned char>(arg[0])))
+    {
+        return false;
+    }
+
+    char *end;
+    errno = 0;
+    count = std::strtoul(arg, &end, 10);
+    return *end == '\0' && errno == 0 && count >= min && count <= max;
+}
+
+/**
+ * @brief Parse the command line.
+ *
+ * @param argc Number of arguments.
+ * @param argv Arguments.
+ * @param[out] options Options to fill in.
+ *
+ * @return True on success, otherwise false.
+ */
+static bool parse_args(const int argc, char **argv, Game::Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--stats-csv") == 0 && has_value)
+        {
+            options.stats.export_format = FrameStats::ExportFormat::CSV;
+            options.stats.export_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--stats-trace") == 0 && has_value)
+        {
+            options.stats.export_format = FrameStats::ExportFormat::TRACE;
+            options.stats.export_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--chasers") == 0 && has_value)
+        {
+            unsigned long num_chasers;
+            if (!parse_count(argv[++i], 0, max_num_chasers, num_chasers))
+            {
+                LOG_ERROR("Invalid number of chasers %s, expected at most %lu\n",
+                          argv[i],
+                          max_num_chasers);
+                return false;
+            }
+            options.num_chasers = num_chasers;
+        }
+        else if (std::strcmp(argv[i], "--benchmark") == 0 && has_value)
+        {
+            unsigned long num_frames;
+            if (!parse_count(argv[++i], 1, max_benchmark_frames, num_frames))
+            {
+                LOG_ERROR("Invalid number of benchmark frames %s, expected 1 to %lu\n",
+                          argv[i],
+                          max_benchmark_frames);
+                return false;
+            }
+            options.benchmark.num_frames = num_frames;
+        }
+        else if (std::strcmp(argv[i], "--benchmark-report") == 0 && has_value)
+        {
+            options.benchmark.report_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--camera-path") == 0 && has_value)
+        {
+            options.benchmark.camera_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--record-camera-path") == 0 && has_value)
+        {
+            options.record_camera_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--frame-budget") == 0 && has_value)
+        {
+            char *end;
+            const float frame_budget_ms = std::strtof(argv[++i], &end);
+            if (end == argv[i] || *end != '\0' || !std::isfinite(frame_budget_ms) ||
+                frame_budget_ms < min_frame_budget_ms)
+            {
+                LOG_ERROR("Invalid frame budget %s, expected at least %.0f ms\n",
+                          argv[i],
+                          min_frame_budget_ms);
+                return false;
+            }
+            options.frame_budget_ms = frame_budget_ms;
+        }
+        else
+        {
+            LOG_ERROR("Unknown or incomplete argument %s\n", argv[i]);
+            LOG("Usage: %s [--stats-csv <path> | --stats-trace <path>] [--chasers <count>]\n"
+                "       [--benchmark <frames> [--benchmark-report <path>]"
+                " [--camera-path <path>]]\n"
+                "       [--record-camera-path <path>] [--frame-budget <ms>]\n",
+                argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
 {
     LOG("Starting game (commit %s)\n", GIT_COMMIT);
 
-    using namespace Engine;
+    Game::Options options;
+    if (!parse_args(argc, argv, options))
+    {
+        return -1;
+    }
 
-    std::unique_ptr<Game> game = Game::create();
+    std::unique_ptr<Game> game = Game::create(options);
     ASSERT_RET_IF_NOT(game, -1);
 
-    game->run();
-
-    return 0;
-}
\ No newline at end of file
+    return game->run() ? 0 : -1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace Engine
+{
+    /**
+     * @brief Split the range [begin, end) into contiguous sub-ranges and call
+     * func(sub_begin, sub_end) on each of them on the job system. The range is split into a
+     * few sub-ranges per thread so that threads which finish early can steal the rest. The
+     * calling thread takes the last sub-range and helps with the others. Returns once all
+     * sub-ranges are done.
+     *
+     * @param begin Start of the range.
+     * @param end End of the range, exclusive.
+     * @param func Function taking the start and end of a sub-range.
+     * @param min_chunk_size Smallest sub-range worth a job of its own. Ranges no larger than
+     * this are run directly on the calling thread.
+     */
+    template <typename Func>
+    void parallel_for(const size_t begin,
+                      const size_t end,
+                      Func &&func,
+                      const size_t min_chunk_size = 1)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+
+        static constexpr size_t chunks_per_thread = 4;
+
+        JobSystem &job_system = JobSystem::get();
+        const size_t count = end - begin;
+        const size_t max_num_chunks = (job_system.get_num_workers() + 1) * chunks_per_thread;
+        const size_t num_chunks =
+            std::clamp<size_t>(count / std::max<size_t>(1, min_chunk_size), 1, max_num_chunks);
+        if (num_chunks == 1)
+        {
+            func(begin, end);
+            return;
+        }
+
+        JobSystem::Counter counter;
+
+        const size_t count_per_chunk = count / num_chunks;
+        const size_t remainder = count % num_chunks;
+        size_t sub_begin = begin;
+        for (size_t i = 0; i < num_chunks - 1; i++)
+        {
+            const size_t sub_end = sub_begin + count_per_chunk + (i < remainder ? 1 : 0);
+            job_system.run([&func, sub_begin, sub_end]() { func(sub_begin, sub_end); },
+                           &counter);
+            sub_begin = sub_end;
+        }
+
+        func(sub_begin, end);
+
+        job_system.wait(counter);
+    }
+}